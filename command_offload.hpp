@@ -0,0 +1,93 @@
+#ifndef COMMAND_OFFLOAD_HPP
+#define COMMAND_OFFLOAD_HPP
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "command_processor.hpp"
+#include "entry_manager.hpp"
+#include "src/thread_pool.hpp"
+
+/*
+Worker offload for multiplexed connections (MULTIPLEX in connection.hpp). A command that would hold up the
+poll loop runs on the server's thread pool instead, and its response is tagged with its request id and sent
+whenever it's ready. Requests the client pipelined behind it are answered in the meantime.
+
+Only commands CommandProcessor::is_offloadable() names qualify: the ones that never touch the keyspace.
+EntryManager is built for the poll loop thread alone, so GET, SET and friends run inline on the loop even in
+multiplexed mode. Being on the loop is what keeps them fast.
+
+The poll loop submits work with submit(), onto the pool the server was started with. A worker runs the
+command, queues a Completion and signals event_fd(), which the loop polls alongside the sockets. On a signal
+the loop calls drain() and hands each Completion to its connection. Completions name a connection by fd and Connection::id(). When the connection
+closed while its command ran, the id doesn't match and the response is dropped. State that workers touch
+lives in a shared_ptr that each task holds, so tasks still queued when the server goes away are harmless.
+*/
+
+class CommandOffload {
+public:
+    struct Completion {
+        int fd;
+        uint32_t connection;                // Connection::id()
+        uint32_t request_id;
+        std::vector<uint8_t> response;      // serialized, without the length and id
+    };
+
+    explicit CommandOffload(ThreadPool& pool) : pool_(pool), state_(std::make_shared<State>()) {}
+
+    CommandOffload(const CommandOffload&) = delete;
+    CommandOffload& operator=(const CommandOffload&) = delete;
+
+    // poll it for POLLIN: completions are waiting
+    [[nodiscard]] int event_fd() const noexcept { return state_->event_fd; }
+
+    // commands currently on a worker or waiting for one
+    [[nodiscard]] size_t in_flight() const noexcept { return state_->in_flight.load(std::memory_order_relaxed); }
+
+    void submit(EntryManager& entry_manager, int fd, uint32_t connection, uint32_t request_id,
+                std::vector<std::string> args) {
+        state_->in_flight.fetch_add(1, std::memory_order_relaxed);
+        (void)pool_.enqueue([state = state_, &entry_manager, fd, connection, request_id, args = std::move(args)] {
+            Completion done{fd, connection, request_id, {}};
+            CommandProcessor::process_command({args, done.response, entry_manager, fd});
+            {
+                std::lock_guard lock(state->mutex);
+                state->done.push_back(std::move(done));
+            }
+            state->in_flight.fetch_sub(1, std::memory_order_relaxed);
+            uint64_t one = 1;
+            (void)!::write(state->event_fd, &one, sizeof(one));
+        });
+    }
+
+    // everything finished since the last call; poll loop only
+    std::vector<Completion> drain() {
+        uint64_t count;
+        (void)!::read(state_->event_fd, &count, sizeof(count));
+        std::vector<Completion> out;
+        std::lock_guard lock(state_->mutex);
+        out.swap(state_->done);
+        return out;
+    }
+
+private:
+    struct State {
+        State() : event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+        ~State() { ::close(event_fd); }
+
+        int event_fd;
+        std::mutex mutex;
+        std::vector<Completion> done;
+        std::atomic<size_t> in_flight{0};
+    };
+
+    ThreadPool& pool_;
+    std::shared_ptr<State> state_;
+};
+
+#endif // COMMAND_OFFLOAD_HPP
@@ -11,11 +11,21 @@
 #include <algorithm>
 #include <utility>
 #include <mutex>        
+#include <atomic>
+#include <thread>       // std::this_thread::sleep_for
+#include <cmath>         // std::isnan
 #include "src/hashtable.hpp"
 #include "src/heap.hpp"
 #include "src/zset.hpp"
 #include "entry_manager.hpp"
 #include "response_serializer.hpp"
+#include "src/raft/replica_directory.hpp"
+#include "src/stats/hot_keys.hpp"
+#include "src/stats/command_stats.hpp"
+#include "src/stats/slow_log.hpp"
+#include "src/stats/request_trace.hpp"
+#include "src/stats/lock_profiler.hpp"
+#include "src/stats/traffic_capture.hpp"
 
 constexpr int ERR_ARG = -1;
 constexpr int ERR_UNKNOWN = -2;
@@ -29,10 +39,16 @@ public:
         const std::vector<std::string>& args;
         std::vector<uint8_t>& response;
         EntryManager& entry_manager;
+        int client_fd = -1;             // the requesting connection, for SLOWLOG; -1 if none
+        RequestTrace* trace = nullptr;  // stamped around the handler when the request is sampled
     };
 
     static const std::unordered_map<std::string, std::function<void(CommandContext)>> command_handlers;
 
+    // DEBUG answers only when the server was started with --enable-debug on: a client could otherwise park the
+    // poll loop for a minute with one DEBUG SLEEP on a connection that doesn't offload
+    static inline std::atomic<bool> debug_enabled{false};
+
     static void process_command(CommandContext ctx) {
         if (ctx.args.empty()) { 
             return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "empty command\n");
@@ -41,15 +57,65 @@ public:
         std::string command_key = ctx.args[0]; 
         std::transform(command_key.begin(), command_key.end(), command_key.begin(), ::tolower);
 
-        auto it = command_handlers.find(command_key);
-        if (it == command_handlers.end()) { 
+        const auto& table = dispatch_table();
+        auto it = table.find(command_key);
+        if (it == table.end()) { 
             return ResponseSerializer::serialize_error(ctx.response, ERR_UNKNOWN, "unknown command\n");
         }
 
-        it->second(ctx);
+        const Dispatch& dispatch = it->second;
+        if (ctx.args.size() > 1 && dispatch.keyed) {
+            HotKeys::instance().observe(ctx.args[1]);
+        }
+        if (ctx.trace) {
+            ctx.trace->command_id = static_cast<uint32_t>(dispatch.stats_id);
+            ctx.trace->stamp(RequestTrace::HandlerEnter);
+        }
+        CommandStats& stats = CommandStats::instance();
+        SlowLog& slow_log = SlowLog::instance();
+        if (!stats.enabled() && !slow_log.enabled()) {
+            (*dispatch.handler)(ctx);
+        } else {
+            uint64_t start = CommandStats::now();
+            (*dispatch.handler)(ctx);
+            uint64_t ticks = CommandStats::now() - start;
+            if (stats.enabled()) {
+                stats.record(dispatch.stats_id, ticks);
+            }
+            slow_log.maybe_record(dispatch.stats_id, ctx.args, ticks, ctx.client_fd);
+        }
+        if (ctx.trace) {
+            ctx.trace->stamp(RequestTrace::HandlerExit);
+        }
+    }
+
+    // can `command` (lower case) run off the poll loop: it never touches the keyspace, so a worker can run
+    // it while the loop serves other requests (see command_offload.hpp)
+    static bool is_offloadable(std::string_view command) {
+        return command == "debug" || command == "info" || command == "latency" || command == "slowlog" ||
+               command == "hotkeys" || command == "replicas" || command == "lockstats";
     }
 
 private:
+    // command_handlers plus each command's CommandStats id and whether args[1] is a key, so dispatch stays
+    // one lookup
+    struct Dispatch {
+        const std::function<void(CommandContext)>* handler;
+        size_t stats_id;
+        bool keyed;
+    };
+
+    static const std::unordered_map<std::string, Dispatch>& dispatch_table() {
+        static const auto table = [] {
+            std::unordered_map<std::string, Dispatch> t;
+            for (const auto& [name, handler] : command_handlers) {
+                t.emplace(name, Dispatch{&handler, CommandStats::instance().id(name), is_keyed(name)});
+            }
+            return t;
+        }();
+        return table;
+    }
+
     static void handle_get(CommandContext ctx) {
         if (ctx.args.size() != 2) { 
             return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "GET requires one key\n");
@@ -171,6 +237,30 @@ private:
         bool success = ctx.entry_manager.set_entry_ttl(*entry, ttl_ms);
         ResponseSerializer::serialize_integer(ctx.response, success ? 1 : 0);
     }
+
+    // PEXPIREAT key <unix ms>: the replication stream's form of PEXPIRE, so a replica doesn't restart the TTL
+    // when it applies it (see ReplicationPrimary::write). a deadline already past deletes the key.
+    static void handle_pexpireat(CommandContext ctx) {
+        if (ctx.args.size() != 3) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "PEXPIREAT requires key and deadline\n");
+        }
+
+        int64_t deadline_ms;
+        if (!parse_int(ctx.args[2], deadline_ms) || deadline_ms < 0) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid deadline value\n");
+        }
+
+        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
+        if (!entry) {
+            ResponseSerializer::serialize_integer(ctx.response, 0);
+            return;
+        }
+
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        bool success = ctx.entry_manager.set_entry_ttl(*entry, std::max<int64_t>(deadline_ms - now_ms, 0));
+        ResponseSerializer::serialize_integer(ctx.response, success ? 1 : 0);
+    }
     
     
 
@@ -192,6 +282,188 @@ private:
     
     
 
+    // one line per replica: "<id> <address> <role> <applied_idx> <lag>", for clients picking where to read
+    static void handle_replicas(CommandContext ctx) {
+        if (ctx.args.size() != 1) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "REPLICAS takes no arguments\n");
+        }
+        ResponseSerializer::serialize_string(ctx.response, ReplicaDirectory::instance().describe());
+    }
+
+    // HOTKEYS [n]: the n (default 10) most requested keys, one "<key> <est count> <rate/s> <error>" line each
+    static void handle_hotkeys(CommandContext ctx) {
+        if (ctx.args.size() > 2) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "HOTKEYS takes at most a count\n");
+        }
+        int64_t n = 10;
+        if (ctx.args.size() == 2 && (!parse_int(ctx.args[1], n) || n <= 0)) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid count\n");
+        }
+        if (HotKeys::instance().sample_rate() == 0) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "hot key tracking is disabled\n");
+        }
+        ResponseSerializer::serialize_string(ctx.response, HotKeys::instance().describe(static_cast<size_t>(n)));
+    }
+
+    // INFO [stats|commandstats]: counters in INFO line format, every section without an argument
+    static void handle_info(CommandContext ctx) {
+        if (ctx.args.size() > 2) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "INFO takes at most a section\n");
+        }
+        std::string section = ctx.args.size() == 2 ? to_lower(ctx.args[1]) : "";
+        if (section == "all" || section == "everything") {
+            section.clear();
+        }
+        if (!section.empty() && section != "stats" && section != "commandstats") {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "unknown INFO section\n");
+        }
+        ResponseSerializer::serialize_string(ctx.response, CommandStats::instance().info(section));
+    }
+
+    // LATENCY [command]: call count, throughput and p50/p99/p999/max per command; LATENCY RESET starts over
+    static void handle_latency(CommandContext ctx) {
+        if (ctx.args.size() > 2) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "LATENCY takes at most a command\n");
+        }
+        std::string command = ctx.args.size() == 2 ? to_lower(ctx.args[1]) : "";
+        if (command == "reset") {
+            CommandStats::instance().reset();
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        if (!command.empty() && !command_handlers.contains(command)) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "unknown command\n");
+        }
+        ResponseSerializer::serialize_string(ctx.response, CommandStats::instance().latency(command));
+    }
+
+    // SLOWLOG GET [n] | LEN | RESET. GET lists the n (default 10) newest slow commands, newest first, one
+    // "<id> <unix time us> <duration us> <client fd> <args...>" line each
+    static void handle_slowlog(CommandContext ctx) {
+        std::string sub = ctx.args.size() >= 2 ? to_lower(ctx.args[1]) : "";
+        SlowLog& slow_log = SlowLog::instance();
+        if (sub == "len" && ctx.args.size() == 2) {
+            return ResponseSerializer::serialize_string(ctx.response, std::to_string(slow_log.size()));
+        }
+        if (sub == "reset" && ctx.args.size() == 2) {
+            slow_log.reset();
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        if (sub != "get" || ctx.args.size() > 3) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "usage: SLOWLOG GET [n] | LEN | RESET\n");
+        }
+        int64_t n = 10;
+        if (ctx.args.size() == 3 && (!parse_int(ctx.args[2], n) || n <= 0)) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid count\n");
+        }
+        std::string out;
+        for (const auto& record : slow_log.get(static_cast<size_t>(n))) {
+            out += std::to_string(record.id) + ' ' + std::to_string(record.timestamp_us) + ' ' +
+                   std::to_string(record.duration_us) + ' ' + std::to_string(record.client_fd);
+            for (const auto& arg : record.args) {
+                out += ' ';
+                out += arg;
+            }
+            out += '\n';
+        }
+        ResponseSerializer::serialize_string(ctx.response, out);
+    }
+
+    // TRACE SAMPLE <n> (trace 1 in n requests per thread, 0 stops) | DUMP (Chrome trace-event JSON of what's
+    // buffered) | RESET
+    static void handle_trace(CommandContext ctx) {
+        std::string sub = ctx.args.size() >= 2 ? to_lower(ctx.args[1]) : "";
+        RequestTracer& tracer = RequestTracer::instance();
+        if (sub == "sample" && ctx.args.size() == 3) {
+            int64_t n = 0;
+            if (!parse_int(ctx.args[2], n) || n < 0 || n > UINT32_MAX) {
+                return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid sample rate\n");
+            }
+            tracer.configure({.sample_rate = static_cast<uint32_t>(n)});
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        if (sub == "dump" && ctx.args.size() == 2) {
+            return ResponseSerializer::serialize_string(ctx.response, tracer.dump());
+        }
+        if (sub == "reset" && ctx.args.size() == 2) {
+            tracer.clear();
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "usage: TRACE SAMPLE <n> | DUMP | RESET\n");
+    }
+
+    // LOCKSTATS [RESET]: per lock site acquisitions, contention, wait and hold times since the last reset, most
+    // total wait first. Only in builds with -DVECTORDB_LOCK_PROFILING
+    static void handle_lockstats(CommandContext ctx) {
+        if (!LockProfiler::compiled_in()) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG,
+                                                       "lock profiling not compiled in (-DVECTORDB_LOCK_PROFILING)\n");
+        }
+        if (ctx.args.size() == 2 && to_lower(ctx.args[1]) == "reset") {
+            LockProfiler::instance().reset();
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        if (ctx.args.size() != 1) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "usage: LOCKSTATS [RESET]\n");
+        }
+        ResponseSerializer::serialize_string(ctx.response, LockProfiler::instance().report());
+    }
+
+    // CAPTURE START <name> [max_mb] | STOP | STATUS: record incoming requests for tests/traffic_replay.cpp.
+    // <name> is a new file in the server's --capture-dir, never a path
+    static void handle_capture(CommandContext ctx) {
+        std::string sub = ctx.args.size() >= 2 ? to_lower(ctx.args[1]) : "";
+        TrafficCapture& capture = TrafficCapture::instance();
+        if (sub == "start" && (ctx.args.size() == 3 || ctx.args.size() == 4)) {
+            uint64_t max_bytes = TrafficCapture::Options{}.max_bytes;
+            int64_t mb = 0;
+            if (ctx.args.size() == 4) {
+                if (!parse_int(ctx.args[3], mb) || mb <= 0) {
+                    return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid size\n");
+                }
+                max_bytes = static_cast<uint64_t>(mb) << 20;
+            }
+            if (auto started = capture.start_named(ctx.args[2], max_bytes); !started) {
+                return ResponseSerializer::serialize_error(ctx.response, ERR_ARG,
+                                                           "capture failed: " + started.error().message() + "\n");
+            }
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        if (sub == "stop" && ctx.args.size() == 2) {
+            capture.stop();
+            return ResponseSerializer::serialize_string(ctx.response, "OK");
+        }
+        if (sub == "status" && ctx.args.size() == 2) {
+            auto st = capture.stats();
+            return ResponseSerializer::serialize_string(
+                ctx.response, std::string(st.enabled ? "capturing" : "stopped") + " path=" + st.path +
+                                  " records=" + std::to_string(st.records) + " bytes=" + std::to_string(st.bytes) +
+                                  " dropped=" + std::to_string(st.dropped));
+        }
+        ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "usage: CAPTURE START <name> [max_mb] | STOP | STATUS\n");
+    }
+
+    // DEBUG SLEEP <ms>: holds whichever thread runs it for ms, a stand-in for a long command in tests and
+    // benchmarks of head-of-line blocking. off unless debug_enabled
+    static void handle_debug(CommandContext ctx) {
+        if (!debug_enabled.load(std::memory_order_relaxed)) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "DEBUG is disabled (--enable-debug on)\n");
+        }
+        int64_t ms = 0;
+        if (ctx.args.size() != 3 || to_lower(ctx.args[1]) != "sleep" || !parse_int(ctx.args[2], ms) || ms < 0 ||
+            ms > 60000) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "usage: DEBUG SLEEP <ms>\n");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        ResponseSerializer::serialize_string(ctx.response, "OK");
+    }
+
+    // does args[1] name a key. an allowlist: a new command stays out of HOTKEYS until it is added here
+    static bool is_keyed(std::string_view command) {
+        return command == "get" || command == "set" || command == "del" || command == "exists" ||
+               command == "zadd" || command == "zrem" || command == "pexpire" || command == "pexpireat" ||
+               command == "pttl";
+    }
+
         // helper function to convert a string to lowercase safely
     static inline std::string to_lower(std::string_view str) {
         std::string result;
@@ -244,7 +516,17 @@ CommandProcessor::command_handlers = {
     {"zrem", handle_zrem},
     {"flushall", handle_flushall},
     {"pexpire", handle_pexpire},
-    {"pttl", handle_pttl}        
+    {"pexpireat", handle_pexpireat},
+    {"pttl", handle_pttl},
+    {"replicas", handle_replicas},
+    {"hotkeys", handle_hotkeys},
+    {"info", handle_info},
+    {"latency", handle_latency},
+    {"slowlog", handle_slowlog},
+    {"trace", handle_trace},
+    {"lockstats", handle_lockstats},
+    {"capture", handle_capture},
+    {"debug", handle_debug}
 };
 
 #endif
\ No newline at end of file
@@ -5,7 +5,11 @@
 #include <cstdint>      
 #include <type_traits>   
 #include <string>        
-#include <string_view>   
+#include <string_view>
+#include <array>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>   // _mm_crc32_u8, _mm_crc32_u64
+#endif
 
 /* fairly convoluted but container_of can help you move "backwards" in inheritance hierarchies or class containment to find the parent class or container.
 
@@ -44,5 +48,43 @@ constexpr SerializationType get_serialization_type() {
     }
 }
 
+// CRC-32C (Castagnoli) - checksums every record we put on disk. Uses the SSE4.2 crc32 instruction
+// when the compiler targets it, otherwise a byte-at-a-time table built at compile time.
+// Pass the previous result as `crc` to checksum a record in several pieces.
+
+inline constexpr std::array<uint32_t, 256> k_crc32c_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1; // reflected Castagnoli polynomial
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+[[nodiscard]] inline uint32_t crc32c(const void* data, std::size_t len, uint32_t crc = 0) noexcept {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if defined(__SSE4_2__)
+    uint64_t crc64 = crc;
+    for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), bytes += sizeof(uint64_t)) {
+        uint64_t word;
+        __builtin_memcpy(&word, bytes, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; len > 0; --len, ++bytes) {
+        crc = _mm_crc32_u8(crc, *bytes);
+    }
+#else
+    for (; len > 0; --len, ++bytes) {
+        crc = k_crc32c_table[(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+    }
+#endif
+    return ~crc;
+}
+
 
 #endif 
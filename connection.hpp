@@ -10,13 +10,21 @@
 #include <span>           
 #include <algorithm>      
 #include <unistd.h>       
+#include <sys/socket.h>
 #include <cerrno>         
 #include <mutex>          
+#include <memory>
+#include <strings.h>      
 #include "socket.hpp"               
 #include "request_parser.hpp"       
 #include "response_serializer.hpp"  
 #include "command_processor.hpp"   
 #include "entry_manager.hpp"        
+#include "src/replication/primary.hpp"
+#include "src/stats/traffic_capture.hpp"
+#include "command_offload.hpp"
+#include "src/transport/shm_ring.hpp"
+#include "src/transport/uring_backend.hpp"
 
 static constexpr size_t MAX_MSG_SIZE = 4096; 
 static constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(5000); 
@@ -34,46 +42,135 @@ using Result = std::expected<T, std::error_code>;
 
 class Connection {
     public:
-        Connection(Socket socket, EntryManager& entry_manager, CommandProcessor& processor)
+        // primary: writes also go down the replication stream. read_only: we're a replica, refuse writes.
+        // offload: where multiplexed connections send long commands; null runs everything inline.
+        Connection(Socket socket, EntryManager& entry_manager, CommandProcessor& processor,
+                   ReplicationPrimary* primary = nullptr, bool read_only = false, CommandOffload* offload = nullptr)
             : socket_(std::move(socket)), 
               entry_manager_(entry_manager), 
               command_processor_(processor),
+              primary_(primary),
+              read_only_(read_only),
+              offload_(offload),
               state_(ConnectionState::Request),
-              idle_start_(std::chrono::steady_clock::now()) {
+              idle_start_(std::chrono::steady_clock::now()),
+              capture_id_(TrafficCapture::instance().next_connection_id()) {
             rbuf_.reserve(MAX_MSG_SIZE);
             wbuf_.reserve(MAX_MSG_SIZE);
         }
+
+        ~Connection() {
+            if (TrafficCapture::instance().enabled()) {
+                TrafficCapture::instance().closed(capture_id_);
+            }
+            if (uring_) {
+                // the ring may still have sends queued on the fd; the backend closes it when they're done
+                (void)socket_.release();
+                uring_->release();
+            }
+        }
     
 
     [[nodiscard]] int fd() const noexcept { return socket_.get(); }  
     [[nodiscard]] ConnectionState state() const noexcept { return state_; }  
     [[nodiscard]] auto idle_start() const noexcept { return idle_start_; }  
+    // unique for the life of the process, unlike the fd
+    [[nodiscard]] uint32_t id() const noexcept { return capture_id_; }
+    
+    // a shared-memory client the server hasn't parked (ShmChannel::spinning): call process_io() again
+    // without waiting for poll()
+    [[nodiscard]] bool busy_polling() const noexcept { return shm_ && shm_->spinning(); }
+    // from now on the socket is read and written through the server's io_uring (src/transport/uring_backend.hpp)
+    void use_uring(UringChannel* channel) noexcept { uring_ = channel; }
     
     void update_idle_time() noexcept { idle_start_ = std::chrono::steady_clock::now(); } 
     Result<void> process_io();
+    // the response to an offloaded request is ready (see command_offload.hpp)
+    Result<void> complete(uint32_t request_id, std::span<const uint8_t> response);
 
 private:
     Socket socket_;  
     EntryManager& entry_manager_;  
     CommandProcessor& command_processor_;  
+    ReplicationPrimary* primary_;
+    bool read_only_;
+    CommandOffload* offload_;
     ConnectionState state_; 
     std::chrono::steady_clock::time_point idle_start_;  
     std::vector<uint8_t> rbuf_;  
     std::vector<uint8_t> wbuf_; 
     size_t wbuf_sent_{0};  
+    RequestTrace trace_;    // the sampled request in flight, if any (see src/stats/request_trace.hpp)
+    uint32_t capture_id_;   // this connection in traffic captures (see src/stats/traffic_capture.hpp)
+    bool same_read_{false}; // the next frame arrived in the same read as the previous one
+
+    // framed clients (length-prefixed binary requests, see RequestParser) and text clients share the port;
+    // a frame's first byte is the top byte of a length below MAX_MSG_SIZE, always 0, which no text command
+    // starts with. Decided on the first byte the connection sends.
+    enum class Protocol : uint8_t { Unknown, Text, Framed };
+    Protocol protocol_{Protocol::Unknown};
 
+    // MULTIPLEX: a framed client opts in with a request holding just that word, answered "OK" as usual.
+    // From then on every request frame carries a request id (a big-endian u32 right after the length, see
+    // RequestParser::parse_tagged) and every response is a native u32 length, the native u32 id, then the
+    // body; the length covers the id. Responses can then arrive out of order: offloadable commands run on a
+    // worker and answer when done, while everything after them is answered by the loop in the meantime.
+    bool multiplexed_{false};
+
+    // SHM [ring_bytes]: a framed client on the Unix socket moves its traffic to shared-memory rings (see
+    // src/transport/shm_ring.hpp). The "OK" carries the memfd; afterwards reads and writes go through shm_
+    // and the socket only rings the doorbell.
+    std::unique_ptr<ShmChannel> shm_;
+    UringChannel* uring_ = nullptr;     // owned by the server's UringBackend
+
+    // the socket, or whichever transport stands in for it
+    ssize_t io_read(uint8_t* out, size_t n);
+    ssize_t io_write(const uint8_t* in, size_t n);
+
+    bool start_shm(const std::vector<std::string>& cmd, size_t frame, std::vector<uint8_t>& response);
+    bool offloadable(const std::vector<std::string>& cmd) const;
+    void append_response(uint32_t request_id, std::span<const uint8_t> body);
+
+    Result<void> process_framed();
     Result<void> handle_request();
     Result<void> handle_response();
     Result<bool> try_fill_buffer();
     Result<bool> try_flush_buffer();
     Result<bool> try_process_request();
+    void execute(CommandProcessor::CommandContext ctx);
 };
 
+inline void Connection::execute(CommandProcessor::CommandContext ctx) {
+    if ((primary_ || read_only_) && !ctx.args.empty() && is_write_command(ctx.args[0])) {
+        if (read_only_) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "READONLY replica does not accept writes\n");
+        }
+        return primary_->write(ctx.args, [&] { command_processor_.process_command(ctx); });
+    }
+    command_processor_.process_command(ctx);
+}
+
 Result<void> Connection::process_io() {
+    if (protocol_ == Protocol::Unknown) {
+        uint8_t first;
+        ssize_t n = uring_ ? uring_->peek(&first) : recv(socket_.get(), &first, 1, MSG_PEEK);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return {};
+        }
+        if (n > 0) {
+            protocol_ = first == 0 ? Protocol::Framed : Protocol::Text;
+        }
+    }
+    if (protocol_ == Protocol::Framed) {
+        return process_framed();
+    }
+
     char buffer[1024] = {0};
-    ssize_t bytes_read = read(socket_.get(), buffer, sizeof(buffer) - 1);
+    RequestTracer::instance().begin(trace_, socket_.get());
+    ssize_t bytes_read = io_read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer) - 1);
 
     if (bytes_read > 0) {
+        trace_.stamp(RequestTrace::ReadEnd);
         buffer[bytes_read] = '\0';  
         std::string request(buffer);
         std::cout << " Received command: " << request << std::endl;
@@ -84,13 +181,20 @@ Result<void> Connection::process_io() {
         while (iss >> word) {
             args.push_back(word);
         }
+        trace_.stamp(RequestTrace::Parsed);
+        if (TrafficCapture::instance().enabled()) [[unlikely]] {
+            TrafficCapture::instance().record(capture_id_, args);
+        }
 
         std::vector<uint8_t> response;
-        CommandProcessor::CommandContext ctx{args, response, entry_manager_};  
-        command_processor_.process_command(ctx);
+        CommandProcessor::CommandContext ctx{args, response, entry_manager_, socket_.get(),
+                                             trace_.active ? &trace_ : nullptr};  
+        execute(ctx);
 
         std::string response_str(response.begin(), response.end());
-        ssize_t bytes_sent = write(socket_.get(), response_str.c_str(), response.size());
+        trace_.stamp(RequestTrace::Serialized);
+        ssize_t bytes_sent = io_write(response.data(), response.size());
+        RequestTracer::instance().finish(trace_);
 
         if (bytes_sent < 0) {
             std::cerr << " Write failed: " << strerror(errno) << std::endl;
@@ -111,6 +215,39 @@ Result<void> Connection::process_io() {
 
 
 
+inline ssize_t Connection::io_read(uint8_t* out, size_t n) {
+    if (shm_) {
+        return shm_->read(out, n);
+    }
+    return uring_ ? uring_->read(out, n) : read(socket_.get(), out, n);
+}
+
+inline ssize_t Connection::io_write(const uint8_t* in, size_t n) {
+    if (shm_) {
+        return shm_->write(in, n);
+    }
+    return uring_ ? uring_->write(in, n) : write(socket_.get(), in, n);
+}
+
+// reads and answers every complete frame available, pipelined ones included, then flushes what it can; the
+// server polls for POLLOUT while a flush is unfinished and doesn't read more until it is done
+inline Result<void> Connection::process_framed() {
+    if (state_ == ConnectionState::Request) {
+        if (auto r = handle_request(); !r) {
+            return r;
+        }
+    }
+    if (state_ == ConnectionState::Response) {
+        if (auto r = handle_response(); !r) {
+            return r;
+        }
+    }
+    if (state_ == ConnectionState::End) {
+        return std::unexpected(std::make_error_code(std::errc::connection_reset));
+    }
+    return {};
+}
+
 inline Result<void> Connection::handle_request() {
     while (true) {
         auto result = try_fill_buffer(); 
@@ -140,11 +277,17 @@ inline Result<void> Connection::handle_response() {
 inline Result<bool> Connection::try_fill_buffer() {
     assert(rbuf_.size() < MAX_MSG_SIZE); 
     
+    if (!trace_.active) {
+        RequestTracer::instance().begin(trace_, socket_.get());
+    }
+    // read straight into the vector's storage: size it up first, then trim to what arrived
+    size_t filled = rbuf_.size();
+    rbuf_.resize(MAX_MSG_SIZE);
     ssize_t rv;
     do {
-        size_t capacity = MAX_MSG_SIZE - rbuf_.size();
-        rv = read(socket_.get(), rbuf_.data() + rbuf_.size(), capacity);
+        rv = io_read(rbuf_.data() + filled, MAX_MSG_SIZE - filled);
     } while (rv < 0 && errno == EINTR);
+    rbuf_.resize(filled + static_cast<size_t>(std::max<ssize_t>(rv, 0)));
     
     if (rv < 0) {
         if (errno == EAGAIN) {
@@ -157,44 +300,90 @@ inline Result<bool> Connection::try_fill_buffer() {
         state_ = ConnectionState::End; 
         return false;
     }
-
-    rbuf_.resize(rbuf_.size() + rv);
+    trace_.stamp(RequestTrace::ReadEnd);
+    same_read_ = false;
     
-    while (try_process_request()) {} 
+    Result<bool> more;
+    do {
+        more = try_process_request();
+    } while (more && *more);
     
-    return true;
+    // answer this batch before reading the next
+    return state_ == ConnectionState::Request;
 }
 
 inline Result<bool> Connection::try_process_request() {
-    if (rbuf_.size() < sizeof(uint32_t)) {
-        return false; 
+    size_t frame = frame_size(rbuf_);
+    if (frame == 0) {
+        uint32_t len = 0;
+        if (rbuf_.size() >= sizeof(len)) {
+            std::memcpy(&len, rbuf_.data(), sizeof(len));
+        }
+        if (sizeof(len) + __builtin_bswap32(len) > MAX_MSG_SIZE) {
+            state_ = ConnectionState::End;  // would never fit in rbuf_
+        }
+        return false;   // wait for the rest of the frame
     }
     
-    auto parse_result = RequestParser::parse(std::span(rbuf_));
+    auto request = std::span(rbuf_).first(frame);
+    uint32_t request_id = 0;
+    Result<std::vector<std::string>> parse_result;
+    if (multiplexed_) {
+        auto tagged = RequestParser::parse_tagged(request);
+        if (tagged) {
+            request_id = tagged->first;
+            parse_result = std::move(tagged->second);
+        } else {
+            parse_result = std::unexpected(tagged.error());
+        }
+    } else {
+        parse_result = RequestParser::parse(request);
+    }
     if (!parse_result) {
         state_ = ConnectionState::End; 
         return false;
     }
+    trace_.stamp(RequestTrace::Parsed);
     
     auto& cmd = *parse_result;
-    
-    std::vector<uint8_t> response;
-    CommandProcessor::CommandContext ctx{
-        cmd, response, entry_manager_
-    };
-    
-    command_processor_.process_command(ctx);
-    
-    uint32_t wlen = static_cast<uint32_t>(response.size());
-    wbuf_.clear();
-    wbuf_.reserve(sizeof(wlen) + response.size());
-    ResponseSerializer::append_data(wbuf_, wlen);
-    wbuf_.insert(wbuf_.end(), response.begin(), response.end());
+    bool handshake = !multiplexed_ && cmd.size() == 1 && ::strcasecmp(cmd[0].c_str(), "multiplex") == 0;
+    bool shm = !multiplexed_ && !shm_ && !cmd.empty() && cmd.size() <= 2 && ::strcasecmp(cmd[0].c_str(), "shm") == 0;
 
-    state_ = ConnectionState::Response;
-    wbuf_sent_ = 0;
+    if (TrafficCapture::instance().enabled()) [[unlikely]] {
+        // replay speaks plain frames: multiplexed requests are stored as those, the handshake not at all
+        if (multiplexed_) {
+            TrafficCapture::instance().record(capture_id_, cmd);
+        } else if (!handshake && !shm) {
+            TrafficCapture::instance().record(capture_id_, request, same_read_);
+        }
+    }
+    same_read_ = true;
+
+    if (multiplexed_ && offload_ && offloadable(cmd)) {
+        offload_->submit(entry_manager_, socket_.get(), capture_id_, request_id, std::move(cmd));
+    } else {
+        std::vector<uint8_t> response;
+        if (handshake) {
+            ResponseSerializer::serialize_string(response, "OK");
+        } else if (shm) {
+            if (start_shm(cmd, frame, response)) {
+                rbuf_.clear();      // the "OK" went out with the memfd; the rings take over from here
+                return false;
+            }
+        } else {
+            CommandProcessor::CommandContext ctx{
+                cmd, response, entry_manager_, socket_.get(), trace_.active ? &trace_ : nullptr
+            };
+            execute(ctx);
+        }
+        // pipelined requests queue their responses behind each other's
+        append_response(request_id, response);
+        trace_.stamp(RequestTrace::Serialized);
+        state_ = ConnectionState::Response;
+        multiplexed_ = multiplexed_ || handshake;
+    }
     
-    size_t consumed = sizeof(uint32_t) + cmd.size();
+    size_t consumed = frame;
     if (consumed < rbuf_.size()) {
         std::copy(rbuf_.begin() + consumed, rbuf_.end(), rbuf_.begin());
         rbuf_.resize(rbuf_.size() - consumed);
@@ -205,12 +394,83 @@ inline Result<bool> Connection::try_process_request() {
     return rbuf_.size() >= sizeof(uint32_t);
 }
 
+// true once the client is on the rings; otherwise `response` holds the error to send over the socket
+inline bool Connection::start_shm(const std::vector<std::string>& cmd, size_t frame, std::vector<uint8_t>& response) {
+    sockaddr_storage local{};
+    socklen_t len = sizeof(local);
+    if (::getsockname(socket_.get(), reinterpret_cast<sockaddr*>(&local), &len) < 0 || local.ss_family != AF_UNIX) {
+        ResponseSerializer::serialize_error(response, ERR_ARG, "SHM needs a Unix socket connection\n");
+        return false;
+    }
+    // the rings are polled by the poll loop; under io_uring the socket belongs to the ring
+    if (uring_) {
+        ResponseSerializer::serialize_error(response, ERR_ARG, "SHM needs the poll I/O backend\n");
+        return false;
+    }
+    // nothing may be queued either way, or it would land on the wrong transport
+    if (!wbuf_.empty() || rbuf_.size() != frame) {
+        ResponseSerializer::serialize_error(response, ERR_ARG, "SHM must be the only request in flight\n");
+        return false;
+    }
+    size_t ring_bytes = 1u << 20;
+    if (cmd.size() == 2) {
+        char* end = nullptr;
+        ring_bytes = std::strtoull(cmd[1].c_str(), &end, 10);
+        if (cmd[1].empty() || *end != '\0') {
+            ResponseSerializer::serialize_error(response, ERR_ARG, "SHM ring size must be a number\n");
+            return false;
+        }
+    }
+    auto region = ShmRegion::create(ring_bytes);
+    if (!region) {
+        ResponseSerializer::serialize_error(response, ERR_ARG, "SHM could not create the rings\n");
+        return false;
+    }
+    std::vector<uint8_t> ok;
+    ResponseSerializer::serialize_string(ok, "OK");
+    std::vector<uint8_t> frame_out;
+    ResponseSerializer::append_data(frame_out, static_cast<uint32_t>(ok.size()));
+    frame_out.insert(frame_out.end(), ok.begin(), ok.end());
+    if (!send_with_fd(socket_.get(), frame_out, region->fd())) {
+        state_ = ConnectionState::End;
+        return true;
+    }
+    region->close_fd();
+    shm_ = std::make_unique<ShmChannel>(std::move(*region), socket_.get());
+    RequestTracer::instance().finish(trace_);
+    return true;
+}
+
+inline bool Connection::offloadable(const std::vector<std::string>& cmd) const {
+    if (cmd.empty()) {
+        return false;
+    }
+    std::string name = cmd[0];
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return CommandProcessor::is_offloadable(name);
+}
+
+inline void Connection::append_response(uint32_t request_id, std::span<const uint8_t> body) {
+    uint32_t wlen = static_cast<uint32_t>(body.size() + (multiplexed_ ? sizeof(request_id) : 0));
+    ResponseSerializer::append_data(wbuf_, wlen);
+    if (multiplexed_) {
+        ResponseSerializer::append_data(wbuf_, request_id);
+    }
+    wbuf_.insert(wbuf_.end(), body.begin(), body.end());
+}
+
+inline Result<void> Connection::complete(uint32_t request_id, std::span<const uint8_t> response) {
+    append_response(request_id, response);
+    state_ = ConnectionState::Response;
+    return handle_response();
+}
+
 inline Result<bool> Connection::try_flush_buffer() {
     while (wbuf_sent_ < wbuf_.size()) {
         ssize_t rv;
         do {
             size_t remain = wbuf_.size() - wbuf_sent_;
-            rv = write(socket_.get(), wbuf_.data() + wbuf_sent_, remain);
+            rv = io_write(wbuf_.data() + wbuf_sent_, remain);
         } while (rv < 0 && errno == EINTR);
         
         if (rv < 0) {
@@ -227,6 +487,7 @@ inline Result<bool> Connection::try_flush_buffer() {
         state_ = ConnectionState::Request; 
         wbuf_sent_ = 0;
         wbuf_.clear();
+        RequestTracer::instance().finish(trace_);
         return false;
     }
     
@@ -12,12 +12,20 @@
 #include <iostream>
 #include <type_traits>
 #include <mutex>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <string_view>
 #include "common.hpp"
 #include "response_serializer.hpp" 
 #include "src/heap.hpp"               
 #include "src/thread_pool.hpp"   
 #include "src/zset.hpp"             
 #include "src/hashtable.hpp"
+#include "src/storage/value_log.hpp"
+#include "src/cache/CountMinSketch.cpp"
 
 template <typename T>
 struct IsValidType : std::disjunction<
@@ -29,6 +37,21 @@ struct IsValidType : std::disjunction<
     std::is_same<T, std::unordered_set<std::string>>,        
     std::is_same<T, std::unique_ptr<ZSet>>> {};              
 
+// value types in IsValidType order, for per-type keyspace counts
+inline constexpr std::array<std::string_view, 7> k_entry_type_names{
+    "string", "int", "double", "list", "hash", "set", "zset"};
+
+template <typename T>
+constexpr size_t entry_type_index() {
+    if constexpr (std::is_same_v<T, std::string>) return 0;
+    else if constexpr (std::is_same_v<T, int64_t>) return 1;
+    else if constexpr (std::is_same_v<T, double>) return 2;
+    else if constexpr (std::is_same_v<T, std::vector<std::string>>) return 3;
+    else if constexpr (std::is_same_v<T, std::unordered_map<std::string, std::string>>) return 4;
+    else if constexpr (std::is_same_v<T, std::unordered_set<std::string>>) return 5;
+    else return 6;
+}
+
     inline uint64_t get_monotonic_usec() {
     return std::chrono::duration_cast<std::chrono::microseconds>(
                std::chrono::steady_clock::now().time_since_epoch())
@@ -39,8 +62,12 @@ class EntryBase {
 public:
     virtual ~EntryBase() = default;
     virtual void print() const = 0;
+    virtual size_t type_index() const = 0;      // position in k_entry_type_names
     size_t heap_idx = static_cast<size_t>(-1);
     std::string key;
+    // tiered storage (strings only): the value's copy in the value log, and whether RAM still holds it
+    ValueRef vlog;
+    bool value_evicted = false;
 };
 
 template <typename T, typename = std::enable_if_t<IsValidType<T>::value>>
@@ -52,6 +79,8 @@ public:
         key = std::move(k);
     }
 
+    size_t type_index() const override { return entry_type_index<T>(); }
+
     Entry(Entry&&) noexcept = default;
     Entry& operator=(Entry&&) noexcept = default;
 
@@ -69,26 +98,105 @@ public:
                 std::cout << "  (empty ZSet)" << std::endl;
             }
             std::cout << "}" << std::endl;
-        } else {
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) {
             std::cout << "Key: " << key << " -> " << value << std::endl;
+        } else {
+            std::cout << "Key: " << key << " -> (" << value.size() << " items)" << std::endl;
         }
     }
 };
 
+/*
+Tiered storage (enable_tiering): keys and metadata always stay in db_, but string values that a
+CountMinSketch says are rarely touched can be demoted to an on-disk ValueLog by demote_cold(). A demoted
+entry keeps its ValueRef; find_entry() reads the value back with one pread and keeps it resident again. The
+value log copy stays valid until the key is overwritten or deleted, so re-demoting an unchanged value costs
+no I/O. Value log GC runs on the log's own thread and repoints entries through relocate_value().
+With demote_interval set, demote_cold() runs on a thread of its own that often (the server's --tiering-dir).
+
+Commands read a string entry's value with no lock held, so demotion and promotion never touch the value of
+an entry in db_: they publish a new Entry in its place and readers holding the old one keep a value that
+doesn't change under them. A TTL moves to the new Entry with it (BinaryHeap::repoint). find_entry() looks
+up under tier_mutex_, and demote_cold() skips any entry someone else holds a reference to, so a TTL set on
+a just-found entry can't land on an orphaned copy.
+
+Lock order: tier_mutex_, then db_'s locks, then the value log's.
+*/
+
 class EntryManager {
+public:
+    struct TieringOptions {
+        std::string dir;
+        size_t min_value_bytes = 256;       // smaller values aren't worth a disk round trip
+        int hot_threshold = 2;              // sketch estimate at or above this keeps a value in RAM
+        size_t sketch_counters = 1 << 20;
+        uint64_t segment_bytes = 64ull << 20;
+        double gc_garbage_ratio = 0.5;
+        std::chrono::milliseconds gc_interval{1000};
+        std::chrono::milliseconds demote_interval{0};  // > 0: demote_cold() on a background thread this often
+    };
+
+    struct TieringStats {
+        uint64_t evicted_values;
+        uint64_t evicted_bytes;             // value bytes no longer held in RAM
+        uint64_t demoted;
+        uint64_t promoted;
+        ValueLog::Stats log;
+    };
+
+    // kept in atomics next to the map, so metrics scrapes never take a lock a command holds
+    struct KeyspaceStats {
+        std::array<uint64_t, k_entry_type_names.size()> keys_by_type;
+        uint64_t keys_with_expiry;
+    };
+
 private:
     HMap<std::string, std::shared_ptr<EntryBase>> db_;  
     BinaryHeap<uint64_t> heap_;                         
     ThreadPool thread_pool_;                            
 
+    TieringOptions tiering_options_;
+    std::unique_ptr<CountMinSketch> sketch_;
+    mutable std::mutex tier_mutex_;
+    std::atomic<uint64_t> evicted_values_{0};  // tiering counters: written under tier_mutex_, atomic for
+    std::atomic<uint64_t> evicted_bytes_{0};   // lock-free reads
+    std::atomic<uint64_t> demoted_{0};
+    std::atomic<uint64_t> promoted_{0};
+    std::array<std::atomic<uint64_t>, k_entry_type_names.size()> keys_by_type_{};
+    std::atomic<uint64_t> keys_with_expiry_{0};
+    std::mutex demote_mutex_;
+    std::condition_variable demote_cv_;
+    std::thread demote_thread_;
+    bool demote_stop_{true};
+    std::unique_ptr<ValueLog> vlog_;        // last: its GC thread calls back into db_, so it goes first
+
 public:
     EntryManager(size_t thread_pool_size = 4)
         : heap_(std::less<uint64_t>()), thread_pool_(thread_pool_size) {}
 
+    ~EntryManager() {
+        stop_demotion();
+        if (vlog_) {
+            vlog_->stop_gc();
+        }
+    }
+
 
     std::shared_ptr<EntryBase> find_entry(const std::string& key) {
-        auto entry = db_.find(key); 
-        return entry ? *entry : nullptr;
+        if (!vlog_) {
+            auto entry = db_.find(key);
+            return entry ? *entry : nullptr;
+        }
+        std::lock_guard lock(tier_mutex_);
+        auto entry = db_.find(key);
+        if (!entry) {
+            return nullptr;
+        }
+        sketch_->increment(sketch_hash(key));
+        if ((*entry)->value_evicted) {
+            return promote(*entry);
+        }
+        return *entry;
     }
         
     
@@ -97,11 +205,27 @@ public:
         static_assert(IsValidType<T>::value, "Invalid Redis type");
 
         auto entry = std::make_shared<Entry<T>>(std::move(key), std::move(value));
+        if (vlog_) {
+            std::lock_guard lock(tier_mutex_);
+            sketch_->increment(sketch_hash(entry->key));
+            if (auto old = db_.find(entry->key)) {
+                drop_value(**old);
+                forget_key(**old);
+            }
+            db_.insert(entry->key, entry);
+            count_key(*entry, 1);
+            return entry;
+        }
+        if (auto old = db_.find(entry->key)) {
+            forget_key(**old);
+        }
         db_.insert(entry->key, entry);
+        count_key(*entry, 1);
         return entry;
     }
 
     bool delete_entry(const std::string& key) {
+        auto tiers = lock_tiers();          // so a demotion can't swap the entry between the find and the remove
         auto entry = db_.find(key);
         if (!entry) {
             return false;  
@@ -110,13 +234,172 @@ public:
         if ((*entry)->heap_idx != static_cast<size_t>(-1)) {
             remove_from_heap(**entry);
         }
+        if (vlog_) {
+            drop_value(**entry);
+        }
+        count_key(**entry, -1);
         db_.remove(key);
         return true;  
     }
+
+    Result<void> enable_tiering(TieringOptions options) {
+        auto log = ValueLog::open(ValueLog::Options{options.dir, options.segment_bytes,
+                                                    options.gc_garbage_ratio, options.gc_interval});
+        if (!log) {
+            return std::unexpected(log.error());
+        }
+        tiering_options_ = std::move(options);
+        sketch_ = std::make_unique<CountMinSketch>(tiering_options_.sketch_counters);
+        vlog_ = std::move(*log);
+        vlog_->start_gc([this](std::string_view key, const ValueRef& from, const ValueLog::CopyFn& copy) {
+            relocate_value(key, from, copy);
+        });
+        if (tiering_options_.demote_interval.count() > 0) {
+            demote_stop_ = false;
+            demote_thread_ = std::thread([this] {
+                std::unique_lock lock(demote_mutex_);
+                while (!demote_stop_) {
+                    demote_cv_.wait_for(lock, tiering_options_.demote_interval, [&] { return demote_stop_; });
+                    if (demote_stop_) break;
+                    lock.unlock();
+                    demote_cold();
+                    lock.lock();
+                }
+            });
+        }
+        return {};
+    }
+
+    void stop_demotion() {
+        {
+            std::lock_guard lock(demote_mutex_);
+            demote_stop_ = true;
+        }
+        demote_cv_.notify_all();
+        if (demote_thread_.joinable()) {
+            demote_thread_.join();
+        }
+    }
+
+    // one demotion pass: every resident string value at least min_value_bytes long, not held by a command right
+    // now, whose sketch estimate is under hot_threshold moves to the value log. the sketch is halved afterwards
+    // so estimates track recent traffic. returns the number of values demoted.
+    size_t demote_cold() {
+        if (!vlog_) {
+            return 0;
+        }
+        std::lock_guard lock(tier_mutex_);
+        // pick first, publish after: db_ is read-locked for the walk
+        std::vector<std::shared_ptr<EntryBase>> cold;
+        db_.for_each([&](const std::string& key, const std::shared_ptr<EntryBase>& entry) {
+            auto* str = dynamic_cast<Entry<std::string>*>(entry.get());
+            if (!str || str->value_evicted || entry.use_count() > 1 ||
+                str->value.size() < tiering_options_.min_value_bytes ||
+                sketch_->getCountMin(sketch_hash(key)) >= tiering_options_.hot_threshold) {
+                return;
+            }
+            cold.push_back(entry);
+        });
+        size_t demoted = 0;
+        for (auto& entry : cold) {
+            auto& str = static_cast<Entry<std::string>&>(*entry);
+            if (!str.vlog) {
+                auto ref = vlog_->append(str.key, str.value);
+                if (!ref) {
+                    log_message("tiering: value log append failed: {}", ref.error().message());
+                    break;
+                }
+                str.vlog = *ref;
+            }
+            auto evicted = std::make_shared<Entry<std::string>>(str.key, std::string());
+            evicted->vlog = str.vlog;
+            evicted->value_evicted = true;
+            heap_.repoint(&str.heap_idx, &evicted->heap_idx);
+            evicted_bytes_ += str.value.size();
+            ++evicted_values_;
+            db_.insert(evicted->key, evicted);  // the last reference to the resident value goes with `cold`
+            ++demoted;
+        }
+        demoted_ += demoted;
+        sketch_->decay();
+        return demoted;
+    }
+
+    // hold while walking entries that may be evicted (snapshots) and reading them with read_evicted()
+    [[nodiscard]] std::unique_lock<std::mutex> lock_tiers() const {
+        return vlog_ ? std::unique_lock(tier_mutex_) : std::unique_lock<std::mutex>();
+    }
+
+    // value of a demoted string entry, without making it resident. lock_tiers() must be held.
+    bool read_evicted(const EntryBase& entry, std::string& out) const {
+        return vlog_ && entry.value_evicted && vlog_->read(entry.vlog, out).has_value();
+    }
+
+    [[nodiscard]] TieringStats tiering_stats() const {
+        std::lock_guard lock(tier_mutex_);
+        return TieringStats{evicted_values_, evicted_bytes_, demoted_, promoted_,
+                            vlog_ ? vlog_->stats() : ValueLog::Stats{}};
+    }
+
+    // tiering_stats() without the value log's own stats, and without taking tier_mutex_
+    [[nodiscard]] TieringStats tiering_counters() const noexcept {
+        return TieringStats{evicted_values_, evicted_bytes_, demoted_, promoted_, ValueLog::Stats{}};
+    }
+
+    // lock-free: counters only, no lookups
+    [[nodiscard]] KeyspaceStats keyspace_stats() const noexcept {
+        KeyspaceStats s{};
+        for (size_t i = 0; i < keys_by_type_.size(); ++i) {
+            s.keys_by_type[i] = keys_by_type_[i].load(std::memory_order_relaxed);
+        }
+        s.keys_with_expiry = keys_with_expiry_.load(std::memory_order_relaxed);
+        return s;
+    }
     
+    // visit every live entry - full keyspace walks (snapshots) only, the map is read-locked for the whole scan.
+    template <typename Fn>
+    void for_each_entry(Fn&& fn) const {
+        db_.for_each([&](const std::string&, const std::shared_ptr<EntryBase>& entry) { fn(entry); });
+    }
+
+    // every lock a fork() must hold for the child to inherit a consistent keyspace: no insert, erase, resize
+    // step, demotion, promotion or value log append is half done while a Freeze lives. Hold it only for the
+    // fork itself - it stops every reader and writer. The keyspace's own writer must be the forking thread
+    // (entry values have no lock of their own to take here).
+    struct Freeze {
+        std::unique_lock<std::mutex> tiers;
+        std::unique_lock<SiteMutex<std::shared_mutex>> map;
+        std::unique_lock<std::mutex> vlog;
+    };
+    [[nodiscard]] Freeze freeze() const {
+        Freeze f{lock_tiers(), db_.freeze(), {}};
+        if (vlog_) {
+            f.vlog = vlog_->freeze();
+        }
+        return f;
+    }
+
+    // for_each_entry() and read_evicted() in a child forked under freeze(): the child is single-threaded and
+    // inherited those locks held for good, so neither takes one
+    template <typename Fn>
+    void for_each_entry_frozen(Fn&& fn) const {
+        db_.for_each_frozen([&](const std::string&, const std::shared_ptr<EntryBase>& entry) { fn(entry); });
+    }
+    bool read_evicted_frozen(const EntryBase& entry, std::string& out) const {
+        return vlog_ && entry.value_evicted && vlog_->read_frozen(entry.vlog, out).has_value();
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return db_.size(); }
+
     bool clear_all() {
+        if (vlog_) {
+            std::lock_guard lock(tier_mutex_);
+            db_.for_each([&](const std::string&, const std::shared_ptr<EntryBase>& entry) { drop_value(*entry); });
+        }
         db_.clear();
         heap_.clear();
+        for (auto& count : keys_by_type_) count.store(0, std::memory_order_relaxed);
+        keys_with_expiry_.store(0, std::memory_order_relaxed);
         return db_.size() == 0 && heap_.size() == 0;
     }    
     
@@ -153,8 +436,9 @@ public:
 
     bool remove_from_heap(EntryBase& entry) {
         if (entry.heap_idx >= heap_.size()) return false;
-        heap_.pop();
+        heap_.erase(entry.heap_idx);
         entry.heap_idx = static_cast<size_t>(-1);
+        keys_with_expiry_.fetch_sub(1, std::memory_order_relaxed);
         return true;
     }
 
@@ -163,9 +447,8 @@ public:
         if (entry.heap_idx != static_cast<size_t>(-1)) {
             return false;  // Entry is already in the heap
         }
-        heap_.push(HeapItem<uint64_t>(expire_at, &entry.heap_idx));
-        entry.heap_idx = heap_.size() - 1;
-        heap_.update(entry.heap_idx);
+        heap_.push(HeapItem<uint64_t>(expire_at, &entry.heap_idx));  // sift_up keeps entry.heap_idx current
+        keys_with_expiry_.fetch_add(1, std::memory_order_relaxed);
         return true;  // Successfully added to the heap
     }
     
@@ -178,6 +461,68 @@ public:
     }
     
 
+private:
+    static uint64_t sketch_hash(const std::string& key) {
+        return hash_key(key.data(), key.size());
+    }
+
+    void count_key(const EntryBase& entry, int delta) {
+        keys_by_type_[entry.type_index()].fetch_add(static_cast<uint64_t>(delta), std::memory_order_relaxed);
+    }
+
+    // `entry` is about to be overwritten: insert() frees it, so its TTL goes too (a plain SET clears the TTL)
+    void forget_key(EntryBase& entry) {
+        if (entry.heap_idx != static_cast<size_t>(-1)) {
+            remove_from_heap(entry);
+        }
+        count_key(entry, -1);
+    }
+
+    // tier_mutex_ held. publishes a resident copy of the evicted entry in its place and returns it; on a read
+    // error the evicted entry stays and is returned as is
+    std::shared_ptr<EntryBase> promote(const std::shared_ptr<EntryBase>& entry) {
+        std::string value;
+        if (auto r = vlog_->read(entry->vlog, value); !r) {
+            log_message("tiering: value log read for {} failed: {}", entry->key, r.error().message());
+            return entry;
+        }
+        evicted_bytes_ -= value.size();
+        --evicted_values_;
+        ++promoted_;
+        auto resident = std::make_shared<Entry<std::string>>(entry->key, std::move(value));
+        resident->vlog = entry->vlog;
+        heap_.repoint(&entry->heap_idx, &resident->heap_idx);
+        db_.insert(resident->key, resident);
+        return resident;
+    }
+
+    // tier_mutex_ held. the entry is being overwritten or removed: its value log copy is garbage now.
+    void drop_value(EntryBase& entry) {
+        if (entry.value_evicted) {
+            // the record is header + key + value
+            evicted_bytes_ -= entry.vlog.record_len - sizeof(ValueLog::RecordHeader) - entry.key.size();
+            --evicted_values_;
+            entry.value_evicted = false;
+        }
+        if (entry.vlog) {
+            vlog_->release(entry.vlog);
+            entry.vlog = {};
+        }
+    }
+
+    // value log GC found `key`'s record at `from`; move it if the entry still points there
+    void relocate_value(std::string_view key, const ValueRef& from, const ValueLog::CopyFn& copy) {
+        std::lock_guard lock(tier_mutex_);
+        auto entry = db_.find(std::string(key));
+        if (!entry || (*entry)->vlog != from) {
+            return;
+        }
+        if (auto to = copy()) {
+            (*entry)->vlog = *to;
+        }
+    }
+
+public:
     // void delete_entry_async(const std::string& key) {
     //     thread_pool_.enqueue([this, key]() { 
     //         delete_entry(key); 
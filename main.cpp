@@ -3,16 +3,20 @@
 #include <cstdlib>       // std::size_t, std::stoi
 #include <csignal>       // std::signal, SIGINT
 #include <exception>     // std::exception
+#include <string>        // std::string
+#include <unistd.h>      // write, STDOUT_FILENO
 #include "server.hpp"    // Server class
 
 Server* global_server = nullptr;
 
+// only async-signal-safe calls here: the signal may land while the loop thread holds a lock (the capture's,
+// say), so the shutdown itself happens in main once run() returns
 void handle_signal(int) {
     if (global_server) {
-        std::cout << "\nShutting down server gracefully...\n";
-        global_server->stop();
+        static constexpr char message[] = "\nShutting down server gracefully...\n";
+        (void)::write(STDOUT_FILENO, message, sizeof(message) - 1);
+        global_server->request_stop();
     }
-    std::exit(0);
 }
 
 
@@ -45,10 +49,121 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
+        // async replication: --repl-port <port> serves replicas, --replicaof <host>:<port> makes us one
+        // hot key tracking: --hotkeys-sample <n> observes 1 in n commands (0 turns HOTKEYS off)
+        // prometheus metrics: --metrics-port <port> serves /metrics on 127.0.0.1:<port>
+        // slow log: --slowlog-threshold-us <us> (-1 off, 0 everything), --slowlog-len <records>
+        // request tracing: --trace-sample <n> traces 1 in n requests (TRACE DUMP returns them as Chrome JSON)
+        // latency histograms: --commandstats off stops timing commands (INFO commandstats / LATENCY go quiet)
+        // traffic capture: --capture <path> records every request for tests/traffic_replay.cpp (CAPTURE STOP ends it),
+        //   --capture-dir <dir> lets CAPTURE START <name> create <dir>/<name> (without it clients can't start one)
+        // worker offload: --offload off keeps multiplexed connections' long commands on the poll loop
+        // debugging: --enable-debug on answers DEBUG SLEEP (it stalls whichever thread runs it; off by default)
+        // local clients: --unix <path> also listens there (SHM moves a client to shared memory),
+        //   --shm-busy-poll-us <us> spins that long on a shared-memory client's ring before sleeping (default 0)
+        // I/O backend: --io uring runs sockets through io_uring (poll if the kernel can't), --io poll is the default;
+        //   --uring-register <none|files|buffers|all> registers the sockets and/or the send buffers with the ring
+        // tiered storage: --tiering-dir <dir> keeps a value log there and demotes cold string values to it every
+        //   --tiering-demote-ms <ms> (default 1000). set up before anything else that touches the keyspace
+        EntryManager::TieringOptions tiering;
+        tiering.demote_interval = std::chrono::milliseconds(1000);
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            if (flag == "--tiering-dir") {
+                tiering.dir = argv[i + 1];
+            } else if (flag == "--tiering-demote-ms") {
+                tiering.demote_interval = std::chrono::milliseconds(std::stoll(argv[i + 1]));
+            }
+        }
+        if (!tiering.dir.empty()) {
+            auto tiers = server.enable_tiering(tiering);
+            if (!tiers) {
+                std::cerr << "Failed to enable tiered storage: " << tiers.error().message() << "\n";
+                return 1;
+            }
+        }
+
+        bool io_uring = false;
+        UringBackend::Options uring_options;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            std::string value = argv[i + 1];
+            if (flag == "--repl-port") {
+                auto repl = server.enable_replication(static_cast<uint16_t>(std::stoi(value)));
+                if (!repl) {
+                    std::cerr << "Failed to start replication: " << repl.error().message() << "\n";
+                    return 1;
+                }
+            } else if (flag == "--hotkeys-sample") {
+                HotKeys::Options hot_keys;
+                hot_keys.sample_rate = static_cast<uint32_t>(std::stoul(value));
+                HotKeys::instance().configure(hot_keys);
+            } else if (flag == "--metrics-port") {
+                auto metrics = server.enable_metrics(static_cast<uint16_t>(std::stoi(value)));
+                if (!metrics) {
+                    std::cerr << "Failed to start metrics endpoint: " << metrics.error().message() << "\n";
+                    return 1;
+                }
+            } else if (flag == "--slowlog-threshold-us" || flag == "--slowlog-len") {
+                SlowLog::Options slow_log{SlowLog::instance().threshold_us(), SlowLog::instance().capacity()};
+                if (flag == "--slowlog-len") {
+                    slow_log.capacity = static_cast<size_t>(std::stoul(value));
+                } else {
+                    slow_log.threshold_us = std::stoll(value);
+                }
+                SlowLog::instance().configure(slow_log);
+            } else if (flag == "--trace-sample") {
+                RequestTracer::instance().configure({.sample_rate = static_cast<uint32_t>(std::stoul(value))});
+            } else if (flag == "--capture") {
+                auto capture = TrafficCapture::instance().start({.path = value});
+                if (!capture) {
+                    std::cerr << "Failed to start traffic capture: " << capture.error().message() << "\n";
+                    return 1;
+                }
+            } else if (flag == "--capture-dir") {
+                TrafficCapture::instance().set_directory(value);
+            } else if (flag == "--offload") {
+                server.set_offload(value != "off");
+            } else if (flag == "--enable-debug") {
+                CommandProcessor::debug_enabled.store(value == "on");
+            } else if (flag == "--unix") {
+                auto unix_listener = server.listen_unix(value);
+                if (!unix_listener) {
+                    std::cerr << "Failed to listen on " << value << ": " << unix_listener.error().message() << "\n";
+                    return 1;
+                }
+            } else if (flag == "--shm-busy-poll-us") {
+                ShmChannel::busy_poll_us.store(static_cast<uint32_t>(std::stoul(value)));
+            } else if (flag == "--io" && (value == "poll" || value == "uring")) {
+                io_uring = value == "uring";
+            } else if (flag == "--uring-register") {
+                uring_options.fixed_files = value == "files" || value == "all";
+                uring_options.fixed_buffers = value == "buffers" || value == "all";
+            } else if (flag == "--tiering-dir" || flag == "--tiering-demote-ms") {
+                // handled above
+            } else if (flag == "--commandstats") {
+                CommandStats::instance().set_enabled(value != "off");
+            } else if (flag == "--replicaof" && value.find(':') != std::string::npos) {
+                auto colon = value.rfind(':');
+                server.replicate_from(value.substr(0, colon), static_cast<uint16_t>(std::stoi(value.substr(colon + 1))));
+            } else {
+                std::cerr << "Unknown option " << flag << "\n";
+                return 1;
+            }
+        }
+
+        if (io_uring) {
+            auto uring = server.use_io_uring(uring_options);
+            if (!uring) {
+                std::cerr << "io_uring unavailable (" << uring.error().message() << "), using poll\n";
+            }
+        }
+
         std::signal(SIGINT, handle_signal);
 
         std::cout << "Server running on port " << port << " with " << thread_pool_size << " threads.\n";
         server.run();
+        server.stop();
 
         return 0;
 
@@ -8,6 +8,7 @@
 #include <expected>     // For std::expected (C++23)
 #include <system_error> // For std::error_code, std::errc, std::make_error_code
 #include <cstring>      // For std::memcpy
+#include <utility>      // For std::pair
  
 template<typename T>
 using Result = std::expected<T, std::error_code>;
@@ -46,11 +47,44 @@ class RequestParser {
                 return std::unexpected(std::make_error_code(std::errc::message_size));
             }
         
-            std::vector<std::string> cmd;
             const uint8_t* pos = data.data() + sizeof(uint32_t);
-            const uint8_t* end = pos + len;
-        
-        
+            return parse_args(pos, pos + len);
+        }
+
+        /**
+         *  Parses a multiplexed frame (see MULTIPLEX in connection.hpp) into its request id and command.
+         *
+         * Same layout as parse(), except the payload starts with a 4-byte big-endian request id that the
+         * response echoes back; the length covers the id.
+         */
+        static Result<std::pair<uint32_t, std::vector<std::string>>> parse_tagged(std::span<const uint8_t> data) {
+            if (data.size() < 2 * sizeof(uint32_t)) {
+                return std::unexpected(std::make_error_code(std::errc::message_size));
+            }
+
+            uint32_t len, id;
+            std::memcpy(&len, data.data(), sizeof(uint32_t));
+            std::memcpy(&id, data.data() + sizeof(uint32_t), sizeof(uint32_t));
+            len = __builtin_bswap32(len);
+            id = __builtin_bswap32(id);
+
+            if (len < sizeof(uint32_t) || sizeof(uint32_t) + len > data.size()) {
+                return std::unexpected(std::make_error_code(std::errc::message_size));
+            }
+
+            const uint8_t* pos = data.data() + 2 * sizeof(uint32_t);
+            auto cmd = parse_args(pos, data.data() + sizeof(uint32_t) + len);
+            if (!cmd) {
+                return std::unexpected(cmd.error());
+            }
+            return std::pair{id, std::move(*cmd)};
+        }
+
+    private:
+        // the length-prefixed strings between pos and end
+        static Result<std::vector<std::string>> parse_args(const uint8_t* pos, const uint8_t* end) {
+            std::vector<std::string> cmd;
+
             while (pos < end) {
         
                 if (end - pos < sizeof(uint32_t)) {
@@ -11,6 +11,9 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/un.h>
+#include <string>
+#include <thread>
 #include <atomic>
 #include "logging.hpp"
 #include "socket.hpp"
@@ -19,6 +22,11 @@
 #include "src/thread_pool.hpp"
 #include "entry_manager.hpp"
 #include "src/list.hpp"  
+#include "src/replication/primary.hpp"
+#include "src/replication/replica.hpp"
+#include "src/stats/metrics_server.hpp"
+#include "command_offload.hpp"
+#include "src/transport/uring_backend.hpp"
 
 template<typename T>
 using Result = std::expected<T, std::error_code>;
@@ -27,10 +35,20 @@ class Server {
 public:    
     uint16_t port_;
     Socket listen_socket_{-1};
+    Socket unix_listen_socket_{-1};                     // optional, see listen_unix()
+    std::string unix_path_;
     ThreadPool thread_pool_;
+    CommandOffload offload_{thread_pool_};              // long commands of multiplexed connections
+    bool offload_enabled_ = true;
     CommandProcessor command_processor_;
     EntryManager entry_manager_;
     std::atomic<bool> should_stop_;
+    std::unique_ptr<ReplicationPrimary> replication_primary_;
+    std::unique_ptr<ReplicationReplica> replication_replica_;
+    std::atomic<uint64_t> connections_received_{0};     // for metrics: written by the poll loop only
+    std::atomic<uint64_t> connected_clients_{0};
+    std::unique_ptr<MetricsServer> metrics_server_;     // after entry_manager_: stops scraping it first
+    std::unique_ptr<UringBackend> uring_;               // before connections_: they release their fds into it
     
     Server(uint16_t port, size_t thread_pool_size)
         : port_(port), thread_pool_(thread_pool_size), 
@@ -39,11 +57,33 @@ public:
     Result<void> initialize();
     void run();
     void stop();
+    // safe from a signal handler: only raises the flag, and run() returns within a second, stopping the
+    // traffic capture on its own thread on the way out
+    void request_stop() noexcept { should_stop_ = true; }
+    Result<void> enable_replication(uint16_t port);
+    void replicate_from(std::string host, uint16_t port);
+    Result<void> enable_metrics(uint16_t port);
+    // demote cold string values to a value log in options.dir - see entry_manager.hpp. Call before run()
+    // and before anything else (replication, metrics) that touches the keyspace
+    Result<void> enable_tiering(EntryManager::TieringOptions options) {
+        return entry_manager_.enable_tiering(std::move(options));
+    }
+    void collect_metrics(MetricsWriter& w) const;
+    // off: multiplexed connections run every command inline on the poll loop
+    void set_offload(bool enabled) { offload_enabled_ = enabled; }
+    // also accept clients on a Unix domain socket at `path`; these can move to shared memory (SHM)
+    Result<void> listen_unix(const std::string& path);
+    // run() drives sockets through io_uring instead of poll(); call on the thread that calls run(). An error
+    // means the kernel can't do it, and the server stays on poll()
+    Result<void> use_io_uring(UringBackend::Options options);
 
     [[nodiscard]] int get_listen_socket_fd() const {
         return listen_socket_.get();
     }
 
+    // poll_args: TCP listener, offload eventfd, Unix listener (-1 when off, which poll skips), connections
+    static constexpr size_t k_fixed_polls = 3;
+
     std::unordered_map<int, std::unique_ptr<Connection>> connections_;
     DoublyLinkedList<Connection*> idle_list_;
 
@@ -51,8 +91,14 @@ public:
     void prepare_poll_args(std::vector<pollfd>& poll_args);
     std::chrono::milliseconds calculate_next_timeout();
     void process_active_connections(const std::vector<pollfd>& poll_args);
+    bool any_busy_polling() const;
+    void process_busy_polling();
     void process_timers();
     void accept_new_connections(const pollfd& listen_poll);
+    void add_client(int client_fd, const sockaddr_storage& client_addr);
+    void serve(int fd);
+    void run_uring();
+    void deliver_offloaded();
     void add_connection(std::unique_ptr<Connection> conn);
     void remove_connection(int fd);
 };
@@ -67,6 +113,72 @@ Result<void> Server::initialize() {
     return {};
 }
 
+// serve async replicas on `port` - see src/replication/primary.hpp
+inline Result<void> Server::enable_replication(uint16_t port) {
+    auto primary = ReplicationPrimary::start(entry_manager_,
+                                             ReplicationPrimary::Options{.port = port, .client_port = port_});
+    if (!primary) {
+        return std::unexpected(primary.error());
+    }
+    replication_primary_ = std::move(*primary);
+    return {};
+}
+
+// become a read-only replica of host:port
+inline void Server::replicate_from(std::string host, uint16_t port) {
+    replication_replica_ = std::make_unique<ReplicationReplica>(
+        entry_manager_, ReplicationReplica::Options{.host = std::move(host), .port = port, .listening_port = port_});
+}
+
+// Prometheus text format on 127.0.0.1:`port`/metrics, served from its own thread
+inline Result<void> Server::enable_metrics(uint16_t port) {
+    auto metrics = MetricsServer::start(MetricsServer::Options{.port = port},
+                                        [this](MetricsWriter& w) { collect_metrics(w); });
+    if (!metrics) {
+        return std::unexpected(metrics.error());
+    }
+    metrics_server_ = std::move(*metrics);
+    return {};
+}
+
+// runs on the metrics thread: atomics and per-thread shards only, never a lock a command handler holds
+inline void Server::collect_metrics(MetricsWriter& w) const {
+    write_command_metrics(w);
+
+    w.family("vectordb_connected_clients", "gauge", "Client connections currently open.");
+    w.sample("vectordb_connected_clients", "", static_cast<double>(connected_clients_.load(std::memory_order_relaxed)));
+    w.family("vectordb_connections_received_total", "counter", "Client connections accepted.");
+    w.sample("vectordb_connections_received_total", "",
+             static_cast<double>(connections_received_.load(std::memory_order_relaxed)));
+
+    auto keyspace = entry_manager_.keyspace_stats();
+    w.family("vectordb_keys", "gauge", "Keys in the keyspace, by value type.");
+    for (size_t i = 0; i < k_entry_type_names.size(); ++i) {
+        w.sample("vectordb_keys", "type=\"" + std::string(k_entry_type_names[i]) + "\"",
+                 static_cast<double>(keyspace.keys_by_type[i]));
+    }
+    w.family("vectordb_keys_with_expiry", "gauge", "Keys with a TTL set.");
+    w.sample("vectordb_keys_with_expiry", "", static_cast<double>(keyspace.keys_with_expiry));
+
+    auto tiering = entry_manager_.tiering_counters();
+    w.family("vectordb_evicted_values", "gauge", "String values evicted from RAM to the value log.");
+    w.sample("vectordb_evicted_values", "", static_cast<double>(tiering.evicted_values));
+    w.family("vectordb_evicted_value_bytes", "gauge", "Value bytes evicted from RAM to the value log.");
+    w.sample("vectordb_evicted_value_bytes", "", static_cast<double>(tiering.evicted_bytes));
+    w.family("vectordb_values_demoted_total", "counter", "Values moved from RAM to the value log.");
+    w.sample("vectordb_values_demoted_total", "", static_cast<double>(tiering.demoted));
+    w.family("vectordb_values_promoted_total", "counter", "Values read back from the value log into RAM.");
+    w.sample("vectordb_values_promoted_total", "", static_cast<double>(tiering.promoted));
+
+    w.family("vectordb_thread_pool_queue_depth", "gauge", "Tasks waiting in a thread pool.");
+    w.sample("vectordb_thread_pool_queue_depth", "pool=\"server\"", static_cast<double>(thread_pool_.queue_depth()));
+    w.family("vectordb_thread_pool_active_workers", "gauge", "Thread pool workers running a task.");
+    w.sample("vectordb_thread_pool_active_workers", "pool=\"server\"",
+             static_cast<double>(thread_pool_.active_workers()));
+
+    write_process_metrics(w);
+}
+
 inline Result<Socket> Server::create_listen_socket() {
     Socket sock(socket(AF_INET, SOCK_STREAM, 0));
     if (sock.get() < 0) {
@@ -105,9 +217,53 @@ inline Result<Socket> Server::create_listen_socket() {
 }
 
 
+inline Result<void> Server::listen_unix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return std::unexpected(std::make_error_code(std::errc::filename_too_long));
+    }
+    Socket sock(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (sock.get() < 0) {
+        std::cerr << "Socket creation failed: " << strerror(errno) << std::endl;
+        return std::unexpected(std::make_error_code(std::errc::bad_file_descriptor));
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    ::unlink(path.c_str());     // a stale socket file from a previous run
+    if (bind(sock.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Bind failed: " << strerror(errno) << std::endl;
+        return std::unexpected(std::make_error_code(std::errc::address_in_use));
+    }
+    if (listen(sock.get(), SOMAXCONN) < 0) {
+        std::cerr << "Listen failed: " << strerror(errno) << std::endl;
+        return std::unexpected(std::make_error_code(std::errc::connection_refused));
+    }
+    if (auto result = sock.set_nonblocking(); !result) {
+        return std::unexpected(result.error());
+    }
+    unix_listen_socket_ = std::move(sock);
+    unix_path_ = path;
+    std::cout << "Server listening on " << path << std::endl;
+    return {};
+}
+
+inline Result<void> Server::use_io_uring(UringBackend::Options options) {
+    auto backend = UringBackend::create(options);
+    if (!backend) {
+        return std::unexpected(backend.error());
+    }
+    uring_ = std::move(*backend);
+    auto used = uring_->options();
+    std::cout << "I/O backend: io_uring (registered files " << (used.fixed_files ? "on" : "off")
+              << ", registered buffers " << (used.fixed_buffers ? "on" : "off") << ")" << std::endl;
+    return {};
+}
+
 inline void Server::prepare_poll_args(std::vector<pollfd>& poll_args) {
     poll_args.clear();
     poll_args.push_back({listen_socket_.get(), POLLIN, 0});
+    poll_args.push_back({offload_.event_fd(), POLLIN, 0});
+    poll_args.push_back({unix_listen_socket_.get(), POLLIN, 0});
 
     for (const auto& [fd, conn] : connections_) {
         poll_args.push_back({fd, static_cast<short>(conn->state() == ConnectionState::Request ? POLLIN : POLLOUT), 0});
@@ -129,30 +285,66 @@ inline std::chrono::milliseconds Server::calculate_next_timeout() {
 }
 
 inline void Server::process_active_connections(const std::vector<pollfd>& poll_args) {
-    for (size_t i = 1; i < poll_args.size(); ++i) {
+    for (size_t i = k_fixed_polls; i < poll_args.size(); ++i) {
         if (poll_args[i].revents == 0) continue;
 
-        auto it = connections_.find(poll_args[i].fd);
-        if (it == connections_.end()) continue;
+        serve(poll_args[i].fd);
+    }
+}
+
+// one turn of process_io() for the connection on `fd`, closing it if that fails
+inline void Server::serve(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) return;
+
+    auto& conn = it->second;
+    std::cout << " Processing connection: FD " << conn->fd() << std::endl;
+
+    try {
+        auto result = conn->process_io();
+        if (!result) {
+            std::cerr << "Closing connection: FD " << conn->fd() << std::endl;
+            remove_connection(conn->fd());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Connection error: " << e.what() << std::endl;
+        remove_connection(conn->fd());
+    }
+}
+
 
-        auto& conn = it->second;
-        std::cout << " Processing connection: FD " << conn->fd() << std::endl;
 
+inline bool Server::any_busy_polling() const {
+    for (const auto& [fd, conn] : connections_) {
+        if (conn->busy_polling()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// shared-memory connections inside their busy-poll window get read whether poll() saw them or not
+inline void Server::process_busy_polling() {
+    std::vector<int> fds;
+    for (const auto& [fd, conn] : connections_) {
+        if (conn->busy_polling()) {
+            fds.push_back(fd);
+        }
+    }
+    for (int fd : fds) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) continue;
         try {
-            auto result = conn->process_io();
-            if (!result) {
-                std::cerr << "Closing connection: FD " << conn->fd() << std::endl;
-                remove_connection(conn->fd());
+            if (!it->second->process_io()) {
+                remove_connection(fd);
             }
         } catch (const std::exception& e) {
             std::cerr << "Connection error: " << e.what() << std::endl;
-            remove_connection(conn->fd());
+            remove_connection(fd);
         }
     }
 }
 
-
-
 inline void Server::process_timers() {
     using namespace std::chrono;
     auto now = steady_clock::now();
@@ -173,9 +365,9 @@ inline void Server::accept_new_connections(const pollfd& listen_poll) {
     }
 
     while (true) {
-        sockaddr_in client_addr{};
+        sockaddr_storage client_addr{};
         socklen_t addr_len = sizeof(client_addr);
-        int client_fd = accept(listen_socket_.get(), reinterpret_cast<sockaddr*>(&client_addr), &addr_len);
+        int client_fd = accept(listen_poll.fd, reinterpret_cast<sockaddr*>(&client_addr), &addr_len);
 
         if (client_fd < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -187,61 +379,149 @@ inline void Server::accept_new_connections(const pollfd& listen_poll) {
             }
         }
 
-        std::cout << " Accepted connection from " 
-                  << inet_ntoa(client_addr.sin_addr) << ":" 
-                  << ntohs(client_addr.sin_port) << std::endl;
-        
-        try {
-            Socket client_socket(client_fd);
-            auto result = client_socket.set_nonblocking();
-            if (!result) {
-                std::cerr << "Failed to set nonblocking socket.\n";
-                continue;
-            }
+        add_client(client_fd, client_addr);
+    }
+}
 
-            auto conn = std::make_unique<Connection>(
-                std::move(client_socket),
-                entry_manager_,
-                command_processor_
-            );
+inline void Server::add_client(int client_fd, const sockaddr_storage& client_addr) {
+    if (client_addr.ss_family == AF_INET) {
+        auto& in = reinterpret_cast<const sockaddr_in&>(client_addr);
+        std::cout << " Accepted connection from " 
+                  << inet_ntoa(in.sin_addr) << ":" 
+                  << ntohs(in.sin_port) << std::endl;
+    } else {
+        std::cout << " Accepted connection on " << unix_path_ << std::endl;
+    }
+    
+    try {
+        Socket client_socket(client_fd);
+        auto result = client_socket.set_nonblocking();
+        if (!result) {
+            std::cerr << "Failed to set nonblocking socket.\n";
+            return;
+        }
 
-            add_connection(std::move(conn));
-        } catch (...) {
-            close(client_fd);
+        auto conn = std::make_unique<Connection>(
+            std::move(client_socket),
+            entry_manager_,
+            command_processor_,
+            replication_primary_.get(),
+            replication_replica_ != nullptr,
+            offload_enabled_ ? &offload_ : nullptr
+        );
+        if (uring_) {
+            conn->use_uring(uring_->open(client_fd, conn->id()));
         }
+
+        add_connection(std::move(conn));
+    } catch (...) {
+        close(client_fd);
     }
 }
 
 
 
+// hands finished offloaded commands back to their connections
+inline void Server::deliver_offloaded() {
+    for (auto& done : offload_.drain()) {
+        auto it = connections_.find(done.fd);
+        if (it == connections_.end() || it->second->id() != done.connection) {
+            continue;   // closed while the command ran
+        }
+        if (!it->second->complete(done.request_id, done.response)) {
+            remove_connection(done.fd);
+        }
+    }
+}
+
 inline void Server::add_connection(std::unique_ptr<Connection> conn) {
     int fd = conn->fd();
     connections_.emplace(fd, std::move(conn));
+    connections_received_.fetch_add(1, std::memory_order_relaxed);
+    connected_clients_.store(connections_.size(), std::memory_order_relaxed);
 }
 
 inline void Server::remove_connection(int fd) {
     connections_.erase(fd);
+    connected_clients_.store(connections_.size(), std::memory_order_relaxed);
 }
 
 void Server::run() {
     std::cout << "Server is running on port " << port_ << "...\n";
+    if (uring_) {
+        return run_uring();
+    }
 
     std::vector<pollfd> poll_args;
 
     while (!should_stop_) {
         prepare_poll_args(poll_args);
         std::cout << "Polling for activity...\n";  
-        int ret = poll(poll_args.data(), poll_args.size(), 1000);  
+        bool busy = any_busy_polling();
+        int ret = poll(poll_args.data(), poll_args.size(), busy ? 0 : 1000);  
 
         if (should_stop_) break;
 
         if (ret > 0) {
             std::cout << "Poll detected activity\n";
             accept_new_connections(poll_args[0]);
+            if (poll_args[2].revents & POLLIN) {
+                accept_new_connections(poll_args[2]);
+            }
             process_active_connections(poll_args);
+            if (poll_args[1].revents & POLLIN) {
+                deliver_offloaded();
+            }
+        }
+        if (busy) {
+            process_busy_polling();
+            if (ret == 0) {
+                std::this_thread::yield();      // a client on the same core gets its turn
+            }
+        }
+        TrafficCapture::instance().flush();
+    }
+
+    TrafficCapture::instance().stop();
+    std::cout << "Server shutting down...\n";
+}
+
+// run() on io_uring: accepts, reads and sends complete in the ring, and each turn submits everything the
+// previous one queued in a single io_uring_enter() (see src/transport/uring_backend.hpp)
+inline void Server::run_uring() {
+    uring_->add_listener(listen_socket_.get());
+    if (unix_listen_socket_.get() >= 0) {
+        uring_->add_listener(unix_listen_socket_.get());
+    }
+    uring_->watch_offload(offload_.event_fd());
+
+    UringBackend::Events events;
+    while (!should_stop_) {
+        if (auto r = uring_->wait(events, std::chrono::milliseconds(1000)); !r) {
+            std::cerr << "io_uring wait failed: " << r.error().message() << std::endl;
+            break;
+        }
+        if (should_stop_) break;
+
+        for (int client_fd : events.accepted) {
+            sockaddr_storage client_addr{};
+            socklen_t addr_len = sizeof(client_addr);
+            ::getpeername(client_fd, reinterpret_cast<sockaddr*>(&client_addr), &addr_len);
+            add_client(client_fd, client_addr);
+        }
+        for (auto [fd, id] : events.ready) {
+            auto it = connections_.find(fd);
+            if (it != connections_.end() && it->second->id() == id) {
+                serve(fd);
+            }
+        }
+        if (events.offload) {
+            deliver_offloaded();
         }
+        TrafficCapture::instance().flush();
     }
 
+    TrafficCapture::instance().stop();
     std::cout << "Server shutting down...\n";
 }
 
@@ -249,7 +529,10 @@ void Server::run() {
 
 void Server::stop() {
     should_stop_ = true;
-    close(listen_socket_.get());  // Close the listening socket
+    close(listen_socket_.release());  // Close the listening socket
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+    }
     std::cout << "Stopping server...\n";
 }
 
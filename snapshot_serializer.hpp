@@ -0,0 +1,387 @@
+#ifndef SNAPSHOT_SERIALIZER_HPP
+#define SNAPSHOT_SERIALIZER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <functional>
+#include <expected>
+#include <system_error>
+#include "common.hpp"
+#include "entry_manager.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Point-in-time dump of the whole keyspace, used for raft snapshots (and anything else that needs to ship the
+keyspace around). Layout, all integers host-endian since both ends run the same build:
+
+    "VDBSNAP1"
+    record*     u8 tag | u32 key_len | key | i64 ttl_ms (-1 = none) | value
+    0xFF | u64 record_count | u32 crc32c(everything before the crc)
+
+values by tag:
+    String  u32 len | bytes
+    Int     i64
+    Double  f64
+    List    u32 n | n * string
+    Hash    u32 n | n * (string, string)
+    Set     u32 n | n * string
+    ZSet    u32 n | n * (string, f64)
+
+write() hands out chunk_bytes at a time so a caller can stream straight into a file or socket without holding
+the whole image in memory.
+
+write() walks the live keyspace, so it runs under db_'s read locks for as long as the sink takes. Callers
+that can't stall the keyspace that long fork() under EntryManager::freeze() and call write_frozen() in the
+child, which walks the child's copy-on-write image of the keyspace instead.
+*/
+
+class SnapshotSerializer {
+public:
+    static constexpr std::string_view k_magic = "VDBSNAP1";
+    static constexpr size_t k_default_chunk = 64 * 1024;
+
+    enum class Tag : uint8_t {
+        String = 0,
+        Int    = 1,
+        Double = 2,
+        List   = 3,
+        Hash   = 4,
+        Set    = 5,
+        ZSet   = 6,
+        End    = 0xFF
+    };
+
+    using Sink = std::function<Result<void>(std::span<const uint8_t>)>;
+
+    // streams the keyspace into sink; returns the number of records written.
+    static Result<uint64_t> write(EntryManager& entry_manager, const Sink& sink, size_t chunk_bytes = k_default_chunk) {
+        auto tiers = entry_manager.lock_tiers(); // demoted values are read straight from the value log
+        return write_entries(entry_manager, sink, chunk_bytes, false);
+    }
+
+    // write() in a child forked under EntryManager::freeze() (see RaftSnapshotStore::create): the locks the
+    // child inherited stay held there, so it takes none - and it doesn't log, stderr's lock may be one of them
+    static Result<uint64_t> write_frozen(EntryManager& entry_manager, const Sink& sink,
+                                         size_t chunk_bytes = k_default_chunk) {
+        return write_entries(entry_manager, sink, chunk_bytes, true);
+    }
+
+    // replaces the keyspace with the image in `data`. the checksum is verified before anything is touched.
+    static Result<size_t> load(EntryManager& entry_manager, std::span<const uint8_t> data) {
+        if (data.size() < k_magic.size() + 1 + sizeof(uint64_t) + sizeof(uint32_t) ||
+            std::memcmp(data.data(), k_magic.data(), k_magic.size()) != 0) {
+            return std::unexpected(std::make_error_code(std::errc::bad_message));
+        }
+        uint32_t stored_crc;
+        std::memcpy(&stored_crc, data.data() + data.size() - sizeof(stored_crc), sizeof(stored_crc));
+        if (crc32c(data.data(), data.size() - sizeof(stored_crc)) != stored_crc) {
+            return std::unexpected(std::make_error_code(std::errc::bad_message));
+        }
+
+        entry_manager.clear_all();
+
+        Reader in(data.subspan(k_magic.size(), data.size() - k_magic.size() - sizeof(stored_crc)));
+        size_t count = 0;
+        while (true) {
+            uint8_t tag;
+            if (!in.u8(tag)) {
+                return std::unexpected(std::make_error_code(std::errc::bad_message));
+            }
+            if (tag == static_cast<uint8_t>(Tag::End)) {
+                break;
+            }
+            if (!read_entry(in, static_cast<Tag>(tag), entry_manager)) {
+                return std::unexpected(std::make_error_code(std::errc::bad_message));
+            }
+            ++count;
+        }
+
+        uint64_t expected_count;
+        if (!in.u64(expected_count) || expected_count != count) {
+            return std::unexpected(std::make_error_code(std::errc::bad_message));
+        }
+        return count;
+    }
+
+private:
+    class Writer {
+    public:
+        Writer(const Sink& sink, size_t chunk_bytes) : sink_(sink), chunk_bytes_(chunk_bytes) {
+            buffer_.reserve(chunk_bytes_ + 256);
+        }
+
+        void bytes(const void* data, size_t len) {
+            const uint8_t* raw = static_cast<const uint8_t*>(data);
+            buffer_.insert(buffer_.end(), raw, raw + len);
+            if (buffer_.size() >= chunk_bytes_) {
+                flush();
+            }
+        }
+        void u8(uint8_t v) { bytes(&v, sizeof(v)); }
+        void u32(uint32_t v) { bytes(&v, sizeof(v)); }
+        void u64(uint64_t v) { bytes(&v, sizeof(v)); }
+        void i64(int64_t v) { bytes(&v, sizeof(v)); }
+        void f64(double v) { bytes(&v, sizeof(v)); }
+        void str(std::string_view s) {
+            u32(static_cast<uint32_t>(s.size()));
+            bytes(s.data(), s.size());
+        }
+
+        // crc goes out last, after everything else has been flushed through it
+        void finish() {
+            flush();
+            uint32_t crc = crc_;
+            const uint8_t* raw = reinterpret_cast<const uint8_t*>(&crc);
+            buffer_.assign(raw, raw + sizeof(crc));
+            flush();
+        }
+
+        [[nodiscard]] bool ok() const noexcept { return !error_; }
+        [[nodiscard]] std::error_code error() const noexcept { return error_; }
+
+    private:
+        void flush() {
+            if (buffer_.empty() || error_) {
+                buffer_.clear();
+                return;
+            }
+            crc_ = crc32c(buffer_.data(), buffer_.size(), crc_);
+            if (auto result = sink_(buffer_); !result) {
+                error_ = result.error();
+            }
+            buffer_.clear();
+        }
+
+        const Sink& sink_;
+        size_t chunk_bytes_;
+        std::vector<uint8_t> buffer_;
+        uint32_t crc_{0};
+        std::error_code error_;
+    };
+
+    class Reader {
+    public:
+        explicit Reader(std::span<const uint8_t> data) : data_(data) {}
+
+        bool bytes(void* out, size_t len) {
+            if (data_.size() - pos_ < len) {
+                return false;
+            }
+            std::memcpy(out, data_.data() + pos_, len);
+            pos_ += len;
+            return true;
+        }
+        bool u8(uint8_t& v) { return bytes(&v, sizeof(v)); }
+        bool u32(uint32_t& v) { return bytes(&v, sizeof(v)); }
+        bool u64(uint64_t& v) { return bytes(&v, sizeof(v)); }
+        bool i64(int64_t& v) { return bytes(&v, sizeof(v)); }
+        bool f64(double& v) { return bytes(&v, sizeof(v)); }
+        bool str(std::string& s) {
+            uint32_t len;
+            if (!u32(len) || data_.size() - pos_ < len) {
+                return false;
+            }
+            s.assign(reinterpret_cast<const char*>(data_.data() + pos_), len);
+            pos_ += len;
+            return true;
+        }
+
+    private:
+        std::span<const uint8_t> data_;
+        size_t pos_{0};
+    };
+
+    static Result<uint64_t> write_entries(EntryManager& entry_manager, const Sink& sink, size_t chunk_bytes,
+                                          bool frozen) {
+        Writer out(sink, chunk_bytes);
+        out.bytes(k_magic.data(), k_magic.size());
+
+        uint64_t count = 0;
+        std::string cold;
+        auto visit = [&](const std::shared_ptr<EntryBase>& entry) {
+            if (!out.ok()) {
+                return;
+            }
+            const std::string* evicted = nullptr;
+            if (entry->value_evicted) {
+                if (frozen ? !entry_manager.read_evicted_frozen(*entry, cold) : !entry_manager.read_evicted(*entry, cold)) {
+                    if (!frozen) {
+                        log_message("snapshot: skipping {}, its value log record is unreadable", entry->key);
+                    }
+                    return;
+                }
+                evicted = &cold;
+            }
+            if (write_entry(out, *entry, entry_manager.get_expiry_time(*entry), evicted, frozen)) {
+                ++count;
+            }
+        };
+        if (frozen) {
+            entry_manager.for_each_entry_frozen(visit);
+        } else {
+            entry_manager.for_each_entry(visit);
+        }
+
+        out.u8(static_cast<uint8_t>(Tag::End));
+        out.u64(count);
+        out.finish();
+        if (!out.ok()) {
+            return std::unexpected(out.error());
+        }
+        return count;
+    }
+
+    template<typename T>
+    static const T* value_of(const EntryBase& entry) {
+        auto* typed = dynamic_cast<const Entry<T>*>(&entry);
+        return typed ? &typed->value : nullptr;
+    }
+
+    // `evicted`: the value of a string entry demoted to the value log, which its Entry no longer holds
+    static bool write_entry(Writer& out, const EntryBase& entry, int64_t ttl_ms, const std::string* evicted, bool frozen) {
+        auto header = [&](Tag tag) {
+            out.u8(static_cast<uint8_t>(tag));
+            out.str(entry.key);
+            out.i64(ttl_ms);
+        };
+
+        if (auto* v = evicted ? evicted : value_of<std::string>(entry)) {
+            header(Tag::String);
+            out.str(*v);
+        } else if (auto* v = value_of<int64_t>(entry)) {
+            header(Tag::Int);
+            out.i64(*v);
+        } else if (auto* v = value_of<double>(entry)) {
+            header(Tag::Double);
+            out.f64(*v);
+        } else if (auto* v = value_of<std::vector<std::string>>(entry)) {
+            header(Tag::List);
+            out.u32(static_cast<uint32_t>(v->size()));
+            for (const auto& item : *v) {
+                out.str(item);
+            }
+        } else if (auto* v = value_of<std::unordered_map<std::string, std::string>>(entry)) {
+            header(Tag::Hash);
+            out.u32(static_cast<uint32_t>(v->size()));
+            for (const auto& [field, value] : *v) {
+                out.str(field);
+                out.str(value);
+            }
+        } else if (auto* v = value_of<std::unordered_set<std::string>>(entry)) {
+            header(Tag::Set);
+            out.u32(static_cast<uint32_t>(v->size()));
+            for (const auto& item : *v) {
+                out.str(item);
+            }
+        } else if (auto* v = value_of<std::unique_ptr<ZSet>>(entry)) {
+            header(Tag::ZSet);
+            if (!*v) {
+                out.u32(0);
+                return true;
+            }
+            std::shared_lock<SiteMutex<std::shared_mutex>> lock;
+            if (!frozen) {
+                lock = std::shared_lock((*v)->zset_mutex_);
+            }
+            out.u32(static_cast<uint32_t>((*v)->nodes_.size()));
+            for (const auto& node : (*v)->nodes_) {
+                out.str(node->get_key());
+                out.f64(node->get_value());
+            }
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static bool read_entry(Reader& in, Tag tag, EntryManager& entry_manager) {
+        std::string key;
+        int64_t ttl_ms;
+        if (!in.str(key) || !in.i64(ttl_ms)) {
+            return false;
+        }
+
+        std::shared_ptr<EntryBase> entry;
+        uint32_t n = 0;
+        switch (tag) {
+            case Tag::String: {
+                std::string v;
+                if (!in.str(v)) return false;
+                entry = entry_manager.create_entry(std::move(key), std::move(v));
+                break;
+            }
+            case Tag::Int: {
+                int64_t v;
+                if (!in.i64(v)) return false;
+                entry = entry_manager.create_entry(std::move(key), v);
+                break;
+            }
+            case Tag::Double: {
+                double v;
+                if (!in.f64(v)) return false;
+                entry = entry_manager.create_entry(std::move(key), v);
+                break;
+            }
+            case Tag::List: {
+                if (!in.u32(n)) return false;
+                std::vector<std::string> v(n);
+                for (auto& item : v) {
+                    if (!in.str(item)) return false;
+                }
+                entry = entry_manager.create_entry(std::move(key), std::move(v));
+                break;
+            }
+            case Tag::Hash: {
+                if (!in.u32(n)) return false;
+                std::unordered_map<std::string, std::string> v;
+                v.reserve(n);
+                for (uint32_t i = 0; i < n; ++i) {
+                    std::string field, value;
+                    if (!in.str(field) || !in.str(value)) return false;
+                    v.emplace(std::move(field), std::move(value));
+                }
+                entry = entry_manager.create_entry(std::move(key), std::move(v));
+                break;
+            }
+            case Tag::Set: {
+                if (!in.u32(n)) return false;
+                std::unordered_set<std::string> v;
+                v.reserve(n);
+                for (uint32_t i = 0; i < n; ++i) {
+                    std::string item;
+                    if (!in.str(item)) return false;
+                    v.insert(std::move(item));
+                }
+                entry = entry_manager.create_entry(std::move(key), std::move(v));
+                break;
+            }
+            case Tag::ZSet: {
+                if (!in.u32(n)) return false;
+                auto zset = std::make_unique<ZSet>();
+                for (uint32_t i = 0; i < n; ++i) {
+                    std::string member;
+                    double score;
+                    if (!in.str(member) || !in.f64(score)) return false;
+                    zset->add_internal(member, score);
+                }
+                entry = entry_manager.create_entry(std::move(key), std::move(zset));
+                break;
+            }
+            default:
+                return false;
+        }
+
+        if (ttl_ms > 0) {
+            entry_manager.set_entry_ttl(*entry, ttl_ms);
+        }
+        return true;
+    }
+};
+
+#endif // SNAPSHOT_SERIALIZER_HPP
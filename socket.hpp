@@ -41,6 +41,9 @@ public:
     
     // returns the file descriptor
     [[nodiscard]] int get() const noexcept { return fd_; }
+
+    // gives up ownership without closing: the caller closes the fd
+    int release() noexcept { return std::exchange(fd_, -1); }
     
     // sets the socket to non-blocking mode
     Result<void> set_nonblocking() const {
@@ -1,120 +1,171 @@
 #ifndef COUNTMINSKETCH_HPP
 #define COUNTMINSKETCH_HPP
 
+#include <cstdint>
+#include <cstddef>
 #include <vector>
-#include <random>
-#include <chrono>
+#include <atomic>
+#include <memory>
+#include <bit>
+#include <algorithm>
 
+/*
+Frequency sketch for cache admission / tiering decisions: 4-bit saturating counters, depth 4, plus a bloom
+filter "doorkeeper" in front (TinyLFU).
 
-//E ach element in _bits is a 32-bit int storing 8 counters (4 bits per counter)
+Layout: 64-byte blocks of 8 x uint64_t. A key hashes to one block, and everything about it lives there: its 4
+depth counters and, with the doorkeeper on, its 3 doorkeeper bits. So an update or an estimate touches
+exactly one cache line, instead of one per row plus one for the filter. Everything is driven by the single
+64-bit hash the caller provides - its low bits pick the block, a remix of it picks the positions inside.
 
-class CountMinRow {
-    private:
-        friend class CountMinSketch;
-        std::vector<int> _bits;
-
-        int get(int value) const {
-            int countIndex = value / 8; // get vector index
-            int countOffset = value % 8 * 4; // get the offset in index with 4-bit stride
+    doorkeeper on:   words 0-5: 96 counters, 24 per depth          words 6-7: 128 doorkeeper bits
+    doorkeeper off:  words 0-7: 128 counters, 32 per depth (words 2i and 2i+1)
 
-            return (_bits[countIndex] >> countOffset) & 0x7;
-        }
+Doorkeeper: the first time a key is seen it only sets its doorkeeper bits; its counters start counting from
+the second hit. One-hit wonders - most keys in a skewed workload - never reach the counters, so they don't
+inflate the ones other keys collide with. getCountMin() adds the doorkeeper bit back, so a key seen once
+estimates as 1. decay() halves the counters and clears the doorkeeper.
 
-        void increment(int value) {
-            int countIndex = value / 8; // get vector index
-            int countOffset = value % 8 * 4; // get the offset in index with 4-bit stride
+Concurrency: words are std::atomic<uint64_t> accessed with relaxed loads and stores, no read-modify-write.
+A counter is only ever written as (value it was read at) + 1 while below 15, so a nibble can't carry into its
+neighbour; two threads racing on one word can lose an increment (or a decay can), which a frequency estimate
+tolerates. Nothing is locked and no lock-prefixed instruction is issued on the hot path.
+*/
 
-            int value = (_bits[countIndex] >> countOffset) & 0x7;
+class CountMinSketch {
+    public:
+        static constexpr int COUNT_MIN_SKETCH_DEPTH = 4;
+        static constexpr uint8_t MAX_COUNT = 15;
 
-            if (value < 15) {
-                _bits[countIndex] += (1 << countOffset);
-		    }
+        // countNum: counters per depth (rounded up); roughly the number of distinct keys you want to tell apart
+        explicit CountMinSketch(size_t countNum, bool doorkeeper = true) : door_(doorkeeper) {
+            size_t per_block = door_ ? 24 : 32; // counters per depth per block
+            size_t blocks = std::bit_ceil(std::max<size_t>(1, (countNum + per_block - 1) / per_block));
+            blocks_ = std::make_unique<Block[]>(blocks);
+            block_mask_ = blocks - 1;
         }
 
-        void clear() {
-            for (auto& it : _bits) {
-                it = 0;
+        CountMinSketch(const CountMinSketch&) = delete;
+        CountMinSketch& operator=(const CountMinSketch&) = delete;
+
+        // estimated count of `hash`, 0..MAX_COUNT + 1
+        int getCountMin(uint64_t hash) const {
+            uint64_t mixed = remix(hash);
+            const Block& block = blocks_[hash & block_mask_];
+            int min = MAX_COUNT;
+            for (int i = 0; i < COUNT_MIN_SKETCH_DEPTH; i++) {
+                auto [word, shift] = slot(mixed, i);
+                int count = static_cast<int>((block.words[word].load(std::memory_order_relaxed) >> shift) & 0xF);
+                min = std::min(min, count);
             }
-        }
-        /*
-        This line: Halves all counters by shifting right... Removes invalid bits caused by carry-over ... Keeps all 4-bit counters valid and self-contained*/
-        void decay() {
-            for (auto& it : _bits) {
-                // 0x77777777 = 
-                // 0111 0111 0111 0111 0111.
-                // When we bitshift left, we have carry over digits
-                // && these with 0x777777... guarantees these digits are set to 0!
-                it = (it >> 1) & 0x77777777;
+            if (door_ && door_contains(block, mixed)) {
+                min += 1;
             }
+            return min;
         }
 
-    public:
-        explicit CountMinRow(size_t countNum) : _bits((countNum < 8 ? 8 : countNum) / 8, 0) {}
-};    
-
-class CountMinSketch {    
-    private:
-        std::vector<CountMinRow> rows_;
-        std::vector<uint32_t> seed_;	
-        uint32_t mask_;					
-    
-        static const int COUNT_MIN_SKETCH_DEPTH = 4;
-    
-        int next2Power(int x) {
-            x--;
-            x |= x >> 1;
-            x |= x >> 2;
-            x |= x >> 4;
-            x |= x >> 8;
-            x |= x >> 16;
-            x |= x >> 32;
-            x++;
-            return x;
-        }
-    public:
-        explicit CountMinSketch(size_t countNum) : seed_(4) {
-            countNum = next2Power(countNum);
-            if (countNum < 8) {
-                countNum = 8;
+        void increment(uint64_t hash) {
+            uint64_t mixed = remix(hash);
+            Block& block = blocks_[hash & block_mask_];
+            if (door_ && door_insert(block, mixed)) {
+                return; // first sighting since the last decay
             }
-            rows_.resize(4, CountMinRow(countNum));
-            mask_ = countNum - 1;
-    
-            unsigned time = std::chrono::system_clock::now().time_since_epoch().count();
-            std::mt19937 generator(time);
             for (int i = 0; i < COUNT_MIN_SKETCH_DEPTH; i++) {
-                generator.discard(generator.state_size);
-                seed_[i] = generator();
+                auto [word, shift] = slot(mixed, i);
+                auto& w = block.words[word];
+                uint64_t cur = w.load(std::memory_order_relaxed);
+                if (((cur >> shift) & 0xF) < MAX_COUNT) {
+                    w.store(cur + (uint64_t{1} << shift), std::memory_order_relaxed);
+                }
             }
         }
-    
-        int getCountMin(uint32_t hash) {
-            int min = 16, value = 0;
-            for (int i = 0; i < rows_.size(); i++) {
-                value = rows_[i].get((hash ^ seed_[i]) & mask_);
-    
-                min = (value < min) ? value : min;
+
+        // halve every counter (shifting each word right leaks a bit into the nibble below; the mask drops it)
+        void decay() {
+            for (size_t b = 0; b <= block_mask_; b++) {
+                auto& words = blocks_[b].words;
+                int counter_words = door_ ? 6 : 8;
+                for (int w = 0; w < counter_words; w++) {
+                    words[w].store((words[w].load(std::memory_order_relaxed) >> 1) & 0x7777777777777777ull,
+                                   std::memory_order_relaxed);
+                }
+                for (int w = counter_words; w < 8; w++) {
+                    words[w].store(0, std::memory_order_relaxed);
+                }
             }
-            return min;
         }
-    
-        void increment(uint32_t hash) {
-            for (int i = 0; i < rows_.size(); i++) {
-                rows_[i].increment((hash ^ seed_[i]) & mask_);
+
+        void clear() {
+            for (size_t b = 0; b <= block_mask_; b++) {
+                for (auto& w : blocks_[b].words) {
+                    w.store(0, std::memory_order_relaxed);
+                }
             }
         }
-    
-        void decay() {
-            for (auto& row : rows_) {
-                row.decay();
+
+        [[nodiscard]] size_t memory_bytes() const noexcept {
+            return (block_mask_ + 1) * sizeof(Block);
+        }
+
+    private:
+        struct alignas(64) Block {
+            std::atomic<uint64_t> words[8];
+        };
+        static_assert(sizeof(Block) == 64);
+
+        bool door_;
+        std::unique_ptr<Block[]> blocks_;
+        size_t block_mask_ = 0;
+
+        // the block comes from the raw hash's low bits, positions inside it from a remix, so the two stay
+        // independent even when the caller's hash is weak in its high bits
+        static uint64_t remix(uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ull;
+            h ^= h >> 33;
+            return h;
+        }
+
+        // depth i: with the doorkeeper, nibble 24i + (8 bits of the remix scaled to 0..23); without, 5 bits
+        // pick one of the 32 nibbles in words 2i / 2i+1
+        std::pair<int, int> slot(uint64_t mixed, int i) const {
+            uint64_t bits = mixed >> (i * 8);
+            int nibble = door_ ? 24 * i + static_cast<int>(((bits & 0xFF) * 24) >> 8) : 32 * i + static_cast<int>(bits & 0x1F);
+            return {nibble >> 4, (nibble & 15) * 4};
+        }
+
+        // doorkeeper probe p: 7 bits of the remix above the slot bits, one of the 128 bits in words 6-7
+        static std::pair<int, uint64_t> door_bit(uint64_t mixed, int p) {
+            int bit = static_cast<int>((mixed >> (32 + p * 7)) & 0x7F);
+            return {6 + (bit >> 6), uint64_t{1} << (bit & 63)};
+        }
+
+        static bool door_contains(const Block& block, uint64_t mixed) {
+            for (int p = 0; p < 3; p++) {
+                auto [word, bit] = door_bit(mixed, p);
+                if (!(block.words[word].load(std::memory_order_relaxed) & bit)) {
+                    return false;
+                }
             }
+            return true;
         }
-    
-        void clear() {
-            for (auto& row : rows_) {
-                row.clear();
+
+        // true if the key was not in the doorkeeper yet (and now is)
+        static bool door_insert(Block& block, uint64_t mixed) {
+            bool inserted = false;
+            for (int p = 0; p < 3; p++) {
+                auto [word, bit] = door_bit(mixed, p);
+                auto& w = block.words[word];
+                uint64_t cur = w.load(std::memory_order_relaxed);
+                if (!(cur & bit)) {
+                    w.store(cur | bit, std::memory_order_relaxed);
+                    inserted = true;
+                }
             }
+            return inserted;
         }
-    };
+};
 
-#endif
\ No newline at end of file
+#endif
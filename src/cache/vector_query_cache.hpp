@@ -0,0 +1,321 @@
+#ifndef VECTOR_QUERY_CACHE_HPP
+#define VECTOR_QUERY_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <list>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include "CountMinSketch.cpp"
+#include "../dsa/hashtable.hpp"
+
+/*
+Result cache for k-NN vector queries. Search traffic repeats itself (identical embeddings out of cached
+upstream models), and every repeat otherwise pays for a full index traversal.
+
+Entries are keyed by a hash of (query vector bytes, k, ef, filter), where filter is whatever 64-bit tag
+the caller derives from its filter (0 for none). The full query is kept alongside, so a hash collision is
+a miss, never a wrong answer.
+
+Memory is bounded by max_bytes, split over `shards` LRU lists each with its own mutex. Admission is TinyLFU:
+every lookup counts the query in the shard's CountMinSketch, and once the shard is full a new result only gets
+in if its query is more frequent than the LRU victim it would evict. So a burst of one-off queries can't flush
+the repeated ones.
+
+Invalidation follows the index:
+    on_insert()          new vectors can enter any result, so this bumps the generation and every older
+                         entry turns stale (inserts_invalidate = false skips that, for callers that can live
+                         with results missing the newest vectors)
+    on_delete(label)     drops only the cached results that contain `label`
+    bump_generation()    everything, e.g. after a rebuild
+A search that overlaps a write must not cache what it computed, so get_or_compute() takes a Ticket before
+searching and insert() refuses results whose ticket predates a write.
+
+Metrics: hits, misses, admissions/rejections, invalidations, and saved_ns - the search time each hit would
+otherwise have spent, as measured when the entry was computed.
+*/
+
+class VectorQueryCache {
+public:
+    using Label = size_t;
+    using Hits = std::vector<std::pair<float, Label>>;     // (distance, label), as the index returns them
+
+    struct Options {
+        size_t max_bytes = 64ull << 20;
+        size_t shards = 8;
+        bool inserts_invalidate = true;
+    };
+
+    struct Query {
+        std::span<const float> vector;
+        uint32_t k = 10;
+        uint32_t ef = 0;
+        uint64_t filter = 0;
+    };
+
+    // index state a search started from
+    struct Ticket {
+        uint64_t generation;
+        uint64_t deletes;
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t admitted;
+        uint64_t rejected;              // TinyLFU said the victim was more valuable
+        uint64_t evicted;
+        uint64_t invalidated;           // dropped by on_delete, or found stale after a generation bump
+        uint64_t entries;
+        uint64_t bytes;
+        uint64_t saved_ns;              // search time hits didn't spend
+
+        [[nodiscard]] double hit_rate() const noexcept {
+            return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+        }
+    };
+
+    explicit VectorQueryCache(Options options) : options_(options) {
+        options_.shards = std::max<size_t>(1, options_.shards);
+        for (size_t i = 0; i < options_.shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>(options_.max_bytes / options_.shards));
+        }
+    }
+
+    VectorQueryCache() : VectorQueryCache(Options()) {}
+
+    VectorQueryCache(const VectorQueryCache&) = delete;
+    VectorQueryCache& operator=(const VectorQueryCache&) = delete;
+
+    static uint64_t hash(const Query& query) {
+        uint64_t h = hash_key(query.vector.data(), query.vector.size_bytes());
+        uint64_t params[3] = {query.k, query.ef, query.filter};
+        return h ^ (hash_key(params, sizeof(params)) * 0x9e3779b97f4a7c15ull);
+    }
+
+    [[nodiscard]] Ticket ticket() const noexcept {
+        return {generation_.load(std::memory_order_acquire), deletes_.load(std::memory_order_acquire)};
+    }
+
+    std::optional<Hits> lookup(const Query& query) {
+        uint64_t h = hash(query);
+        Shard& shard = shard_of(h);
+        std::lock_guard lock(shard.mutex);
+        shard.touch(h);
+        auto it = shard.index.find(h);
+        if (it == shard.index.end() || !it->second->matches(query)) {
+            ++shard.misses;
+            return std::nullopt;
+        }
+        if (it->second->generation != generation_.load(std::memory_order_acquire)) {
+            shard.erase(it->second);
+            ++shard.invalidated;
+            ++shard.misses;
+            return std::nullopt;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        ++shard.hits;
+        shard.saved_ns += it->second->cost_ns;
+        return it->second->hits;
+    }
+
+    // cache `hits` for `query`, computed in `cost` starting from `ticket`; false if not admitted
+    bool insert(const Query& query, Hits hits, std::chrono::nanoseconds cost, Ticket ticket) {
+        uint64_t h = hash(query);
+        Entry entry{h, std::vector<float>(query.vector.begin(), query.vector.end()), query.k, query.ef, query.filter,
+                    std::move(hits), ticket.generation, static_cast<uint64_t>(cost.count()), 0};
+        entry.bytes = sizeof(Entry) + entry.query.size() * sizeof(float) +
+                      entry.hits.size() * (sizeof(Hits::value_type) + k_label_index_bytes) + k_index_bytes;
+
+        Shard& shard = shard_of(h);
+        std::lock_guard lock(shard.mutex);
+        // checked under the shard lock: a write that lands after this either bumped the generation (the entry
+        // reads as stale) or will find the entry in by_label once it gets the lock
+        Ticket now = this->ticket();
+        if (now.generation != ticket.generation || now.deletes != ticket.deletes) {
+            return false; // the index changed under the search
+        }
+        if (auto it = shard.index.find(h); it != shard.index.end()) {
+            shard.erase(it->second);
+        }
+        return shard.admit(std::move(entry));
+    }
+
+    // lookup, else run search() and cache what it returns
+    template<typename Search>
+    Hits get_or_compute(const Query& query, Search&& search) {
+        if (auto cached = lookup(query)) {
+            return std::move(*cached);
+        }
+        Ticket before = ticket();
+        auto start = std::chrono::steady_clock::now();
+        Hits hits = search();
+        auto cost = std::chrono::steady_clock::now() - start;
+        insert(query, hits, std::chrono::duration_cast<std::chrono::nanoseconds>(cost), before);
+        return hits;
+    }
+
+    void on_insert() {
+        if (options_.inserts_invalidate) {
+            bump_generation();
+        }
+    }
+
+    void on_delete(Label label) {
+        deletes_.fetch_add(1, std::memory_order_acq_rel);
+        for (auto& shard : shards_) {
+            std::lock_guard lock(shard->mutex);
+            auto it = shard->by_label.find(label);
+            if (it == shard->by_label.end()) continue;
+            std::vector<uint64_t> hashes = it->second; // erase() edits by_label
+            for (uint64_t h : hashes) {
+                if (auto e = shard->index.find(h); e != shard->index.end()) {
+                    shard->erase(e->second);
+                    ++shard->invalidated;
+                }
+            }
+        }
+    }
+
+    // stale entries are dropped lazily, on their next lookup or when LRU reaches them
+    void bump_generation() {
+        generation_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard lock(shard->mutex);
+            shard->lru.clear();
+            shard->index.clear();
+            shard->by_label.clear();
+            shard->bytes = 0;
+        }
+    }
+
+    [[nodiscard]] Stats stats() const {
+        Stats s{};
+        for (const auto& shard : shards_) {
+            std::lock_guard lock(shard->mutex);
+            s.hits += shard->hits;
+            s.misses += shard->misses;
+            s.admitted += shard->admitted;
+            s.rejected += shard->rejected;
+            s.evicted += shard->evicted;
+            s.invalidated += shard->invalidated;
+            s.entries += shard->index.size();
+            s.bytes += shard->bytes;
+            s.saved_ns += shard->saved_ns;
+        }
+        return s;
+    }
+
+private:
+    // rough per-entry overhead of the hash index and of one by_label slot
+    static constexpr size_t k_index_bytes = 64;
+    static constexpr size_t k_label_index_bytes = 48;
+
+    struct Entry {
+        uint64_t hash;
+        std::vector<float> query;
+        uint32_t k;
+        uint32_t ef;
+        uint64_t filter;
+        Hits hits;
+        uint64_t generation;
+        uint64_t cost_ns;
+        size_t bytes;
+
+        bool matches(const Query& q) const {
+            return k == q.k && ef == q.ef && filter == q.filter && query.size() == q.vector.size() &&
+                   std::memcmp(query.data(), q.vector.data(), q.vector.size_bytes()) == 0;
+        }
+    };
+
+    struct Shard {
+        using Lru = std::list<Entry>;
+
+        explicit Shard(size_t budget)
+            // one counter per ~256 bytes of budget: a few times more counters than entries
+            : budget(budget), sketch(std::max<size_t>(1024, budget / 256)) {}
+
+        std::mutex mutex;
+        size_t budget;
+        size_t bytes = 0;
+        Lru lru;                                                // front = most recent
+        std::unordered_map<uint64_t, Lru::iterator> index;
+        std::unordered_map<Label, std::vector<uint64_t>> by_label;
+        CountMinSketch sketch;
+        uint64_t touches = 0;
+        uint64_t hits = 0, misses = 0, admitted = 0, rejected = 0, evicted = 0, invalidated = 0, saved_ns = 0;
+
+        // count a lookup for admission; age the sketch every ~10 lookups per entry so it follows the workload
+        void touch(uint64_t h) {
+            sketch.increment(h);
+            if (++touches >= std::max<uint64_t>(4096, 10 * index.size())) {
+                sketch.decay();
+                touches = 0;
+            }
+        }
+
+        bool admit(Entry&& entry) {
+            if (entry.bytes > budget) {
+                ++rejected;
+                return false;
+            }
+            int freq = sketch.getCountMin(entry.hash);
+            while (bytes + entry.bytes > budget) {
+                Entry& victim = lru.back();
+                if (victim.generation == entry.generation && sketch.getCountMin(victim.hash) >= freq) {
+                    ++rejected;
+                    return false;
+                }
+                erase(std::prev(lru.end())); // stale victims go without a contest
+                ++evicted;
+            }
+            lru.push_front(std::move(entry));
+            Entry& e = lru.front();
+            index.emplace(e.hash, lru.begin());
+            for (const auto& [distance, label] : e.hits) {
+                by_label[label].push_back(e.hash);
+            }
+            bytes += e.bytes;
+            ++admitted;
+            return true;
+        }
+
+        void erase(Lru::iterator it) {
+            for (const auto& [distance, label] : it->hits) {
+                auto l = by_label.find(label);
+                if (l == by_label.end()) continue;
+                auto& hashes = l->second;
+                if (auto pos = std::find(hashes.begin(), hashes.end(), it->hash); pos != hashes.end()) {
+                    *pos = hashes.back();
+                    hashes.pop_back();
+                }
+                if (hashes.empty()) by_label.erase(l);
+            }
+            bytes -= it->bytes;
+            index.erase(it->hash);
+            lru.erase(it);
+        }
+    };
+
+    Shard& shard_of(uint64_t h) {
+        return *shards_[(h >> 32) % shards_.size()];
+    }
+
+    Options options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<uint64_t> deletes_{0};
+};
+
+#endif // VECTOR_QUERY_CACHE_HPP
@@ -0,0 +1,688 @@
+#ifndef CLIENT_CLIENT_HPP
+#define CLIENT_CLIENT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <functional>
+#include <coroutine>
+#include <expected>
+#include <system_error>
+#include <type_traits>
+#include <initializer_list>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../../common.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Client library for the framed protocol: what an application links instead of hand-rolling blocking sockets
+the way tests/client.cpp does.
+
+A ClientPool holds `connections` TCP connections to one server and one io thread that drives all of them
+with epoll. call() picks the connection with the fewest calls outstanding and appends the request to that
+connection's submit queue. Then it wakes the io thread through an eventfd, unless a wakeup is already
+pending. The io thread takes everything queued on a connection and sends it with writev, so concurrent calls
+go out as one pipelined batch: a burst of N calls costs one wakeup and one write rather than N round trips.
+The server answers a connection's frames in order, so replies are matched to calls FIFO.
+
+Three ways to wait for a reply, all on the same path:
+
+    call(args, callback)        the callback runs on the io thread, so it must not block
+    call(args) -> future        for threads that can block
+    co_await pool.async(args)   resumes the coroutine on the io thread; ClientTask is a fire-and-forget
+                                coroutine type for callers that don't have their own
+
+Arguments: a ClientArg only points at the caller's bytes. Arguments shorter than k_zero_copy_min are copied
+into the request at call(). Longer ones, typically binary vectors (ClientArg::binary(std::span<const float>)),
+go from the caller's memory to the socket through writev with no copy. Their memory must stay valid until the
+call completes. A frame is capped at MAX_MSG_SIZE on the server, so larger calls fail up front with
+std::errc::message_size.
+
+Errors: a call completes with an error_code, never throws. Replies that are Error frames are still replies:
+check Reply::is_error(). A connection that fails fails everything queued or in flight on it with
+connection_reset. The io thread redials it every k_reconnect_interval_ms while other connections take its
+calls. With none left, call() fails with not_connected. Destroying the pool fails whatever is left with
+operation_canceled.
+*/
+
+struct Reply {
+    SerializationType type = SerializationType::Nil;
+    std::string str;            // String payload, or the Error message
+    int64_t integer = 0;        // Integer, or the Error code
+    double number = 0;          // Double
+
+    [[nodiscard]] bool is_nil() const noexcept { return type == SerializationType::Nil; }
+    [[nodiscard]] bool is_error() const noexcept { return type == SerializationType::Error; }
+
+    // one response body, without its length prefix
+    static Result<Reply> parse(std::span<const uint8_t> body) {
+        auto bad = std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        if (body.empty()) {
+            return bad;
+        }
+        Reply reply;
+        reply.type = static_cast<SerializationType>(body[0]);
+        auto rest = body.subspan(1);
+        switch (reply.type) {
+            case SerializationType::Nil:
+                return reply;
+            case SerializationType::Error: {
+                int32_t code;
+                uint32_t len;
+                if (rest.size() < 8) {
+                    return bad;
+                }
+                std::memcpy(&code, rest.data(), 4);
+                std::memcpy(&len, rest.data() + 4, 4);
+                if (rest.size() - 8 < len) {
+                    return bad;
+                }
+                reply.integer = code;
+                reply.str.assign(reinterpret_cast<const char*>(rest.data() + 8), len);
+                return reply;
+            }
+            case SerializationType::String: {
+                uint32_t len;
+                if (rest.size() < 4) {
+                    return bad;
+                }
+                std::memcpy(&len, rest.data(), 4);
+                if (rest.size() - 4 < len) {
+                    return bad;
+                }
+                reply.str.assign(reinterpret_cast<const char*>(rest.data() + 4), len);
+                return reply;
+            }
+            case SerializationType::Integer: {
+                // ascii digits and "\r\n"
+                std::string_view text(reinterpret_cast<const char*>(rest.data()), rest.size());
+                if (text.ends_with("\r\n")) {
+                    text.remove_suffix(2);
+                }
+                bool negative = !text.empty() && text[0] == '-';
+                if (negative) {
+                    text.remove_prefix(1);
+                }
+                if (text.empty()) {
+                    return bad;
+                }
+                for (char c : text) {
+                    if (c < '0' || c > '9') {
+                        return bad;
+                    }
+                    reply.integer = reply.integer * 10 + (c - '0');
+                }
+                reply.integer = negative ? -reply.integer : reply.integer;
+                return reply;
+            }
+            case SerializationType::Double:
+                if (rest.size() < sizeof(double)) {
+                    return bad;
+                }
+                std::memcpy(&reply.number, rest.data(), sizeof(double));
+                return reply;
+        }
+        return bad;
+    }
+};
+
+// one argument of a call: a view of the caller's bytes (see the lifetime rule above)
+class ClientArg {
+public:
+    ClientArg(std::string_view s) noexcept : data_(reinterpret_cast<const uint8_t*>(s.data()), s.size()) {}
+    ClientArg(const std::string& s) noexcept : ClientArg(std::string_view(s)) {}
+    ClientArg(const char* s) noexcept : ClientArg(std::string_view(s)) {}
+
+    // raw bytes of trivially copyable values, e.g. a float vector
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    static ClientArg binary(std::span<const T> values) noexcept {
+        return ClientArg(std::span(reinterpret_cast<const uint8_t*>(values.data()), values.size_bytes()));
+    }
+
+    [[nodiscard]] std::span<const uint8_t> bytes() const noexcept { return data_; }
+
+private:
+    explicit ClientArg(std::span<const uint8_t> data) noexcept : data_(data) {}
+    std::span<const uint8_t> data_;
+};
+
+class ClientPool {
+public:
+    using Callback = std::move_only_function<void(Result<Reply>)>;
+
+    static constexpr size_t k_zero_copy_min = 256;
+    static constexpr size_t k_max_frame = 4096;                 // MAX_MSG_SIZE in connection.hpp
+    static constexpr int k_reconnect_interval_ms = 100;
+
+    struct Options {
+        std::string host = "127.0.0.1";
+        uint16_t port = 1234;
+        size_t connections = 2;
+        std::string unix_path;      // set: connect to Server::listen_unix there instead of host:port
+    };
+
+    struct Stats {
+        uint64_t calls;
+        uint64_t replies;
+        uint64_t writes;            // writev syscalls; calls / writes is the batching factor
+        uint64_t reads;
+        uint64_t reconnects;
+    };
+
+    // connects every connection up front; fails if any of them can't connect
+    static Result<std::unique_ptr<ClientPool>> connect(Options options) {
+        std::unique_ptr<ClientPool> pool(new ClientPool(std::move(options)));
+        if (auto r = pool->open(); !r) {
+            return std::unexpected(r.error());
+        }
+        return pool;
+    }
+
+    ~ClientPool() {
+        stop_.store(true);
+        wake();
+        if (io_thread_.joinable()) {
+            io_thread_.join();
+        }
+        for (auto& conn : conns_) {
+            fail(*conn, std::make_error_code(std::errc::operation_canceled));
+            if (conn->fd >= 0) {
+                ::close(conn->fd);
+            }
+        }
+        if (epoll_fd_ >= 0) {
+            ::close(epoll_fd_);
+        }
+        if (event_fd_ >= 0) {
+            ::close(event_fd_);
+        }
+    }
+
+    ClientPool(const ClientPool&) = delete;
+    ClientPool& operator=(const ClientPool&) = delete;
+
+    void call(std::span<const ClientArg> args, Callback done) {
+        Pending p;
+        if (auto r = encode(args, p); !r) {
+            return done(std::unexpected(r.error()));
+        }
+        p.done = std::move(done);
+
+        // least outstanding, starting from a rotating index so ties spread out
+        size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < conns_.size(); ++i) {
+            Conn* best = nullptr;
+            for (size_t j = 0; j < conns_.size(); ++j) {
+                Conn* c = conns_[(start + j) % conns_.size()].get();
+                if (!c->up.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                if (!best || c->outstanding.load(std::memory_order_relaxed) <
+                                 best->outstanding.load(std::memory_order_relaxed)) {
+                    best = c;
+                }
+            }
+            if (!best) {
+                break;
+            }
+            {
+                std::lock_guard lock(best->mutex);
+                if (!best->up.load(std::memory_order_relaxed)) {
+                    continue;       // went down after we looked
+                }
+                best->queue.push_back(std::move(p));
+                best->outstanding.fetch_add(1, std::memory_order_relaxed);
+            }
+            calls_.fetch_add(1, std::memory_order_relaxed);
+            wake();
+            return;
+        }
+        p.done(std::unexpected(std::make_error_code(std::errc::not_connected)));
+    }
+
+    void call(std::initializer_list<ClientArg> args, Callback done) {
+        call(std::span(args.begin(), args.size()), std::move(done));
+    }
+
+    std::future<Result<Reply>> call(std::span<const ClientArg> args) {
+        std::promise<Result<Reply>> promise;
+        auto future = promise.get_future();
+        call(args, [promise = std::move(promise)](Result<Reply> r) mutable { promise.set_value(std::move(r)); });
+        return future;
+    }
+
+    std::future<Result<Reply>> call(std::initializer_list<ClientArg> args) {
+        return call(std::span(args.begin(), args.size()));
+    }
+
+    // co_await pool.async(args); the ClientArgs are copied into the awaiter, the bytes they point at are not.
+    // GCC 12 rejects a braced list inside a coroutine, so pass a named std::array there
+    class Awaiter {
+    public:
+        Awaiter(ClientPool& pool, std::vector<ClientArg> args) : pool_(pool), args_(std::move(args)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // whichever of await_suspend and the callback finishes second resumes the coroutine, so a call
+        // that completes before await_suspend returns just doesn't suspend
+        bool await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            pool_.call(args_, [this](Result<Reply> r) {
+                result_ = std::move(r);
+                if (done_.exchange(true)) {
+                    handle_.resume();
+                }
+            });
+            return !done_.exchange(true);
+        }
+
+        Result<Reply> await_resume() { return std::move(result_); }
+
+    private:
+        ClientPool& pool_;
+        std::vector<ClientArg> args_;
+        Result<Reply> result_;
+        std::coroutine_handle<> handle_;
+        std::atomic<bool> done_{false};
+    };
+
+    Awaiter async(std::initializer_list<ClientArg> args) { return Awaiter(*this, std::vector<ClientArg>(args)); }
+    Awaiter async(std::span<const ClientArg> args) {
+        return Awaiter(*this, std::vector<ClientArg>(args.begin(), args.end()));
+    }
+
+    [[nodiscard]] Stats stats() const noexcept {
+        return {calls_.load(std::memory_order_relaxed), replies_.load(std::memory_order_relaxed),
+                writes_.load(std::memory_order_relaxed), reads_.load(std::memory_order_relaxed),
+                reconnects_.load(std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] size_t connections() const noexcept { return conns_.size(); }
+
+private:
+    struct Pending {
+        std::vector<uint8_t> head;              // length prefixes and the copied arguments
+        // pieces of the frame in order: a piece with `external` set is a zero-copy argument, otherwise it is
+        // head[offset, offset + length). Empty when the whole frame is `head`.
+        struct Piece {
+            const uint8_t* external;
+            size_t offset;
+            size_t length;
+        };
+        std::vector<Piece> pieces;
+        size_t size = 0;                        // frame bytes
+        Callback done;
+    };
+
+    struct Conn {
+        int fd = -1;
+        std::atomic<bool> up{false};
+        std::atomic<uint32_t> outstanding{0};   // queued or in flight, for picking a connection
+
+        std::mutex mutex;
+        std::vector<Pending> queue;             // submitted, not yet taken by the io thread
+
+        // io thread only
+        std::deque<Pending> inflight;           // taken, in send order; the first `written` are fully sent
+        size_t written = 0;
+        size_t partial = 0;                     // bytes of inflight[written] already sent
+        bool want_write = false;
+        std::vector<uint8_t> in;
+        size_t in_start = 0;
+    };
+
+    Options options_;
+    std::vector<std::unique_ptr<Conn>> conns_;
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    std::thread io_thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> wake_pending_{false};
+    std::atomic<size_t> next_{0};
+    std::atomic<uint64_t> calls_{0}, replies_{0}, writes_{0}, reads_{0}, reconnects_{0};
+
+    explicit ClientPool(Options options) : options_(std::move(options)) {}
+
+    Result<void> open() {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || event_fd_ < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;                  // the eventfd
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev);
+        for (size_t i = 0; i < std::max<size_t>(1, options_.connections); ++i) {
+            conns_.push_back(std::make_unique<Conn>());
+            if (auto r = dial(*conns_.back()); !r) {
+                return r;
+            }
+        }
+        io_thread_ = std::thread([this] { run(); });
+        return {};
+    }
+
+    Result<void> dial(Conn& conn) {
+        if (!options_.unix_path.empty()) {
+            return dial_unix(conn);
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addrs = nullptr;
+        std::string port = std::to_string(options_.port);
+        if (int rc = ::getaddrinfo(options_.host.c_str(), port.c_str(), &hints, &addrs); rc != 0) {
+            return std::unexpected(std::make_error_code(std::errc::host_unreachable));
+        }
+        int fd = -1;
+        int error = ECONNREFUSED;
+        for (addrinfo* a = addrs; a && fd < 0; a = a->ai_next) {
+            fd = ::socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+            if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+                error = errno;
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(addrs);
+        if (fd < 0) {
+            return std::unexpected(std::error_code(error, std::system_category()));
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return attach(conn, fd);
+    }
+
+    Result<void> dial_unix(Conn& conn) {
+        sockaddr_un addr{};
+        if (options_.unix_path.size() >= sizeof(addr.sun_path)) {
+            return std::unexpected(std::make_error_code(std::errc::filename_too_long));
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, options_.unix_path.c_str(), options_.unix_path.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            int error = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return std::unexpected(std::error_code(error, std::system_category()));
+        }
+        return attach(conn, fd);
+    }
+
+    // a connected socket joins the io thread's epoll set
+    Result<void> attach(Conn& conn, int fd) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        conn.fd = fd;
+        conn.in.resize(64 * 1024);
+        conn.in_start = 0;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &conn;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        conn.up.store(true);
+        return {};
+    }
+
+    static Result<void> encode(std::span<const ClientArg> args, Pending& p) {
+        size_t payload = 0;
+        for (const auto& arg : args) payload += 4 + arg.bytes().size();
+        if (args.empty() || 4 + payload > k_max_frame) {
+            return std::unexpected(std::make_error_code(args.empty() ? std::errc::invalid_argument
+                                                                     : std::errc::message_size));
+        }
+        p.size = 4 + payload;
+        p.head.reserve(p.size);
+        auto put_be32 = [&](uint32_t v) {
+            for (int i = 0; i < 4; ++i) p.head.push_back(static_cast<uint8_t>(v >> (24 - 8 * i)));
+        };
+        put_be32(static_cast<uint32_t>(payload));
+        size_t copied_from = 0;                 // start of the head bytes not yet covered by a piece
+        for (const auto& arg : args) {
+            auto bytes = arg.bytes();
+            put_be32(static_cast<uint32_t>(bytes.size()));
+            if (bytes.size() < k_zero_copy_min) {
+                p.head.insert(p.head.end(), bytes.begin(), bytes.end());
+                continue;
+            }
+            p.pieces.push_back({nullptr, copied_from, p.head.size() - copied_from});
+            p.pieces.push_back({bytes.data(), 0, bytes.size()});
+            copied_from = p.head.size();
+        }
+        if (!p.pieces.empty() && copied_from < p.head.size()) {
+            p.pieces.push_back({nullptr, copied_from, p.head.size() - copied_from});
+        }
+        return {};
+    }
+
+    void wake() {
+        if (!wake_pending_.exchange(true)) {
+            uint64_t one = 1;
+            (void)!::write(event_fd_, &one, sizeof(one));
+        }
+    }
+
+    void run() {
+        epoll_event events[64];
+        while (!stop_.load()) {
+            bool any_down = std::any_of(conns_.begin(), conns_.end(), [](const auto& c) { return !c->up.load(); });
+            int n = ::epoll_wait(epoll_fd_, events, 64, any_down ? k_reconnect_interval_ms : -1);
+            if (n < 0 && errno != EINTR) {
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                if (!events[i].data.ptr) {
+                    uint64_t count;
+                    (void)!::read(event_fd_, &count, sizeof(count));
+                    // cleared before draining: a call queued after the drain sees false and wakes us again
+                    wake_pending_.store(false);
+                    for (auto& conn : conns_) {
+                        take_queue(*conn);
+                    }
+                    continue;
+                }
+                Conn& conn = *static_cast<Conn*>(events[i].data.ptr);
+                if (conn.fd < 0) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    read_replies(conn);
+                }
+                if (conn.fd >= 0 && (events[i].events & EPOLLOUT)) {
+                    send(conn);
+                }
+            }
+            if (any_down) {
+                reconnect();
+            }
+        }
+    }
+
+    void take_queue(Conn& conn) {
+        if (conn.fd < 0) {
+            return;
+        }
+        {
+            std::lock_guard lock(conn.mutex);
+            if (conn.queue.empty()) {
+                return;
+            }
+            for (auto& p : conn.queue) conn.inflight.push_back(std::move(p));
+            conn.queue.clear();
+        }
+        send(conn);
+    }
+
+    // writes as much of the unsent tail of `inflight` as the socket takes, one writev per IOV_MAX pieces
+    void send(Conn& conn) {
+        std::vector<iovec> iov;
+        while (conn.written < conn.inflight.size()) {
+            iov.clear();
+            size_t skip = conn.partial;
+            for (size_t i = conn.written; i < conn.inflight.size(); ++i) {
+                auto& p = conn.inflight[i];
+                if (iov.size() + p.pieces.size() + 1 > IOV_MAX) {
+                    break;
+                }
+                auto add = [&](const uint8_t* data, size_t len) {
+                    if (skip >= len) {
+                        skip -= len;
+                        return;
+                    }
+                    iov.push_back({const_cast<uint8_t*>(data + skip), len - skip});
+                    skip = 0;
+                };
+                if (p.pieces.empty()) {
+                    add(p.head.data(), p.head.size());
+                }
+                for (const auto& piece : p.pieces) {
+                    add(piece.external ? piece.external : p.head.data() + piece.offset, piece.length);
+                }
+            }
+            ssize_t n = ::writev(conn.fd, iov.data(), static_cast<int>(iov.size()));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            writes_.fetch_add(1, std::memory_order_relaxed);
+            if (n <= 0) {
+                return down(conn);
+            }
+            size_t sent = conn.partial + static_cast<size_t>(n);
+            while (conn.written < conn.inflight.size() && sent >= conn.inflight[conn.written].size) {
+                sent -= conn.inflight[conn.written].size;
+                ++conn.written;
+            }
+            conn.partial = sent;
+        }
+        bool want_write = conn.written < conn.inflight.size();
+        if (want_write != conn.want_write) {
+            conn.want_write = want_write;
+            epoll_event ev{};
+            ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0u);
+            ev.data.ptr = &conn;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+        }
+    }
+
+    void read_replies(Conn& conn) {
+        while (true) {
+            ssize_t n = ::read(conn.fd, conn.in.data() + conn.in_start, conn.in.size() - conn.in_start);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            }
+            reads_.fetch_add(1, std::memory_order_relaxed);
+            if (n <= 0) {
+                return down(conn);
+            }
+            size_t end = conn.in_start + static_cast<size_t>(n);
+            size_t pos = 0;
+            while (end - pos >= 4) {
+                uint32_t len;
+                std::memcpy(&len, conn.in.data() + pos, 4);
+                if (end - pos - 4 < len) {
+                    if (4 + size_t{len} > conn.in.size()) {
+                        conn.in.resize(4 + size_t{len});
+                    }
+                    break;
+                }
+                if (conn.written == 0) {
+                    return down(conn);      // a reply nobody asked for: the stream is out of sync
+                }
+                Pending p = std::move(conn.inflight.front());
+                conn.inflight.pop_front();
+                --conn.written;
+                conn.outstanding.fetch_sub(1, std::memory_order_relaxed);
+                replies_.fetch_add(1, std::memory_order_relaxed);
+                p.done(Reply::parse(std::span(conn.in.data() + pos + 4, len)));
+                pos += 4 + len;
+            }
+            std::memmove(conn.in.data(), conn.in.data() + pos, end - pos);
+            conn.in_start = end - pos;
+        }
+    }
+
+    // fails everything on the connection and leaves it for reconnect()
+    void down(Conn& conn) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn.fd, nullptr);
+        ::close(conn.fd);
+        conn.fd = -1;
+        fail(conn, std::make_error_code(std::errc::connection_reset));
+    }
+
+    void fail(Conn& conn, std::error_code error) {
+        std::vector<Pending> queued;
+        {
+            std::lock_guard lock(conn.mutex);
+            conn.up.store(false);
+            queued.swap(conn.queue);
+        }
+        std::deque<Pending> inflight;
+        inflight.swap(conn.inflight);
+        conn.written = 0;
+        conn.partial = 0;
+        conn.want_write = false;
+        conn.in_start = 0;
+        for (auto& p : inflight) {
+            conn.outstanding.fetch_sub(1, std::memory_order_relaxed);
+            p.done(std::unexpected(error));
+        }
+        for (auto& p : queued) {
+            conn.outstanding.fetch_sub(1, std::memory_order_relaxed);
+            p.done(std::unexpected(error));
+        }
+    }
+
+    void reconnect() {
+        for (auto& conn : conns_) {
+            if (!conn->up.load() && !stop_.load() && dial(*conn)) {
+                reconnects_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// a coroutine nobody waits for: starts right away and frees itself when it returns
+struct ClientTask {
+    struct promise_type {
+        ClientTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+#endif // CLIENT_CLIENT_HPP
@@ -15,6 +15,7 @@
 #include <cstddef>
 #include <mutex>
 #include <shared_mutex>
+#include "../stats/lock_profiler.hpp"
 #include <optional> 
 #include <chrono> 
 #include <iostream>
@@ -69,7 +70,7 @@ public:
     AVLTree& operator= (AVLTree&&) = default;
 
     std::unique_ptr<AVLNode<K, V>> root_;
-    mutable std::shared_mutex tree_mutex;
+    mutable SiteMutex<std::shared_mutex> tree_mutex{"avl.tree"};
 
     // `SET` 
     void set(const K& key, const V& value) {
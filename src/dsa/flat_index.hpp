@@ -0,0 +1,120 @@
+#ifndef FLAT_INDEX_HPP
+#define FLAT_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+/*
+Exact (brute-force) k-NN index over fixed-dimension float vectors: every search scans them all. That is
+what the benchmarks already used as the reference search, packaged so the embedded API (src/embedded) can
+offer vector collections without waiting on the HNSW index.
+
+Vectors live in one contiguous array, `dim` floats per slot, so a scan streams memory linearly. Labels map to
+slots through an unordered_map. Removing a vector moves the last slot into its place, which keeps the array
+dense. Distances are squared L2, or negative inner product for Metric::InnerProduct, so smaller is closer
+either way. Results come back closest first as (distance, label), the same shape as VectorQueryCache::Hits.
+
+Not synchronized: callers lock around it (EmbeddedDB keeps a shared_mutex per collection).
+*/
+
+class FlatIndex {
+public:
+    using Label = size_t;
+    using Hits = std::vector<std::pair<float, Label>>;
+
+    enum class Metric : uint8_t { L2, InnerProduct };
+
+    FlatIndex(size_t dim, Metric metric) : dim_(dim), metric_(metric) {}
+
+    [[nodiscard]] size_t dim() const noexcept { return dim_; }
+    [[nodiscard]] Metric metric() const noexcept { return metric_; }
+    [[nodiscard]] size_t size() const noexcept { return labels_.size(); }
+
+    // inserts or overwrites; `v` must have dim() floats
+    void upsert(Label label, std::span<const float> v) {
+        auto [it, inserted] = slots_.try_emplace(label, labels_.size());
+        if (inserted) {
+            labels_.push_back(label);
+            data_.insert(data_.end(), v.begin(), v.end());
+        } else {
+            std::copy(v.begin(), v.end(), data_.begin() + static_cast<ptrdiff_t>(it->second * dim_));
+        }
+    }
+
+    bool remove(Label label) {
+        auto it = slots_.find(label);
+        if (it == slots_.end()) {
+            return false;
+        }
+        size_t slot = it->second;
+        size_t last = labels_.size() - 1;
+        if (slot != last) {
+            std::copy_n(data_.begin() + static_cast<ptrdiff_t>(last * dim_), dim_,
+                        data_.begin() + static_cast<ptrdiff_t>(slot * dim_));
+            labels_[slot] = labels_[last];
+            slots_[labels_[slot]] = slot;
+        }
+        labels_.pop_back();
+        data_.resize(last * dim_);
+        slots_.erase(it);
+        return true;
+    }
+
+    // a copy of the stored vector, empty if `label` isn't there
+    [[nodiscard]] std::vector<float> get(Label label) const {
+        auto it = slots_.find(label);
+        if (it == slots_.end()) {
+            return {};
+        }
+        auto first = data_.begin() + static_cast<ptrdiff_t>(it->second * dim_);
+        return std::vector<float>(first, first + static_cast<ptrdiff_t>(dim_));
+    }
+
+    [[nodiscard]] Hits search(std::span<const float> query, size_t k) const {
+        // max-heap of the best k so far: the worst of them is on top, ready to be replaced
+        std::priority_queue<std::pair<float, Label>> best;
+        for (size_t slot = 0; slot < labels_.size(); ++slot) {
+            float d = distance(query.data(), data_.data() + slot * dim_);
+            if (best.size() < k) {
+                best.emplace(d, labels_[slot]);
+            } else if (k > 0 && d < best.top().first) {
+                best.pop();
+                best.emplace(d, labels_[slot]);
+            }
+        }
+        Hits hits(best.size());
+        for (size_t i = hits.size(); i > 0; --i) {
+            hits[i - 1] = best.top();
+            best.pop();
+        }
+        return hits;
+    }
+
+private:
+    size_t dim_;
+    Metric metric_;
+    std::vector<float> data_;
+    std::vector<Label> labels_;                     // slot -> label
+    std::unordered_map<Label, size_t> slots_;       // label -> slot
+
+    float distance(const float* a, const float* b) const {
+        float sum = 0;
+        if (metric_ == Metric::L2) {
+            for (size_t i = 0; i < dim_; ++i) {
+                float d = a[i] - b[i];
+                sum += d * d;
+            }
+            return sum;
+        }
+        for (size_t i = 0; i < dim_; ++i) sum += a[i] * b[i];
+        return -sum;
+    }
+};
+
+#endif // FLAT_INDEX_HPP
@@ -13,6 +13,7 @@
 #include <bitset>
 #include <mutex>
 #include <shared_mutex>
+#include "../stats/lock_profiler.hpp"
 // To-Do: 
 /*
 1. Testing each Method - likely some inconsistencies in passing by ref/ptr (particularly in insert) 
@@ -104,8 +105,13 @@ public:
     
         uint64_t hash = hash_key(key);  // FIXED: Use correct `hash_key` function
         size_t pos = hash & mask_;
-        std::cout << "[Insert] Key: " << key << ", Hash: " << hash << ", pos: " << pos << std::endl;
         std::unique_lock lock(*bucket_locks_[pos]);          
+        for (HNode<K, V>* current = buckets_[pos].get(); current; current = current->next_.get()) {
+            if (current->key_ == key) {
+                current->value_ = std::move(value); // overwrite - a second node would shadow or be shadowed after migration
+                return;
+            }
+        }
         auto node = std::make_unique<HNode<K, V>>(std::move(key), std::move(value), hash);
         node->next_ = std::move(buckets_[pos]);          
         buckets_[pos] = std::move(node);
@@ -179,6 +185,23 @@ public:
         return node;
     }
     
+    // visit every node, one bucket (under its shared lock) at a time. fn must not touch this table.
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t pos = 0; pos < buckets_.size(); ++pos) {
+            std::shared_lock lock(*bucket_locks_[pos]);
+            visit_bucket(pos, fn);
+        }
+    }
+
+    // for_each() without the bucket locks - see HMap::for_each_frozen()
+    template<typename Fn>
+    void for_each_unlocked(Fn&& fn) const {
+        for (size_t pos = 0; pos < buckets_.size(); ++pos) {
+            visit_bucket(pos, fn);
+        }
+    }
+
     [[nodiscard]] size_t size() const noexcept { return size_; } 
     [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; } 
     bool empty() const noexcept { return size_ == 0; } 
@@ -191,7 +214,14 @@ public:
     
 private:
     std::vector<std::unique_ptr<HNode<K,V>>> buckets_; 
-    std::vector<std::unique_ptr<std::shared_mutex>> bucket_locks_;
+    std::vector<std::unique_ptr<SiteMutex<std::shared_mutex>>> bucket_locks_;
+
+    template<typename Fn>
+    void visit_bucket(size_t pos, Fn& fn) const {
+        for (const HNode<K, V>* current = buckets_[pos].get(); current; current = current->next_.get()) {
+            fn(current->key_, current->value_);
+        }
+    }
     size_t mask_{0}; 
     size_t size_{0}; 
 
@@ -208,7 +238,7 @@ private:
         buckets_.resize(capacity);
         bucket_locks_.resize(capacity);
         for (size_t i = 0; i < capacity; ++i) {
-            bucket_locks_[i] = std::make_unique<std::shared_mutex>();
+            bucket_locks_[i] = std::make_unique<SiteMutex<std::shared_mutex>>("htable.bucket");
         }
 
         mask_ = capacity - 1; 
@@ -250,14 +280,15 @@ public:
     
         // Calculate the load factor using floating point division
         double load_factor = static_cast<double>(primary_table_.size()) / primary_table_.capacity();
-        std::cout << "[Insert] Load factor: " << load_factor << " for key " << key << std::endl;
         
         // If the load factor exceeds the threshold, trigger resizing
         if (load_factor >= k_max_load_factor) {
-            std::cout << "[Resize Triggered] Load factor exceeded threshold." << std::endl;
             start_resize();
         }
     
+        if (temporary_table_) {
+            temporary_table_->remove(key); // not yet migrated - drop the stale copy so the new value wins
+        }
         primary_table_.insert(key, value);
         lock.unlock();
         help_resize();
@@ -271,12 +302,11 @@ public:
     V* find(const K& key) {
         help_resize();
     
-        {
-            std::shared_lock lock(map_mutex_);  
-            
-            if (auto* node = primary_table_.lookup(key)) {
-                return &(node->value_);
-            }
+        // both tables under the lock: a concurrent insert can start a resize and replace temporary_table_
+        std::shared_lock lock(map_mutex_);  
+        
+        if (auto* node = primary_table_.lookup(key)) {
+            return &(node->value_);
         }
     
         if (temporary_table_) {  
@@ -310,7 +340,6 @@ public:
     
     
     std::unique_ptr<HNode<K, V>> steal_first_node(size_t& pos) {
-        std::cout << "[Steal] pos=" << pos << std::endl;
         std::unique_lock lock(map_mutex_);
         if (!temporary_table_) return nullptr;
         return temporary_table_->steal_first_node(pos);
@@ -318,6 +347,33 @@ public:
     
 
     
+    // visit every key/value in both tables. holds map_mutex_ shared for the walk so no migration moves nodes
+    // underneath us - used for full-keyspace scans like snapshotting, not the hot path.
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        std::shared_lock lock(map_mutex_);
+        primary_table_.for_each(fn);
+        if (temporary_table_) {
+            temporary_table_->for_each(fn);
+        }
+    }
+
+    // map_mutex_ exclusively: while it's held no insert, erase or migration step is half done, so a process
+    // forked under it inherits a consistent map
+    [[nodiscard]] std::unique_lock<SiteMutex<std::shared_mutex>> freeze() const {
+        return std::unique_lock(map_mutex_);
+    }
+
+    // for_each() in a child forked under freeze(): it's single-threaded and its copy of the map can't change,
+    // and map_mutex_ stays locked there for good, so no lock is taken
+    template<typename Fn>
+    void for_each_frozen(Fn&& fn) const {
+        primary_table_.for_each_unlocked(fn);
+        if (temporary_table_) {
+            temporary_table_->for_each_unlocked(fn);
+        }
+    }
+
     [[nodiscard]] size_t size() const noexcept {
         return primary_table_.size() + 
                (temporary_table_ ? temporary_table_->size() : 0); // Get the size of both primary and resizing table (if exists).
@@ -339,36 +395,30 @@ private:
     HTable<K,V> primary_table_;
     std::optional<HTable<K,V>> temporary_table_;
     size_t resizing_pos_{0};
-    mutable std::shared_mutex map_mutex_;
+    mutable SiteMutex<std::shared_mutex> map_mutex_{"hmap"};
     void help_resize() {
         // Sanity check! Do not proceed if resizing table does not exist
         if (!temporary_table_) {
-            std::cout << "[HelpResize] No temporary table. Skipping." << std::endl;
             return;
         }
     
-        std::cout << "[Resize] Starting. pos=" << resizing_pos_ << ", size=" 
-                  << temporary_table_->size() << std::endl; 
-    
         std::unique_lock lock(map_mutex_); 
+        if (!temporary_table_) {
+            return; // another thread finished the migration while we waited
+        }
         size_t work_done = 0;
     
         while (work_done < max_work && !temporary_table_->empty()) {
-            std::cout << "[HelpResize] Attempting steal @ pos " << resizing_pos_ << std::endl;
-    
             auto node = temporary_table_->steal_first_node(resizing_pos_);
             if (node) {
-                std::cout << "[HelpResize] Moving key: " << node->key_ << std::endl;
                 primary_table_.insert(std::move(node->key_), std::move(node->value_));
                 work_done++;
             } else {
-                std::cout << "[HelpResize] No node to steal at pos " << resizing_pos_ << ", incrementing." << std::endl;
                 resizing_pos_++;  // Only advance when the bucket is empty
             }
     
             // Debug if resizing_pos_ goes out of bounds
             if (resizing_pos_ >= temporary_table_->capacity()) {
-                std::cout << "[HelpResize] Warning: resizing_pos_ exceeded capacity. Resetting." << std::endl;
                 resizing_pos_ = 0;  // Reset if out of bounds
             }
         }
@@ -376,16 +426,14 @@ private:
         if (temporary_table_->empty()) { 
             temporary_table_.reset();
             resizing_pos_ = 0;
-            std::cout << "[HelpResize] Completed resizing, reset temporary_table." << std::endl;
         }
     }
     
+    // caller (insert) already holds map_mutex_ exclusively - re-locking here deadlocked on the first resize.
     void start_resize() {
-        std::unique_lock lock(map_mutex_);
         assert(!temporary_table_); // First a sanity check that resizing table doesn't already exist!
     
         size_t new_capacity = primary_table_.capacity() * 2; // New capacity is 2x previous, this is a standard approach.
-        std::cout << "[Resize Start] New cap = " << new_capacity << std::endl;
     
         // Move the existing primary table's data to temporary table for resizing
         temporary_table_.emplace(std::move(primary_table_)); 
@@ -7,6 +7,8 @@
 #include <memory>
 #include <stdexcept>
 #include <mutex>
+#include <shared_mutex>
+#include "../stats/lock_profiler.hpp"
 
 template<typename T>
 class HeapItem;
@@ -32,18 +34,18 @@ public:
 
     [[nodiscard]] std::optional<HeapItem<T>> top() const {
         std::shared_lock lock(heap_mutex_);
-        if (empty()) return std::nullopt;
+        if (items_.empty()) return std::nullopt;
         return items_[0]; 
     }    
 
     HeapItem<T> pop() { 
         std::unique_lock lock(heap_mutex_);        
 
-        if (empty()) {
+        if (items_.empty()) {
             throw std::out_of_range("Heap is empty");
         }
         HeapItem<T> result = std::move(items_[0]); // move our items_[0] to our result. Since we popped our element - we must 
-        if (size() > 1) {
+        if (items_.size() > 1) {
             items_[0] = std::move(items_.back());
             items_.pop_back();
             sift_down(0);
@@ -53,6 +55,25 @@ public:
         return result;
     }
 
+    // removes the item at `pos` wherever it sits; the last item takes its slot and is sifted into place
+    void erase(std::size_t pos) {
+        std::unique_lock lock(heap_mutex_);
+        if (pos >= items_.size()) {
+            throw std::out_of_range("erase: Invalid index");
+        }
+        if (pos + 1 == items_.size()) {
+            items_.pop_back();
+            return;
+        }
+        items_[pos] = std::move(items_.back());
+        items_.pop_back();
+        if (pos > 0 && compare_(items_[pos].value_, items_[parent(pos)].value_)) {
+            sift_up(pos);
+        } else {
+            sift_down(pos);
+        }
+    }
+
     void pop_back() {
         std::unique_lock lock(heap_mutex_);
         if (!items_.empty()) {
@@ -82,6 +103,20 @@ public:
         update(j);
     }
     
+    // the item tracked through `from` is tracked through `to` from now on - its owner was replaced by a copy.
+    // false if `from` isn't tracking an item
+    bool repoint(std::size_t* from, std::size_t* to) {
+        std::unique_lock lock(heap_mutex_);
+        std::size_t pos = *from;
+        if (pos >= items_.size() || items_[pos].position_ref_ != from) {
+            return false;
+        }
+        items_[pos].position_ref_ = to;
+        *to = pos;
+        *from = static_cast<std::size_t>(-1);
+        return true;
+    }
+
     void clear() {
         std::unique_lock lock(heap_mutex_);
         std::vector<HeapItem<T>>().swap(items_);  // ✅ Force memory deallocation
@@ -100,7 +135,7 @@ private:
     std::vector<HeapItem<T>> items_; // So we have a vector of HeapItems with any type
     Compare compare_; // and a comparator function (for our MinHeap functionality)
     // fancy way of swapping parent and child (our node at pos) until our child satisfies the comparator property thereby sifting it up the tree!
-    mutable std::shared_mutex heap_mutex_;     
+    mutable SiteMutex<std::shared_mutex> heap_mutex_{"heap"};
     void sift_up(std::size_t pos) { // position in array as an argument to push_up our item
         HeapItem<T> temp = std::move(items_[pos]); // let's grab that object through movement (no copy)
         
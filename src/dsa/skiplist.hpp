@@ -80,7 +80,8 @@ private:
     bool find(const Key& key, std::vector<Node*>& preds, std::vector<Node*>& succs) {
         bool valid = true;
         Node* pred = head.get();
-        for (int level = currentLevel - 1; level >= 0; --level) {
+        // every level, not just up to currentLevel: add() links and locks preds up to its own topLevel
+        for (int level = MAX_LEVEL - 1; level >= 0; --level) {
             Node* curr = pred->next[level].load(std::memory_order_acquire);
             while (true) {
                 if (curr->marked.load(std::memory_order_acquire)) {
@@ -136,9 +137,11 @@ private:
             for (int level = 0; level < topLevel; ++level)
                 newNode->next[level].store(succs[level], std::memory_order_relaxed);
     
+            // a pred shared by neighbouring levels is locked once; std::mutex isn't recursive
             std::array<std::unique_lock<std::mutex>, MAX_LEVEL> predLocks;
             for (int level = 0; level < topLevel; ++level)
-                predLocks[level] = std::unique_lock<std::mutex>(preds[level]->node_lock);
+                if (level == 0 || preds[level] != preds[level - 1])
+                    predLocks[level] = std::unique_lock<std::mutex>(preds[level]->node_lock);
     
             bool valid = true;
             for (int level = 0; level < topLevel; ++level) {
@@ -188,7 +191,8 @@ private:
             std::array<std::unique_lock<std::mutex>, MAX_LEVEL> predLocks;
             bool valid = true;
             for (int level = 0; level < victim->next.size(); ++level)
-                predLocks[level] = std::unique_lock<std::mutex>(preds[level]->node_lock);
+                if (level == 0 || preds[level] != preds[level - 1])
+                    predLocks[level] = std::unique_lock<std::mutex>(preds[level]->node_lock);
     
             for (int level = 0; level < victim->next.size(); ++level) {
                 if (preds[level]->next[level].load(std::memory_order_acquire) != victim) {
@@ -4,6 +4,8 @@
 #include <functional>
 #include <future>
 #include <queue>
+#include <deque>
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <memory>
@@ -73,7 +75,8 @@ public:
                 throw std::runtime_error("Cannot enqueue on stopped ThreadPool");
             }
     
-            condition_.wait(lock, [this] { return !tasks_.empty() || stop.load(); });
+            tasks_.emplace_back([task] { (*task)(); });
+            queued_.fetch_add(1, std::memory_order_relaxed);
         }
         
         condition_.notify_one();
@@ -87,6 +90,9 @@ public:
         std::lock_guard<std::mutex> lock(mutex_); // smart lock, behaves like a unique or shared ptr, automatically lifted upon function termnination. 
         return tasks_.size();
     }
+    // same number without the lock, possibly a moment stale - for metrics scrapers that mustn't block the pool
+    [[nodiscard]] size_t queue_depth() const noexcept { return queued_.load(std::memory_order_relaxed); }
+    [[nodiscard]] size_t active_workers() const noexcept { return active_workers_.load(std::memory_order_relaxed); }
 
     void wait_for_tasks() { 
         std::unique_lock<std::mutex> lock(mutex_);
@@ -123,7 +129,8 @@ void worker() {
             if (stop && tasks_.empty()) return; // exit only when tasks are completely finished
 
             task = std::move(tasks_.front());
-            tasks_.pop();
+            tasks_.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
             active_workers_.fetch_add(1, std::memory_order_relaxed); 
         } 
         task(); // execute task
@@ -136,6 +143,7 @@ void worker() {
     std::vector<std::thread> threads_;
     std::deque<std::function<void()>> tasks_;
     std::atomic<size_t> active_workers_{0};
+    std::atomic<size_t> queued_{0};
     mutable std::mutex mutex_; // Locking a resource so no other threads can grab it. *** We should replace this with a more efficient method for concurrency ***
     std::condition_variable condition_; 
     /* std::condition_variable is a synchronization primitive that is used to safely make threads wait until a condition is met instead of busy-waiting. 
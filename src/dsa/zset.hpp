@@ -7,6 +7,7 @@
 #include <memory> // include memory management utilities like unique_ptr
 #include <mutex>
 #include <future>
+#include <iostream>
 using ZNode = AVLNode<std::string, double>;
 
 class ZSet { // define the zset class
@@ -15,21 +16,19 @@ public:
     HMap<std::string, ZNode*> hash; // Assuming HMap<K, V> uses string keys
     ThreadPool thread_pool_; // thread pool for handling asynchronous tasks
     std::vector<std::shared_ptr<ZNode>> nodes_; // Keeps ZNode alive
-    mutable std::shared_mutex zset_mutex_;
+    mutable SiteMutex<std::shared_mutex> zset_mutex_{"zset"};
     explicit ZSet(size_t threads = 4) : thread_pool_(threads) {} // initialize thread pool with a default of 4 worker threads
 
 
     ZNode* lookup(std::string_view name) {
         std::shared_lock lock(zset_mutex_);
-        std::cerr << "Looking up: " << name << std::endl;
-        ZNode** node_ptr = hash.find(std::string(name));
-        return (node_ptr && *node_ptr) ? *node_ptr : nullptr;
+        return lookup_locked(name);
     }
     
     bool add_internal(std::string_view name, double score) {
         std::unique_lock lock(zset_mutex_);  
-        if (ZNode* node = lookup(name)) {
-            update_score(node, score);
+        if (ZNode* node = lookup_locked(name)) {
+            update_score_locked(node, score);
             return false;
         }
     
@@ -41,13 +40,9 @@ public:
             return false;
         }
     
-        std::cerr << "Created node: " << node->get_key() << " with score: " << node->get_value() << std::endl;
-    
         nodes_.emplace_back(node);  
         hash.insert(node->get_key(), node.get()); 
         tree.set(node->get_key(), score);
-    
-        std::cerr << "Added node successfully: " << node->get_key() << std::endl;
         return true;
     }
     
@@ -79,28 +74,7 @@ public:
     
     bool update_score(ZNode* node, double new_score) {
         std::unique_lock lock(zset_mutex_);  
-        if (!node) {
-            std::cerr << "update_score: Received a nullptr!" << std::endl;
-            return false;
-        }
-    
-        std::string key = node->get_key();
-        if (key.empty()) {
-            std::cerr << "update_score: Node key is empty!" << std::endl;
-            return false;
-        }
-    
-        ZNode** node_ptr = hash.find(key);
-        if (!node_ptr || !*node_ptr) {
-            std::cerr << "update_score: Key not found in hash: " << key << std::endl;
-            return false; 
-        }
-    
-        tree.del(key);
-        node->set_value(new_score);
-        tree.set(key, new_score);
-        
-        return true; 
+        return update_score_locked(node, new_score);
     }
     
     bool remove_internal(std::string_view name) {
@@ -128,7 +102,7 @@ public:
     
     ZNode* query(double score, std::string_view name, int64_t offset) {
         std::shared_lock lock(zset_mutex_);  
-        return tree.exists(std::string(name)) ? lookup(name) : nullptr;
+        return tree.exists(std::string(name)) ? lookup_locked(name) : nullptr;
     }
 
     ~ZSet() {
@@ -138,7 +112,37 @@ public:
         thread_pool_.shutdown();
     }
     
+private:
+    // callers hold zset_mutex_; locking it again from the same thread throws EDEADLK
+    ZNode* lookup_locked(std::string_view name) {
+        ZNode** node_ptr = hash.find(std::string(name));
+        return (node_ptr && *node_ptr) ? *node_ptr : nullptr;
+    }
+
+    bool update_score_locked(ZNode* node, double new_score) {
+        if (!node) {
+            std::cerr << "update_score: Received a nullptr!" << std::endl;
+            return false;
+        }
+    
+        std::string key = node->get_key();
+        if (key.empty()) {
+            std::cerr << "update_score: Node key is empty!" << std::endl;
+            return false;
+        }
+    
+        ZNode** node_ptr = hash.find(key);
+        if (!node_ptr || !*node_ptr) {
+            std::cerr << "update_score: Key not found in hash: " << key << std::endl;
+            return false; 
+        }
     
+        tree.del(key);
+        node->set_value(new_score);
+        tree.set(key, new_score);
+        
+        return true; 
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,320 @@
+#ifndef EMBEDDED_DB_HPP
+#define EMBEDDED_DB_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <expected>
+#include <system_error>
+#include <shared_mutex>
+#include <mutex>
+#include <unordered_map>
+#include "../../entry_manager.hpp"
+#include "../dsa/zset.hpp"
+#include "../dsa/flat_index.hpp"
+#include "../cache/vector_query_cache.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Embedded mode: the store as a C++ library, for services that run next to it and shouldn't pay a TCP round
+trip and a serialize/parse per lookup. Include this header and link nothing else: everything is header-only,
+like the rest of the tree.
+
+EmbeddedDB owns an EntryManager and calls it directly. It doesn't go through RequestParser,
+ResponseSerializer or CommandProcessor, so there is no command lookup, no response buffer and no stats or
+tracing hooks. The semantics are those of the matching commands:
+
+    get / set / del / exists / pexpire / pttl      GET, SET, DEL, EXISTS, PEXPIRE, PTTL
+    zadd / zrem / zscore                           ZADD, ZREM, and a score lookup the server has no command for
+    mget / mset                                    the same, many keys per call
+
+Vector collections are named FlatIndex instances (exact k-NN, L2 or inner product). An optional
+VectorQueryCache sits in front of each one. They live in EmbeddedDB next to the keyspace; the server has no
+vector commands, so they aren't reachable over the wire.
+
+Thread safety: EntryManager is built for one poll loop, so its HMap hands out pointers into itself. Here, key
+reads share engine_mutex_ and key writes take it exclusively, so readers run in parallel and writers never
+move a value out from under them. Batch calls take the lock once for the whole batch, which is most of what
+makes them cheaper than a loop. Each collection has its own shared_mutex: searches share it, upserts and
+removes take it exclusively.
+
+Errors: a key holding another type, or a vector of the wrong dimension, is std::errc::invalid_argument. An
+unknown collection is no_such_file_or_directory. Creating one that already exists is file_exists.
+*/
+
+class EmbeddedDB {
+public:
+    using Label = FlatIndex::Label;
+    using Metric = FlatIndex::Metric;
+    using Hits = FlatIndex::Hits;
+
+    struct Options {
+        size_t thread_pool_size = 1;            // EntryManager's background pool
+    };
+
+    struct CollectionOptions {
+        size_t dim = 0;
+        Metric metric = Metric::L2;
+        size_t cache_bytes = 0;                 // VectorQueryCache in front of searches; 0 for none
+    };
+
+    EmbeddedDB() : EmbeddedDB(Options()) {}
+    explicit EmbeddedDB(Options options) : db_(options.thread_pool_size) {}
+
+    EmbeddedDB(const EmbeddedDB&) = delete;
+    EmbeddedDB& operator=(const EmbeddedDB&) = delete;
+
+    // strings
+
+    Result<std::optional<std::string>> get(const std::string& key) {
+        std::shared_lock lock(engine_mutex_);
+        return get_locked(key);
+    }
+
+    void set(const std::string& key, std::string value) {
+        std::unique_lock lock(engine_mutex_);
+        db_.create_entry(key, std::move(value));
+    }
+
+    bool del(const std::string& key) {
+        std::unique_lock lock(engine_mutex_);
+        return db_.delete_entry(key);
+    }
+
+    bool exists(const std::string& key) {
+        std::shared_lock lock(engine_mutex_);
+        return db_.find_entry(key) != nullptr;
+    }
+
+    // false if the key doesn't exist
+    bool pexpire(const std::string& key, int64_t ttl_ms) {
+        std::unique_lock lock(engine_mutex_);
+        auto entry = db_.find_entry(key);
+        return entry && ttl_ms >= 0 && db_.set_entry_ttl(*entry, ttl_ms);
+    }
+
+    // ms left; -1 without a TTL, -2 if the key doesn't exist (as PTTL)
+    int64_t pttl(const std::string& key) {
+        std::shared_lock lock(engine_mutex_);
+        auto entry = db_.find_entry(key);
+        return entry ? db_.get_expiry_time(*entry) : -2;
+    }
+
+    std::vector<Result<std::optional<std::string>>> mget(std::span<const std::string> keys) {
+        std::vector<Result<std::optional<std::string>>> out;
+        out.reserve(keys.size());
+        std::shared_lock lock(engine_mutex_);
+        for (const auto& key : keys) out.push_back(get_locked(key));
+        return out;
+    }
+
+    void mset(std::span<const std::pair<std::string, std::string>> pairs) {
+        std::unique_lock lock(engine_mutex_);
+        for (const auto& [key, value] : pairs) db_.create_entry(key, value);
+    }
+
+    // sorted sets
+
+    // true if `member` is new, false if its score was updated
+    Result<bool> zadd(const std::string& key, std::string_view member, double score) {
+        std::unique_lock lock(engine_mutex_);
+        auto entry = db_.find_entry(key);
+        std::shared_ptr<Entry<std::unique_ptr<ZSet>>> zset;
+        if (entry) {
+            zset = std::dynamic_pointer_cast<Entry<std::unique_ptr<ZSet>>>(entry);
+            if (!zset) {
+                return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+            }
+        } else {
+            zset = std::dynamic_pointer_cast<Entry<std::unique_ptr<ZSet>>>(
+                db_.create_entry(key, std::make_unique<ZSet>()));
+        }
+        return zset->value->add_internal(member, score);
+    }
+
+    Result<bool> zrem(const std::string& key, std::string_view member) {
+        std::unique_lock lock(engine_mutex_);
+        auto zset = find_zset(key);
+        if (!zset) {
+            return std::unexpected(zset.error());
+        }
+        return *zset && (*zset)->value->remove_internal(member);
+    }
+
+    Result<std::optional<double>> zscore(const std::string& key, std::string_view member) {
+        std::shared_lock lock(engine_mutex_);
+        auto zset = find_zset(key);
+        if (!zset) {
+            return std::unexpected(zset.error());
+        }
+        if (!*zset) {
+            return std::nullopt;
+        }
+        ZNode* node = (*zset)->value->lookup(member);
+        return node ? std::optional<double>(node->get_value()) : std::nullopt;
+    }
+
+    // vector collections
+
+    Result<void> create_collection(const std::string& name, CollectionOptions options) {
+        if (options.dim == 0) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        std::unique_lock lock(collections_mutex_);
+        if (collections_.contains(name)) {
+            return std::unexpected(std::make_error_code(std::errc::file_exists));
+        }
+        collections_.emplace(name, std::make_shared<Collection>(options));
+        return {};
+    }
+
+    bool drop_collection(const std::string& name) {
+        std::unique_lock lock(collections_mutex_);
+        return collections_.erase(name) > 0;
+    }
+
+    Result<void> upsert(const std::string& name, Label label, std::span<const float> vector) {
+        return upsert_batch(name, std::span(&label, 1), vector);
+    }
+
+    // labels[i] gets vectors[i * dim, (i + 1) * dim)
+    Result<void> upsert_batch(const std::string& name, std::span<const Label> labels, std::span<const float> vectors) {
+        auto c = collection(name);
+        if (!c) {
+            return std::unexpected(c.error());
+        }
+        size_t dim = (*c)->index.dim();
+        if (vectors.size() != labels.size() * dim) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        std::unique_lock lock((*c)->mutex);
+        for (size_t i = 0; i < labels.size(); ++i) {
+            (*c)->index.upsert(labels[i], vectors.subspan(i * dim, dim));
+            if ((*c)->cache) {
+                (*c)->cache->on_delete(labels[i]);     // an overwrite moves the vector
+            }
+        }
+        if ((*c)->cache) {
+            (*c)->cache->on_insert();
+        }
+        return {};
+    }
+
+    Result<bool> remove(const std::string& name, Label label) {
+        auto c = collection(name);
+        if (!c) {
+            return std::unexpected(c.error());
+        }
+        std::unique_lock lock((*c)->mutex);
+        bool removed = (*c)->index.remove(label);
+        if (removed && (*c)->cache) {
+            (*c)->cache->on_delete(label);
+        }
+        return removed;
+    }
+
+    // up to k nearest, closest first
+    Result<Hits> search(const std::string& name, std::span<const float> query, size_t k) {
+        auto hits = search_batch(name, query, k);
+        if (!hits) {
+            return std::unexpected(hits.error());
+        }
+        return std::move(hits->front());
+    }
+
+    // one result list per dim-float row of `queries`
+    Result<std::vector<Hits>> search_batch(const std::string& name, std::span<const float> queries, size_t k) {
+        auto c = collection(name);
+        if (!c) {
+            return std::unexpected(c.error());
+        }
+        size_t dim = (*c)->index.dim();
+        if (queries.empty() || queries.size() % dim != 0) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        std::vector<Hits> out;
+        out.reserve(queries.size() / dim);
+        std::shared_lock lock((*c)->mutex);
+        for (size_t row = 0; row < queries.size(); row += dim) {
+            auto q = queries.subspan(row, dim);
+            if ((*c)->cache) {
+                out.push_back((*c)->cache->get_or_compute({.vector = q, .k = static_cast<uint32_t>(k)},
+                                                          [&] { return (*c)->index.search(q, k); }));
+            } else {
+                out.push_back((*c)->index.search(q, k));
+            }
+        }
+        return out;
+    }
+
+    Result<size_t> collection_size(const std::string& name) {
+        auto c = collection(name);
+        if (!c) {
+            return std::unexpected(c.error());
+        }
+        std::shared_lock lock((*c)->mutex);
+        return (*c)->index.size();
+    }
+
+private:
+    struct Collection {
+        explicit Collection(const CollectionOptions& options) : index(options.dim, options.metric) {
+            if (options.cache_bytes > 0) {
+                cache = std::make_unique<VectorQueryCache>(VectorQueryCache::Options{.max_bytes = options.cache_bytes});
+            }
+        }
+
+        std::shared_mutex mutex;
+        FlatIndex index;
+        std::unique_ptr<VectorQueryCache> cache;
+    };
+
+    EntryManager db_;
+    std::shared_mutex engine_mutex_;
+    std::shared_mutex collections_mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Collection>> collections_;
+
+    Result<std::optional<std::string>> get_locked(const std::string& key) {
+        auto entry = db_.find_entry(key);
+        if (!entry) {
+            return std::nullopt;
+        }
+        auto str = std::dynamic_pointer_cast<Entry<std::string>>(entry);
+        if (!str) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        return str->value;
+    }
+
+    // null if the key doesn't exist
+    Result<std::shared_ptr<Entry<std::unique_ptr<ZSet>>>> find_zset(const std::string& key) {
+        auto entry = db_.find_entry(key);
+        if (!entry) {
+            return nullptr;
+        }
+        auto zset = std::dynamic_pointer_cast<Entry<std::unique_ptr<ZSet>>>(entry);
+        if (!zset) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        return zset;
+    }
+
+    // shared_ptr: a collection dropped mid-call stays alive until the call is done
+    Result<std::shared_ptr<Collection>> collection(const std::string& name) {
+        std::shared_lock lock(collections_mutex_);
+        auto it = collections_.find(name);
+        if (it == collections_.end()) {
+            return std::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+        return it->second;
+    }
+};
+
+#endif // EMBEDDED_DB_HPP
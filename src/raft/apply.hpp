@@ -0,0 +1,269 @@
+#ifndef RAFT_APPLY_HPP
+#define RAFT_APPLY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <latch>
+#include <functional>
+#include <iterator>
+#include <expected>
+#include <system_error>
+#include "../../command_processor.hpp"
+#include "../../logging.hpp"
+#include "raft.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Applying committed raft entries to a keyspace split into shards, one worker thread per shard.
+
+Entry payloads are command batches:
+
+    u32 count | count x ( u32 argc | argc x ( u32 len | bytes ) )
+
+On each applylog_batch callback the raft thread decodes every entry in the run and routes each command to
+its shard by hashing args[1] (keyless commands like FLUSHALL go to every shard). Each shard gets its
+commands as one list in log order and the shards run concurrently; the callback returns - and raft moves
+last_applied_idx past the run - only once all of them are done. Two commands on the same key always land
+on the same shard in the same relative order, so the result is what serial apply would have produced.
+
+Runs shorter than Options::min_parallel commands are applied inline on the raft thread: waking workers for
+a couple of SETs costs more than it saves.
+
+    ShardedApplier applier(shards);                        // std::vector<EntryManager*>, one per shard
+    raft_cbs_t cbs{...};
+    ShardedApplier::install<&my_node_applier>(cbs);        // ShardedApplier* my_node_applier(void* user_data)
+*/
+
+class CommandBatch {
+public:
+    using Command = std::vector<std::string>;
+
+    static std::vector<uint8_t> encode(std::span<const Command> commands) {
+        std::vector<uint8_t> out;
+        put_u32(out, static_cast<uint32_t>(commands.size()));
+        for (const auto& command : commands) {
+            put_u32(out, static_cast<uint32_t>(command.size()));
+            for (const auto& arg : command) {
+                put_u32(out, static_cast<uint32_t>(arg.size()));
+                out.insert(out.end(), arg.begin(), arg.end());
+            }
+        }
+        return out;
+    }
+
+    // appends to `out`; on failure `out` may hold part of the batch
+    static Result<void> decode(std::span<const uint8_t> in, std::vector<Command>& out) {
+        size_t pos = 0;
+        uint32_t count;
+        if (!get_u32(in, pos, count)) {
+            return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        }
+        for (uint32_t c = 0; c < count; ++c) {
+            uint32_t argc;
+            if (!get_u32(in, pos, argc) || argc > in.size() - pos) {
+                return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+            }
+            Command& command = out.emplace_back();
+            command.reserve(argc);
+            for (uint32_t a = 0; a < argc; ++a) {
+                uint32_t len;
+                if (!get_u32(in, pos, len) || len > in.size() - pos) {
+                    return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+                }
+                command.emplace_back(reinterpret_cast<const char*>(in.data() + pos), len);
+                pos += len;
+            }
+        }
+        return {};
+    }
+
+private:
+    static void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &v, sizeof(v));
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    static bool get_u32(std::span<const uint8_t> in, size_t& pos, uint32_t& v) {
+        if (in.size() - pos < sizeof(v)) {
+            return false;
+        }
+        std::memcpy(&v, in.data() + pos, sizeof(v));
+        pos += sizeof(v);
+        return true;
+    }
+};
+
+class ShardedApplier {
+public:
+    using Command = CommandBatch::Command;
+
+    struct Options {
+        size_t min_parallel = 256;  // commands per run below which we apply inline
+    };
+
+    ShardedApplier(std::vector<EntryManager*> shards, Options options)
+        : shards_(std::move(shards)), options_(options), workers_(shards_.size()) {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i].thread = std::thread(&ShardedApplier::worker, this, i);
+        }
+    }
+
+    explicit ShardedApplier(std::vector<EntryManager*> shards) : ShardedApplier(std::move(shards), Options{}) {}
+
+    ~ShardedApplier() {
+        for (auto& w : workers_) {
+            {
+                std::lock_guard lock(w.mutex);
+                w.stop = true;
+            }
+            w.cv.notify_one();
+        }
+        for (auto& w : workers_) {
+            if (w.thread.joinable()) {
+                w.thread.join();
+            }
+        }
+    }
+
+    ShardedApplier(const ShardedApplier&) = delete;
+    ShardedApplier& operator=(const ShardedApplier&) = delete;
+
+    // which shard owns `key` - readers must route with the same function
+    static size_t shard_of(std::string_view key, size_t shards) {
+        return std::hash<std::string_view>{}(key) % shards;
+    }
+
+    [[nodiscard]] size_t shards() const noexcept { return shards_.size(); }
+    [[nodiscard]] EntryManager& shard(size_t i) const { return *shards_[i]; }
+
+    // apply a run of raft entries; returns once every shard has applied its part
+    int apply(const raft_entry_t* etys, raft_index_t first_idx, int n) {
+        decoded_.clear();
+        for (int i = 0; i < n; ++i) {
+            const raft_entry_t& ety = etys[i];
+            if (ety.type != RAFT_LOGTYPE_NORMAL || ety.data.len == 0) {
+                continue; // membership changes and no-ops
+            }
+            auto data = std::span(static_cast<const uint8_t*>(ety.data.buf), ety.data.len);
+            scratch_.clear();
+            if (auto r = CommandBatch::decode(data, scratch_); !r) {
+                // the whole entry is skipped, including commands decoded before the bad bytes; every replica
+                // skips the same entry, so the state machines stay identical
+                log_message("raft apply: skipping undecodable entry {}", first_idx + i);
+                continue;
+            }
+            decoded_.insert(decoded_.end(), std::make_move_iterator(scratch_.begin()),
+                            std::make_move_iterator(scratch_.end()));
+        }
+        apply(decoded_);
+        applied_entries_ += static_cast<uint64_t>(n);
+        return 0;
+    }
+
+    // apply decoded commands in order, sharded
+    void apply(std::span<const Command> commands) {
+        if (commands.size() < options_.min_parallel || shards_.size() == 1) {
+            for (const auto& command : commands) {
+                if (command.size() < 2) {
+                    for (auto* shard : shards_) execute(*shard, command);
+                } else {
+                    execute(*shards_[shard_of(command[1], shards_.size())], command);
+                }
+            }
+            applied_commands_ += commands.size();
+            return;
+        }
+
+        for (auto& w : workers_) {
+            w.batch.clear();
+        }
+        for (const auto& command : commands) {
+            if (command.size() < 2) {
+                for (auto& w : workers_) w.batch.push_back(&command);
+            } else {
+                workers_[shard_of(command[1], shards_.size())].batch.push_back(&command);
+            }
+        }
+
+        ptrdiff_t busy = 0;
+        for (auto& w : workers_) {
+            busy += !w.batch.empty();
+        }
+        std::latch done(busy);
+        for (auto& w : workers_) {
+            if (w.batch.empty()) continue;
+            {
+                std::lock_guard lock(w.mutex);
+                w.done = &done;
+            }
+            w.cv.notify_one();
+        }
+        done.wait();
+        applied_commands_ += commands.size();
+    }
+
+    [[nodiscard]] uint64_t applied_entries() const noexcept { return applied_entries_; }
+    [[nodiscard]] uint64_t applied_commands() const noexcept { return applied_commands_; }
+
+    // raft callback glue, same shape as RaftLogStore::install
+    template<ShardedApplier* (*Get)(void* user_data)>
+    static void install(raft_cbs_t& cbs) {
+        cbs.applylog_batch = [](raft_server_t*, void* udata, raft_entry_t* etys, raft_index_t first_idx, int n) {
+            return Get(udata)->apply(etys, first_idx, n);
+        };
+    }
+
+private:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<const Command*> batch;  // written by the raft thread only while the worker is idle
+        std::latch* done = nullptr;
+        bool stop = false;
+    };
+
+    std::vector<EntryManager*> shards_;
+    Options options_;
+    std::vector<Worker> workers_;
+    std::vector<Command> decoded_;
+    std::vector<Command> scratch_;   // one entry's commands, kept only if the whole entry decodes
+    uint64_t applied_entries_{0};
+    uint64_t applied_commands_{0};
+
+    static void execute(EntryManager& shard, const Command& command) {
+        std::vector<uint8_t> response; // replicated apply has no client to answer
+        CommandProcessor::process_command({command, response, shard});
+    }
+
+    void worker(size_t i) {
+        Worker& w = workers_[i];
+        EntryManager& shard = *shards_[i];
+        while (true) {
+            std::latch* done;
+            {
+                std::unique_lock lock(w.mutex);
+                w.cv.wait(lock, [&] { return w.done != nullptr || w.stop; });
+                if (w.stop) return;
+                done = w.done;
+                w.done = nullptr;
+            }
+            for (const Command* command : w.batch) {
+                execute(shard, *command);
+            }
+            done->count_down();
+        }
+    }
+};
+
+#endif // RAFT_APPLY_HPP
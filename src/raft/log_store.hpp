@@ -0,0 +1,590 @@
+#ifndef RAFT_LOG_STORE_HPP
+#define RAFT_LOG_STORE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <algorithm>
+#include <expected>
+#include <system_error>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../common.hpp"
+#include "../../logging.hpp"
+#include "raft.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Durable raft log built out of fixed-size segment files.
+
+    <dir>/00000000000000000001.log   append-only records [header | payload]
+    <dir>/00000000000000000001.idx   mmap'd array of record offsets, one slot per log index
+    <dir>/raft.meta                  current term + voted for
+
+Every record header carries a CRC-32C over the header and payload so a torn write at the tail is detected
+on recovery and cut off. Appends land in an in-memory buffer and only reach the kernel on sync(), which issues
+ONE write + fdatasync for everything appended since the last sync - call it once per raft tick (group commit)
+and only send AppendEntries responses / client acks after it returns.
+
+Segments are named after the first index they hold, so:
+    - compaction (dropping a prefix) unlinks whole segments,
+    - truncation (dropping a suffix) unlinks newer segments and ftruncates at most one.
+
+Creating or unlinking a segment changes the directory, not the files, so each one is followed by an fsync of
+the directory itself - otherwise a crash can bring back a segment we dropped or lose one we synced into.
+*/
+
+class RaftLogStore {
+public:
+    struct Options {
+        std::string dir;
+        size_t segment_entries = 1 << 16;           // index slots per segment
+        uint64_t segment_bytes = 64ull << 20;       // roll over once a segment grows past this
+    };
+
+    struct Record {
+        raft_index_t idx{0};
+        int term{0};
+        unsigned int id{0};
+        int type{0};
+        std::vector<uint8_t> data;
+    };
+
+    // on-disk record header, followed by `len` payload bytes. crc covers everything after the crc field.
+    struct RecordHeader {
+        uint32_t crc;
+        uint32_t len;
+        int64_t idx;
+        int32_t term;
+        uint32_t id;
+        int32_t type;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(RecordHeader) == 32);
+
+    static Result<std::unique_ptr<RaftLogStore>> open(Options options) {
+        std::unique_ptr<RaftLogStore> store(new RaftLogStore(std::move(options)));
+        if (auto result = store->recover(); !result) {
+            return std::unexpected(result.error());
+        }
+        return store;
+    }
+
+    ~RaftLogStore() {
+        (void)sync();
+        for (auto& seg : segments_) {
+            close_segment(seg);
+        }
+        if (meta_fd_ != -1) {
+            ::close(meta_fd_);
+        }
+        if (dir_fd_ != -1) {
+            ::close(dir_fd_);
+        }
+    }
+
+    RaftLogStore(const RaftLogStore&) = delete;
+    RaftLogStore& operator=(const RaftLogStore&) = delete;
+
+    [[nodiscard]] raft_index_t first_index() const noexcept { return segments_.empty() ? 1 : segments_.front().first_idx; }
+    [[nodiscard]] raft_index_t last_index() const noexcept { return segments_.empty() ? 0 : segments_.back().last_idx; }
+    [[nodiscard]] int term() const noexcept { return term_; }
+    [[nodiscard]] int voted_for() const noexcept { return voted_for_; }
+    [[nodiscard]] size_t segment_count() const noexcept { return segments_.size(); }
+    [[nodiscard]] uint64_t sync_count() const noexcept { return sync_count_; }
+    [[nodiscard]] uint64_t dir_sync_count() const noexcept { return dir_sync_count_; }
+
+    // buffers one entry; nothing is durable until the next sync(). indexes must be contiguous.
+    Result<void> append(raft_index_t idx, int term, unsigned int id, int type, std::span<const uint8_t> data) {
+        if (idx != last_index() + 1 && !(segments_.empty() && idx >= 1)) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+
+        if (segments_.empty() || segment_full(segments_.back())) {
+            if (auto result = roll_segment(idx); !result) {
+                return std::unexpected(result.error());
+            }
+        }
+
+        Segment& seg = segments_.back();
+        RecordHeader header{0, static_cast<uint32_t>(data.size()), idx, term, id, type, 0};
+        header.crc = record_crc(header, data);
+
+        uint64_t offset = seg.size + pending_.size();
+        seg.index[idx - seg.first_idx] = offset + 1; // 0 marks an empty slot
+        seg.last_idx = idx;
+
+        const uint8_t* raw = reinterpret_cast<const uint8_t*>(&header);
+        pending_.insert(pending_.end(), raw, raw + sizeof(header));
+        pending_.insert(pending_.end(), data.begin(), data.end());
+        return {};
+    }
+
+    // group commit: a single write + fdatasync covers every append since the previous sync.
+    Result<void> sync() {
+        if (segments_.empty()) {
+            return {};
+        }
+        if (auto result = flush_pending(); !result) {
+            return std::unexpected(result.error());
+        }
+        for (int fd : dirty_fds_) {
+            if (::fdatasync(fd) < 0) {
+                return std::unexpected(errno_code());
+            }
+        }
+        if (!dirty_fds_.empty()) {
+            ++sync_count_;
+        }
+        dirty_fds_.clear();
+        return {};
+    }
+
+    Result<Record> read(raft_index_t idx) const {
+        const Segment* seg = find_segment(idx);
+        if (!seg) {
+            return std::unexpected(std::make_error_code(std::errc::result_out_of_range));
+        }
+        uint64_t slot = seg->index[idx - seg->first_idx];
+        if (slot == 0) {
+            return std::unexpected(std::make_error_code(std::errc::result_out_of_range));
+        }
+        uint64_t offset = slot - 1;
+
+        RecordHeader header;
+        Record record;
+        if (seg == &segments_.back() && offset >= seg->size) {
+            // still sitting in the group-commit buffer
+            const uint8_t* pos = pending_.data() + (offset - seg->size);
+            std::memcpy(&header, pos, sizeof(header));
+            record.data.assign(pos + sizeof(header), pos + sizeof(header) + header.len);
+        } else {
+            if (::pread(seg->fd, &header, sizeof(header), static_cast<off_t>(offset)) != sizeof(header)) {
+                return std::unexpected(std::make_error_code(std::errc::io_error));
+            }
+            record.data.resize(header.len);
+            if (header.len > 0 &&
+                ::pread(seg->fd, record.data.data(), header.len, static_cast<off_t>(offset + sizeof(header))) != header.len) {
+                return std::unexpected(std::make_error_code(std::errc::io_error));
+            }
+        }
+
+        if (header.idx != idx || header.crc != record_crc(header, record.data)) {
+            return std::unexpected(std::make_error_code(std::errc::bad_message));
+        }
+        record.idx = header.idx;
+        record.term = header.term;
+        record.id = header.id;
+        record.type = header.type;
+        return record;
+    }
+
+    // drop every entry with index >= idx. newer segments are unlinked, the one holding idx is ftruncated.
+    Result<void> truncate_suffix(raft_index_t idx) {
+        while (!segments_.empty() && segments_.back().first_idx >= idx) {
+            if (auto result = drop_segment(segments_.size() - 1); !result) {
+                return std::unexpected(result.error());
+            }
+        }
+        if (segments_.empty() || segments_.back().last_idx < idx) {
+            return {};
+        }
+
+        Segment& seg = segments_.back();
+        uint64_t offset = seg.index[idx - seg.first_idx] - 1;
+        for (raft_index_t i = idx; i <= seg.last_idx; ++i) {
+            seg.index[i - seg.first_idx] = 0;
+        }
+        seg.last_idx = idx - 1;
+
+        if (offset >= seg.size) {
+            pending_.resize(offset - seg.size); // only buffered entries were dropped - no syscalls
+            return {};
+        }
+        pending_.clear();
+        if (::ftruncate(seg.fd, static_cast<off_t>(offset)) < 0) {
+            return std::unexpected(errno_code());
+        }
+        seg.size = offset;
+        dirty_fds_.push_back(seg.fd);
+        return {};
+    }
+
+    // drop whole segments whose entries all precede idx. entries of a partially covered segment stay
+    // readable until the rest of that segment is compacted too.
+    Result<void> compact_prefix(raft_index_t idx) {
+        while (segments_.size() > 1 && segments_.front().last_idx < idx) {
+            if (auto result = drop_segment(0); !result) {
+                return std::unexpected(result.error());
+            }
+        }
+        return {};
+    }
+
+    // drop every segment and start the log over right after idx: the next append must be idx + 1. for when a
+    // snapshot up to idx replaces the log rather than trimming it.
+    Result<void> reset(raft_index_t idx) {
+        while (!segments_.empty()) {
+            if (auto result = drop_segment(segments_.size() - 1); !result) {
+                return std::unexpected(result.error());
+            }
+        }
+        return roll_segment(idx + 1);   // an empty segment, so last_index() == idx across a restart too
+    }
+
+    // raft just loaded a snapshot of everything up to (idx, term). entries past idx stay if they continue the
+    // snapshot - we hold idx with its term, or were already restarted right after it - the same rule
+    // raft_load_snapshot uses for its in-memory log. otherwise they belong to the log the snapshot replaced.
+    Result<void> on_snapshot_loaded(raft_index_t idx, int term) {
+        if (!segments_.empty() && first_index() == idx + 1) {
+            return {};
+        }
+        if (auto record = read(idx); record && record->term == term) {
+            return {};
+        }
+        return reset(idx);
+    }
+
+    // term and vote change rarely and must be durable before we answer a RequestVote, so they bypass group commit.
+    Result<void> save_term_vote(int term, int voted_for) {
+        int32_t meta[3] = {term, voted_for, 0};
+        meta[2] = static_cast<int32_t>(crc32c(meta, sizeof(int32_t) * 2));
+        if (::pwrite(meta_fd_, meta, sizeof(meta), 0) != sizeof(meta) || ::fdatasync(meta_fd_) < 0) {
+            return std::unexpected(errno_code());
+        }
+        term_ = term;
+        voted_for_ = voted_for;
+        return {};
+    }
+
+    // rebuild raft's in-memory log and persistent state from disk. must run before raft_periodic, and after
+    // raft_load_snapshot if the node has a snapshot - entries the snapshot already covers are skipped.
+    // payloads are malloc'd; the application owns them from here on (free them in its own log_pop/log_poll).
+    Result<void> load_into(raft_server_t* raft) {
+        replaying_ = true;
+        raft_set_current_term(raft, term_);
+        if (voted_for_ != -1) {
+            raft_vote_for_nodeid(raft, voted_for_);
+        }
+        for (raft_index_t idx = std::max(first_index(), raft_get_current_idx(raft) + 1); idx <= last_index(); ++idx) {
+            auto record = read(idx);
+            if (!record) {
+                replaying_ = false;
+                return std::unexpected(record.error());
+            }
+            raft_entry_t ety{};
+            ety.term = static_cast<unsigned int>(record->term);
+            ety.id = record->id;
+            ety.type = record->type;
+            ety.data.len = static_cast<unsigned int>(record->data.size());
+            ety.data.buf = std::malloc(record->data.size() ? record->data.size() : 1);
+            std::memcpy(ety.data.buf, record->data.data(), record->data.size());
+            raft_append_entry(raft, &ety);
+        }
+        replaying_ = false;
+        return {};
+    }
+
+    /*
+    raft callback glue. the raft library hands every callback the same user_data pointer, so the caller tells us how to
+    get from it to the store:
+
+        raft_cbs_t cbs{...send_requestvote, send_appendentries, applylog...};
+        RaftLogStore::install<&my_node_store>(cbs);   // RaftLogStore* my_node_store(void* user_data)
+        raft_set_callbacks(raft, &cbs, my_node);
+    */
+    template<RaftLogStore* (*Get)(void* user_data)>
+    static void install(raft_cbs_t& cbs) {
+        cbs.log_offer = [](raft_server_t*, void* udata, raft_entry_t* ety, raft_index_t idx) {
+            return Get(udata)->on_log_offer(ety, idx);
+        };
+        cbs.log_pop = [](raft_server_t*, void* udata, raft_entry_t*, raft_index_t idx) {
+            return Get(udata)->on_log_pop(idx);
+        };
+        cbs.log_poll = [](raft_server_t*, void* udata, raft_entry_t*, raft_index_t idx) {
+            return Get(udata)->on_log_poll(idx);
+        };
+        cbs.persist_term = [](raft_server_t*, void* udata, int term) {
+            return Get(udata)->on_persist_term(term);
+        };
+        cbs.persist_vote = [](raft_server_t*, void* udata, int node) {
+            return Get(udata)->on_persist_vote(node);
+        };
+    }
+
+    int on_log_offer(const raft_entry_t* ety, raft_index_t idx) {
+        if (replaying_) return 0;
+        auto data = std::span(static_cast<const uint8_t*>(ety->data.buf), ety->data.len);
+        return append(idx, static_cast<int>(ety->term), ety->id, ety->type, data) ? 0 : -1;
+    }
+    int on_log_pop(raft_index_t idx) { return truncate_suffix(idx) ? 0 : -1; }
+    int on_log_poll(raft_index_t idx) { return compact_prefix(idx + 1) ? 0 : -1; }
+    int on_persist_term(int term) { return replaying_ || save_term_vote(term, -1) ? 0 : -1; }
+    int on_persist_vote(int node) { return replaying_ || save_term_vote(term_, node) ? 0 : -1; }
+
+private:
+    struct Segment {
+        raft_index_t first_idx{1};
+        raft_index_t last_idx{0};       // first_idx - 1 while empty
+        int fd{-1};
+        int index_fd{-1};
+        uint64_t size{0};               // bytes handed to the kernel; buffered bytes live in pending_
+        uint64_t* index{nullptr};       // mmap'd, index[i] = offset + 1 of record first_idx + i
+        size_t slots{0};
+    };
+
+    Options options_;
+    std::vector<Segment> segments_;
+    std::vector<uint8_t> pending_;      // group-commit buffer for the active (last) segment
+    std::vector<int> dirty_fds_;        // fds written since the last fdatasync
+    int meta_fd_{-1};
+    int dir_fd_{-1};                    // options_.dir, fsync'd after every segment create/unlink
+    int term_{0};
+    int voted_for_{-1};
+    bool replaying_{false};
+    uint64_t sync_count_{0};
+    uint64_t dir_sync_count_{0};
+
+    explicit RaftLogStore(Options options) : options_(std::move(options)) {}
+
+    static std::error_code errno_code() {
+        return std::make_error_code(static_cast<std::errc>(errno));
+    }
+
+    static uint32_t record_crc(const RecordHeader& header, std::span<const uint8_t> data) {
+        constexpr size_t skip = sizeof(header.crc);
+        uint32_t crc = crc32c(reinterpret_cast<const uint8_t*>(&header) + skip, sizeof(header) - skip);
+        return crc32c(data.data(), data.size(), crc);
+    }
+
+    std::string segment_path(raft_index_t first_idx, const char* ext) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%020ld.%s", first_idx, ext);
+        return options_.dir + "/" + name;
+    }
+
+    bool segment_full(const Segment& seg) const {
+        return static_cast<size_t>(seg.last_idx - seg.first_idx + 1) >= seg.slots ||
+               seg.size + pending_.size() >= options_.segment_bytes;
+    }
+
+    const Segment* find_segment(raft_index_t idx) const {
+        auto it = std::upper_bound(segments_.begin(), segments_.end(), idx,
+                                   [](raft_index_t i, const Segment& s) { return i < s.first_idx; });
+        if (it == segments_.begin()) return nullptr;
+        --it;
+        return (idx <= it->last_idx) ? &*it : nullptr;
+    }
+
+    Result<void> map_index(Segment& seg, raft_index_t first_idx, bool create) {
+        std::string path = segment_path(first_idx, "idx");
+        seg.index_fd = ::open(path.c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+        if (seg.index_fd < 0) {
+            return std::unexpected(errno_code());
+        }
+        seg.slots = options_.segment_entries;
+        size_t bytes = seg.slots * sizeof(uint64_t);
+        if (::ftruncate(seg.index_fd, static_cast<off_t>(bytes)) < 0) {
+            return std::unexpected(errno_code());
+        }
+        void* mem = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, seg.index_fd, 0);
+        if (mem == MAP_FAILED) {
+            return std::unexpected(errno_code());
+        }
+        seg.index = static_cast<uint64_t*>(mem);
+        return {};
+    }
+
+    void close_segment(Segment& seg) {
+        if (seg.index) ::munmap(seg.index, seg.slots * sizeof(uint64_t));
+        if (seg.index_fd != -1) ::close(seg.index_fd);
+        if (seg.fd != -1) ::close(seg.fd);
+        seg.index = nullptr;
+        seg.index_fd = seg.fd = -1;
+    }
+
+    // makes creates and unlinks in the directory durable, like the file's own fdatasync does for its data
+    Result<void> sync_dir() {
+        if (::fsync(dir_fd_) < 0) {
+            return std::unexpected(errno_code());
+        }
+        ++dir_sync_count_;
+        return {};
+    }
+
+    Result<void> drop_segment(size_t pos) {
+        Segment& seg = segments_[pos];
+        if (pos == segments_.size() - 1) {
+            pending_.clear();
+        }
+        std::erase(dirty_fds_, seg.fd);
+        raft_index_t first_idx = seg.first_idx;
+        close_segment(seg);
+        segments_.erase(segments_.begin() + static_cast<std::ptrdiff_t>(pos));
+        if (::unlink(segment_path(first_idx, "log").c_str()) < 0 ||
+            ::unlink(segment_path(first_idx, "idx").c_str()) < 0) {
+            return std::unexpected(errno_code());
+        }
+        return sync_dir();
+    }
+
+    // hand buffered records to the kernel (no fsync) so the active segment can be sealed or read back.
+    Result<void> flush_pending() {
+        if (pending_.empty()) {
+            return {};
+        }
+        Segment& seg = segments_.back();
+        size_t written = 0;
+        while (written < pending_.size()) {
+            ssize_t rv = ::pwrite(seg.fd, pending_.data() + written, pending_.size() - written,
+                                  static_cast<off_t>(seg.size + written));
+            if (rv < 0) {
+                if (errno == EINTR) continue;
+                return std::unexpected(errno_code());
+            }
+            written += static_cast<size_t>(rv);
+        }
+        seg.size += pending_.size();
+        pending_.clear();
+        if (std::find(dirty_fds_.begin(), dirty_fds_.end(), seg.fd) == dirty_fds_.end()) {
+            dirty_fds_.push_back(seg.fd);
+        }
+        return {};
+    }
+
+    Result<void> roll_segment(raft_index_t first_idx) {
+        if (!segments_.empty()) {
+            if (auto result = flush_pending(); !result) {
+                return std::unexpected(result.error());
+            }
+            Segment& sealed = segments_.back();
+            ::msync(sealed.index, sealed.slots * sizeof(uint64_t), MS_ASYNC);
+        }
+
+        Segment seg;
+        seg.first_idx = first_idx;
+        seg.last_idx = first_idx - 1;
+        seg.fd = ::open(segment_path(first_idx, "log").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (seg.fd < 0) {
+            return std::unexpected(errno_code());
+        }
+        if (auto result = map_index(seg, first_idx, true); !result) {
+            close_segment(seg);
+            return std::unexpected(result.error());
+        }
+        std::memset(seg.index, 0, seg.slots * sizeof(uint64_t));
+        segments_.push_back(seg);
+        return sync_dir();
+    }
+
+    // walk a segment record by record, re-deriving its index. a bad CRC or short read ends the segment there.
+    Result<void> scan_segment(Segment& seg) {
+        struct stat st{};
+        if (::fstat(seg.fd, &st) < 0) {
+            return std::unexpected(errno_code());
+        }
+        uint64_t file_size = static_cast<uint64_t>(st.st_size);
+        uint64_t offset = 0;
+        std::vector<uint8_t> payload;
+        std::memset(seg.index, 0, seg.slots * sizeof(uint64_t));
+        seg.last_idx = seg.first_idx - 1;
+
+        while (offset + sizeof(RecordHeader) <= file_size) {
+            RecordHeader header;
+            if (::pread(seg.fd, &header, sizeof(header), static_cast<off_t>(offset)) != sizeof(header)) break;
+            if (header.idx != seg.last_idx + 1 || offset + sizeof(header) + header.len > file_size) break;
+            payload.resize(header.len);
+            if (header.len > 0 &&
+                ::pread(seg.fd, payload.data(), header.len, static_cast<off_t>(offset + sizeof(header))) != header.len) break;
+            if (header.crc != record_crc(header, payload)) break;
+            if (static_cast<size_t>(header.idx - seg.first_idx) >= seg.slots) break;
+
+            seg.index[header.idx - seg.first_idx] = offset + 1;
+            seg.last_idx = header.idx;
+            offset += sizeof(header) + header.len;
+        }
+
+        if (offset < file_size) {
+            log_message("raft log: dropping {} torn bytes at the tail of segment {}", file_size - offset, seg.first_idx);
+            if (::ftruncate(seg.fd, static_cast<off_t>(offset)) < 0) {
+                return std::unexpected(errno_code());
+            }
+        }
+        seg.size = offset;
+        return {};
+    }
+
+    Result<void> recover() {
+        std::error_code ec;
+        std::filesystem::create_directories(options_.dir, ec);
+        if (ec) {
+            return std::unexpected(ec);
+        }
+
+        dir_fd_ = ::open(options_.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd_ < 0) {
+            return std::unexpected(errno_code());
+        }
+        meta_fd_ = ::open((options_.dir + "/raft.meta").c_str(), O_RDWR | O_CREAT, 0644);
+        if (meta_fd_ < 0) {
+            return std::unexpected(errno_code());
+        }
+        int32_t meta[3] = {0, -1, 0};
+        if (::pread(meta_fd_, meta, sizeof(meta), 0) == sizeof(meta) &&
+            static_cast<uint32_t>(meta[2]) == crc32c(meta, sizeof(int32_t) * 2)) {
+            term_ = meta[0];
+            voted_for_ = meta[1];
+        }
+
+        std::vector<raft_index_t> firsts;
+        for (const auto& file : std::filesystem::directory_iterator(options_.dir, ec)) {
+            if (file.path().extension() == ".log") {
+                firsts.push_back(std::stol(file.path().stem().string()));
+            }
+        }
+        if (ec) {
+            return std::unexpected(ec);
+        }
+        std::sort(firsts.begin(), firsts.end());
+
+        for (size_t i = 0; i < firsts.size(); ++i) {
+            Segment seg;
+            seg.first_idx = firsts[i];
+            seg.fd = ::open(segment_path(seg.first_idx, "log").c_str(), O_RDWR);
+            if (seg.fd < 0) {
+                return std::unexpected(errno_code());
+            }
+            if (auto result = map_index(seg, seg.first_idx, true); !result) {
+                close_segment(seg);
+                return std::unexpected(result.error());
+            }
+            if (auto result = scan_segment(seg); !result) {
+                close_segment(seg);
+                return std::unexpected(result.error());
+            }
+            bool contiguous = segments_.empty() || segments_.back().last_idx + 1 == seg.first_idx;
+            if (!contiguous) {
+                // a gap means a crash between truncation and unlink - everything from here on is stale
+                log_message("raft log: discarding segment {} (expected index {})", seg.first_idx, segments_.back().last_idx + 1);
+                close_segment(seg);
+                ::unlink(segment_path(firsts[i], "log").c_str());
+                ::unlink(segment_path(firsts[i], "idx").c_str());
+                continue;
+            }
+            segments_.push_back(seg);
+        }
+        // raft.meta or an index file may have just been created, and stale segments unlinked
+        return sync_dir();
+    }
+};
+
+#endif // RAFT_LOG_STORE_HPP
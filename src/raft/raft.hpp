@@ -14,6 +14,15 @@
 #ifndef RAFT_H_
 #define RAFT_H_
 
+/** Log index type.
+ * 64-bit so that a long-lived cluster cannot wrap its log. */
+typedef long int raft_index_t;
+
+/** Heartbeat round identifier.
+ * Bumped by the leader on every broadcast and echoed back by followers so
+ * the leader can tell which round a response acknowledges. */
+typedef unsigned long raft_msg_id_t;
+
 typedef enum {
     RAFT_STATE_NONE,
     RAFT_STATE_FOLLOWER,
@@ -67,7 +76,7 @@ typedef struct
     int term;
 
     /** the entry's index */
-    int idx;
+    raft_index_t idx;
 } msg_entry_response_t;
 
 /** Vote request message.
@@ -82,7 +91,7 @@ typedef struct
     int candidate_id;
 
     /** index of candidate's last log entry */
-    int last_log_idx;
+    raft_index_t last_log_idx;
 
     /** term of candidate's last log entry */
     int last_log_term;
@@ -110,7 +119,7 @@ typedef struct
 
     /** the index of the log just before the newest entry for the node who
      * receives this message */
-    int prev_log_idx;
+    raft_index_t prev_log_idx;
 
     /** the term of the log just before the newest entry for the node who
      * receives this message */
@@ -118,13 +127,18 @@ typedef struct
 
     /** the index of the entry that has been appended to the majority of the
      * cluster. Entries up to this index will be applied to the FSM */
-    int leader_commit;
+    raft_index_t leader_commit;
 
     /** number of entries within this message */
     int n_entries;
 
     /** array of entries within this message */
     msg_entry_t* entries;
+
+    /* Non-Raft fields follow: */
+
+    /** heartbeat round this message belongs to; echoed in the response */
+    raft_msg_id_t msg_id;
 } msg_appendentries_t;
 
 /** Appendentries response message.
@@ -143,10 +157,13 @@ typedef struct
      * regards to full fledged RPC */
 
     /** This is the highest log IDX we've received and appended to our log */
-    int current_idx;
+    raft_index_t current_idx;
 
     /** The first idx that we received within the appendentries message */
-    int first_idx;
+    raft_index_t first_idx;
+
+    /** msg_id of the appendentries message this responds to */
+    raft_msg_id_t msg_id;
 } msg_appendentries_response_t;
 
 typedef void* raft_server_t;
@@ -182,6 +199,23 @@ typedef int (
     msg_appendentries_t* msg
     );
 
+/** Callback for sending a snapshot to a node.
+ * Called instead of send_appendentries when the entries the node needs next
+ * have already been compacted out of the log.
+ * The application streams its latest snapshot to the node and, once the node
+ * has loaded it, resumes replication via raft_node_set_next_idx.
+ * @param[in] raft The Raft server making this callback
+ * @param[in] user_data User data that is passed from Raft server
+ * @param[in] node The node that needs the snapshot
+ * @return 0 on success */
+typedef int (
+*func_send_snapshot_f
+)   (
+    raft_server_t* raft,
+    void *user_data,
+    raft_node_t* node
+    );
+
 /** Callback for detecting when non-voting nodes have obtained enough logs.
  * This triggers only when there are no pending configuration changes.
  * @param[in] raft The Raft server making this callback
@@ -226,6 +260,27 @@ typedef int (
     raft_entry_t* ety
     );
 
+/** Callback for applying a run of committed log entries in one go.
+ * Takes over from applylog when set: the entries at first_idx .. first_idx + n - 1
+ * are contiguous in memory, and last_applied_idx only moves past them once this
+ * returns 0, so the application may apply them concurrently as long as it has
+ * finished before returning.
+ * @param[in] raft The Raft server making this callback
+ * @param[in] user_data User data that is passed from Raft server
+ * @param[in] etys The first entry to be applied
+ * @param[in] first_idx Log index of etys[0]
+ * @param[in] n Number of entries
+ * @return 0 on success */
+typedef int (
+*func_applylog_batch_f
+)   (
+    raft_server_t* raft,
+    void *user_data,
+    raft_entry_t* etys,
+    raft_index_t first_idx,
+    int n
+    );
+
 /** Callback for saving who we voted for to disk.
  * For safety reasons this callback MUST flush the change to disk.
  * @param[in] raft The Raft server making this callback
@@ -264,7 +319,7 @@ typedef int (
     raft_server_t* raft,
     void *user_data,
     raft_entry_t *entry,
-    int entry_idx
+    raft_index_t entry_idx
     );
 
 typedef struct
@@ -308,6 +363,15 @@ typedef struct
     /** Callback for catching debugging log messages
      * This callback is optional */
     func_log_f log;
+
+    /** Callback for sending a snapshot to a node that has fallen behind the
+     * start of the log.
+     * This callback is optional; without it such nodes cannot catch up. */
+    func_send_snapshot_f send_snapshot;
+
+    /** Callback for applying committed entries in batches
+     * This callback is optional; replaces applylog when set. */
+    func_applylog_batch_f applylog_batch;
 } raft_cbs_t;
 
 typedef struct
@@ -480,11 +544,11 @@ int raft_get_current_term(raft_server_t* me);
 
 /**
  * @return current log index */
-int raft_get_current_idx(raft_server_t* me);
+raft_index_t raft_get_current_idx(raft_server_t* me);
 
 /**
  * @return commit index */
-int raft_get_commit_idx(raft_server_t* me_);
+raft_index_t raft_get_commit_idx(raft_server_t* me_);
 
 /**
  * @return 1 if follower; 0 otherwise */
@@ -508,7 +572,7 @@ int raft_get_request_timeout(raft_server_t* me);
 
 /**
  * @return index of last applied entry */
-int raft_get_last_applied_idx(raft_server_t* me);
+raft_index_t raft_get_last_applied_idx(raft_server_t* me);
 
 /**
  * @return 1 if node is leader; 0 otherwise */
@@ -516,11 +580,11 @@ int raft_node_is_leader(raft_node_t* node);
 
 /**
  * @return the node's next index */
-int raft_node_get_next_idx(raft_node_t* node);
+raft_index_t raft_node_get_next_idx(raft_node_t* node);
 
 /**
  * @return this node's user data */
-int raft_node_get_match_idx(raft_node_t* me);
+raft_index_t raft_node_get_match_idx(raft_node_t* me);
 
 /**
  * @return this node's user data */
@@ -533,7 +597,7 @@ void raft_node_set_udata(raft_node_t* me, void* user_data);
 /**
  * @param[in] idx The entry's index
  * @return entry from index */
-raft_entry_t* raft_get_entry_from_idx(raft_server_t* me, int idx);
+raft_entry_t* raft_get_entry_from_idx(raft_server_t* me, raft_index_t idx);
 
 /**
  * @param[in] node The node's ID
@@ -590,7 +654,7 @@ void raft_set_current_term(raft_server_t* me, const int term);
 /** Set the commit idx.
  * This should be used to reload persistent state, ie. the commit_idx field.
  * @param[in] commit_idx The new commit index. */
-void raft_set_commit_idx(raft_server_t* me, int commit_idx);
+void raft_set_commit_idx(raft_server_t* me, raft_index_t commit_idx);
 
 /** Add an entry to the server's log.
  * This should be used to reload persistent state, ie. the commit log.
@@ -649,6 +713,71 @@ int raft_entry_is_voting_cfg_change(raft_entry_t* ety);
  * @return 1 if this is a configuration change. */
 int raft_entry_is_cfg_change(raft_entry_t* ety);
 
+/** Drop every log entry up to and including idx.
+ * Call this once the state machine has been snapshotted at idx.
+ * The log_poll callback is called for each dropped entry.
+ * @param[in] idx Last index covered by the snapshot; must already be applied
+ * @return 0 on success; -1 if idx has not been applied or is not in the log */
+int raft_compact_log(raft_server_t* me, raft_index_t idx);
+
+/** Replace the log with a snapshot received from the leader.
+ * The state machine must already hold the snapshot's contents.
+ * If our entry at idx has the snapshot's term, the entries after it are kept
+ * and only those up to idx are dropped (log_poll callback); otherwise every
+ * entry is removed (log_pop callback). The commit and applied indexes jump
+ * to idx.
+ * @param[in] term Term of the last entry covered by the snapshot
+ * @param[in] idx Index of the last entry covered by the snapshot
+ * @return 0 on success; -1 if the snapshot is older than our commit index */
+int raft_load_snapshot(raft_server_t* me, int term, raft_index_t idx);
+
+/**
+ * @return index of the last entry covered by the latest snapshot; 0 if none */
+raft_index_t raft_get_snapshot_last_idx(raft_server_t* me);
+
+/**
+ * @return term of the last entry covered by the latest snapshot; 0 if none */
+int raft_get_snapshot_last_term(raft_server_t* me);
+
+/** Callback for a queued read request.
+ * @param[in] arg The cb_arg passed to raft_queue_read_request
+ * @param[in] can_read 1 if the state machine is now at least as fresh as the
+ *  leader's commit index at the time of the request and may be read from
+ *  inside this callback; 0 if we lost leadership and the read must be retried
+ *  elsewhere */
+typedef void (*func_read_request_callback_f)(void *arg, int can_read);
+
+/** Queue a linearizable read (ReadIndex).
+ * No log entry is written. Instead the leader confirms it is still leader
+ * with one heartbeat round, then calls cb once last_applied_idx has caught
+ * up with the commit index it observed. Every read queued before the next
+ * heartbeat shares that round, so a burst of reads costs one round trip.
+ * Reads wait until the leader has committed an entry from its own term;
+ * append a no-op on becoming leader so that happens promptly.
+ * @return 0 on success; -1 if we are not the leader */
+int raft_queue_read_request(raft_server_t* me, func_read_request_callback_f cb, void *cb_arg);
+
+/** Enable leader leases for raft_lease_read_ok.
+ * A lease starts when a heartbeat is sent and is valid for msec once a
+ * majority acknowledges it. It relies on bounded clock drift, so msec is
+ * clamped below the election timeout; 0 (the default) disables leases.
+ * @param[in] msec Lease length in milliseconds */
+void raft_set_lease_timeout(raft_server_t* me, int msec);
+
+/** Lease-based read fast path.
+ * @return 1 if we hold a valid lease and the state machine has applied
+ *  everything committed, so the read can be served locally right now
+ *  without a heartbeat round; 0 otherwise (fall back to
+ *  raft_queue_read_request) */
+int raft_lease_read_ok(raft_server_t* me);
+
+/** Leader's commit index as last heard in an appendentries message.
+ * On the leader this is just the commit index. A follower or non-voting
+ * node can compare it with its last applied index to see how stale its
+ * state machine is.
+ * @return highest leader commit index seen */
+raft_index_t raft_get_leader_commit_idx(raft_server_t* me);
+
 #endif /* RAFT_H_ */
 #ifndef RAFT_LOG_H_
 #define RAFT_LOG_H_
@@ -657,7 +786,7 @@ typedef void* log_t;
 
 log_t* log_new();
 
-void log_set_callbacks(log_t* me_, raft_cbs_t* funcs, void* raft);
+void log_set_callbacks(log_t* me_, raft_cbs_t* funcs, raft_server_t* raft);
 
 void log_free(log_t* me_);
 
@@ -674,7 +803,7 @@ int log_count(log_t* me_);
 
 /**
  * Delete all logs from this log onwards */
-void log_delete(log_t* me_, int idx);
+void log_delete(log_t* me_, raft_index_t idx);
 
 /**
  * Empty the queue. */
@@ -685,17 +814,25 @@ void log_empty(log_t * me_);
  * @return oldest entry */
 void *log_poll(log_t * me_);
 
-raft_entry_t* log_get_from_idx(log_t* me_, int idx, int *n_etys);
+raft_entry_t* log_get_from_idx(log_t* me_, raft_index_t idx, int *n_etys);
 
-raft_entry_t* log_get_at_idx(log_t* me_, int idx);
+raft_entry_t* log_get_at_idx(log_t* me_, raft_index_t idx);
 
 /**
  * @return youngest entry */
 raft_entry_t *log_peektail(log_t * me_);
 
-void log_delete(log_t* me_, int idx);
+void log_delete(log_t* me_, raft_index_t idx);
+
+raft_index_t log_get_current_idx(log_t* me_);
 
-int log_get_current_idx(log_t* me_);
+/**
+ * @return index of the entry just before the oldest entry held in the log */
+raft_index_t log_get_base(log_t* me_);
+
+/**
+ * Remove every entry and restart the log right after idx. */
+void log_load_from_snapshot(log_t* me_, raft_index_t idx);
 
 #endif /* RAFT_LOG_H_ */
 
@@ -712,6 +849,21 @@ int log_get_current_idx(log_t* me_);
  * @version 0.1
  */
 
+#define RAFT_MSG_ID_RING 64
+
+typedef struct raft_read_request {
+    /* heartbeat round that must be acknowledged by a majority */
+    raft_msg_id_t msg_id;
+
+    /* commit index to wait for; -1 until the round is confirmed */
+    raft_index_t read_idx;
+
+    func_read_request_callback_f cb;
+    void *cb_arg;
+
+    struct raft_read_request *next;
+} raft_read_request_t;
+
 typedef struct {
     /* Persistent state: */
 
@@ -724,15 +876,15 @@ typedef struct {
     int voted_for;
 
     /* the log which is replicated */
-    void* log;
+    log_t* log;
 
     /* Volatile state: */
 
     /* idx of highest log entry known to be committed */
-    int commit_idx;
+    raft_index_t commit_idx;
 
     /* idx of highest log entry applied to state machine */
-    int last_applied_idx;
+    raft_index_t last_applied_idx;
 
     /* follower/leader/candidate indicator */
     int state;
@@ -740,7 +892,7 @@ typedef struct {
     /* amount of time left till timeout */
     int timeout_elapsed;
 
-    raft_node_t* nodes;
+    raft_node_t** nodes;
     int num_nodes;
 
     int election_timeout;
@@ -758,7 +910,34 @@ typedef struct {
     raft_node_t* node;
 
     /* the log which has a voting cfg change, otherwise -1 */
-    int voting_cfg_change_log_idx;
+    raft_index_t voting_cfg_change_log_idx;
+
+    /* last entry covered by the latest snapshot; the log starts right after it */
+    raft_index_t snapshot_last_idx;
+    int snapshot_last_term;
+
+    /* heartbeat round of the latest broadcast */
+    raft_msg_id_t msg_id;
+
+    /* highest round acknowledged by a majority (including us) */
+    raft_msg_id_t quorum_msg_id;
+
+    /* pending ReadIndex requests, oldest first */
+    raft_read_request_t* read_queue_head;
+    raft_read_request_t* read_queue_tail;
+
+    /* milliseconds of raft_periodic time since raft_new */
+    long now;
+
+    /* leader lease length (0 = disabled) and when the current lease runs out */
+    int lease_timeout;
+    long lease_until;
+
+    /* when each of the last RAFT_MSG_ID_RING rounds was broadcast */
+    long msg_sent_at[RAFT_MSG_ID_RING];
+
+    /* highest leader_commit seen in an appendentries message */
+    raft_index_t leader_commit_idx;
 } raft_server_private_t;
 
 void raft_election_start(raft_server_t* me);
@@ -784,13 +963,19 @@ void raft_send_appendentries_all(raft_server_t* me_);
  * @return 1 if entry committed, 0 otherwise */
 int raft_apply_entry(raft_server_t* me_);
 
+/**
+ * Apply every committed entry through the applylog_batch callback, as few
+ * calls as the log's ring buffer allows.
+ * @return 0 on success, -1 if the callback failed */
+int raft_apply_batch(raft_server_t* me_);
+
 /**
  * Appends entry using the current term.
  * Note: we make the assumption that current term is up-to-date
  * @return 0 if unsuccessful */
 int raft_append_entry(raft_server_t* me_, raft_entry_t* c);
 
-void raft_set_last_applied_idx(raft_server_t* me, int idx);
+void raft_set_last_applied_idx(raft_server_t* me, raft_index_t idx);
 
 void raft_set_state(raft_server_t* me_, int state);
 
@@ -798,11 +983,11 @@ int raft_get_state(raft_server_t* me_);
 
 raft_node_t* raft_node_new(void* udata, int id);
 
-void raft_node_set_next_idx(raft_node_t* node, int nextIdx);
+void raft_node_set_next_idx(raft_node_t* node, raft_index_t nextIdx);
 
-void raft_node_set_match_idx(raft_node_t* node, int matchIdx);
+void raft_node_set_match_idx(raft_node_t* node, raft_index_t matchIdx);
 
-int raft_node_get_match_idx(raft_node_t* me_);
+raft_index_t raft_node_get_match_idx(raft_node_t* me_);
 
 void raft_node_vote_for_me(raft_node_t* me_, const int vote);
 
@@ -814,6 +999,20 @@ int raft_node_has_sufficient_logs(raft_node_t* me_);
 
 int raft_votes_is_majority(const int nnodes, const int nvotes);
 
+raft_msg_id_t raft_node_get_max_seen_msg_id(raft_node_t* me_);
+
+void raft_node_set_max_seen_msg_id(raft_node_t* me_, raft_msg_id_t msg_id);
+
+/**
+ * Recompute the highest heartbeat round acknowledged by a majority (we count
+ * as having seen every round we sent) and extend the lease if it moved. */
+void raft_update_quorum_msg_id(raft_server_t* me_);
+
+/**
+ * Hand out ReadIndex results whose round is confirmed and whose index has
+ * been applied; fail everything if we're no longer leader. */
+void raft_process_read_queue(raft_server_t* me_);
+
 #endif /* RAFT_PRIVATE_H_ */
 /**
  * Copyright (c) 2013, Willem-Hendrik Thiart
@@ -850,13 +1049,13 @@ typedef struct
     int front, back;
 
     /* we compact the log, and thus need to increment the Base Log Index */
-    int base;
+    raft_index_t base;
 
     raft_entry_t* entries;
 
     /* callbacks */
     raft_cbs_t *cb;
-    void* raft;
+    raft_server_t* raft;
 } log_private_t;
 
 static void __raft__ensurecapacity(log_private_t * me)
@@ -897,7 +1096,7 @@ log_t* log_new()
     return (log_t*)me;
 }
 
-void log_set_callbacks(log_t* me_, raft_cbs_t* funcs, void* raft)
+void log_set_callbacks(log_t* me_, raft_cbs_t* funcs, raft_server_t* raft)
 {
     log_private_t* me = (log_private_t*)me_;
 
@@ -914,22 +1113,27 @@ int log_append_entry(log_t* me_, raft_entry_t* c)
 
     __raft__ensurecapacity(me);
 
+    /* callbacks are handed the entry's log index, not its array slot */
     if (me->cb && me->cb->log_offer)
-        me->cb->log_offer(me->raft, raft_get_udata(me->raft), c, me->back);
+        if (0 != me->cb->log_offer(me->raft, raft_get_udata(me->raft), c,
+                                   me->base + me->count + 1))
+            return -1;
     memcpy(&me->entries[me->back], c, sizeof(raft_entry_t));
     me->count++;
     me->back++;
+    if (me->back == me->size)
+        me->back = 0;
     return 0;
 }
 
-raft_entry_t* log_get_from_idx(log_t* me_, int idx, int *n_etys)
+raft_entry_t* log_get_from_idx(log_t* me_, raft_index_t idx, int *n_etys)
 {
     log_private_t* me = (log_private_t*)me_;
     int i;
 
     assert(0 <= idx - 1);
 
-    if (me->base + me->count < idx || idx < me->base)
+    if (me->base + me->count < idx || idx <= me->base)
     {
         *n_etys = 0;
         return NULL;
@@ -951,14 +1155,14 @@ raft_entry_t* log_get_from_idx(log_t* me_, int idx, int *n_etys)
     return &me->entries[i];
 }
 
-raft_entry_t* log_get_at_idx(log_t* me_, int idx)
+raft_entry_t* log_get_at_idx(log_t* me_, raft_index_t idx)
 {
     log_private_t* me = (log_private_t*)me_;
     int i;
 
     assert(0 <= idx - 1);
 
-    if (me->base + me->count < idx || idx < me->base)
+    if (me->base + me->count < idx || idx <= me->base)
         return NULL;
 
     /* idx starts at 1 */
@@ -974,10 +1178,10 @@ int log_count(log_t* me_)
     return ((log_private_t*)me_)->count;
 }
 
-void log_delete(log_t* me_, int idx)
+void log_delete(log_t* me_, raft_index_t idx)
 {
     log_private_t* me = (log_private_t*)me_;
-    int end;
+    raft_index_t end;
 
     /* idx starts at 1 */
     idx -= 1;
@@ -985,9 +1189,11 @@ void log_delete(log_t* me_, int idx)
 
     for (end = log_count(me_); idx < end; idx++)
     {
+        if (0 == me->back)
+            me->back = me->size;
         if (me->cb && me->cb->log_pop)
             me->cb->log_pop(me->raft, raft_get_udata(me->raft),
-                            &me->entries[me->back - 1], me->back);
+                            &me->entries[me->back - 1], me->base + me->count);
         me->back--;
         me->count--;
     }
@@ -1003,8 +1209,10 @@ void *log_poll(log_t * me_)
     const void *elem = &me->entries[me->front];
     if (me->cb && me->cb->log_poll)
         me->cb->log_poll(me->raft, raft_get_udata(me->raft),
-                         &me->entries[me->front], me->front);
+                         &me->entries[me->front], me->base + 1);
     me->front++;
+    if (me->front == me->size)
+        me->front = 0;
     me->count--;
     me->base++;
     return (void*)elem;
@@ -1040,11 +1248,27 @@ void log_free(log_t * me_)
     free(me);
 }
 
-int log_get_current_idx(log_t* me_)
+raft_index_t log_get_current_idx(log_t* me_)
 {
     log_private_t* me = (log_private_t*)me_;
     return log_count(me_) + me->base;
 }
+
+raft_index_t log_get_base(log_t* me_)
+{
+    return ((log_private_t*)me_)->base;
+}
+
+void log_load_from_snapshot(log_t* me_, raft_index_t idx)
+{
+    log_private_t* me = (log_private_t*)me_;
+
+    log_delete(me_, me->base + 1);
+    me->front = 0;
+    me->back = 0;
+    me->count = 0;
+    me->base = idx;
+}
 /**
  * Copyright (c) 2013, Willem-Hendrik Thiart
  * Use of this source code is governed by a BSD-style license that can be
@@ -1071,12 +1295,15 @@ typedef struct
 {
     void* udata;
 
-    int next_idx;
-    int match_idx;
+    raft_index_t next_idx;
+    raft_index_t match_idx;
 
     int flags;
 
     int id;
+
+    /* latest heartbeat round this node has acknowledged */
+    raft_msg_id_t max_seen_msg_id;
 } raft_node_private_t;
 
 raft_node_t* raft_node_new(void* udata, int id)
@@ -1093,26 +1320,26 @@ raft_node_t* raft_node_new(void* udata, int id)
     return (raft_node_t*)me;
 }
 
-int raft_node_get_next_idx(raft_node_t* me_)
+raft_index_t raft_node_get_next_idx(raft_node_t* me_)
 {
     raft_node_private_t* me = (raft_node_private_t*)me_;
     return me->next_idx;
 }
 
-void raft_node_set_next_idx(raft_node_t* me_, int nextIdx)
+void raft_node_set_next_idx(raft_node_t* me_, raft_index_t nextIdx)
 {
     raft_node_private_t* me = (raft_node_private_t*)me_;
     /* log index begins at 1 */
     me->next_idx = nextIdx < 1 ? 1 : nextIdx;
 }
 
-int raft_node_get_match_idx(raft_node_t* me_)
+raft_index_t raft_node_get_match_idx(raft_node_t* me_)
 {
     raft_node_private_t* me = (raft_node_private_t*)me_;
     return me->match_idx;
 }
 
-void raft_node_set_match_idx(raft_node_t* me_, int matchIdx)
+void raft_node_set_match_idx(raft_node_t* me_, raft_index_t matchIdx)
 {
     raft_node_private_t* me = (raft_node_private_t*)me_;
     me->match_idx = matchIdx;
@@ -1177,6 +1404,18 @@ int raft_node_get_id(raft_node_t* me_)
     raft_node_private_t* me = (raft_node_private_t*)me_;
     return me->id;
 }
+
+raft_msg_id_t raft_node_get_max_seen_msg_id(raft_node_t* me_)
+{
+    raft_node_private_t* me = (raft_node_private_t*)me_;
+    return me->max_seen_msg_id;
+}
+
+void raft_node_set_max_seen_msg_id(raft_node_t* me_, raft_msg_id_t msg_id)
+{
+    raft_node_private_t* me = (raft_node_private_t*)me_;
+    me->max_seen_msg_id = msg_id;
+}
 /**
  * Copyright (c) 2013, Willem-Hendrik Thiart
  * Use of this source code is governed by a BSD-style license that can be
@@ -1247,6 +1486,14 @@ void raft_free(raft_server_t* me_)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
 
+    /* nobody is going to confirm these any more */
+    while (me->read_queue_head)
+    {
+        raft_read_request_t* req = me->read_queue_head;
+        me->read_queue_head = req->next;
+        req->cb(req->cb_arg, 0);
+        free(req);
+    }
     log_free(me->log);
     free(me_);
 }
@@ -1255,7 +1502,7 @@ void raft_election_start(raft_server_t* me_)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
 
-    __raft__log(me_, NULL, "election starting: %d %d, term: %d ci: %d",
+    __raft__log(me_, NULL, "election starting: %d %d, term: %d ci: %ld",
           me->election_timeout, me->timeout_elapsed, me->current_term,
           raft_get_current_idx(me_));
 
@@ -1316,10 +1563,13 @@ int raft_periodic(raft_server_t* me_, int msec_since_last_period)
     raft_server_private_t* me = (raft_server_private_t*)me_;
 
     me->timeout_elapsed += msec_since_last_period;
+    me->now += msec_since_last_period;
 
     if (me->state == RAFT_STATE_LEADER)
     {
-        if (me->request_timeout <= me->timeout_elapsed)
+        /* reads queued since the last broadcast are waiting on the next one */
+        if (me->request_timeout <= me->timeout_elapsed ||
+            (me->read_queue_tail && me->msg_id < me->read_queue_tail->msg_id))
             raft_send_appendentries_all(me_);
     }
     else if (me->election_timeout <= me->timeout_elapsed)
@@ -1329,13 +1579,23 @@ int raft_periodic(raft_server_t* me_, int msec_since_last_period)
     }
 
     if (me->last_applied_idx < me->commit_idx)
-        if (-1 == raft_apply_entry(me_))
+    {
+        if (me->cb.applylog_batch)
+        {
+            if (-1 == raft_apply_batch(me_))
+                return -1;
+        }
+        else if (-1 == raft_apply_entry(me_))
             return -1;
+    }
+
+    if (me->read_queue_head)
+        raft_process_read_queue(me_);
 
     return 0;
 }
 
-raft_entry_t* raft_get_entry_from_idx(raft_server_t* me_, int etyidx)
+raft_entry_t* raft_get_entry_from_idx(raft_server_t* me_, raft_index_t etyidx)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
     return log_get_at_idx(me->log, etyidx);
@@ -1348,12 +1608,21 @@ int raft_recv_appendentries_response(raft_server_t* me_,
     raft_server_private_t* me = (raft_server_private_t*)me_;
 
     __raft__log(me_, node,
-          "received appendentries response %s ci:%d rci:%d 1stidx:%d",
+          "received appendentries response %s ci:%ld rci:%ld 1stidx:%ld",
           r->success == 1 ? "SUCCESS" : "fail",
           raft_get_current_idx(me_),
           r->current_idx,
           r->first_idx);
 
+    /* any response in our term acknowledges our leadership for that round,
+     * even a stale or failed one */
+    if (raft_is_leader(me_) && node && r->term == me->current_term &&
+        raft_node_get_max_seen_msg_id(node) < r->msg_id)
+    {
+        raft_node_set_max_seen_msg_id(node, r->msg_id);
+        raft_update_quorum_msg_id(me_);
+    }
+
     /* Stale response -- ignore */
     if (r->current_idx != 0 && r->current_idx <= raft_node_get_match_idx(node))
         return 0;
@@ -1382,7 +1651,7 @@ int raft_recv_appendentries_response(raft_server_t* me_,
            decrement nextIndex and retry (§5.3) */
         assert(0 <= raft_node_get_next_idx(node));
 
-        int next_idx = raft_node_get_next_idx(node);
+        raft_index_t next_idx = raft_node_get_next_idx(node);
         assert(0 <= next_idx);
         if (r->current_idx < next_idx - 1)
             raft_node_set_next_idx(node, min(r->current_idx + 1, raft_get_current_idx(me_)));
@@ -1412,19 +1681,19 @@ int raft_recv_appendentries_response(raft_server_t* me_,
 
     /* Update commit idx */
     int votes = 1; /* include me */
-    int point = r->current_idx;
+    raft_index_t point = r->current_idx;
     int i;
     for (i = 0; i < me->num_nodes; i++)
     {
         if (me->node == me->nodes[i] || !raft_node_is_voting(me->nodes[i]))
             continue;
 
-        int match_idx = raft_node_get_match_idx(me->nodes[i]);
+        raft_index_t match_idx = raft_node_get_match_idx(me->nodes[i]);
 
         if (0 < match_idx)
         {
             raft_entry_t* ety = raft_get_entry_from_idx(me_, match_idx);
-            if (ety->term == me->current_term && point <= match_idx)
+            if (ety && (int)ety->term == me->current_term && point <= match_idx)
                 votes++;
         }
     }
@@ -1451,9 +1720,10 @@ int raft_recv_appendentries(
     raft_server_private_t* me = (raft_server_private_t*)me_;
 
     me->timeout_elapsed = 0;
+    r->msg_id = ae->msg_id;
 
     if (0 < ae->n_entries)
-        __raft__log(me_, node, "recvd appendentries from: %lx, t:%d ci:%d lc:%d pli:%d plt:%d #%d",
+        __raft__log(me_, node, "recvd appendentries from: %p, t:%d ci:%ld lc:%ld pli:%ld plt:%d #%d",
               node,
               ae->term,
               raft_get_current_idx(me_),
@@ -1483,26 +1753,38 @@ int raft_recv_appendentries(
         goto fail_with_current_idx;
     }
 
+    /* remember how far the leader has committed even if our log can't take
+     * these entries yet - it's what follower reads measure staleness by */
+    if (me->leader_commit_idx < ae->leader_commit)
+        me->leader_commit_idx = ae->leader_commit;
+
     /* Not the first appendentries we've received */
     /* NOTE: the log starts at 1 */
     if (0 < ae->prev_log_idx)
     {
         raft_entry_t* e = raft_get_entry_from_idx(me_, ae->prev_log_idx);
 
-        if (!e)
+        /* prev entry was compacted into our snapshot, which only holds
+         * committed entries, so the terms can only disagree on a stale AE */
+        if (!e && ae->prev_log_idx == me->snapshot_last_idx)
         {
-            __raft__log(me_, node, "AE no log at prev_idx %d", ae->prev_log_idx);
+            if (me->snapshot_last_term != ae->prev_log_term)
+                goto fail_with_current_idx;
+        }
+        else if (!e)
+        {
+            __raft__log(me_, node, "AE no log at prev_idx %ld", ae->prev_log_idx);
             goto fail_with_current_idx;
         }
 
         /* 2. Reply false if log doesn't contain an entry at prevLogIndex
            whose term matches prevLogTerm (§5.3) */
-        if (raft_get_current_idx(me_) < ae->prev_log_idx)
+        else if (raft_get_current_idx(me_) < ae->prev_log_idx)
             goto fail_with_current_idx;
 
-        if (e->term != ae->prev_log_term)
+        else if ((int)e->term != ae->prev_log_term)
         {
-            __raft__log(me_, node, "AE term doesn't match prev_term (ie. %d vs %d) ci:%d pli:%d",
+            __raft__log(me_, node, "AE term doesn't match prev_term (ie. %d vs %d) ci:%ld pli:%ld",
                   e->term, ae->prev_log_term, raft_get_current_idx(me_), ae->prev_log_idx);
             assert(me->commit_idx < ae->prev_log_idx);
             /* Delete all the following log entries because they don't match */
@@ -1527,7 +1809,7 @@ int raft_recv_appendentries(
     for (i = 0; i < ae->n_entries; i++)
     {
         msg_entry_t* ety = &ae->entries[i];
-        int ety_index = ae->prev_log_idx + 1 + i;
+        raft_index_t ety_index = ae->prev_log_idx + 1 + i;
         raft_entry_t* existing_ety = raft_get_entry_from_idx(me_, ety_index);
         r->current_idx = ety_index;
         if (existing_ety && existing_ety->term != ety->term)
@@ -1554,7 +1836,7 @@ int raft_recv_appendentries(
         min(leaderCommit, index of most recent entry) */
     if (raft_get_commit_idx(me_) < ae->leader_commit)
     {
-        int last_log_idx = max(raft_get_current_idx(me_), 1);
+        raft_index_t last_log_idx = max(raft_get_current_idx(me_), 1);
         raft_set_commit_idx(me_, min(last_log_idx, ae->leader_commit));
     }
 
@@ -1581,26 +1863,27 @@ int raft_already_voted(raft_server_t* me_)
 
 static int __raft__should_grant_vote(raft_server_private_t* me, msg_requestvote_t* vr)
 {
-    if (vr->term < raft_get_current_term((void*)me))
+    if (vr->term < raft_get_current_term((raft_server_t*)me))
         return 0;
 
     /* TODO: if voted for is candiate return 1 (if below checks pass) */
-    if (raft_already_voted((void*)me))
+    if (raft_already_voted((raft_server_t*)me))
         return 0;
 
     /* Below we check if log is more up-to-date... */
 
-    int current_idx = raft_get_current_idx((void*)me);
+    raft_index_t current_idx = raft_get_current_idx((raft_server_t*)me);
 
     /* Our log is definitely not more up-to-date if it's empty! */
     if (0 == current_idx)
         return 1;
 
-    raft_entry_t* e = raft_get_entry_from_idx((void*)me, current_idx);
-    if (e->term < vr->last_log_term)
+    /* our last entry may only survive as the tail of a snapshot */
+    int last_log_term = raft_get_last_log_term((raft_server_t*)me);
+    if (last_log_term < vr->last_log_term)
         return 1;
 
-    if (vr->last_log_term == e->term && current_idx <= vr->last_log_idx)
+    if (vr->last_log_term == last_log_term && current_idx <= vr->last_log_idx)
         return 1;
 
     return 0;
@@ -1710,7 +1993,7 @@ int raft_recv_entry(raft_server_t* me_,
     if (!raft_is_leader(me_))
         return -1;
 
-    __raft__log(me_, NULL, "received entry t:%d id: %d idx: %d",
+    __raft__log(me_, NULL, "received entry t:%d id: %d idx: %ld",
           me->current_term, e->id, raft_get_current_idx(me_) + 1);
 
     raft_entry_t ety;
@@ -1728,7 +2011,7 @@ int raft_recv_entry(raft_server_t* me_,
         /* Only send new entries.
          * Don't send the entry to peers who are behind, to prevent them from
          * becoming congested. */
-        int next_idx = raft_node_get_next_idx(me->nodes[i]);
+        raft_index_t next_idx = raft_node_get_next_idx(me->nodes[i]);
         if (next_idx == raft_get_current_idx(me_))
             raft_send_appendentries(me_, me->nodes[i]);
     }
@@ -1784,13 +2067,13 @@ int raft_apply_entry(raft_server_t* me_)
     if (me->last_applied_idx == me->commit_idx)
         return -1;
 
-    int log_idx = me->last_applied_idx + 1;
+    raft_index_t log_idx = me->last_applied_idx + 1;
 
     raft_entry_t* e = raft_get_entry_from_idx(me_, log_idx);
     if (!e)
         return -1;
 
-    __raft__log(me_, NULL, "applying log: %d, id: %d size: %d",
+    __raft__log(me_, NULL, "applying log: %ld, id: %d size: %d",
           me->last_applied_idx, e->id, e->data.len);
 
     me->last_applied_idx++;
@@ -1804,7 +2087,7 @@ int raft_apply_entry(raft_server_t* me_)
     return 0;
 }
 
-raft_entry_t* raft_get_entries_from_idx(raft_server_t* me_, int idx, int* n_etys)
+raft_entry_t* raft_get_entries_from_idx(raft_server_t* me_, raft_index_t idx, int* n_etys)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
     return log_get_from_idx(me->log, idx, n_etys);
@@ -1823,10 +2106,15 @@ int raft_send_appendentries(raft_server_t* me_, raft_node_t* node)
     msg_appendentries_t ae = {};
     ae.term = me->current_term;
     ae.leader_commit = raft_get_commit_idx(me_);
+    ae.msg_id = me->msg_id;
     ae.prev_log_idx = 0;
     ae.prev_log_term = 0;
 
-    int next_idx = raft_node_get_next_idx(node);
+    raft_index_t next_idx = raft_node_get_next_idx(node);
+
+    /* the entries this node needs are gone; it has to catch up from a snapshot */
+    if (next_idx <= me->snapshot_last_idx && me->cb.send_snapshot)
+        return me->cb.send_snapshot(me_, me->udata, node);
 
     ae.entries = raft_get_entries_from_idx(me_, next_idx, &ae.n_entries);
 
@@ -1837,9 +2125,11 @@ int raft_send_appendentries(raft_server_t* me_, raft_node_t* node)
         ae.prev_log_idx = next_idx - 1;
         if (prev_ety)
             ae.prev_log_term = prev_ety->term;
+        else if (next_idx - 1 == me->snapshot_last_idx)
+            ae.prev_log_term = me->snapshot_last_term;
     }
 
-    __raft__log(me_, node, "sending appendentries node: ci:%d t:%d lc:%d pli:%d plt:%d",
+    __raft__log(me_, node, "sending appendentries node: ci:%ld t:%d lc:%ld pli:%ld plt:%d",
           raft_get_current_idx(me_),
           ae.term,
           ae.leader_commit,
@@ -1857,9 +2147,14 @@ void raft_send_appendentries_all(raft_server_t* me_)
     int i;
 
     me->timeout_elapsed = 0;
+    me->msg_id++;
+    me->msg_sent_at[me->msg_id % RAFT_MSG_ID_RING] = me->now;
     for (i = 0; i < me->num_nodes; i++)
         if (me->node != me->nodes[i])
             raft_send_appendentries(me_, me->nodes[i]);
+
+    /* nobody else to ask */
+    raft_update_quorum_msg_id(me_);
 }
 
 raft_node_t* raft_add_node(raft_server_t* me_, void* udata, int id, int is_self)
@@ -1875,7 +2170,7 @@ raft_node_t* raft_add_node(raft_server_t* me_, void* udata, int id, int is_self)
     }
 
     me->num_nodes++;
-    me->nodes = (raft_node_t*)realloc(me->nodes, sizeof(raft_node_t*) * me->num_nodes);
+    me->nodes = (raft_node_t**)realloc(me->nodes, sizeof(raft_node_t*) * me->num_nodes);
     me->nodes[me->num_nodes - 1] = raft_node_new(udata, id);
     assert(me->nodes[me->num_nodes - 1]);
     if (is_self)
@@ -1895,8 +2190,8 @@ void raft_remove_node(raft_server_t* me_, raft_node_t* node)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
 
-    raft_node_t* new_array, *new_node;
-    new_array = (raft_node_t*)calloc((me->num_nodes - 1), sizeof(raft_node_t*));
+    raft_node_t** new_array, **new_node;
+    new_array = (raft_node_t**)calloc((me->num_nodes - 1), sizeof(raft_node_t*));
     new_node = new_array;
 
     int i;
@@ -1960,10 +2255,45 @@ int raft_msg_entry_response_committed(raft_server_t* me_,
 
 void raft_apply_all(raft_server_t* me_)
 {
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+
+    if (me->cb.applylog_batch)
+    {
+        raft_apply_batch(me_);
+        return;
+    }
     while (raft_get_last_applied_idx(me_) < raft_get_commit_idx(me_))
         raft_apply_entry(me_);
 }
 
+int raft_apply_batch(raft_server_t* me_)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+
+    while (me->last_applied_idx < me->commit_idx)
+    {
+        raft_index_t first_idx = me->last_applied_idx + 1;
+        int n;
+        raft_entry_t* e = raft_get_entries_from_idx(me_, first_idx, &n);
+        if (!e || n <= 0)
+            return -1;
+        if (me->commit_idx - me->last_applied_idx < n)
+            n = (int)(me->commit_idx - me->last_applied_idx);
+
+        __raft__log(me_, NULL, "applying logs: %ld..%ld", first_idx, first_idx + n - 1);
+
+        if (0 != me->cb.applylog_batch(me_, me->udata, e, first_idx, n))
+            return -1;
+        me->last_applied_idx += n;
+
+        /* voting cfg change is now complete */
+        if (first_idx <= me->voting_cfg_change_log_idx &&
+            me->voting_cfg_change_log_idx <= me->last_applied_idx)
+            me->voting_cfg_change_log_idx = -1;
+    }
+    return 0;
+}
+
 int raft_entry_is_voting_cfg_change(raft_entry_t* ety)
 {
     return RAFT_LOGTYPE_ADD_NODE == ety->type ||
@@ -1977,6 +2307,62 @@ int raft_entry_is_cfg_change(raft_entry_t* ety)
         RAFT_LOGTYPE_ADD_NONVOTING_NODE == ety->type ||
         RAFT_LOGTYPE_REMOVE_NODE == ety->type);
 }
+
+int raft_compact_log(raft_server_t* me_, raft_index_t idx)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+
+    if (idx <= me->snapshot_last_idx)
+        return 0;
+
+    /* the snapshot can only cover what the state machine has seen */
+    if (me->last_applied_idx < idx)
+        return -1;
+
+    raft_entry_t* ety = raft_get_entry_from_idx(me_, idx);
+    if (!ety)
+        return -1;
+    int term = ety->term;
+
+    __raft__log(me_, NULL, "compacting log up to idx: %ld term: %d", idx, term);
+
+    while (log_get_base(me->log) < idx)
+        log_poll(me->log);
+
+    me->snapshot_last_idx = idx;
+    me->snapshot_last_term = term;
+    return 0;
+}
+
+int raft_load_snapshot(raft_server_t* me_, int term, raft_index_t idx)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+
+    if (idx <= me->commit_idx)
+        return -1;
+
+    __raft__log(me_, NULL, "loading snapshot idx: %ld term: %d", idx, term);
+
+    /* if our entry at idx has the snapshot's term, everything up to it matches the leader's log (log
+       matching property): keep what follows and only drop the covered prefix. otherwise start over. */
+    raft_entry_t* ety = raft_get_entry_from_idx(me_, idx);
+    if (ety && (int)ety->term == term)
+    {
+        while (log_get_base(me->log) < idx)
+            log_poll(me->log);
+    }
+    else
+        log_load_from_snapshot(me->log, idx);
+    me->commit_idx = idx;
+    me->last_applied_idx = idx;
+    me->snapshot_last_idx = idx;
+    me->snapshot_last_term = term;
+
+    /* a cfg change inside the snapshot is complete by definition */
+    if (me->voting_cfg_change_log_idx <= idx)
+        me->voting_cfg_change_log_idx = -1;
+    return 0;
+}
 /**
  * Copyright (c) 2013, Willem-Hendrik Thiart
  * Use of this source code is governed by a BSD-style license that can be
@@ -2065,13 +2451,13 @@ int raft_get_current_term(raft_server_t* me_)
     return ((raft_server_private_t*)me_)->current_term;
 }
 
-int raft_get_current_idx(raft_server_t* me_)
+raft_index_t raft_get_current_idx(raft_server_t* me_)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
     return log_get_current_idx(me->log);
 }
 
-void raft_set_commit_idx(raft_server_t* me_, int idx)
+void raft_set_commit_idx(raft_server_t* me_, raft_index_t idx)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
     assert(me->commit_idx <= idx);
@@ -2079,18 +2465,18 @@ void raft_set_commit_idx(raft_server_t* me_, int idx)
     me->commit_idx = idx;
 }
 
-void raft_set_last_applied_idx(raft_server_t* me_, int idx)
+void raft_set_last_applied_idx(raft_server_t* me_, raft_index_t idx)
 {
     raft_server_private_t* me = (raft_server_private_t*)me_;
     me->last_applied_idx = idx;
 }
 
-int raft_get_last_applied_idx(raft_server_t* me_)
+raft_index_t raft_get_last_applied_idx(raft_server_t* me_)
 {
     return ((raft_server_private_t*)me_)->last_applied_idx;
 }
 
-int raft_get_commit_idx(raft_server_t* me_)
+raft_index_t raft_get_commit_idx(raft_server_t* me_)
 {
     return ((raft_server_private_t*)me_)->commit_idx;
 }
@@ -2102,6 +2488,12 @@ void raft_set_state(raft_server_t* me_, int state)
     if (state == RAFT_STATE_LEADER)
         me->current_leader = me->node;
     me->state = state;
+
+    /* rounds and leases from an earlier term prove nothing */
+    me->quorum_msg_id = me->msg_id;
+    me->lease_until = 0;
+    if (state != RAFT_STATE_LEADER && me->read_queue_head)
+        raft_process_read_queue(me_);
 }
 
 int raft_get_state(raft_server_t* me_)
@@ -2129,7 +2521,7 @@ raft_node_t* raft_get_node_from_idx(raft_server_t* me_, const int idx)
 
 int raft_get_current_leader(raft_server_t* me_)
 {
-    raft_server_private_t* me = (void*)me_;
+    raft_server_private_t* me = (raft_server_private_t*)me_;
     if (me->current_leader)
         return raft_node_get_id(me->current_leader);
     return -1;
@@ -2137,7 +2529,7 @@ int raft_get_current_leader(raft_server_t* me_)
 
 raft_node_t* raft_get_current_leader_node(raft_server_t* me_)
 {
-    raft_server_private_t* me = (void*)me_;
+    raft_server_private_t* me = (raft_server_private_t*)me_;
     return me->current_leader;
 }
 
@@ -2163,13 +2555,167 @@ int raft_is_candidate(raft_server_t* me_)
 
 int raft_get_last_log_term(raft_server_t* me_)
 {
-    int current_idx = raft_get_current_idx(me_);
+    raft_index_t current_idx = raft_get_current_idx(me_);
     if (0 < current_idx)
     {
         raft_entry_t* ety = raft_get_entry_from_idx(me_, current_idx);
         if (ety)
             return ety->term;
+        if (current_idx == raft_get_snapshot_last_idx(me_))
+            return raft_get_snapshot_last_term(me_);
+    }
+    return 0;
+}
+
+raft_index_t raft_get_snapshot_last_idx(raft_server_t* me_)
+{
+    return ((raft_server_private_t*)me_)->snapshot_last_idx;
+}
+
+int raft_get_snapshot_last_term(raft_server_t* me_)
+{
+    return ((raft_server_private_t*)me_)->snapshot_last_term;
+}
+
+void raft_update_quorum_msg_id(raft_server_t* me_)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+    raft_msg_id_t confirmed = me->quorum_msg_id;
+    int i, j;
+
+    for (i = 0; i < me->num_nodes; i++)
+    {
+        raft_node_t* candidate = me->nodes[i];
+        if (!raft_node_is_voting(candidate) && candidate != me->node)
+            continue;
+        raft_msg_id_t round = candidate == me->node ?
+            me->msg_id : raft_node_get_max_seen_msg_id(candidate);
+        if (round <= me->quorum_msg_id)
+            continue;
+
+        int acks = 0, voters = 0;
+        for (j = 0; j < me->num_nodes; j++)
+        {
+            raft_node_t* node = me->nodes[j];
+            if (!raft_node_is_voting(node) && node != me->node)
+                continue;
+            voters++;
+            if (node == me->node || round <= raft_node_get_max_seen_msg_id(node))
+                acks++;
+        }
+        if (voters / 2 < acks)
+            me->quorum_msg_id = round;
+    }
+
+    /* the lease runs from when the newly confirmed round was sent, not when
+     * the acks arrived */
+    if (me->lease_timeout && confirmed < me->quorum_msg_id &&
+        me->msg_id - me->quorum_msg_id < RAFT_MSG_ID_RING)
+    {
+        long until = me->msg_sent_at[me->quorum_msg_id % RAFT_MSG_ID_RING] + me->lease_timeout;
+        if (me->lease_until < until)
+            me->lease_until = until;
     }
+
+    if (me->read_queue_head)
+        raft_process_read_queue(me_);
+}
+
+/* a new leader's commit index may lag until it commits an entry of its own */
+static int raft_has_committed_in_term(raft_server_private_t* me)
+{
+    raft_entry_t* ety = 0 < me->commit_idx ? raft_get_entry_from_idx((raft_server_t*)me, me->commit_idx) : NULL;
+    if (ety)
+        return (int)ety->term == me->current_term;
+    return me->commit_idx == me->snapshot_last_idx &&
+           me->snapshot_last_term == me->current_term;
+}
+
+int raft_queue_read_request(raft_server_t* me_, func_read_request_callback_f cb, void *cb_arg)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+
+    if (!raft_is_leader(me_))
+        return -1;
+
+    raft_read_request_t* req = (raft_read_request_t*)malloc(sizeof(raft_read_request_t));
+    if (!req)
+        return -1;
+
+    /* ride on the next broadcast - every read queued before it shares it */
+    req->msg_id = me->msg_id + 1;
+    req->read_idx = -1;
+    req->cb = cb;
+    req->cb_arg = cb_arg;
+    req->next = NULL;
+
+    if (me->read_queue_tail)
+        me->read_queue_tail->next = req;
+    else
+        me->read_queue_head = req;
+    me->read_queue_tail = req;
     return 0;
 }
+
+void raft_process_read_queue(raft_server_t* me_)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+    int is_leader = raft_is_leader(me_);
+    int in_term = is_leader && raft_has_committed_in_term(me);
+
+    while (me->read_queue_head)
+    {
+        raft_read_request_t* req = me->read_queue_head;
+
+        if (is_leader)
+        {
+            if (req->read_idx == -1)
+            {
+                if (!in_term || me->quorum_msg_id < req->msg_id)
+                    break;
+                req->read_idx = me->commit_idx;
+            }
+            if (me->last_applied_idx < req->read_idx)
+                break;
+        }
+
+        me->read_queue_head = req->next;
+        if (!me->read_queue_head)
+            me->read_queue_tail = NULL;
+        req->cb(req->cb_arg, is_leader);
+        free(req);
+    }
+}
+
+void raft_set_lease_timeout(raft_server_t* me_, int msec)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+    /* leave room for clock drift between us and whoever starts the next election */
+    int cap = me->election_timeout - me->election_timeout / 10;
+    me->lease_timeout = msec < cap ? msec : cap;
+    me->lease_until = 0;
+}
+
+raft_index_t raft_get_leader_commit_idx(raft_server_t* me_)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+    if (raft_is_leader(me_))
+        return me->commit_idx;
+    return me->leader_commit_idx < me->commit_idx ? me->commit_idx : me->leader_commit_idx;
+}
+
+int raft_lease_read_ok(raft_server_t* me_)
+{
+    raft_server_private_t* me = (raft_server_private_t*)me_;
+    return raft_is_leader(me_) &&
+           me->now < me->lease_until &&
+           raft_has_committed_in_term(me) &&
+           me->commit_idx <= me->last_applied_idx;
+}
+/* keep the amalgamation's helper macros from leaking into C++ includers
+ * (std::min, std::ifstream in(...), ...) */
+#undef in
+#undef min
+#undef max
+
 #endif /* RAFT_AMALGAMATIONE_SH */
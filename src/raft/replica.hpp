@@ -0,0 +1,268 @@
+#ifndef RAFT_REPLICA_HPP
+#define RAFT_REPLICA_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+#include "raft.hpp"
+#include "replica_directory.hpp"
+
+/*
+Reads served by followers and non-voting replicas (raft_add_non_voting_node) so read-heavy work like vector
+search scales with replica count instead of piling onto the leader. Every read names a consistency level:
+
+    Linearizable      leader only: lease fast path, else ReadIndex. Non-leaders refuse (caller redirects).
+    ReadIndex         any replica: a follower asks the leader for a read index (one heartbeat round on the
+                      leader, batched with every other read in flight), waits until it has applied that far
+                      and then serves locally - linearizable, but the search CPU is spent on the replica.
+    BoundedStaleness  any replica: served immediately if we're at most max_lag committed entries behind the
+                      leader and heard from it within max_silence_ms, otherwise upgraded to ReadIndex.
+
+The transport for forwarded read-index requests is the application's, same as the raft messages: hand
+ReplicaReads a function that ships msg_readindex_t to a node, and feed it whatever comes back.
+*/
+
+enum class ReadConsistency : uint8_t {
+    Linearizable,
+    ReadIndex,
+    BoundedStaleness
+};
+
+inline std::optional<ReadConsistency> parse_read_consistency(std::string_view name) {
+    if (name == "linearizable" || name == "strong") return ReadConsistency::Linearizable;
+    if (name == "readindex") return ReadConsistency::ReadIndex;
+    if (name == "stale" || name == "bounded") return ReadConsistency::BoundedStaleness;
+    return std::nullopt;
+}
+
+typedef struct
+{
+    uint64_t request_id;
+    int term;
+} msg_readindex_t;
+
+typedef struct
+{
+    uint64_t request_id;
+    raft_index_t read_idx;      // serve once last_applied_idx reaches this
+    int success;                // 0: the node asked is not (or no longer) leader, or not in the request's term
+    int term;                   // the term the request was answered in
+} msg_readindex_response_t;
+
+class ReplicaReads {
+public:
+    struct Options {
+        raft_index_t max_lag = 1000;  // committed entries a stale read may be behind
+        int max_silence_ms = 1000;    // how long since the last appendentries a stale read may be served
+    };
+
+    using ReadFn = std::function<void(bool ok)>; // ok == false: not servable here, retry on the leader
+    using ForwardFn = std::function<void(int node_id, const msg_readindex_t&)>;
+    using ReplyFn = std::function<void(const msg_readindex_response_t&)>;
+
+    ReplicaReads(raft_server_t* raft, ForwardFn forward, Options options)
+        : raft_(raft), forward_(std::move(forward)), options_(options) {}
+
+    ReplicaReads(raft_server_t* raft, ForwardFn forward) : ReplicaReads(raft, std::move(forward), Options{}) {}
+
+    ~ReplicaReads() {
+        fail_pending();
+    }
+
+    ReplicaReads(const ReplicaReads&) = delete;
+    ReplicaReads& operator=(const ReplicaReads&) = delete;
+
+    // run `read` as soon as this node may serve it at `level` - possibly before returning. false means it
+    // can't be served from here at all (no known leader, or Linearizable on a non-leader) and `read` is dropped.
+    bool submit(ReadConsistency level, ReadFn read) {
+        if (level == ReadConsistency::BoundedStaleness) {
+            if (within_staleness()) {
+                ++served_local_;
+                read(true);
+                return true;
+            }
+            level = ReadConsistency::ReadIndex;
+        }
+
+        if (raft_is_leader(raft_)) {
+            if (raft_lease_read_ok(raft_)) {
+                ++served_local_;
+                read(true);
+                return true;
+            }
+            auto* ctx = new ReadFn(std::move(read));
+            if (raft_queue_read_request(raft_, run_read, ctx) != 0) {
+                delete ctx;
+                return false;
+            }
+            return true;
+        }
+
+        int leader = raft_get_current_leader(raft_);
+        if (level == ReadConsistency::Linearizable || leader == -1) {
+            return false;
+        }
+
+        uint64_t id = next_request_id_++;
+        int term = raft_get_current_term(raft_);
+        pending_.emplace(id, Pending{std::move(read), leader, term, -1});
+        forward_(leader, msg_readindex_t{id, term});
+        ++forwarded_;
+        return true;
+    }
+
+    // leader side: a replica wants a read index. the reply goes out once a heartbeat round confirms we're
+    // still leader; it carries our commit index at that moment. a request from another term is refused: one
+    // of us is out of date, and the replica's idea of who leads may not be us.
+    void on_readindex(const msg_readindex_t& msg, ReplyFn reply) {
+        int term = raft_get_current_term(raft_);
+        if (msg.term != term) {
+            reply(msg_readindex_response_t{msg.request_id, 0, 0, term});
+            return;
+        }
+        auto* ctx = new ForwardedRead{raft_, msg.request_id, term, std::move(reply)};
+        if (raft_queue_read_request(raft_, reply_read_index, ctx) != 0) {
+            ctx->reply(msg_readindex_response_t{msg.request_id, 0, 0, term});
+            delete ctx;
+        }
+    }
+
+    // follower side: the leader answered one of our forwarded reads. an index from a term other than the
+    // one we asked in may come from a deposed leader, so it fails the read like a refusal does.
+    void on_readindex_response(const msg_readindex_response_t& r) {
+        auto it = pending_.find(r.request_id);
+        if (it == pending_.end()) {
+            return;
+        }
+        if (!r.success || r.term != it->second.term) {
+            ReadFn read = std::move(it->second.read);
+            pending_.erase(it);
+            read(false);
+            return;
+        }
+        it->second.read_idx = r.read_idx;
+        poll();
+    }
+
+    // call after every raft_periodic / apply: serves forwarded reads whose index has been applied and fails
+    // the unanswered ones sent to a node that is no longer leader, or in a term that has since ended.
+    void poll() {
+        raft_index_t applied = raft_get_last_applied_idx(raft_);
+        int leader = raft_get_current_leader(raft_);
+        int term = raft_get_current_term(raft_);
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            Pending& p = it->second;
+            bool ready = p.read_idx != -1 && p.read_idx <= applied;
+            bool orphaned = p.read_idx == -1 && (p.leader != leader || p.term != term);
+            if (!ready && !orphaned) {
+                ++it;
+                continue;
+            }
+            ReadFn read = std::move(p.read);
+            it = pending_.erase(it);
+            if (ready) {
+                ++served_forwarded_;
+            }
+            read(ready);
+        }
+    }
+
+    [[nodiscard]] bool within_staleness() const {
+        if (raft_is_leader(raft_)) {
+            return true;
+        }
+        return raft_get_current_leader(raft_) != -1 &&
+               raft_get_leader_commit_idx(raft_) - raft_get_last_applied_idx(raft_) <= options_.max_lag &&
+               raft_get_timeout_elapsed(raft_) <= options_.max_silence_ms;
+    }
+
+    // refresh the discovery list from this node's point of view. the leader knows every replica's match
+    // index; a follower only knows itself and who it thinks leads.
+    void publish(const std::unordered_map<int, std::string>& addresses,
+                 ReplicaDirectory& directory = ReplicaDirectory::instance()) const {
+        auto address_of = [&](int id) {
+            auto it = addresses.find(id);
+            return it == addresses.end() ? std::string("?") : it->second;
+        };
+
+        std::vector<ReplicaDirectory::Replica> replicas;
+        raft_index_t commit = raft_get_leader_commit_idx(raft_);
+        int self = raft_get_nodeid(raft_);
+        int leader = raft_get_current_leader(raft_);
+
+        for (int i = 0; i < raft_get_num_nodes(raft_); ++i) {
+            raft_node_t* node = raft_get_node_from_idx(raft_, i);
+            int id = raft_node_get_id(node);
+            auto role = id == leader ? ReplicaDirectory::Role::Leader
+                      : raft_node_is_voting(node) ? ReplicaDirectory::Role::Follower
+                      : ReplicaDirectory::Role::NonVoting;
+
+            if (id == self) {
+                raft_index_t applied = raft_get_last_applied_idx(raft_);
+                replicas.push_back({id, address_of(id), role, applied, commit - applied});
+            } else if (raft_is_leader(raft_)) {
+                raft_index_t match = raft_node_get_match_idx(node);
+                replicas.push_back({id, address_of(id), role, match, commit > match ? commit - match : 0});
+            } else {
+                replicas.push_back({id, address_of(id), role, -1, -1});
+            }
+        }
+        directory.publish(std::move(replicas));
+    }
+
+    [[nodiscard]] uint64_t served_local() const noexcept { return served_local_; }
+    [[nodiscard]] uint64_t served_forwarded() const noexcept { return served_forwarded_; }
+    [[nodiscard]] uint64_t forwarded() const noexcept { return forwarded_; }
+    [[nodiscard]] size_t pending() const noexcept { return pending_.size(); }
+
+private:
+    struct Pending {
+        ReadFn read;
+        int leader;
+        int term;                   // ours when the read was forwarded
+        raft_index_t read_idx;
+    };
+
+    struct ForwardedRead {
+        raft_server_t* raft;
+        uint64_t request_id;
+        int term;
+        ReplyFn reply;
+    };
+
+    raft_server_t* raft_;
+    ForwardFn forward_;
+    Options options_;
+    std::unordered_map<uint64_t, Pending> pending_;
+    uint64_t next_request_id_{1};
+    uint64_t served_local_{0};
+    uint64_t served_forwarded_{0};
+    uint64_t forwarded_{0};
+
+    static void run_read(void* arg, int can_read) {
+        auto* read = static_cast<ReadFn*>(arg);
+        (*read)(can_read != 0);
+        delete read;
+    }
+
+    static void reply_read_index(void* arg, int can_read) {
+        auto* ctx = static_cast<ForwardedRead*>(arg);
+        ctx->reply(msg_readindex_response_t{ctx->request_id, can_read ? raft_get_commit_idx(ctx->raft) : 0, can_read,
+                                            ctx->term});
+        delete ctx;
+    }
+
+    void fail_pending() {
+        auto pending = std::move(pending_);
+        pending_.clear();
+        for (auto& [id, p] : pending) {
+            p.read(false);
+        }
+    }
+};
+
+#endif // RAFT_REPLICA_HPP
@@ -0,0 +1,84 @@
+#ifndef RAFT_REPLICA_DIRECTORY_HPP
+#define RAFT_REPLICA_DIRECTORY_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+
+/*
+Who can serve reads, for client-side discovery (the REPLICAS command). Kept free of raft types so the
+command processor can include it without pulling in the raft amalgamation. Whatever replicates this node
+fills it in and the server just reads it: under raft ReplicaReads::publish(), under async replication the
+primary (src/replication/primary.hpp, whenever the server runs with --repl-port).
+
+One line per replica:
+    <id> <address> <leader|follower|nonvoting> <applied_idx> <lag>
+Under raft applied_idx is a log index and lag is how many committed entries the replica is behind the
+leader (-1 if unknown). Under async replication they are a stream offset and bytes behind the primary.
+*/
+
+class ReplicaDirectory {
+public:
+    enum class Role : uint8_t { Leader, Follower, NonVoting };
+
+    struct Replica {
+        int id;
+        std::string address;
+        Role role;
+        int64_t applied_idx;
+        int64_t lag;
+    };
+
+    static ReplicaDirectory& instance() {
+        static ReplicaDirectory directory;
+        return directory;
+    }
+
+    void publish(std::vector<Replica> replicas) {
+        std::unique_lock lock(mutex_);
+        replicas_ = std::move(replicas);
+    }
+
+    [[nodiscard]] std::vector<Replica> list() const {
+        std::shared_lock lock(mutex_);
+        return replicas_;
+    }
+
+    [[nodiscard]] std::string describe() const {
+        std::shared_lock lock(mutex_);
+        std::string out;
+        for (const auto& replica : replicas_) {
+            out += std::to_string(replica.id);
+            out += ' ';
+            out += replica.address;
+            out += ' ';
+            out += role_name(replica.role);
+            out += ' ';
+            out += std::to_string(replica.applied_idx);
+            out += ' ';
+            out += std::to_string(replica.lag);
+            out += '\n';
+        }
+        return out;
+    }
+
+    static std::string_view role_name(Role role) {
+        switch (role) {
+            case Role::Leader:    return "leader";
+            case Role::Follower:  return "follower";
+            case Role::NonVoting: return "nonvoting";
+        }
+        return "unknown";
+    }
+
+private:
+    ReplicaDirectory() = default;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<Replica> replicas_;
+};
+
+#endif // RAFT_REPLICA_DIRECTORY_HPP
@@ -0,0 +1,345 @@
+#ifndef RAFT_SIM_HPP
+#define RAFT_SIM_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <random>
+#include <functional>
+#include <optional>
+#include "raft.hpp"
+
+/*
+Deterministic in-process raft cluster for tests and benchmarks - no sockets, no threads, no wall clock.
+
+Every node is a real raft_server_t whose send_requestvote / send_appendentries callbacks drop the message
+onto a single virtual-time event queue. step() advances the clock one millisecond at a time: deliver every
+message that is due, call raft_periodic on each node, apply what committed. Given the same Options (seed
+included) a run replays identically, so a failing schedule can be reproduced from its seed.
+
+Faults:
+    latency       each message takes uniform [latency_min_ms, latency_max_ms] to arrive
+    drop_rate     probability a message is lost
+    partition()   nodes in different groups can't reach each other until heal()
+    disk_sync_ms  a follower acks appendentries carrying entries only after this long (its fsync)
+    stall_apply() a node's state machine stops applying - its commit index still moves - until released
+
+Entry payloads are copied into an arena owned by the simulation, so every node's log can point at them
+for as long as the simulation lives.
+*/
+
+class RaftSim {
+public:
+    struct Options {
+        int nodes = 3;
+        uint64_t seed = 1;
+        int latency_min_ms = 1;
+        int latency_max_ms = 1;
+        double drop_rate = 0.0;
+        int disk_sync_ms = 0;
+        int election_timeout_ms = 1000;
+        int request_timeout_ms = 100;
+    };
+
+    struct Stats {
+        uint64_t sent = 0;
+        uint64_t delivered = 0;
+        uint64_t dropped = 0;
+        uint64_t elections = 0;   // times any node became leader
+    };
+
+    explicit RaftSim(Options options) : options_(options), rng_(options.seed) {
+        // raft_become_candidate draws its election jitter from rand()
+        std::srand(static_cast<unsigned>(options.seed));
+
+        raft_cbs_t cbs = {};
+        cbs.send_requestvote = send_requestvote;
+        cbs.send_appendentries = send_appendentries;
+        cbs.applylog_batch = applylog_batch;
+
+        nodes_.reserve(options_.nodes);
+        for (int i = 0; i < options_.nodes; ++i) {
+            auto node = std::make_unique<Node>();
+            node->sim = this;
+            node->id = i;
+            node->raft = raft_new();
+            raft_set_callbacks(node->raft, &cbs, node.get());
+            raft_set_election_timeout(node->raft, options_.election_timeout_ms);
+            raft_set_request_timeout(node->raft, options_.request_timeout_ms);
+            for (int j = 0; j < options_.nodes; ++j) {
+                raft_add_node(node->raft, nullptr, j, i == j);
+            }
+            nodes_.push_back(std::move(node));
+        }
+
+        // stagger the first timeouts so the opening election isn't a guaranteed split vote
+        std::uniform_int_distribution<int> offset(0, options_.election_timeout_ms - 1);
+        for (auto& node : nodes_) {
+            raft_periodic(node->raft, offset(rng_));
+        }
+    }
+
+    ~RaftSim() {
+        for (auto& node : nodes_) {
+            raft_free(node->raft);
+        }
+    }
+
+    RaftSim(const RaftSim&) = delete;
+    RaftSim& operator=(const RaftSim&) = delete;
+
+    [[nodiscard]] int size() const noexcept { return static_cast<int>(nodes_.size()); }
+    [[nodiscard]] raft_server_t* raft(int id) const { return nodes_[id]->raft; }
+    [[nodiscard]] uint64_t now() const noexcept { return now_; }
+    [[nodiscard]] const Stats& stats() const noexcept { return stats_; }
+    [[nodiscard]] uint64_t applied(int id) const { return nodes_[id]->applied; }
+
+    // the leader with the highest term, or -1. a deposed leader stuck behind a partition can still think
+    // it leads, so "the" leader is the one the majority follows.
+    [[nodiscard]] int leader() const {
+        int best = -1;
+        for (const auto& node : nodes_) {
+            if (raft_is_leader(node->raft) &&
+                (best == -1 || raft_get_current_term(nodes_[best]->raft) < raft_get_current_term(node->raft))) {
+                best = node->id;
+            }
+        }
+        return best;
+    }
+
+    // advance virtual time by ms, one millisecond at a time
+    void step(int ms = 1) {
+        for (int i = 0; i < ms; ++i) {
+            ++now_;
+            deliver_due();
+            for (auto& node : nodes_) {
+                bool was_leader = raft_is_leader(node->raft);
+                raft_periodic(node->raft, 1);
+                raft_apply_all(node->raft);
+                if (!was_leader && raft_is_leader(node->raft)) {
+                    on_elected(*node);
+                }
+            }
+        }
+    }
+
+    // step until pred() holds; returns the virtual ms it took, or nullopt after max_ms
+    std::optional<uint64_t> run_until(const std::function<bool()>& pred, uint64_t max_ms) {
+        uint64_t start = now_;
+        while (!pred()) {
+            if (now_ - start >= max_ms) {
+                return std::nullopt;
+            }
+            step();
+        }
+        return now_ - start;
+    }
+
+    // hand an entry to the current leader; nullopt if there isn't one
+    std::optional<msg_entry_response_t> propose(std::string_view data) {
+        int id = leader();
+        if (id == -1) {
+            return std::nullopt;
+        }
+        arena_.emplace_back(data);
+        msg_entry_t entry = {};
+        entry.id = next_entry_id_++;
+        entry.type = RAFT_LOGTYPE_NORMAL;
+        entry.data.buf = arena_.back().data();
+        entry.data.len = static_cast<unsigned int>(arena_.back().size());
+
+        msg_entry_response_t response;
+        if (raft_recv_entry(nodes_[id]->raft, &entry, &response) != 0) {
+            return std::nullopt;
+        }
+        return response;
+    }
+
+    // 1 committed, 0 pending, -1 lost to a leader change
+    int committed(const msg_entry_response_t& response) const {
+        int id = leader();
+        return id == -1 ? 0 : raft_msg_entry_response_committed(nodes_[id]->raft, &response);
+    }
+
+    // nodes listed together can talk; everyone not listed ends up in a group of their own
+    void partition(const std::vector<std::vector<int>>& groups) {
+        for (auto& node : nodes_) {
+            node->group = -1 - node->id;
+        }
+        for (size_t g = 0; g < groups.size(); ++g) {
+            for (int id : groups[g]) {
+                nodes_[id]->group = static_cast<int>(g);
+            }
+        }
+    }
+
+    void isolate(int id) {
+        std::vector<int> rest;
+        for (auto& node : nodes_) {
+            if (node->id != id) rest.push_back(node->id);
+        }
+        partition({rest});
+    }
+
+    void heal() {
+        for (auto& node : nodes_) {
+            node->group = 0;
+        }
+    }
+
+    [[nodiscard]] bool connected(int a, int b) const { return nodes_[a]->group == nodes_[b]->group; }
+
+    void stall_apply(int id, bool stalled = true) { nodes_[id]->apply_stalled = stalled; }
+
+private:
+    struct Node {
+        RaftSim* sim;
+        int id;
+        raft_server_t* raft;
+        int group = 0;
+        uint64_t applied = 0;
+        bool apply_stalled = false;
+    };
+
+    struct Message {
+        enum Type { AE, AER, RV, RVR } type;
+        int from, to;
+        msg_appendentries_t ae;
+        std::vector<msg_entry_t> entries;
+        msg_appendentries_response_t aer;
+        msg_requestvote_t rv;
+        msg_requestvote_response_t rvr;
+    };
+
+    struct Event {
+        uint64_t at;
+        uint64_t seq;   // FIFO among messages due at the same ms keeps runs deterministic
+        std::shared_ptr<Message> message;
+        bool operator>(const Event& other) const {
+            return at != other.at ? at > other.at : seq > other.seq;
+        }
+    };
+
+    Options options_;
+    std::mt19937_64 rng_;
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+    std::deque<std::string> arena_;
+    uint64_t now_ = 0;
+    uint64_t seq_ = 0;
+    unsigned int next_entry_id_ = 1;
+    Stats stats_;
+
+    void on_elected(Node& node) {
+        ++stats_.elections;
+        // a no-op from the new term lets it commit (and serve ReadIndex) without waiting for a client write
+        arena_.emplace_back();
+        msg_entry_t entry = {};
+        entry.id = next_entry_id_++;
+        entry.type = RAFT_LOGTYPE_NORMAL;
+        entry.data.buf = arena_.back().data();
+        msg_entry_response_t response;
+        raft_recv_entry(node.raft, &entry, &response);
+    }
+
+    void send(std::shared_ptr<Message> message, int extra_delay_ms = 0) {
+        ++stats_.sent;
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        if (!connected(message->from, message->to) ||
+            (options_.drop_rate > 0 && coin(rng_) < options_.drop_rate)) {
+            ++stats_.dropped;
+            return;
+        }
+        std::uniform_int_distribution<int> latency(options_.latency_min_ms, options_.latency_max_ms);
+        uint64_t at = now_ + static_cast<uint64_t>(latency(rng_) + extra_delay_ms);
+        events_.push(Event{at, seq_++, std::move(message)});
+    }
+
+    void deliver_due() {
+        while (!events_.empty() && events_.top().at <= now_) {
+            std::shared_ptr<Message> m = events_.top().message;
+            events_.pop();
+
+            // a partition raised while the message was in flight still eats it
+            if (!connected(m->from, m->to)) {
+                ++stats_.dropped;
+                continue;
+            }
+            ++stats_.delivered;
+
+            raft_server_t* to = nodes_[m->to]->raft;
+            raft_node_t* from = raft_get_node(to, m->from);
+            switch (m->type) {
+                case Message::AE: {
+                    auto reply = std::make_shared<Message>();
+                    reply->type = Message::AER;
+                    reply->from = m->to;
+                    reply->to = m->from;
+                    m->ae.entries = m->entries.data();
+                    raft_recv_appendentries(to, from, &m->ae, &reply->aer);
+                    send(std::move(reply), m->ae.n_entries > 0 ? options_.disk_sync_ms : 0);
+                    break;
+                }
+                case Message::AER:
+                    raft_recv_appendentries_response(to, from, &m->aer);
+                    break;
+                case Message::RV: {
+                    auto reply = std::make_shared<Message>();
+                    reply->type = Message::RVR;
+                    reply->from = m->to;
+                    reply->to = m->from;
+                    raft_recv_requestvote(to, from, &m->rv, &reply->rvr);
+                    send(std::move(reply));
+                    break;
+                }
+                case Message::RVR: {
+                    bool was_leader = raft_is_leader(to);
+                    raft_recv_requestvote_response(to, from, &m->rvr);
+                    if (!was_leader && raft_is_leader(to)) {
+                        on_elected(*nodes_[m->to]);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    static int send_requestvote(raft_server_t*, void* udata, raft_node_t* node, msg_requestvote_t* msg) {
+        auto* self = static_cast<Node*>(udata);
+        auto m = std::make_shared<Message>();
+        m->type = Message::RV;
+        m->from = self->id;
+        m->to = raft_node_get_id(node);
+        m->rv = *msg;
+        self->sim->send(std::move(m));
+        return 0;
+    }
+
+    static int send_appendentries(raft_server_t*, void* udata, raft_node_t* node, msg_appendentries_t* msg) {
+        auto* self = static_cast<Node*>(udata);
+        auto m = std::make_shared<Message>();
+        m->type = Message::AE;
+        m->from = self->id;
+        m->to = raft_node_get_id(node);
+        m->ae = *msg;
+        m->entries.assign(msg->entries, msg->entries + msg->n_entries);
+        self->sim->send(std::move(m));
+        return 0;
+    }
+
+    static int applylog_batch(raft_server_t*, void* udata, raft_entry_t*, raft_index_t, int n) {
+        auto* node = static_cast<Node*>(udata);
+        if (node->apply_stalled) {
+            return -1;  // nothing applied; raft offers the same run again next tick
+        }
+        node->applied += static_cast<uint64_t>(n);
+        return 0;
+    }
+};
+
+#endif // RAFT_SIM_HPP
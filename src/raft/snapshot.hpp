@@ -0,0 +1,553 @@
+#ifndef RAFT_SNAPSHOT_HPP
+#define RAFT_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <algorithm>
+#include <csignal>
+#include <expected>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../../common.hpp"
+#include "../../logging.hpp"
+#include "../../entry_manager.hpp"
+#include "../../snapshot_serializer.hpp"
+#include "log_store.hpp"
+#include "raft.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Raft snapshots + log compaction.
+
+    <dir>/snapshot.bin       FileHeader | SnapshotSerializer image
+    <dir>/snapshot.new       a snapshot being written in the background by create()
+    <dir>/snapshot.recv      partially received snapshot from the leader (renamed over snapshot.bin once complete)
+
+Taking a snapshot is split so the raft thread never encodes or writes the keyspace. create() forks at the last
+applied index, holding EntryManager::freeze() for the fork alone; the child encodes its copy-on-write image of
+the keyspace into snapshot.new, fdatasyncs it and exits. Pages the parent writes meanwhile get copied, so a
+busy keyspace costs up to its own size again in memory while a child runs. poll_create(), called every raft
+tick, reaps the child: renames its file into place and only THEN compacts the in-memory raft log - a crash at any point leaves either the old snapshot + full log or the new snapshot + a log
+that still overlaps it, both of which recover fine. Compacting the durable log (RaftLogStore::compact_prefix)
+is the caller's call, same rule: after poll_create() reports the new snapshot. Installing or restoring a
+snapshot is different - it can replace the log outright, so both take the node's RaftLogStore and restart it
+right after the snapshot when raft dropped its log (otherwise its next append would not line up).
+
+A follower that has fallen behind the leader's compaction point gets the snapshot streamed to it as a sequence
+of InstallSnapshot chunks (RaftSnapshotSender on the leader, recv_installsnapshot on the follower). Chunks are
+written straight to disk on arrival so a 10M key snapshot never has to sit in a single message buffer, and the
+sender keeps a small window of chunks in flight so transfer isn't one RTT per chunk.
+*/
+
+typedef struct
+{
+    int term;                   // leader's current term
+    int leader_id;
+    raft_index_t last_idx;      // snapshot replaces everything up to and including this index
+    int last_term;              // term of last_idx
+    uint64_t offset;            // byte offset of this chunk within the snapshot image
+    const uint8_t* data;
+    uint32_t len;
+    int done;                   // 1 if this is the final chunk
+} msg_installsnapshot_t;
+
+typedef struct
+{
+    int term;                   // follower's current term
+    raft_index_t last_idx;      // snapshot this answers for
+    uint64_t next_offset;       // the byte the follower wants next - the leader rewinds here on failure
+    int success;                // 1 if the chunk was accepted; with done set, the snapshot is installed
+    int complete;
+} msg_installsnapshot_response_t;
+
+class RaftSnapshotStore {
+public:
+    struct FileHeader {
+        char magic[8];
+        int64_t last_idx;
+        int32_t last_term;
+        uint32_t reserved;
+        uint64_t image_len;
+    };
+    static_assert(sizeof(FileHeader) == 32);
+
+    static constexpr char k_magic[8] = {'V', 'D', 'B', 'R', 'S', 'N', 'P', '1'};
+
+    static Result<std::unique_ptr<RaftSnapshotStore>> open(std::string dir) {
+        std::unique_ptr<RaftSnapshotStore> store(new RaftSnapshotStore(std::move(dir)));
+        if (::mkdir(store->dir_.c_str(), 0755) < 0 && errno != EEXIST) {
+            return std::unexpected(errno_code());
+        }
+        if (auto result = store->open_current(); !result) {
+            return std::unexpected(result.error());
+        }
+        return store;
+    }
+
+    ~RaftSnapshotStore() {
+        if (creating()) {
+            ::kill(child_, SIGKILL);
+            ::waitpid(child_, nullptr, 0);
+            ::unlink(path("snapshot.new").c_str());
+        }
+        if (fd_ != -1) ::close(fd_);
+        if (recv_fd_ != -1) ::close(recv_fd_);
+    }
+
+    RaftSnapshotStore(const RaftSnapshotStore&) = delete;
+    RaftSnapshotStore& operator=(const RaftSnapshotStore&) = delete;
+
+    [[nodiscard]] bool empty() const noexcept { return header_.last_idx == 0; }
+    [[nodiscard]] raft_index_t last_idx() const noexcept { return header_.last_idx; }
+    [[nodiscard]] int last_term() const noexcept { return header_.last_term; }
+    [[nodiscard]] uint64_t image_size() const noexcept { return header_.image_len; }
+    [[nodiscard]] bool creating() const noexcept { return child_ > 0; }
+
+    // serialize the keyspace as of (idx, term) and atomically replace the current snapshot. synchronous, and
+    // the keyspace's read locks are held throughout - raft nodes take snapshots with create() instead.
+    Result<void> save(EntryManager& entry_manager, raft_index_t idx, int term) {
+        FileHeader header{};
+        std::memcpy(header.magic, k_magic, sizeof(k_magic));
+        header.last_idx = idx;
+        header.last_term = term;
+
+        uint64_t keys = 0;
+        auto written = write_image(path("snapshot.tmp"), header, [&](const SnapshotSerializer::Sink& sink) {
+            auto count = SnapshotSerializer::write(entry_manager, sink);
+            keys = count.value_or(0);
+            return count;
+        });
+        if (!written) {
+            return std::unexpected(written.error());
+        }
+        if (auto result = install(path("snapshot.tmp")); !result) {
+            return result;
+        }
+        log_message("raft snapshot: saved idx {} ({} keys, {} bytes)", idx, keys, written->image_len);
+        return {};
+    }
+
+    // start a snapshot of the state machine at raft's last applied index: forks a child that writes it while
+    // raft carries on. call on the thread that applies the log - it must be the keyspace's only writer. one
+    // at a time: a no-op while a child is still writing.
+    Result<void> create(raft_server_t* raft, EntryManager& entry_manager) {
+        if (creating()) {
+            return {};
+        }
+        raft_index_t idx = raft_get_last_applied_idx(raft);
+        if (idx <= last_idx()) {
+            return {};
+        }
+        raft_entry_t* ety = raft_get_entry_from_idx(raft, idx);
+        if (!ety) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, k_magic, sizeof(k_magic));
+        header.last_idx = idx;
+        header.last_term = static_cast<int32_t>(ety->term);
+        std::string tmp = path("snapshot.new");
+
+        pid_t pid;
+        {
+            auto frozen = entry_manager.freeze();
+            pid = ::fork();
+            if (pid == 0) {
+                auto written = write_image(tmp, header, [&](const SnapshotSerializer::Sink& sink) {
+                    return SnapshotSerializer::write_frozen(entry_manager, sink);
+                });
+                ::_exit(written ? 0 : 1);
+            }
+        }
+        if (pid < 0) {
+            return std::unexpected(errno_code());
+        }
+        child_ = pid;
+        child_idx_ = idx;
+        return {};
+    }
+
+    // call from the raft thread every tick (wait = true blocks until a running create() is done). once the
+    // child has written its snapshot, moves it into place and drops the covered prefix of raft's log.
+    // returns the index of the snapshot it installed, 0 if there wasn't one to install.
+    Result<raft_index_t> poll_create(raft_server_t* raft, bool wait = false) {
+        if (!creating()) {
+            return 0;
+        }
+        int status = 0;
+        pid_t done = ::waitpid(child_, &status, wait ? 0 : WNOHANG);
+        if (done == 0) {
+            return 0;
+        }
+        child_ = -1;
+        std::string tmp = path("snapshot.new");
+        if (done < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ::unlink(tmp.c_str());
+            return std::unexpected(done < 0 ? errno_code() : std::make_error_code(std::errc::io_error));
+        }
+        if (child_idx_ <= last_idx()) {
+            ::unlink(tmp.c_str());   // a snapshot from the leader landed meanwhile, and it's newer
+            return 0;
+        }
+        if (auto result = install(tmp); !result) {
+            return std::unexpected(result.error());
+        }
+        log_message("raft snapshot: saved idx {} in a child process ({} bytes)", child_idx_, header_.image_len);
+        if (raft_compact_log(raft, child_idx_) != 0) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        return child_idx_;
+    }
+
+    // startup: load the saved snapshot into the keyspace and tell raft where its log begins.
+    // call before RaftLogStore::load_into so entries already covered by the snapshot are skipped. with a
+    // durable log, pass it so a log the snapshot replaced is restarted after it.
+    Result<void> restore(raft_server_t* raft, EntryManager& entry_manager, RaftLogStore* log = nullptr) {
+        if (empty()) {
+            return {};
+        }
+        if (auto result = load_image(fd_, header_, entry_manager); !result) {
+            return result;
+        }
+        raft_load_snapshot(raft, header_.last_term, header_.last_idx);
+        if (log) {
+            return log->on_snapshot_loaded(header_.last_idx, header_.last_term);
+        }
+        return {};
+    }
+
+    // leader side: copy up to out.size() bytes of the image starting at offset.
+    Result<size_t> read_chunk(uint64_t offset, std::span<uint8_t> out) const {
+        if (offset >= header_.image_len) {
+            return 0;
+        }
+        size_t len = static_cast<size_t>(std::min<uint64_t>(out.size(), header_.image_len - offset));
+        ssize_t n = ::pread(fd_, out.data(), len, static_cast<off_t>(sizeof(FileHeader) + offset));
+        if (n != static_cast<ssize_t>(len)) {
+            return std::unexpected(n < 0 ? errno_code() : std::make_error_code(std::errc::io_error));
+        }
+        return len;
+    }
+
+    // follower side: accept one chunk. chunks must arrive in order; anything else is answered with the offset
+    // we actually want so the leader can rewind. the last chunk swaps the keyspace and resets raft's log, and
+    // `log` (the node's durable log, if any) with it.
+    msg_installsnapshot_response_t recv_installsnapshot(raft_server_t* raft, EntryManager& entry_manager,
+                                                        const msg_installsnapshot_t& msg, RaftLogStore* log = nullptr) {
+        msg_installsnapshot_response_t r{raft_get_current_term(raft), msg.last_idx, 0, 0, 0};
+        if (msg.term < r.term) {
+            return r;
+        }
+        if (r.term < msg.term) {
+            raft_set_current_term(raft, msg.term);
+            r.term = msg.term;
+        }
+
+        // we already have everything this snapshot covers
+        if (msg.last_idx <= raft_get_commit_idx(raft)) {
+            r.next_offset = msg.offset + msg.len;
+            r.success = 1;
+            r.complete = 1;
+            return r;
+        }
+
+        if (msg.offset == 0) {
+            if (auto result = begin_receive(msg.last_idx, msg.last_term); !result) {
+                log_message("raft snapshot: receive failed: {}", result.error().message());
+                return r;
+            }
+        } else if (recv_fd_ == -1 || recv_header_.last_idx != msg.last_idx || recv_offset_ != msg.offset) {
+            // a different snapshot, or a gap - ask for the start of what we can use
+            r.next_offset = (recv_fd_ != -1 && recv_header_.last_idx == msg.last_idx) ? recv_offset_ : 0;
+            return r;
+        }
+
+        if (auto result = pwrite_all(recv_fd_, msg.data, msg.len, sizeof(FileHeader) + recv_offset_); !result) {
+            log_message("raft snapshot: receive failed: {}", result.error().message());
+            return r;
+        }
+        recv_offset_ += msg.len;
+        r.next_offset = recv_offset_;
+        r.success = 1;
+
+        if (msg.done) {
+            if (auto result = finish_receive(raft, entry_manager, log); !result) {
+                log_message("raft snapshot: install failed: {}", result.error().message());
+                r.success = 0;
+                r.next_offset = 0;
+                return r;
+            }
+            r.complete = 1;
+        }
+        return r;
+    }
+
+private:
+    std::string dir_;
+    int fd_{-1};
+    FileHeader header_{};
+
+    int recv_fd_{-1};
+    FileHeader recv_header_{};
+    uint64_t recv_offset_{0};
+
+    pid_t child_{-1};                       // create()'s child, reaped by poll_create()
+    raft_index_t child_idx_{0};
+
+    explicit RaftSnapshotStore(std::string dir) : dir_(std::move(dir)) {}
+
+    static std::error_code errno_code() {
+        return std::error_code(errno, std::generic_category());
+    }
+
+    [[nodiscard]] std::string path(const char* name) const {
+        return dir_ + "/" + name;
+    }
+
+    static Result<void> pwrite_all(int fd, const void* data, size_t len, uint64_t offset) {
+        const uint8_t* raw = static_cast<const uint8_t*>(data);
+        while (len > 0) {
+            ssize_t n = ::pwrite(fd, raw, len, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return std::unexpected(errno_code());
+            }
+            raw += n;
+            len -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        return {};
+    }
+
+    Result<void> open_current() {
+        int fd = ::open(path("snapshot.bin").c_str(), O_RDONLY);
+        if (fd < 0) {
+            return errno == ENOENT ? Result<void>{} : std::unexpected(errno_code());
+        }
+        FileHeader header;
+        if (::pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            std::memcmp(header.magic, k_magic, sizeof(k_magic)) != 0) {
+            ::close(fd);
+            log_message("raft snapshot: ignoring unreadable snapshot in {}", dir_);
+            return {};
+        }
+        if (fd_ != -1) {
+            ::close(fd_);
+        }
+        fd_ = fd;
+        header_ = header;
+        return {};
+    }
+
+    // FileHeader | image into a new `tmp`, fdatasync'd. `encode(sink)` streams the image; touches no member
+    // and doesn't log, so create()'s child can run it
+    template<typename Encode>
+    static Result<FileHeader> write_image(const std::string& tmp, FileHeader header, Encode&& encode) {
+        int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return std::unexpected(errno_code());
+        }
+        uint64_t offset = sizeof(FileHeader);
+        auto written = encode([&](std::span<const uint8_t> chunk) -> Result<void> {
+            if (auto result = pwrite_all(fd, chunk.data(), chunk.size(), offset); !result) {
+                return result;
+            }
+            offset += chunk.size();
+            return {};
+        });
+        if (!written) {
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return std::unexpected(written.error());
+        }
+        header.image_len = offset - sizeof(FileHeader);
+        if (auto result = sync_file(fd, tmp, header); !result) {
+            return std::unexpected(result.error());
+        }
+        return header;
+    }
+
+    // header goes in last, then the data is made durable; closes fd either way
+    static Result<void> sync_file(int fd, const std::string& tmp, const FileHeader& header) {
+        auto fail = [&](std::error_code ec) -> Result<void> {
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return std::unexpected(ec);
+        };
+        if (auto result = pwrite_all(fd, &header, sizeof(header), 0); !result) {
+            return fail(result.error());
+        }
+        if (::fdatasync(fd) < 0) {
+            return fail(errno_code());
+        }
+        ::close(fd);
+        return {};
+    }
+
+    // the rename is made durable before the new file is reopened as current
+    Result<void> install(const std::string& tmp) {
+        if (::rename(tmp.c_str(), path("snapshot.bin").c_str()) < 0) {
+            return std::unexpected(errno_code());
+        }
+        if (int dir_fd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY); dir_fd >= 0) {
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+        return open_current();
+    }
+
+    Result<void> begin_receive(raft_index_t idx, int term) {
+        if (recv_fd_ != -1) {
+            ::close(recv_fd_);
+        }
+        recv_fd_ = ::open(path("snapshot.recv").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (recv_fd_ < 0) {
+            return std::unexpected(errno_code());
+        }
+        recv_header_ = FileHeader{};
+        std::memcpy(recv_header_.magic, k_magic, sizeof(k_magic));
+        recv_header_.last_idx = idx;
+        recv_header_.last_term = term;
+        recv_offset_ = 0;
+        return {};
+    }
+
+    Result<void> finish_receive(raft_server_t* raft, EntryManager& entry_manager, RaftLogStore* log) {
+        int fd = recv_fd_;
+        recv_fd_ = -1;
+        recv_header_.image_len = recv_offset_;
+        if (auto result = sync_file(fd, path("snapshot.recv"), recv_header_); !result) {
+            return result;
+        }
+        if (auto result = install(path("snapshot.recv")); !result) {
+            return result;
+        }
+        if (auto result = load_image(fd_, header_, entry_manager); !result) {
+            return result;
+        }
+        if (raft_load_snapshot(raft, header_.last_term, header_.last_idx) != 0) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        if (log) {
+            return log->on_snapshot_loaded(header_.last_idx, header_.last_term);
+        }
+        return {};
+    }
+
+    static Result<void> load_image(int fd, const FileHeader& header, EntryManager& entry_manager) {
+        size_t map_len = sizeof(FileHeader) + header.image_len;
+        void* map = ::mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            return std::unexpected(errno_code());
+        }
+        ::madvise(map, map_len, MADV_SEQUENTIAL);
+        std::span<const uint8_t> image(static_cast<const uint8_t*>(map) + sizeof(FileHeader), header.image_len);
+        auto loaded = SnapshotSerializer::load(entry_manager, image);
+        ::munmap(map, map_len);
+        if (!loaded) {
+            return std::unexpected(loaded.error());
+        }
+        return {};
+    }
+};
+
+/*
+Leader-side state for streaming the current snapshot to ONE follower. Create it from the send_snapshot
+callback, call next() whenever you can send (each tick and after each response) and feed every response
+to on_response(). Up to `window` chunks are in flight; a rejected chunk rewinds to the offset the follower
+asked for. If a newer snapshot is taken mid-transfer the stream restarts from byte 0 of the new one.
+*/
+
+class RaftSnapshotSender {
+public:
+    explicit RaftSnapshotSender(const RaftSnapshotStore& store, size_t chunk_bytes = 1 << 20, size_t window = 4)
+        : store_(store), chunk_bytes_(chunk_bytes), window_(window) {
+        restart();
+    }
+
+    [[nodiscard]] bool complete() const noexcept { return complete_; }
+    [[nodiscard]] uint64_t acked_bytes() const noexcept { return acked_offset_; }
+
+    // fills msg (pointing into buffer) with the next chunk; false if the window is full or everything is sent
+    bool next(raft_server_t* raft, msg_installsnapshot_t& msg, std::vector<uint8_t>& buffer) {
+        if (last_idx_ != store_.last_idx()) {
+            restart();
+        }
+        if (complete_ || sent_offset_ >= store_.image_size() || sent_offset_ - acked_offset_ >= window_ * chunk_bytes_) {
+            return false;
+        }
+
+        buffer.resize(chunk_bytes_);
+        auto n = store_.read_chunk(sent_offset_, buffer);
+        if (!n) {
+            log_message("raft snapshot: read failed: {}", n.error().message());
+            return false;
+        }
+
+        msg.term = raft_get_current_term(raft);
+        msg.leader_id = raft_get_nodeid(raft);
+        msg.last_idx = store_.last_idx();
+        msg.last_term = store_.last_term();
+        msg.offset = sent_offset_;
+        msg.data = buffer.data();
+        msg.len = static_cast<uint32_t>(*n);
+        msg.done = sent_offset_ + *n == store_.image_size();
+
+        sent_offset_ += *n;
+        return true;
+    }
+
+    // returns true once the follower has installed the snapshot; replication then resumes after last_idx
+    bool on_response(raft_server_t* raft, raft_node_t* node, const msg_installsnapshot_response_t& r) {
+        if (r.term > raft_get_current_term(raft)) {
+            raft_set_current_term(raft, r.term);
+            raft_become_follower(raft);
+            return false;
+        }
+        if (r.last_idx != last_idx_ || complete_) {
+            return complete_;
+        }
+        if (r.complete) {
+            complete_ = true;
+            raft_node_set_next_idx(node, last_idx_ + 1);
+            raft_node_set_match_idx(node, last_idx_);
+            return true;
+        }
+        if (!r.success) {
+            sent_offset_ = acked_offset_ = r.next_offset;
+            return false;
+        }
+        acked_offset_ = std::max(acked_offset_, r.next_offset);
+        return false;
+    }
+
+private:
+    const RaftSnapshotStore& store_;
+    size_t chunk_bytes_;
+    size_t window_;
+    raft_index_t last_idx_{0};
+    uint64_t sent_offset_{0};
+    uint64_t acked_offset_{0};
+    bool complete_{false};
+
+    void restart() {
+        last_idx_ = store_.last_idx();
+        sent_offset_ = 0;
+        acked_offset_ = 0;
+        complete_ = false;
+    }
+};
+
+#endif // RAFT_SNAPSHOT_HPP
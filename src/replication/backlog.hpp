@@ -0,0 +1,115 @@
+#ifndef REPLICATION_BACKLOG_HPP
+#define REPLICATION_BACKLOG_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <optional>
+#include <cctype>
+
+/*
+The last `capacity` bytes of the primary's replication stream, kept in a ring so a replica that drops its
+connection can resume from its own offset instead of pulling a full snapshot.
+
+Offsets count stream bytes since the primary started (its replication id changes on restart, so offsets
+are only comparable under the same id). The backlog holds [start_offset(), end_offset()); a replica at
+offset o can partially resync iff start_offset() <= o <= end_offset().
+
+Not synchronised - the owner (ReplicationPrimary) serialises access.
+*/
+
+class ReplicationBacklog {
+public:
+    explicit ReplicationBacklog(size_t capacity) : ring_(capacity) {}
+
+    void append(std::span<const uint8_t> data) {
+        const size_t cap = ring_.size();
+        if (data.size() >= cap) {
+            // only the tail fits
+            std::memcpy(ring_.data(), data.data() + data.size() - cap, cap);
+            head_ = 0;
+            end_ += data.size();
+            held_ = cap;
+            return;
+        }
+        size_t first = std::min(data.size(), cap - head_);
+        std::memcpy(ring_.data() + head_, data.data(), first);
+        std::memcpy(ring_.data(), data.data() + first, data.size() - first);
+        head_ = (head_ + data.size()) % cap;
+        end_ += data.size();
+        held_ = std::min(cap, held_ + data.size());
+    }
+
+    [[nodiscard]] uint64_t end_offset() const noexcept { return end_; }
+    [[nodiscard]] uint64_t start_offset() const noexcept { return end_ - held_; }
+    [[nodiscard]] size_t capacity() const noexcept { return ring_.size(); }
+    [[nodiscard]] bool covers(uint64_t offset) const noexcept {
+        return offset >= start_offset() && offset <= end_;
+    }
+
+    // copy up to out.size() bytes starting at `offset`; nullopt if the backlog no longer holds it
+    std::optional<size_t> read(uint64_t offset, std::span<uint8_t> out) const {
+        if (!covers(offset)) {
+            return std::nullopt;
+        }
+        const size_t cap = ring_.size();
+        size_t n = static_cast<size_t>(std::min<uint64_t>(out.size(), end_ - offset));
+        // ring position of `offset`: head_ is where end_ lands
+        size_t pos = (head_ + cap - static_cast<size_t>(end_ - offset) % cap) % cap;
+        size_t first = std::min(n, cap - pos);
+        std::memcpy(out.data(), ring_.data() + pos, first);
+        std::memcpy(out.data() + first, ring_.data(), n - first);
+        return n;
+    }
+
+private:
+    std::vector<uint8_t> ring_;
+    size_t head_{0};   // next write position
+    size_t held_{0};   // valid bytes in the ring
+    uint64_t end_{0};  // offset one past the newest byte
+};
+
+// commands on the replication link use the client request framing (see RequestParser):
+//     u32 total_len | ( u32 len | bytes )*      lengths big-endian
+inline void encode_command(std::vector<uint8_t>& out, std::span<const std::string> args) {
+    auto put = [&](uint32_t v) {
+        v = __builtin_bswap32(v);
+        uint8_t bytes[4];
+        std::memcpy(bytes, &v, sizeof(v));
+        out.insert(out.end(), bytes, bytes + 4);
+    };
+    uint32_t total = 0;
+    for (const auto& arg : args) {
+        total += static_cast<uint32_t>(sizeof(uint32_t) + arg.size());
+    }
+    put(total);
+    for (const auto& arg : args) {
+        put(static_cast<uint32_t>(arg.size()));
+        out.insert(out.end(), arg.begin(), arg.end());
+    }
+}
+
+// bytes of the complete frame at the front of `data`, or 0 if it hasn't fully arrived
+inline size_t frame_size(std::span<const uint8_t> data) {
+    if (data.size() < sizeof(uint32_t)) {
+        return 0;
+    }
+    uint32_t len;
+    std::memcpy(&len, data.data(), sizeof(len));
+    size_t total = sizeof(uint32_t) + __builtin_bswap32(len);
+    return data.size() >= total ? total : 0;
+}
+
+// commands that change the keyspace and therefore go down the replication stream
+inline bool is_write_command(std::string_view name) {
+    static constexpr std::string_view k_writes[] = {"set", "del", "flushall", "zadd", "zrem", "pexpire", "pexpireat"};
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    return std::find(std::begin(k_writes), std::end(k_writes), lower) != std::end(k_writes);
+}
+
+#endif // REPLICATION_BACKLOG_HPP
@@ -0,0 +1,539 @@
+#ifndef REPLICATION_PRIMARY_HPP
+#define REPLICATION_PRIMARY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <span>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <charconv>
+#include <chrono>
+#include <expected>
+#include <system_error>
+#include <csignal>
+#include <poll.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../../socket.hpp"
+#include "../../logging.hpp"
+#include "../../request_parser.hpp"
+#include "../../snapshot_serializer.hpp"
+#include "backlog.hpp"
+#include "../raft/replica_directory.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Primary side of async (non-raft) replication, for cache-tier deployments where losing the last few writes
+on failover is acceptable. Clients are acked as soon as the primary has applied a write; replicas catch up
+behind it.
+
+Every write is applied and appended to the replication stream under one lock (write()), so the stream is
+exactly the primary's apply order and a snapshot taken under the same lock lines up with a stream offset.
+A full resync holds that lock only to note the offset and fork(): the child writes its copy-on-write image
+of the keyspace into a memfd and exits, and the replica gets it from there in chunks while writes go on.
+PEXPIRE goes down the stream as PEXPIREAT with an absolute unix-ms deadline, so a replica that applies it
+late - or again, after a resync - doesn't push the key's expiry back.
+The stream is buffered in a ReplicationBacklog; a thread of our own serves replicas on the replication port:
+
+    replica -> primary   PSYNC <replid> <offset>        ("?" "-1" on first contact)
+    primary -> replica   CONTINUE <replid>               partial resync: stream from <offset> out of the backlog
+                         FULLRESYNC <replid> <offset> <bytes>, then <bytes> of snapshot, then stream from <offset>
+    replica -> primary   REPLCONF ACK <offset>          every ~100ms, for lag reporting
+                         REPLCONF LISTENING-PORT <port> before PSYNC, the port it serves clients on
+
+With client_port set the primary lists itself and its replicas in ReplicaDirectory (the REPLICAS command)
+every 100ms: itself as leader at the stream's end offset, each replica as a follower at its acked offset
+and the bytes it is behind. A replica's address is the IP it connected from with the port it advertised.
+
+All messages use the client request framing (encode_command). A replica that falls further behind than the
+backlog holds is disconnected and comes back through FULLRESYNC.
+*/
+
+class ReplicationPrimary {
+public:
+    struct Options {
+        uint16_t port = 0;                 // 0: pick a free port (see port())
+        size_t backlog_bytes = 16u << 20;
+        uint16_t client_port = 0;          // ours, for REPLICAS; 0 leaves ReplicaDirectory alone
+    };
+
+    struct ReplicaStats {
+        std::string address;
+        uint64_t acked_offset;
+        uint64_t lag_bytes;                // end_offset - acked_offset
+        bool streaming;
+    };
+
+    struct Stats {
+        uint64_t offset;                   // stream bytes produced so far
+        uint64_t backlog_start;
+        uint64_t full_resyncs;
+        uint64_t partial_resyncs;
+        std::vector<ReplicaStats> replicas;
+    };
+
+    static Result<std::unique_ptr<ReplicationPrimary>> start(EntryManager& entry_manager, Options options) {
+        std::unique_ptr<ReplicationPrimary> primary(new ReplicationPrimary(entry_manager, options));
+        if (auto r = primary->listen(); !r) {
+            return std::unexpected(r.error());
+        }
+        primary->thread_ = std::thread(&ReplicationPrimary::run, primary.get());
+        return primary;
+    }
+
+    ~ReplicationPrimary() {
+        stop_ = true;
+        wake();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (options_.client_port) {
+            ReplicaDirectory::instance().publish({});
+        }
+        ::close(wake_fds_[0]);
+        ::close(wake_fds_[1]);
+    }
+
+    ReplicationPrimary(const ReplicationPrimary&) = delete;
+    ReplicationPrimary& operator=(const ReplicationPrimary&) = delete;
+
+    // apply a write and put it on the stream, atomically with respect to snapshots
+    template<typename Apply>
+    void write(const std::vector<std::string>& args, Apply&& apply) {
+        {
+            std::lock_guard lock(mutex_);
+            apply();
+            frame_.clear();
+            encode_write(frame_, args);
+            backlog_.append(frame_);
+        }
+        wake();
+    }
+
+    [[nodiscard]] uint16_t port() const noexcept { return port_; }
+    [[nodiscard]] const std::string& replid() const noexcept { return replid_; }
+
+    [[nodiscard]] uint64_t offset() const {
+        std::lock_guard lock(mutex_);
+        return backlog_.end_offset();
+    }
+
+    [[nodiscard]] Stats stats() const {
+        std::lock_guard lock(mutex_);
+        Stats s{backlog_.end_offset(), backlog_.start_offset(), full_resyncs_, partial_resyncs_, {}};
+        for (const auto& r : replicas_) {
+            s.replicas.push_back({r.address, r.acked_offset, backlog_.end_offset() - r.acked_offset,
+                                  r.state == Link::State::Streaming});
+        }
+        return s;
+    }
+
+private:
+    struct Link {
+        enum class State { Handshake, Snapshotting, Streaming } state = State::Handshake;
+        Socket socket{-1};
+        std::string address;
+        std::vector<uint8_t> rbuf;
+        std::vector<uint8_t> wbuf;        // handshake reply, sent before the snapshot and any stream bytes
+        size_t wbuf_sent = 0;
+        uint64_t sent_offset = 0;         // next stream byte to send
+        uint64_t acked_offset = 0;
+        uint16_t listening_port = 0;      // REPLCONF LISTENING-PORT; 0 if the replica didn't say
+        // full resync: the child writing the snapshot, then the memfd it wrote, sent on after wbuf
+        pid_t child = -1;
+        int snapshot_fd = -1;
+        uint64_t snapshot_size = 0;
+        uint64_t snapshot_sent = 0;
+
+        Link() = default;
+        Link(const Link&) = delete;
+        Link& operator=(const Link&) = delete;
+        ~Link() {
+            if (child > 0) {
+                ::kill(child, SIGKILL);
+                ::waitpid(child, nullptr, 0);
+            }
+            if (snapshot_fd != -1) {
+                ::close(snapshot_fd);
+            }
+        }
+    };
+
+    // at most this many chunks of a snapshot per pass, so mutex_ (and with it every write) isn't held for the
+    // whole transfer to a fast replica
+    static constexpr size_t k_snapshot_chunks_per_pass = 4;
+
+    EntryManager& entry_manager_;
+    Options options_;
+    std::string replid_;
+    Socket listen_socket_{-1};
+    uint16_t port_{0};
+    int wake_fds_[2]{-1, -1};
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+
+    mutable std::mutex mutex_;            // guards backlog_, the keyspace during snapshots, counters, replicas_
+    ReplicationBacklog backlog_;
+    std::vector<uint8_t> frame_;
+    std::list<Link> replicas_;
+    uint64_t full_resyncs_{0};
+    uint64_t partial_resyncs_{0};
+    std::chrono::steady_clock::time_point published_at_{};
+    static constexpr std::chrono::milliseconds k_publish_interval{100};
+
+    ReplicationPrimary(EntryManager& entry_manager, Options options)
+        : entry_manager_(entry_manager), options_(options), backlog_(options.backlog_bytes) {
+        std::random_device rd;
+        std::mt19937_64 rng(rd());
+        static constexpr char k_hex[] = "0123456789abcdef";
+        for (int i = 0; i < 40; ++i) {
+            replid_ += k_hex[rng() % 16];
+        }
+    }
+
+    Result<void> listen() {
+        if (::pipe2(wake_fds_, O_NONBLOCK | O_CLOEXEC) < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        Socket sock(::socket(AF_INET, SOCK_STREAM, 0));
+        if (sock.get() < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        int val = 1;
+        ::setsockopt(sock.get(), SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options_.port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (::bind(sock.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(sock.get(), SOMAXCONN) < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(sock.get(), reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        if (auto r = sock.set_nonblocking(); !r) {
+            return std::unexpected(r.error());
+        }
+        listen_socket_ = std::move(sock);
+        log_message("replication: listening on port {}, replid {}", port_, replid_);
+        return {};
+    }
+
+    void wake() {
+        char c = 1;
+        (void)!::write(wake_fds_[1], &c, 1);
+    }
+
+    void run() {
+        std::vector<pollfd> fds;
+        std::vector<Link*> links;
+        std::vector<uint8_t> chunk(256 << 10);
+
+        while (!stop_) {
+            fds.clear();
+            links.clear();
+            fds.push_back({listen_socket_.get(), POLLIN, 0});
+            fds.push_back({wake_fds_[0], POLLIN, 0});
+            {
+                std::lock_guard lock(mutex_);
+                for (auto& link : replicas_) {
+                    short events = POLLIN;
+                    if (link.wbuf_sent < link.wbuf.size() || link.snapshot_sent < link.snapshot_size ||
+                        (link.state == Link::State::Streaming && link.sent_offset < backlog_.end_offset())) {
+                        events |= POLLOUT;
+                    }
+                    fds.push_back({link.socket.get(), events, 0});
+                    links.push_back(&link);
+                }
+            }
+
+            if (::poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR) {
+                log_message("replication: poll failed: {}", std::strerror(errno));
+                return;
+            }
+            if (fds[1].revents & POLLIN) {
+                char drain[256];
+                while (::read(wake_fds_[0], drain, sizeof(drain)) > 0) {}
+            }
+            if (fds[0].revents & POLLIN) {
+                accept_replicas();
+            }
+
+            std::lock_guard lock(mutex_);
+            for (size_t i = 0; i < links.size(); ++i) {
+                Link& link = *links[i];
+                bool ok = true;
+                if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    ok = read_from(link);
+                }
+                if (ok && link.state == Link::State::Snapshotting) {
+                    ok = reap_snapshot(link);
+                }
+                if (ok) {
+                    ok = write_to(link, chunk);
+                }
+                if (!ok) {
+                    log_message("replication: replica {} disconnected at offset {}", link.address, link.acked_offset);
+                    replicas_.remove_if([&](const Link& l) { return &l == &link; });
+                }
+            }
+            if (options_.client_port && std::chrono::steady_clock::now() - published_at_ >= k_publish_interval) {
+                publish_replicas();
+            }
+        }
+    }
+
+    // mutex_ held. our own host is whatever address the replicas reached us on
+    void publish_replicas() {
+        published_at_ = std::chrono::steady_clock::now();
+        std::string host = "127.0.0.1";
+        if (!replicas_.empty()) {
+            sockaddr_in addr{};
+            socklen_t len = sizeof(addr);
+            char ip[INET_ADDRSTRLEN];
+            if (::getsockname(replicas_.front().socket.get(), reinterpret_cast<sockaddr*>(&addr), &len) == 0 &&
+                ::inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip))) {
+                host = ip;
+            }
+        }
+        uint64_t end = backlog_.end_offset();
+        std::vector<ReplicaDirectory::Replica> list;
+        list.push_back({0, host + ":" + std::to_string(options_.client_port), ReplicaDirectory::Role::Leader,
+                        static_cast<int64_t>(end), 0});
+        int id = 1;
+        for (const auto& link : replicas_) {
+            std::string address = link.address;
+            if (link.listening_port) {
+                address = address.substr(0, address.rfind(':')) + ":" + std::to_string(link.listening_port);
+            }
+            list.push_back({id++, std::move(address), ReplicaDirectory::Role::Follower,
+                            static_cast<int64_t>(link.acked_offset), static_cast<int64_t>(end - link.acked_offset)});
+        }
+        ReplicaDirectory::instance().publish(std::move(list));
+    }
+
+    void accept_replicas() {
+        while (true) {
+            sockaddr_in addr{};
+            socklen_t len = sizeof(addr);
+            int fd = ::accept(listen_socket_.get(), reinterpret_cast<sockaddr*>(&addr), &len);
+            if (fd < 0) {
+                return;
+            }
+            Socket sock(fd);
+            if (!sock.set_nonblocking()) {
+                continue;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            std::lock_guard lock(mutex_);
+            Link& link = replicas_.emplace_back();
+            link.socket = std::move(sock);
+            link.address = std::string(inet_ntoa(addr.sin_addr)) + ":" + std::to_string(ntohs(addr.sin_port));
+        }
+    }
+
+    // mutex_ held
+    bool read_from(Link& link) {
+        uint8_t buffer[4096];
+        while (true) {
+            ssize_t n = ::read(link.socket.get(), buffer, sizeof(buffer));
+            if (n > 0) {
+                link.rbuf.insert(link.rbuf.end(), buffer, buffer + n);
+                continue;
+            }
+            if (n == 0) return false;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno != EINTR) return false;
+        }
+
+        size_t pos = 0;
+        while (size_t size = frame_size(std::span(link.rbuf).subspan(pos))) {
+            auto args = RequestParser::parse(std::span(link.rbuf).subspan(pos, size));
+            pos += size;
+            if (!args || args->empty() || !handle_message(link, *args)) {
+                return false;
+            }
+        }
+        link.rbuf.erase(link.rbuf.begin(), link.rbuf.begin() + static_cast<ptrdiff_t>(pos));
+        return true;
+    }
+
+    // mutex_ held
+    bool handle_message(Link& link, const std::vector<std::string>& args) {
+        int64_t offset = -1;
+        if (args.size() == 3) {
+            std::from_chars(args[2].data(), args[2].data() + args[2].size(), offset);
+        }
+        if (args[0] == "REPLCONF" && args.size() == 3 && args[1] == "ACK" && offset >= 0) {
+            link.acked_offset = std::max(link.acked_offset, static_cast<uint64_t>(offset));
+            return true;
+        }
+        if (args[0] == "REPLCONF" && args.size() == 3 && args[1] == "LISTENING-PORT" && offset > 0 && offset <= 65535) {
+            link.listening_port = static_cast<uint16_t>(offset);
+            return true;
+        }
+        if (args[0] != "PSYNC" || args.size() != 3 || link.state != Link::State::Handshake) {
+            return false;
+        }
+
+        if (args[1] == replid_ && offset >= 0 && backlog_.covers(static_cast<uint64_t>(offset))) {
+            link.sent_offset = link.acked_offset = static_cast<uint64_t>(offset);
+            std::vector<std::string> reply{"CONTINUE", replid_};
+            encode_command(link.wbuf, reply);
+            link.state = Link::State::Streaming;
+            ++partial_resyncs_;
+            log_message("replication: partial resync for {} from offset {} ({} bytes behind)",
+                        link.address, offset, backlog_.end_offset() - static_cast<uint64_t>(offset));
+            return true;
+        }
+
+        // full resync. we hold mutex_, so no write can slip in between the fork and its offset.
+        int fd = ::memfd_create("vectordb-resync", MFD_CLOEXEC);
+        if (fd < 0) {
+            log_message("replication: full resync for {} failed: {}", link.address, std::strerror(errno));
+            return false;
+        }
+        uint64_t at = backlog_.end_offset();
+        pid_t pid;
+        {
+            auto frozen = entry_manager_.freeze();
+            pid = ::fork();
+            if (pid == 0) {
+                uint64_t written_at = 0;
+                auto written = SnapshotSerializer::write_frozen(entry_manager_, [&](std::span<const uint8_t> bytes) -> Result<void> {
+                    for (size_t done = 0; done < bytes.size();) {
+                        ssize_t n = ::pwrite(fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(written_at));
+                        if (n < 0 && errno == EINTR) continue;
+                        if (n < 0) return std::unexpected(std::error_code(errno, std::generic_category()));
+                        done += static_cast<size_t>(n);
+                        written_at += static_cast<uint64_t>(n);
+                    }
+                    return {};
+                });
+                ::_exit(written ? 0 : 1);
+            }
+        }
+        if (pid < 0) {
+            log_message("replication: full resync for {} failed: {}", link.address, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        link.child = pid;
+        link.snapshot_fd = fd;
+        link.sent_offset = link.acked_offset = at;
+        link.state = Link::State::Snapshotting;
+        ++full_resyncs_;
+        log_message("replication: full resync for {} at offset {}, snapshotting in child {}", link.address, at, pid);
+        return true;
+    }
+
+    // mutex_ held. once the child is done, the FULLRESYNC line goes out with the snapshot's size behind it
+    bool reap_snapshot(Link& link) {
+        int status = 0;
+        pid_t done = ::waitpid(link.child, &status, WNOHANG);
+        if (done == 0) {
+            return true;
+        }
+        link.child = -1;
+        struct stat st{};
+        if (done < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || ::fstat(link.snapshot_fd, &st) < 0) {
+            log_message("replication: snapshot for {} failed", link.address);
+            return false;
+        }
+        link.snapshot_size = static_cast<uint64_t>(st.st_size);
+        std::vector<std::string> reply{"FULLRESYNC", replid_, std::to_string(link.sent_offset),
+                                       std::to_string(link.snapshot_size)};
+        encode_command(link.wbuf, reply);
+        link.state = Link::State::Streaming;
+        log_message("replication: snapshot for {} ready, {} bytes", link.address, link.snapshot_size);
+        return true;
+    }
+
+    // PEXPIRE becomes PEXPIREAT <unix ms> on the stream; everything else goes as the client sent it
+    static void encode_write(std::vector<uint8_t>& out, const std::vector<std::string>& args) {
+        int64_t ttl_ms = 0;
+        if (args.size() == 3 && args[0].size() == 7 && ::strncasecmp(args[0].c_str(), "pexpire", 7) == 0) {
+            auto [end, ec] = std::from_chars(args[2].data(), args[2].data() + args[2].size(), ttl_ms);
+            if (ec == std::errc() && end == args[2].data() + args[2].size() && ttl_ms >= 0) {
+                int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                encode_command(out, std::vector<std::string>{"PEXPIREAT", args[1], std::to_string(now_ms + ttl_ms)});
+                return;
+            }
+        }
+        encode_command(out, args);
+    }
+
+    // mutex_ held
+    bool write_to(Link& link, std::vector<uint8_t>& chunk) {
+        while (link.wbuf_sent < link.wbuf.size()) {
+            ssize_t n = ::send(link.socket.get(), link.wbuf.data() + link.wbuf_sent,
+                               link.wbuf.size() - link.wbuf_sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            link.wbuf_sent += static_cast<size_t>(n);
+        }
+        link.wbuf.clear();
+        link.wbuf_sent = 0;
+
+        if (link.state != Link::State::Streaming) {
+            return true;
+        }
+        for (size_t pieces = 0; link.snapshot_sent < link.snapshot_size; ++pieces) {
+            if (pieces == k_snapshot_chunks_per_pass) {
+                return true;
+            }
+            size_t want = static_cast<size_t>(std::min<uint64_t>(chunk.size(), link.snapshot_size - link.snapshot_sent));
+            ssize_t n = ::pread(link.snapshot_fd, chunk.data(), want, static_cast<off_t>(link.snapshot_sent));
+            if (n <= 0) {
+                return false;
+            }
+            ssize_t sent = ::send(link.socket.get(), chunk.data(), static_cast<size_t>(n), MSG_NOSIGNAL);
+            if (sent < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            link.snapshot_sent += static_cast<uint64_t>(sent);
+        }
+        if (link.snapshot_fd != -1) {
+            ::close(link.snapshot_fd);
+            link.snapshot_fd = -1;
+        }
+        while (link.sent_offset < backlog_.end_offset()) {
+            auto n = backlog_.read(link.sent_offset, chunk);
+            if (!n) {
+                log_message("replication: replica {} fell out of the backlog", link.address);
+                return false;
+            }
+            ssize_t sent = ::send(link.socket.get(), chunk.data(), *n, MSG_NOSIGNAL);
+            if (sent < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            link.sent_offset += static_cast<uint64_t>(sent);
+        }
+        return true;
+    }
+};
+
+#endif // REPLICATION_PRIMARY_HPP
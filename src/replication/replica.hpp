@@ -0,0 +1,280 @@
+#ifndef REPLICATION_REPLICA_HPP
+#define REPLICATION_REPLICA_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <span>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../../socket.hpp"
+#include "../../logging.hpp"
+#include "../../request_parser.hpp"
+#include "../../snapshot_serializer.hpp"
+#include "../../command_processor.hpp"
+#include "backlog.hpp"
+
+/*
+Replica side of async replication (see primary.hpp for the protocol). A thread of our own connects to the
+primary, resyncs - partially from the primary's backlog when it still holds our offset, else from a full
+snapshot - and then applies the write stream to the local keyspace as it arrives, acking its offset every
+ack_interval. On disconnect it keeps its replid/offset and reconnects, so a short outage costs only the
+bytes missed.
+
+Clients of a replica get reads only; the server refuses writes while a replica is attached.
+*/
+
+class ReplicationReplica {
+public:
+    struct Options {
+        std::string host = "127.0.0.1";
+        uint16_t port = 0;
+        std::chrono::milliseconds ack_interval{100};
+        std::chrono::milliseconds retry_interval{200};
+        uint16_t listening_port = 0;       // the port we serve clients on, told to the primary for REPLICAS
+    };
+
+    struct Stats {
+        bool connected;
+        uint64_t offset;                   // stream bytes applied
+        uint64_t commands_applied;
+        uint64_t full_resyncs;
+        uint64_t partial_resyncs;
+        double apply_rate;                 // stream bytes/sec over the last ack interval
+    };
+
+    ReplicationReplica(EntryManager& entry_manager, Options options)
+        : entry_manager_(entry_manager), options_(std::move(options)) {
+        thread_ = std::thread(&ReplicationReplica::run, this);
+    }
+
+    ~ReplicationReplica() {
+        stop_ = true;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    ReplicationReplica(const ReplicationReplica&) = delete;
+    ReplicationReplica& operator=(const ReplicationReplica&) = delete;
+
+    [[nodiscard]] Stats stats() const {
+        std::lock_guard lock(mutex_);
+        return Stats{connected_, offset_, commands_applied_, full_resyncs_, partial_resyncs_, apply_rate_};
+    }
+
+    [[nodiscard]] uint64_t offset() const {
+        std::lock_guard lock(mutex_);
+        return offset_;
+    }
+
+    // drop the current link (tests / benchmarks use this to exercise partial resync)
+    void disconnect() { drop_ = true; }
+
+private:
+    EntryManager& entry_manager_;
+    Options options_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> drop_{false};
+
+    mutable std::mutex mutex_;            // stats only - the keyspace is written by this thread alone
+    std::string replid_{"?"};
+    uint64_t offset_{0};
+    uint64_t commands_applied_{0};
+    uint64_t full_resyncs_{0};
+    uint64_t partial_resyncs_{0};
+    double apply_rate_{0};
+    bool connected_{false};
+
+    void run() {
+        while (!stop_) {
+            Socket sock = connect_primary();
+            if (sock.get() < 0) {
+                std::this_thread::sleep_for(options_.retry_interval);
+                continue;
+            }
+            stream(sock);
+            {
+                std::lock_guard lock(mutex_);
+                connected_ = false;
+            }
+            drop_ = false;
+            if (!stop_) {
+                log_message("replication: link to {}:{} lost at offset {}, reconnecting",
+                            options_.host, options_.port, offset());
+                std::this_thread::sleep_for(options_.retry_interval);
+            }
+        }
+    }
+
+    Socket connect_primary() {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (::getaddrinfo(options_.host.c_str(), std::to_string(options_.port).c_str(), &hints, &res) != 0) {
+            return Socket(-1);
+        }
+        Socket sock(::socket(res->ai_family, res->ai_socktype, res->ai_protocol));
+        bool ok = sock.get() >= 0 && ::connect(sock.get(), res->ai_addr, res->ai_addrlen) == 0;
+        ::freeaddrinfo(res);
+        if (!ok) {
+            return Socket(-1);
+        }
+        int one = 1;
+        ::setsockopt(sock.get(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return sock;
+    }
+
+    static bool send_all(int fd, const std::vector<uint8_t>& bytes) {
+        size_t sent = 0;
+        while (sent < bytes.size()) {
+            ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static uint64_t to_u64(const std::string& s) {
+        uint64_t v = 0;
+        std::from_chars(s.data(), s.data() + s.size(), v);
+        return v;
+    }
+
+    void stream(Socket& sock) {
+        std::vector<uint8_t> out;
+        {
+            std::lock_guard lock(mutex_);
+            if (options_.listening_port) {
+                std::vector<std::string> port{"REPLCONF", "LISTENING-PORT", std::to_string(options_.listening_port)};
+                encode_command(out, port);
+            }
+            std::vector<std::string> psync{"PSYNC", replid_, replid_ == "?" ? "-1" : std::to_string(offset_)};
+            encode_command(out, psync);
+        }
+        if (!send_all(sock.get(), out)) {
+            return;
+        }
+
+        std::vector<uint8_t> rbuf;
+        std::vector<uint8_t> response;
+        uint8_t buffer[64 << 10];
+        bool synced = false;
+        size_t snapshot_bytes = 0;
+        std::string snapshot_replid;     // where a FULLRESYNC puts us, once its snapshot is loaded
+        uint64_t snapshot_offset = 0;
+        auto last_ack = std::chrono::steady_clock::now();
+        uint64_t offset_at_last_ack = offset();
+
+        while (!stop_ && !drop_) {
+            pollfd pfd{sock.get(), POLLIN, 0};
+            int ready = ::poll(&pfd, 1, static_cast<int>(options_.ack_interval.count()));
+            if (ready < 0 && errno != EINTR) {
+                return;
+            }
+            if (ready > 0) {
+                ssize_t n = ::read(sock.get(), buffer, sizeof(buffer));
+                if (n <= 0) {
+                    return;
+                }
+                rbuf.insert(rbuf.end(), buffer, buffer + n);
+            }
+
+            size_t pos = 0;
+            while (pos < rbuf.size()) {
+                auto view = std::span(rbuf).subspan(pos);
+                if (snapshot_bytes > 0) {
+                    // FULLRESYNC payload: wait for all of it, then load in one go
+                    if (view.size() < snapshot_bytes) break;
+                    if (auto loaded = SnapshotSerializer::load(entry_manager_, view.first(snapshot_bytes)); !loaded) {
+                        log_message("replication: snapshot load failed: {}", loaded.error().message());
+                        return;
+                    }
+                    {
+                        std::lock_guard lock(mutex_);
+                        replid_ = snapshot_replid;
+                        offset_ = snapshot_offset;
+                    }
+                    pos += snapshot_bytes;
+                    snapshot_bytes = 0;
+                    continue;
+                }
+
+                size_t size = frame_size(view);
+                if (size == 0) break;
+                auto args = RequestParser::parse(view.first(size));
+                pos += size;
+                if (!args || args->empty()) {
+                    return;
+                }
+
+                if (!synced) {
+                    std::lock_guard lock(mutex_);
+                    if ((*args)[0] == "CONTINUE" && args->size() == 2 && (*args)[1] == replid_) {
+                        ++partial_resyncs_;
+                    } else if ((*args)[0] == "FULLRESYNC" && args->size() == 4) {
+                        // the snapshot may take a while to arrive now that the primary streams it; until it is
+                        // loaded we are still at the old replid/offset, both for offset() and for a reconnect
+                        snapshot_replid = (*args)[1];
+                        snapshot_offset = to_u64((*args)[2]);
+                        snapshot_bytes = to_u64((*args)[3]);
+                        ++full_resyncs_;
+                        if (snapshot_bytes == 0) {
+                            entry_manager_.clear_all();
+                            replid_ = snapshot_replid;
+                            offset_ = snapshot_offset;
+                        }
+                    } else {
+                        return;
+                    }
+                    connected_ = true;
+                    synced = true;
+                    log_message("replication: {} with {}:{} at offset {}", (*args)[0], options_.host, options_.port,
+                                (*args)[0] == "FULLRESYNC" ? snapshot_offset : offset_);
+                    continue;
+                }
+
+                response.clear();
+                CommandProcessor::process_command({*args, response, entry_manager_});
+                std::lock_guard lock(mutex_);
+                offset_ += size;
+                ++commands_applied_;
+            }
+            rbuf.erase(rbuf.begin(), rbuf.begin() + static_cast<ptrdiff_t>(pos));
+
+            auto now = std::chrono::steady_clock::now();
+            if (synced && now - last_ack >= options_.ack_interval) {
+                uint64_t at = offset();
+                out.clear();
+                std::vector<std::string> ack{"REPLCONF", "ACK", std::to_string(at)};
+                encode_command(out, ack);
+                if (!send_all(sock.get(), out)) {
+                    return;
+                }
+                std::lock_guard lock(mutex_);
+                apply_rate_ = static_cast<double>(at - offset_at_last_ack) /
+                              std::chrono::duration<double>(now - last_ack).count();
+                offset_at_last_ack = at;
+                last_ack = now;
+            }
+        }
+    }
+};
+
+#endif // REPLICATION_REPLICA_HPP
@@ -0,0 +1,367 @@
+#ifndef STATS_COMMAND_STATS_HPP
+#define STATS_COMMAND_STATS_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <bit>
+#include <algorithm>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+Per-command call counts and latency distributions, for INFO commandstats and LATENCY.
+
+Latencies go into log-linear histograms (the HDR histogram layout): values below 2^k_sub_bits get a bucket
+each, above that every power of two is split into 2^k_sub_bits linear sub-buckets, so any recorded value is
+known to within 1/32 (~3%) at a fixed 1920 buckets covering the whole uint64 range. Values are raw ticks
+(rdtsc on x86, steady_clock ns elsewhere), converted to time only when a report is built.
+
+Recording must not contend on the dispatch path, so histograms are per thread: each thread leases a shard on
+its first command and owns it until it exits, when the shard (and its data) is handed to the next new thread.
+A histogram has a single writer, which updates with relaxed load + store - no locked instructions - and readers
+merge all shards on demand. reset() doesn't touch the shards (that would race with their writers); it takes a
+merged baseline and later reports subtract it.
+
+Command ids are handed out by id(name) when the dispatcher builds its table, up to k_max_commands.
+*/
+
+class LatencyHistogram {
+public:
+    static constexpr unsigned k_sub_bits = 5;
+    static constexpr size_t k_sub = size_t{1} << k_sub_bits;
+    static constexpr size_t k_buckets = (64 - k_sub_bits + 1) * k_sub;
+
+    static size_t bucket(uint64_t v) noexcept {
+        if (v < k_sub) {
+            return static_cast<size_t>(v);
+        }
+        unsigned shift = static_cast<unsigned>(std::bit_width(v)) - 1 - k_sub_bits;
+        return ((shift + 1) << k_sub_bits) + static_cast<size_t>((v >> shift) & (k_sub - 1));
+    }
+
+    // smallest value that lands in bucket i, and the bucket's width
+    static uint64_t lower(size_t i) noexcept {
+        if (i < k_sub) {
+            return i;
+        }
+        unsigned shift = static_cast<unsigned>(i >> k_sub_bits) - 1;
+        return (k_sub + (i & (k_sub - 1))) << shift;
+    }
+
+    static uint64_t width(size_t i) noexcept {
+        return i < k_sub ? 1 : uint64_t{1} << ((i >> k_sub_bits) - 1);
+    }
+
+    // owner thread only
+    void record(uint64_t v) noexcept {
+        bump(counts_[bucket(v)], 1);
+        bump(calls_, 1);
+        bump(sum_, v);
+        if (v > max_.load(std::memory_order_relaxed)) {
+            max_.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    // plain counts, for merging and reporting
+    struct Snapshot {
+        std::vector<uint64_t> counts = std::vector<uint64_t>(k_buckets);
+        uint64_t calls = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        void add(const LatencyHistogram& h) {
+            for (size_t i = 0; i < k_buckets; ++i) counts[i] += h.counts_[i].load(std::memory_order_relaxed);
+            calls += h.calls_.load(std::memory_order_relaxed);
+            sum += h.sum_.load(std::memory_order_relaxed);
+            max = std::max(max, h.max_.load(std::memory_order_relaxed));
+        }
+
+        void subtract(const Snapshot& base) {
+            for (size_t i = 0; i < k_buckets; ++i) counts[i] -= base.counts[i];
+            calls -= base.calls;
+            sum -= base.sum;
+        }
+
+        // value at quantile q in [0, 1]: the midpoint of the bucket holding it, capped at the real max
+        [[nodiscard]] uint64_t quantile(double q) const {
+            if (calls == 0) return 0;
+            auto rank = static_cast<uint64_t>(q * static_cast<double>(calls - 1)) + 1;
+            if (rank >= calls) return max;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < k_buckets; ++i) {
+                seen += counts[i];
+                if (seen >= rank) return std::min(max, lower(i) + width(i) / 2);
+            }
+            return max;
+        }
+    };
+
+private:
+    static void bump(std::atomic<uint64_t>& a, uint64_t by) noexcept {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, k_buckets> counts_{};
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+class CommandStats {
+public:
+    static constexpr size_t k_max_commands = 64;
+
+    struct Summary {
+        std::string command;
+        uint64_t calls;
+        double usec;                    // total time spent in the command
+        double p50_us;
+        double p99_us;
+        double p999_us;
+        double max_us;                  // since start; not reset
+        double ops_per_sec;             // calls over the time since the last reset
+    };
+
+    static CommandStats& instance() {
+        static CommandStats stats;
+        return stats;
+    }
+
+    CommandStats(const CommandStats&) = delete;
+    CommandStats& operator=(const CommandStats&) = delete;
+
+    // the id `name` records under; ids past k_max_commands all share the last slot
+    size_t id(std::string_view name) {
+        std::lock_guard lock(names_mutex_);
+        for (size_t i = 0; i < names_.size(); ++i) {
+            if (names_[i] == name) return i;
+        }
+        if (names_.size() == k_max_commands - 1) {
+            names_.emplace_back("other");
+        }
+        if (names_.size() == k_max_commands) {
+            return k_max_commands - 1;
+        }
+        names_.emplace_back(name);
+        return names_.size() - 1;
+    }
+
+    [[nodiscard]] std::string name(size_t id) const {
+        std::lock_guard lock(names_mutex_);
+        return id < names_.size() ? names_[id] : std::string("unknown");
+    }
+
+    void set_enabled(bool on) noexcept { enabled_.store(on, std::memory_order_relaxed); }
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    static uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // one call of command `id` that took `ticks` (a difference of now() values)
+    void record(size_t id, uint64_t ticks) {
+        local().histogram(id).record(ticks);
+    }
+
+    // every command called since the last reset, most called first
+    [[nodiscard]] std::vector<Summary> summaries() const {
+        std::vector<std::string> names;
+        {
+            std::lock_guard lock(names_mutex_);
+            names = names_;
+        }
+        std::lock_guard lock(shards_mutex_);
+        double elapsed = std::chrono::duration<double>(Clock::now() - since_).count();
+        double ns = ns_per_tick();
+        std::vector<Summary> out;
+        for (size_t id = 0; id < names.size(); ++id) {
+            LatencyHistogram::Snapshot snap = merged(id);
+            if (id < baseline_.size()) snap.subtract(baseline_[id]);
+            if (snap.calls == 0) continue;
+            auto us = [&](uint64_t ticks) { return static_cast<double>(ticks) * ns / 1000.0; };
+            out.push_back({names[id], snap.calls, us(snap.sum), us(snap.quantile(0.5)), us(snap.quantile(0.99)),
+                           us(snap.quantile(0.999)), us(snap.max),
+                           static_cast<double>(snap.calls) / std::max(elapsed, 1e-3)});
+        }
+        std::sort(out.begin(), out.end(), [](const Summary& a, const Summary& b) { return a.calls > b.calls; });
+        return out;
+    }
+
+    // raw merged histograms per command, cumulative since start (ignoring reset()), for exporters whose
+    // counters must never go down
+    [[nodiscard]] std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> snapshots() const {
+        std::vector<std::string> names;
+        {
+            std::lock_guard lock(names_mutex_);
+            names = names_;
+        }
+        std::lock_guard lock(shards_mutex_);
+        std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> out;
+        for (size_t id = 0; id < names.size(); ++id) {
+            LatencyHistogram::Snapshot snap = merged(id);
+            if (snap.calls != 0) {
+                out.emplace_back(names[id], std::move(snap));
+            }
+        }
+        return out;
+    }
+
+    // INFO sections: "stats" and "commandstats" in the INFO line format
+    [[nodiscard]] std::string info(std::string_view section) const {
+        auto all = summaries();
+        std::string out;
+        char line[256];
+        if (section == "stats" || section.empty()) {
+            uint64_t calls = 0;
+            double ops = 0;
+            for (const auto& s : all) {
+                calls += s.calls;
+                ops += s.ops_per_sec;
+            }
+            std::snprintf(line, sizeof(line), "# Stats\r\ntotal_commands_processed:%llu\r\nops_per_sec:%.0f\r\n",
+                          static_cast<unsigned long long>(calls), ops);
+            out += line;
+        }
+        if (section == "commandstats" || section.empty()) {
+            out += "# Commandstats\r\n";
+            for (const auto& s : all) {
+                std::snprintf(line, sizeof(line),
+                              "cmdstat_%s:calls=%llu,usec=%.0f,usec_per_call=%.2f,p50=%.2f,p99=%.2f,p999=%.2f\r\n",
+                              s.command.c_str(), static_cast<unsigned long long>(s.calls), s.usec,
+                              s.usec / static_cast<double>(s.calls), s.p50_us, s.p99_us, s.p999_us);
+                out += line;
+            }
+        }
+        return out;
+    }
+
+    // "<command> calls=<n> ops/s=<n> p50=<us> p99=<us> p999=<us> max=<us>" per line, for LATENCY; all
+    // commands if `command` is empty
+    [[nodiscard]] std::string latency(std::string_view command) const {
+        std::string out;
+        char line[256];
+        for (const auto& s : summaries()) {
+            if (!command.empty() && s.command != command) continue;
+            std::snprintf(line, sizeof(line), "%s calls=%llu ops/s=%.0f p50=%.2fus p99=%.2fus p999=%.2fus max=%.2fus\n",
+                          s.command.c_str(), static_cast<unsigned long long>(s.calls), s.ops_per_sec, s.p50_us,
+                          s.p99_us, s.p999_us, s.max_us);
+            out += line;
+        }
+        return out;
+    }
+
+    void reset() {
+        size_t commands;
+        {
+            std::lock_guard lock(names_mutex_);
+            commands = names_.size();
+        }
+        std::lock_guard lock(shards_mutex_);
+        baseline_.resize(commands);
+        for (size_t id = 0; id < commands; ++id) {
+            baseline_[id] = merged(id);
+        }
+        since_ = Clock::now();
+    }
+
+    // calibrated once against steady_clock, on the first report
+    static double ns_per_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+        static const double ns = [] {
+            auto t0 = std::chrono::steady_clock::now();
+            uint64_t c0 = now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            auto t1 = std::chrono::steady_clock::now();
+            uint64_t c1 = now();
+            return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) /
+                   static_cast<double>(c1 - c0);
+        }();
+        return ns;
+#else
+        return 1.0;
+#endif
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ThreadShard {
+        std::array<std::atomic<LatencyHistogram*>, k_max_commands> histograms{};
+        std::atomic<bool> in_use{true};
+
+        ~ThreadShard() {
+            for (auto& h : histograms) delete h.load(std::memory_order_relaxed);
+        }
+
+        LatencyHistogram& histogram(size_t id) {
+            LatencyHistogram* h = histograms[id].load(std::memory_order_relaxed);
+            if (h == nullptr) {
+                h = new LatencyHistogram();
+                histograms[id].store(h, std::memory_order_release);
+            }
+            return *h;
+        }
+    };
+
+    // a thread's claim on a shard, released when the thread exits
+    struct Lease {
+        ThreadShard* shard;
+        explicit Lease(CommandStats& stats) : shard(stats.acquire()) {}
+        ~Lease() { shard->in_use.store(false, std::memory_order_release); }
+    };
+
+    CommandStats() = default;
+
+    ThreadShard& local() {
+        thread_local Lease lease(*this);
+        return *lease.shard;
+    }
+
+    ThreadShard* acquire() {
+        std::lock_guard lock(shards_mutex_);
+        for (auto& shard : shards_) {
+            bool idle = false;
+            if (shard->in_use.compare_exchange_strong(idle, true, std::memory_order_acquire)) {
+                return shard.get();
+            }
+        }
+        shards_.push_back(std::make_unique<ThreadShard>());
+        return shards_.back().get();
+    }
+
+    // caller holds shards_mutex_
+    LatencyHistogram::Snapshot merged(size_t id) const {
+        LatencyHistogram::Snapshot snap;
+        for (const auto& shard : shards_) {
+            if (const LatencyHistogram* h = shard->histograms[id].load(std::memory_order_acquire)) {
+                snap.add(*h);
+            }
+        }
+        return snap;
+    }
+
+    std::atomic<bool> enabled_{true};
+    mutable std::mutex names_mutex_;
+    std::vector<std::string> names_;
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<ThreadShard>> shards_;
+    std::vector<LatencyHistogram::Snapshot> baseline_;      // per command id, as of the last reset
+    Clock::time_point since_ = Clock::now();
+};
+
+#endif // STATS_COMMAND_STATS_HPP
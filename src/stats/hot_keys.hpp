@@ -0,0 +1,245 @@
+#ifndef STATS_HOT_KEYS_HPP
+#define STATS_HOT_KEYS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+/*
+Top-K heavy hitters over the keys commands touch, for the HOTKEYS command: when one key melts a shard the
+server should be able to say which.
+
+Space-Saving (Metwally et al.): each shard tracks at most `capacity` keys as (count, error) pairs in a min-heap
+by count. A tracked key increments its count; an untracked key evicts the minimum and takes over its count + 1,
+recording the inherited count as its error. Any key whose true frequency exceeds N / capacity is guaranteed
+to be tracked, and count - error <= true count <= count.
+
+Cheap enough for the dispatch path:
+    - sampling: each thread observes one command in `sample_rate` on average (a thread-local countdown with
+      a random reset, so periodic traffic can't alias with it). Unsampled calls cost a decrement.
+    - shards: keys are split over `shards` summaries by hash, each with its own mutex, so dispatch threads
+      rarely meet. A key lives in exactly one shard, which makes merging for top() a plain union.
+    - rates: counts are halved every `window`, and the time base with them, so count / elapsed is a rate
+      over roughly the last couple of windows that follows traffic shifts.
+
+Estimated request rate = count * sample_rate / elapsed. Set sample_rate to 0 to turn tracking off.
+*/
+
+class HotKeys {
+public:
+    struct Options {
+        size_t capacity = 256;                  // tracked keys per shard
+        size_t shards = 16;
+        uint32_t sample_rate = 16;              // observe 1 in N commands; 0 disables
+        std::chrono::milliseconds window{10000};
+    };
+
+    struct HotKey {
+        std::string key;
+        uint64_t count;                         // estimated requests (sampled count scaled by sample_rate)
+        uint64_t error;                         // count may overestimate by up to this much
+        double rate;                            // estimated requests per second
+    };
+
+    static HotKeys& instance() {
+        static HotKeys hot_keys;
+        return hot_keys;
+    }
+
+    HotKeys() : HotKeys(Options()) {}
+
+    explicit HotKeys(Options options) {
+        configure(options);
+    }
+
+    HotKeys(const HotKeys&) = delete;
+    HotKeys& operator=(const HotKeys&) = delete;
+
+    // drops everything tracked so far; not meant to race with observe()
+    void configure(Options options) {
+        options.shards = std::max<size_t>(1, options.shards);
+        options.capacity = std::max<size_t>(1, options.capacity);
+        shards_.clear();
+        for (size_t i = 0; i < options.shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>(options.capacity));
+        }
+        options_ = options;
+        sample_rate_.store(options.sample_rate, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint32_t sample_rate() const noexcept { return sample_rate_.load(std::memory_order_relaxed); }
+
+    // the dispatch path calls this for every keyed command
+    void observe(std::string_view key) {
+        uint32_t rate = sample_rate_.load(std::memory_order_relaxed);
+        if (rate == 0) {
+            return;
+        }
+        thread_local uint32_t countdown = 0;
+        thread_local uint64_t rng = 0x9e3779b97f4a7c15ull ^ reinterpret_cast<uintptr_t>(&countdown);
+        if (countdown > 1) {
+            --countdown;
+            return;
+        }
+        // next sample in 1..2*rate-1 calls: mean `rate`
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        countdown = rate == 1 ? 1 : 1 + static_cast<uint32_t>(rng % (2 * rate - 1));
+
+        size_t h = std::hash<std::string_view>{}(key);
+        shards_[h % shards_.size()]->observe(key, options_.window);
+    }
+
+    // the n hottest keys across all shards, hottest first
+    [[nodiscard]] std::vector<HotKey> top(size_t n) const {
+        std::vector<HotKey> all;
+        auto now = Clock::now();
+        uint64_t scale = std::max<uint32_t>(1, sample_rate());
+        for (const auto& shard : shards_) {
+            std::lock_guard lock(shard->mutex);
+            double elapsed = std::max(1e-3, std::chrono::duration<double>(now - shard->since).count());
+            for (const auto& counter : shard->heap) {
+                all.push_back({counter.key, counter.count * scale, counter.error * scale,
+                               static_cast<double>(counter.count * scale) / elapsed});
+            }
+        }
+        n = std::min(n, all.size());
+        std::partial_sort(all.begin(), all.begin() + static_cast<ptrdiff_t>(n), all.end(),
+                          [](const HotKey& a, const HotKey& b) { return a.count > b.count; });
+        all.resize(n);
+        return all;
+    }
+
+    // "<key> <est count> <rate/s> <error>" per line, for HOTKEYS
+    [[nodiscard]] std::string describe(size_t n) const {
+        std::string out;
+        for (const auto& hot : top(n)) {
+            out += hot.key;
+            out += ' ';
+            out += std::to_string(hot.count);
+            out += ' ';
+            out += std::to_string(static_cast<uint64_t>(hot.rate));
+            out += ' ';
+            out += std::to_string(hot.error);
+            out += '\n';
+        }
+        return out;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard lock(shard->mutex);
+            shard->heap.clear();
+            shard->index.clear();
+            shard->since = Clock::now();
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Counter {
+        std::string key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>{}(key); }
+    };
+
+    // one Space-Saving summary: min-heap by count, plus key -> heap position
+    struct Shard {
+        explicit Shard(size_t capacity) : capacity(capacity) {
+            heap.reserve(capacity);
+            index.reserve(capacity * 2);
+        }
+
+        std::mutex mutex;
+        size_t capacity;
+        std::vector<Counter> heap;
+        std::unordered_map<std::string, size_t, KeyHash, std::equal_to<>> index;
+        Clock::time_point since = Clock::now();
+        Clock::time_point next_decay = since;
+
+        void observe(std::string_view key, std::chrono::milliseconds window) {
+            std::lock_guard lock(mutex);
+            auto now = Clock::now();
+            if (now >= next_decay) {
+                decay(now);
+                next_decay = now + window;
+            }
+
+            if (auto it = index.find(key); it != index.end()) {
+                size_t i = it->second;
+                ++heap[i].count;
+                sift_down(i);
+            } else if (heap.size() < capacity) {
+                heap.push_back({std::string(key), 1, 0});
+                index.emplace(heap.back().key, heap.size() - 1);
+                sift_up(heap.size() - 1);
+            } else {
+                // replace the minimum; the newcomer inherits its count as error
+                auto evicted = index.find(heap[0].key);
+                index.erase(evicted);
+                uint64_t inherited = heap[0].count;
+                heap[0] = {std::string(key), inherited + 1, inherited};
+                index.emplace(heap[0].key, 0);
+                sift_down(0);
+            }
+        }
+
+        // halve counts and the time they were accumulated over, keeping count / elapsed; halving keeps
+        // the heap order
+        void decay(Clock::time_point now) {
+            for (auto& counter : heap) {
+                counter.count /= 2;
+                counter.error /= 2;
+            }
+            since = now - (now - since) / 2;
+        }
+
+        void swap_nodes(size_t a, size_t b) {
+            std::swap(heap[a], heap[b]);
+            index.find(heap[a].key)->second = a;
+            index.find(heap[b].key)->second = b;
+        }
+
+        void sift_up(size_t i) {
+            while (i > 0) {
+                size_t parent = (i - 1) / 2;
+                if (heap[parent].count <= heap[i].count) break;
+                swap_nodes(i, parent);
+                i = parent;
+            }
+        }
+
+        void sift_down(size_t i) {
+            while (true) {
+                size_t smallest = i;
+                size_t l = 2 * i + 1, r = l + 1;
+                if (l < heap.size() && heap[l].count < heap[smallest].count) smallest = l;
+                if (r < heap.size() && heap[r].count < heap[smallest].count) smallest = r;
+                if (smallest == i) break;
+                swap_nodes(i, smallest);
+                i = smallest;
+            }
+        }
+    };
+
+    Options options_;
+    std::atomic<uint32_t> sample_rate_{0};
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif // STATS_HOT_KEYS_HPP
@@ -0,0 +1,376 @@
+#ifndef STATS_LOCK_PROFILER_HPP
+#define STATS_LOCK_PROFILER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <algorithm>
+#include "command_stats.hpp"
+
+/*
+Lock contention profiling for the data structures' mutexes, compiled in with -DVECTORDB_LOCK_PROFILING.
+
+A profiled mutex is declared as SiteMutex<std::shared_mutex> (or <std::mutex>) with a site name, e.g. "heap" or
+"htable.bucket". Every mutex with the same name reports as one site, so all the bucket locks of all HTables
+add up to a single line. Without the flag, SiteMutex is the plain mutex with a constructor that ignores the
+name, so default builds pay nothing.
+
+With the flag, an acquisition tries the lock first. Only when that fails does it read the clock, block, and
+read the clock again, so an uncontended acquisition costs a try_lock, one rdtsc for the hold start and a few
+counter bumps. For each site we record:
+    - acquisitions, exclusive and shared
+    - contended acquisitions (the try failed)
+    - wait time of the contended ones
+    - hold time
+The holder of an exclusive lock keeps its start tick in the mutex itself. Shared holders push theirs on a
+small thread-local stack.
+
+Counters and histograms are per thread, leased the same way CommandStats leases its shards, so recording
+adds no cache-line traffic of its own between the threads it is measuring. report() merges the shards, and
+reset() takes a baseline.
+*/
+
+class LockProfiler {
+public:
+    static constexpr size_t k_max_sites = 32;
+
+    struct Summary {
+        std::string site;
+        uint64_t exclusive;
+        uint64_t shared;
+        uint64_t contended;
+        double wait_us;                 // total time spent blocked
+        double wait_p50_us;             // over contended acquisitions only
+        double wait_p99_us;
+        double wait_max_us;             // since start; not reset
+        double hold_p50_us;
+        double hold_p99_us;
+        double hold_max_us;             // since start; not reset
+    };
+
+    static LockProfiler& instance() {
+        static LockProfiler profiler;
+        return profiler;
+    }
+
+    LockProfiler(const LockProfiler&) = delete;
+    LockProfiler& operator=(const LockProfiler&) = delete;
+
+    // the id `name` records under; sites past k_max_sites all share the last slot
+    size_t site(std::string_view name) {
+        std::lock_guard lock(names_mutex_);
+        for (size_t i = 0; i < names_.size(); ++i) {
+            if (names_[i] == name) return i;
+        }
+        if (names_.size() == k_max_sites - 1) {
+            names_.emplace_back("other");
+        }
+        if (names_.size() == k_max_sites) {
+            return k_max_sites - 1;
+        }
+        names_.emplace_back(name);
+        return names_.size() - 1;
+    }
+
+    // one acquisition at `site`; `wait` is 0 unless it was contended
+    void acquired(size_t site, bool shared, bool contended, uint64_t wait) {
+        SiteCounters& c = local().counters(site);
+        bump(shared ? c.shared : c.exclusive);
+        if (contended) {
+            bump(c.contended);
+            c.wait.record(wait);
+        }
+    }
+
+    void released(size_t site, uint64_t held) {
+        local().counters(site).hold.record(held);
+    }
+
+    // every site acquired since the last reset, most total wait first
+    [[nodiscard]] std::vector<Summary> summaries() const {
+        std::vector<std::string> names;
+        {
+            std::lock_guard lock(names_mutex_);
+            names = names_;
+        }
+        std::lock_guard lock(shards_mutex_);
+        double ns = CommandStats::ns_per_tick();
+        auto us = [&](uint64_t ticks) { return static_cast<double>(ticks) * ns / 1000.0; };
+        std::vector<Summary> out;
+        for (size_t id = 0; id < names.size(); ++id) {
+            SiteSnapshot snap = merged(id);
+            if (id < baseline_.size()) snap.subtract(baseline_[id]);
+            if (snap.exclusive + snap.shared == 0) continue;
+            out.push_back({names[id], snap.exclusive, snap.shared, snap.contended, us(snap.wait.sum),
+                           us(snap.wait.quantile(0.5)), us(snap.wait.quantile(0.99)), us(snap.wait.max),
+                           us(snap.hold.quantile(0.5)), us(snap.hold.quantile(0.99)), us(snap.hold.max)});
+        }
+        std::sort(out.begin(), out.end(), [](const Summary& a, const Summary& b) { return a.wait_us > b.wait_us; });
+        return out;
+    }
+
+    // one line per site, for LOCKSTATS and benchmark output
+    [[nodiscard]] std::string report() const {
+        std::string out;
+        char line[384];
+        for (const auto& s : summaries()) {
+            uint64_t total = s.exclusive + s.shared;
+            std::snprintf(line, sizeof(line),
+                          "%s acquisitions=%llu shared=%llu contended=%llu (%.2f%%) wait=%.0fus wait_p50=%.2fus "
+                          "wait_p99=%.2fus wait_max=%.2fus hold_p50=%.2fus hold_p99=%.2fus hold_max=%.2fus\n",
+                          s.site.c_str(), static_cast<unsigned long long>(total),
+                          static_cast<unsigned long long>(s.shared), static_cast<unsigned long long>(s.contended),
+                          100.0 * static_cast<double>(s.contended) / static_cast<double>(total), s.wait_us,
+                          s.wait_p50_us, s.wait_p99_us, s.wait_max_us, s.hold_p50_us, s.hold_p99_us, s.hold_max_us);
+            out += line;
+        }
+        return out;
+    }
+
+    void reset() {
+        size_t sites;
+        {
+            std::lock_guard lock(names_mutex_);
+            sites = names_.size();
+        }
+        std::lock_guard lock(shards_mutex_);
+        baseline_.resize(sites);
+        for (size_t id = 0; id < sites; ++id) {
+            baseline_[id] = merged(id);
+        }
+    }
+
+    static constexpr bool compiled_in() noexcept {
+#ifdef VECTORDB_LOCK_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    struct SiteCounters {
+        std::atomic<uint64_t> exclusive{0};
+        std::atomic<uint64_t> shared{0};
+        std::atomic<uint64_t> contended{0};
+        LatencyHistogram wait;
+        LatencyHistogram hold;
+    };
+
+    struct SiteSnapshot {
+        uint64_t exclusive = 0;
+        uint64_t shared = 0;
+        uint64_t contended = 0;
+        LatencyHistogram::Snapshot wait;
+        LatencyHistogram::Snapshot hold;
+
+        void add(const SiteCounters& c) {
+            exclusive += c.exclusive.load(std::memory_order_relaxed);
+            shared += c.shared.load(std::memory_order_relaxed);
+            contended += c.contended.load(std::memory_order_relaxed);
+            wait.add(c.wait);
+            hold.add(c.hold);
+        }
+
+        void subtract(const SiteSnapshot& base) {
+            exclusive -= base.exclusive;
+            shared -= base.shared;
+            contended -= base.contended;
+            wait.subtract(base.wait);
+            hold.subtract(base.hold);
+        }
+    };
+
+    struct ThreadShard {
+        std::array<std::atomic<SiteCounters*>, k_max_sites> sites{};
+        std::atomic<bool> in_use{true};
+
+        ~ThreadShard() {
+            for (auto& s : sites) delete s.load(std::memory_order_relaxed);
+        }
+
+        SiteCounters& counters(size_t id) {
+            SiteCounters* c = sites[id].load(std::memory_order_relaxed);
+            if (c == nullptr) {
+                c = new SiteCounters();
+                sites[id].store(c, std::memory_order_release);
+            }
+            return *c;
+        }
+    };
+
+    // a thread's claim on a shard, released when the thread exits
+    struct Lease {
+        ThreadShard* shard;
+        explicit Lease(LockProfiler& profiler) : shard(profiler.acquire()) {}
+        ~Lease() { shard->in_use.store(false, std::memory_order_release); }
+    };
+
+    LockProfiler() = default;
+
+    // single writer per shard, so no locked instructions
+    static void bump(std::atomic<uint64_t>& a) noexcept {
+        a.store(a.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    ThreadShard& local() {
+        thread_local Lease lease(*this);
+        return *lease.shard;
+    }
+
+    ThreadShard* acquire() {
+        std::lock_guard lock(shards_mutex_);
+        for (auto& shard : shards_) {
+            bool idle = false;
+            if (shard->in_use.compare_exchange_strong(idle, true, std::memory_order_acquire)) {
+                return shard.get();
+            }
+        }
+        shards_.push_back(std::make_unique<ThreadShard>());
+        return shards_.back().get();
+    }
+
+    // caller holds shards_mutex_
+    SiteSnapshot merged(size_t id) const {
+        SiteSnapshot snap;
+        for (const auto& shard : shards_) {
+            if (const SiteCounters* c = shard->sites[id].load(std::memory_order_acquire)) {
+                snap.add(*c);
+            }
+        }
+        return snap;
+    }
+
+    mutable std::mutex names_mutex_;
+    std::vector<std::string> names_;
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<ThreadShard>> shards_;
+    std::vector<SiteSnapshot> baseline_;                // per site id, as of the last reset
+};
+
+#ifdef VECTORDB_LOCK_PROFILING
+
+// a Mutex or SharedMutex that reports its acquisitions to LockProfiler under a site name
+template<typename M>
+class SiteMutex {
+public:
+    explicit SiteMutex(std::string_view site) : site_(LockProfiler::instance().site(site)) {}
+
+    SiteMutex(const SiteMutex&) = delete;
+    SiteMutex& operator=(const SiteMutex&) = delete;
+
+    void lock() {
+        bool contended = !mutex_.try_lock();
+        uint64_t wait = 0;
+        if (contended) {
+            uint64_t t0 = CommandStats::now();
+            mutex_.lock();
+            wait = CommandStats::now() - t0;
+        }
+        held_since_ = CommandStats::now();
+        LockProfiler::instance().acquired(site_, false, contended, wait);
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        held_since_ = CommandStats::now();
+        LockProfiler::instance().acquired(site_, false, false, 0);
+        return true;
+    }
+
+    void unlock() {
+        uint64_t held = CommandStats::now() - held_since_;
+        mutex_.unlock();
+        LockProfiler::instance().released(site_, held);
+    }
+
+    void lock_shared() requires requires(M& m) { m.lock_shared(); } {
+        bool contended = !mutex_.try_lock_shared();
+        uint64_t wait = 0;
+        if (contended) {
+            uint64_t t0 = CommandStats::now();
+            mutex_.lock_shared();
+            wait = CommandStats::now() - t0;
+        }
+        push_shared();
+        LockProfiler::instance().acquired(site_, true, contended, wait);
+    }
+
+    bool try_lock_shared() requires requires(M& m) { m.lock_shared(); } {
+        if (!mutex_.try_lock_shared()) {
+            return false;
+        }
+        push_shared();
+        LockProfiler::instance().acquired(site_, true, false, 0);
+        return true;
+    }
+
+    void unlock_shared() requires requires(M& m) { m.lock_shared(); } {
+        uint64_t since = pop_shared();
+        uint64_t held = since == 0 ? 0 : CommandStats::now() - since;
+        mutex_.unlock_shared();
+        if (since != 0) {
+            LockProfiler::instance().released(site_, held);
+        }
+    }
+
+private:
+    // shared holds this thread has open; deeper nesting than this goes untimed
+    struct SharedHolds {
+        std::array<std::pair<const void*, uint64_t>, 16> held;
+        size_t depth = 0;
+    };
+
+    static SharedHolds& shared_holds() {
+        thread_local SharedHolds holds;
+        return holds;
+    }
+
+    void push_shared() {
+        SharedHolds& h = shared_holds();
+        if (h.depth < h.held.size()) {
+            h.held[h.depth++] = {this, CommandStats::now()};
+        }
+    }
+
+    // start tick of this thread's innermost shared hold on this mutex, 0 if untimed
+    uint64_t pop_shared() {
+        SharedHolds& h = shared_holds();
+        for (size_t i = h.depth; i-- > 0;) {
+            if (h.held[i].first == this) {
+                uint64_t since = h.held[i].second;
+                std::copy(h.held.begin() + static_cast<std::ptrdiff_t>(i) + 1,
+                          h.held.begin() + static_cast<std::ptrdiff_t>(h.depth), h.held.begin() + static_cast<std::ptrdiff_t>(i));
+                --h.depth;
+                return since;
+            }
+        }
+        return 0;
+    }
+
+    M mutex_;
+    size_t site_;
+    uint64_t held_since_ = 0;                           // written and read by the exclusive holder only
+};
+
+#else
+
+// profiling compiled out: the plain mutex, named for nobody
+template<typename M>
+class SiteMutex : public M {
+public:
+    explicit SiteMutex(std::string_view) {}
+};
+
+#endif
+
+#endif // STATS_LOCK_PROFILER_HPP
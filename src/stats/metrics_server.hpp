@@ -0,0 +1,291 @@
+#ifndef STATS_METRICS_SERVER_HPP
+#define STATS_METRICS_SERVER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <expected>
+#include <system_error>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../../socket.hpp"
+#include "../../logging.hpp"
+#include "command_stats.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Prometheus text-format metrics over HTTP, on an admin port of its own (127.0.0.1 unless told otherwise).
+
+The listener runs on its own thread and never touches the data-path poll loop: each scrape (GET /metrics)
+calls the collector, which reads counters the rest of the server keeps in atomics or per-thread shards
+(CommandStats, EntryManager::keyspace_stats, ThreadPool::queue_depth, ...). Nothing a collector reads may be
+guarded by a lock a command handler takes - a slow scrape must not stall requests.
+
+HTTP support is the minimum a scraper needs: one request per connection, answered with Connection: close.
+Anything but GET /metrics gets a 404 (or 405 for other methods).
+*/
+
+// builds a text-format exposition
+class MetricsWriter {
+public:
+    // starts a metric family; its samples follow
+    void family(std::string_view name, std::string_view type, std::string_view help) {
+        out_ += "# HELP ";
+        out_ += name;
+        out_ += ' ';
+        out_ += help;
+        out_ += "\n# TYPE ";
+        out_ += name;
+        out_ += ' ';
+        out_ += type;
+        out_ += '\n';
+    }
+
+    // `labels` is the inside of the braces, e.g. command="get"; empty for none
+    void sample(std::string_view name, std::string_view labels, double value) {
+        out_ += name;
+        if (!labels.empty()) {
+            out_ += '{';
+            out_ += labels;
+            out_ += '}';
+        }
+        char number[32];
+        std::snprintf(number, sizeof(number), " %.15g\n", value);
+        out_ += number;
+    }
+
+    // a LatencyHistogram re-bucketed onto fixed `le` bounds in seconds, plus _sum and _count
+    void histogram(std::string_view name, std::string_view labels, const LatencyHistogram::Snapshot& snap,
+                   double seconds_per_tick) {
+        static constexpr std::array<double, 19> k_bounds{
+            1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3,
+            2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0};
+        std::string bucket_name = std::string(name) + "_bucket";
+        std::string prefix = labels.empty() ? std::string() : std::string(labels) + ",";
+        uint64_t cumulative = 0;
+        size_t i = 0;
+        char le[48];
+        for (double bound : k_bounds) {
+            // a histogram bucket counts towards `le` if its midpoint does (the value quantile() reports for it),
+            // so a bound inside a bucket is off by at most the bucket's ~3%
+            for (; i < LatencyHistogram::k_buckets; ++i) {
+                double mid = static_cast<double>(LatencyHistogram::lower(i) + LatencyHistogram::width(i) / 2);
+                if (mid * seconds_per_tick > bound) break;
+                cumulative += snap.counts[i];
+            }
+            std::snprintf(le, sizeof(le), "le=\"%g\"", bound);
+            sample(bucket_name, prefix + le, static_cast<double>(cumulative));
+        }
+        sample(bucket_name, prefix + "le=\"+Inf\"", static_cast<double>(snap.calls));
+        sample(std::string(name) + "_sum", labels, static_cast<double>(snap.sum) * seconds_per_tick);
+        sample(std::string(name) + "_count", labels, static_cast<double>(snap.calls));
+    }
+
+    [[nodiscard]] const std::string& text() const noexcept { return out_; }
+
+private:
+    std::string out_;
+};
+
+// per-command call counters and latency histograms, cumulative since start
+inline void write_command_metrics(MetricsWriter& w) {
+    auto snapshots = CommandStats::instance().snapshots();
+    w.family("vectordb_commands_total", "counter", "Commands processed, by command.");
+    for (const auto& [command, snap] : snapshots) {
+        w.sample("vectordb_commands_total", "command=\"" + command + "\"", static_cast<double>(snap.calls));
+    }
+    w.family("vectordb_command_duration_seconds", "histogram", "Time spent executing a command, by command.");
+    double seconds_per_tick = CommandStats::ns_per_tick() / 1e9;
+    for (const auto& [command, snap] : snapshots) {
+        w.histogram("vectordb_command_duration_seconds", "command=\"" + command + "\"", snap, seconds_per_tick);
+    }
+}
+
+// resident and virtual memory of this process, from /proc/self/statm
+inline void write_process_metrics(MetricsWriter& w) {
+    unsigned long long pages = 0, resident = 0;
+    if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%llu %llu", &pages, &resident) != 2) {
+            pages = resident = 0;
+        }
+        std::fclose(f);
+    }
+    double page = static_cast<double>(::sysconf(_SC_PAGESIZE));
+    w.family("vectordb_process_resident_memory_bytes", "gauge", "Resident set size.");
+    w.sample("vectordb_process_resident_memory_bytes", "", static_cast<double>(resident) * page);
+    w.family("vectordb_process_virtual_memory_bytes", "gauge", "Virtual memory size.");
+    w.sample("vectordb_process_virtual_memory_bytes", "", static_cast<double>(pages) * page);
+}
+
+class MetricsServer {
+public:
+    struct Options {
+        uint16_t port = 0;                      // 0: pick a free port (see port())
+        std::string bind = "127.0.0.1";
+    };
+
+    using Collector = std::function<void(MetricsWriter&)>;
+
+    static Result<std::unique_ptr<MetricsServer>> start(Options options, Collector collect) {
+        std::unique_ptr<MetricsServer> server(new MetricsServer(std::move(options), std::move(collect)));
+        if (auto r = server->listen(); !r) {
+            return std::unexpected(r.error());
+        }
+        server->thread_ = std::thread(&MetricsServer::run, server.get());
+        return server;
+    }
+
+    ~MetricsServer() {
+        stop_ = true;
+        char c = 1;
+        (void)!::write(wake_fds_[1], &c, 1);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        ::close(wake_fds_[0]);
+        ::close(wake_fds_[1]);
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    [[nodiscard]] uint16_t port() const noexcept { return port_; }
+    [[nodiscard]] uint64_t scrapes() const noexcept { return scrapes_.load(std::memory_order_relaxed); }
+
+private:
+    Options options_;
+    Collector collect_;
+    Socket listen_socket_{-1};
+    uint16_t port_{0};
+    int wake_fds_[2]{-1, -1};
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> scrapes_{0};
+
+    MetricsServer(Options options, Collector collect) : options_(std::move(options)), collect_(std::move(collect)) {}
+
+    Result<void> listen() {
+        if (::pipe2(wake_fds_, O_NONBLOCK | O_CLOEXEC) < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        Socket sock(::socket(AF_INET, SOCK_STREAM, 0));
+        if (sock.get() < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        int val = 1;
+        ::setsockopt(sock.get(), SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options_.port);
+        if (::inet_pton(AF_INET, options_.bind.c_str(), &addr.sin_addr) != 1) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        if (::bind(sock.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(sock.get(), 16) < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(sock.get(), reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        if (auto r = sock.set_nonblocking(); !r) {
+            return std::unexpected(r.error());
+        }
+        listen_socket_ = std::move(sock);
+        log_message("metrics: serving /metrics on {}:{}", options_.bind, port_);
+        return {};
+    }
+
+    void run() {
+        while (!stop_) {
+            pollfd fds[2] = {{listen_socket_.get(), POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+            if (::poll(fds, 2, 1000) < 0 && errno != EINTR) {
+                log_message("metrics: poll failed: {}", std::strerror(errno));
+                return;
+            }
+            if (!(fds[0].revents & POLLIN)) {
+                continue;
+            }
+            while (!stop_) {
+                int fd = ::accept(listen_socket_.get(), nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                Socket client(fd);
+                serve(client);
+            }
+        }
+    }
+
+    // one request, one response; a scraper that stalls for a second is dropped
+    void serve(Socket& client) {
+        timeval timeout{1, 0};
+        ::setsockopt(client.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(client.get(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::string request;
+        char buffer[2048];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            ssize_t n = ::recv(client.get(), buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        std::string_view line(request);
+        line = line.substr(0, line.find("\r\n"));
+        std::string_view method = line.substr(0, line.find(' '));
+        std::string_view target = line.substr(std::min(line.size(), method.size() + 1));
+        target = target.substr(0, target.find(' '));
+        target = target.substr(0, target.find('?'));
+
+        if (method != "GET") {
+            return respond(client, "405 Method Not Allowed", "text/plain", "method not allowed\n");
+        }
+        if (target != "/metrics") {
+            return respond(client, "404 Not Found", "text/plain", "try /metrics\n");
+        }
+        MetricsWriter writer;
+        collect_(writer);
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+        respond(client, "200 OK", "text/plain; version=0.0.4; charset=utf-8", writer.text());
+    }
+
+    static void respond(Socket& client, std::string_view status, std::string_view type, std::string_view body) {
+        std::string response = "HTTP/1.1 ";
+        response += status;
+        response += "\r\nContent-Type: ";
+        response += type;
+        response += "\r\nContent-Length: ";
+        response += std::to_string(body.size());
+        response += "\r\nConnection: close\r\n\r\n";
+        response += body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = ::send(client.get(), response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+};
+
+#endif // STATS_METRICS_SERVER_HPP
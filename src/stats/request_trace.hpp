@@ -0,0 +1,212 @@
+#ifndef STATS_REQUEST_TRACE_HPP
+#define STATS_REQUEST_TRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include "command_stats.hpp"
+
+/*
+Sampled per-request lifecycle tracing: where a request's time goes between the socket and the socket.
+
+A traced request carries a RequestTrace through the connection and the dispatcher, which stamp it with
+CommandStats::now() (rdtsc) at each stage boundary:
+
+    ReadStart -> ReadEnd -> Parsed -> HandlerEnter -> HandlerExit -> Serialized -> Flushed
+       read        parse     dispatch      execute       serialize       write
+
+Disabled (sample_rate 0) costs one relaxed load per request in begin(). Enabled, each thread samples one
+request in sample_rate on average (a thread-local countdown with a random reset, as HotKeys does); unsampled
+requests pay a decrement, and every stamp on them is a branch on `active`.
+
+Finished traces go into a per-thread ring of `buffer` entries, so tracing threads never share a cache line;
+its mutex is only ever contended by dump(). dump() renders everything buffered as Chrome trace-event JSON
+(load it in chrome://tracing or Perfetto): one complete ("X") event per stage, per request, on the thread
+that served it, with the command and client fd as args.
+*/
+
+struct RequestTrace {
+    enum Stage : uint8_t { ReadStart, ReadEnd, Parsed, HandlerEnter, HandlerExit, Serialized, Flushed, k_stages };
+
+    bool active = false;
+    int client_fd = -1;
+    uint32_t command_id = UINT32_MAX;           // CommandStats id, once dispatched
+    std::array<uint64_t, k_stages> ticks{};
+
+    void stamp(Stage stage) noexcept {
+        if (active) [[unlikely]] {
+            ticks[stage] = CommandStats::now();
+        }
+    }
+};
+
+class RequestTracer {
+public:
+    struct Options {
+        uint32_t sample_rate = 0;               // trace 1 in N requests per thread; 0 disables
+        size_t buffer = 4096;                   // traces kept per thread, newest win
+    };
+
+    static RequestTracer& instance() {
+        static RequestTracer tracer;
+        return tracer;
+    }
+
+    RequestTracer(const RequestTracer&) = delete;
+    RequestTracer& operator=(const RequestTracer&) = delete;
+
+    // not meant to race with tracing threads; buffered traces are dropped
+    void configure(Options options) {
+        std::lock_guard lock(threads_mutex_);
+        options_ = options;
+        options_.buffer = std::max<size_t>(1, options_.buffer);
+        for (auto& buffer : threads_) {
+            std::lock_guard buffer_lock(buffer->mutex);
+            buffer->traces.clear();
+            buffer->next = 0;
+        }
+        sample_rate_.store(options.sample_rate, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint32_t sample_rate() const noexcept { return sample_rate_.load(std::memory_order_relaxed); }
+
+    // start of a request: decides whether it is traced, and stamps ReadStart if so
+    void begin(RequestTrace& trace, int client_fd) {
+        trace.active = false;
+        uint32_t rate = sample_rate_.load(std::memory_order_relaxed);
+        if (rate == 0) [[likely]] {
+            return;
+        }
+        thread_local uint32_t countdown = 0;
+        thread_local uint64_t rng = 0x9e3779b97f4a7c15ull ^ reinterpret_cast<uintptr_t>(&countdown);
+        if (countdown > 1) {
+            --countdown;
+            return;
+        }
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        countdown = rate == 1 ? 1 : 1 + static_cast<uint32_t>(rng % (2 * rate - 1));
+
+        trace.active = true;
+        trace.client_fd = client_fd;
+        trace.command_id = UINT32_MAX;
+        trace.ticks.fill(0);
+        trace.stamp(RequestTrace::ReadStart);
+    }
+
+    // end of a request: stamps Flushed and buffers the trace
+    void finish(RequestTrace& trace) {
+        if (!trace.active) [[likely]] {
+            return;
+        }
+        trace.stamp(RequestTrace::Flushed);
+        trace.active = false;
+        ThreadBuffer& buffer = local();
+        std::lock_guard lock(buffer.mutex);
+        if (buffer.traces.size() < options_.buffer) {
+            buffer.traces.push_back(trace);
+        } else {
+            buffer.traces[buffer.next] = trace;
+            buffer.next = (buffer.next + 1) % buffer.traces.size();
+        }
+    }
+
+    [[nodiscard]] size_t buffered() const {
+        std::lock_guard lock(threads_mutex_);
+        size_t n = 0;
+        for (const auto& buffer : threads_) {
+            std::lock_guard buffer_lock(buffer->mutex);
+            n += buffer->traces.size();
+        }
+        return n;
+    }
+
+    // every buffered trace as Chrome trace-event JSON; timestamps in microseconds from the earliest trace
+    [[nodiscard]] std::string dump() const {
+        static constexpr std::array<std::string_view, RequestTrace::k_stages - 1> k_spans{
+            "read", "parse", "dispatch", "execute", "serialize", "write"};
+        struct Row {
+            uint32_t tid;
+            RequestTrace trace;
+        };
+        std::vector<Row> rows;
+        {
+            std::lock_guard lock(threads_mutex_);
+            for (const auto& buffer : threads_) {
+                std::lock_guard buffer_lock(buffer->mutex);
+                for (const auto& trace : buffer->traces) rows.push_back({buffer->tid, trace});
+            }
+        }
+        uint64_t base = UINT64_MAX;
+        for (const auto& row : rows) base = std::min(base, row.trace.ticks[RequestTrace::ReadStart]);
+        double us_per_tick = CommandStats::ns_per_tick() / 1000.0;
+
+        std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        char event[384];
+        for (const auto& [tid, trace] : rows) {
+            std::string command = trace.command_id == UINT32_MAX ? std::string("none")
+                                                                  : CommandStats::instance().name(trace.command_id);
+            for (size_t s = 0; s + 1 < RequestTrace::k_stages; ++s) {
+                uint64_t from = trace.ticks[s], to = trace.ticks[s + 1];
+                if (from == 0 || to < from) continue; // stage not reached (e.g. no handler for a bad request)
+                std::snprintf(event, sizeof(event),
+                              "%s{\"name\":\"%.*s\",\"cat\":\"request\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                              "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"command\":\"%s\",\"fd\":%d}}",
+                              first ? "" : ",", static_cast<int>(k_spans[s].size()), k_spans[s].data(), tid,
+                              static_cast<double>(from - base) * us_per_tick,
+                              static_cast<double>(to - from) * us_per_tick, command.c_str(), trace.client_fd);
+                out += event;
+                first = false;
+            }
+        }
+        out += "]}";
+        return out;
+    }
+
+    void clear() {
+        std::lock_guard lock(threads_mutex_);
+        for (auto& buffer : threads_) {
+            std::lock_guard buffer_lock(buffer->mutex);
+            buffer->traces.clear();
+            buffer->next = 0;
+        }
+    }
+
+private:
+    struct ThreadBuffer {
+        std::mutex mutex;                       // owner vs dump() only
+        uint32_t tid;
+        std::vector<RequestTrace> traces;
+        size_t next = 0;                        // oldest entry once full
+    };
+
+    RequestTracer() = default;
+
+    // buffers outlive their threads so dump() still sees what they traced
+    ThreadBuffer& local() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard lock(threads_mutex_);
+            threads_.push_back(std::make_unique<ThreadBuffer>());
+            buffer = threads_.back().get();
+            buffer->tid = static_cast<uint32_t>(threads_.size());
+        }
+        return *buffer;
+    }
+
+    Options options_;
+    std::atomic<uint32_t> sample_rate_{0};
+    mutable std::mutex threads_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads_;
+};
+
+#endif // STATS_REQUEST_TRACE_HPP
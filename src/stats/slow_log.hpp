@@ -0,0 +1,225 @@
+#ifndef STATS_SLOW_LOG_HPP
+#define STATS_SLOW_LOG_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include "command_stats.hpp"
+
+/*
+SLOWLOG: the last `capacity` commands that ran longer than a threshold, with enough of their arguments to
+tell which request it was.
+
+The dispatch path already has the command's duration in ticks (see CommandStats), so the per-request cost is
+maybe_record(): one relaxed load of the threshold and a compare. Only a slow command goes further.
+
+The ring is lock-free. A writer takes a sequence number with fetch_add on head_; the slot is seq % capacity.
+Each slot is a seqlock: the writer CASes the slot's version from even (stable) to odd, writes the record, and
+stores the next even version. Readers copy the record and retry (or skip) if the version moved under them.
+If another writer still holds the slot (the ring wrapped while it was mid-write), the record is dropped and
+counted in dropped() rather than waiting. Record fields are relaxed atomic words, so the racy copy readers make
+is well defined.
+
+Arguments are captured like Redis does, within a fixed 256-byte slot: at most k_max_args of them, each cut to
+k_max_arg_bytes with a "... (N more bytes)" note, and a "... (N more arguments)" entry if some didn't fit.
+*/
+
+class SlowLog {
+public:
+    static constexpr size_t k_max_args = 16;
+    static constexpr size_t k_max_arg_bytes = 64;
+
+    struct Options {
+        int64_t threshold_us = 10000;           // log commands slower than this; -1 disables, 0 logs everything
+        size_t capacity = 128;                  // records kept; rounded up to a power of two
+    };
+
+    struct Record {
+        uint64_t id;                            // increases by one per slow command since start
+        uint64_t timestamp_us;                  // unix time the command finished
+        uint64_t duration_us;
+        std::string command;
+        std::vector<std::string> args;          // args[0] is the command as sent
+        int client_fd;                          // -1 for commands without a client (raft apply, replication)
+    };
+
+    static SlowLog& instance() {
+        static SlowLog slow_log;
+        return slow_log;
+    }
+
+    SlowLog() : SlowLog(Options()) {}
+
+    explicit SlowLog(Options options) {
+        configure(options);
+    }
+
+    SlowLog(const SlowLog&) = delete;
+    SlowLog& operator=(const SlowLog&) = delete;
+
+    // drops every record; not meant to race with maybe_record()
+    void configure(Options options) {
+        size_t capacity = std::bit_ceil(std::max<size_t>(1, options.capacity));
+        slots_ = std::make_unique<Slot[]>(capacity);
+        mask_ = capacity - 1;
+        head_.store(0, std::memory_order_relaxed);
+        reset_at_.store(0, std::memory_order_relaxed);
+        threshold_ticks_.store(to_ticks(options.threshold_us), std::memory_order_relaxed);
+        threshold_us_ = options.threshold_us;
+    }
+
+    [[nodiscard]] bool enabled() const noexcept {
+        return threshold_ticks_.load(std::memory_order_relaxed) != k_disabled;
+    }
+
+    [[nodiscard]] int64_t threshold_us() const noexcept { return threshold_us_; }
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+    [[nodiscard]] uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    // every dispatched command comes through here; all but the slow ones leave after one compare
+    void maybe_record(size_t command_id, const std::vector<std::string>& args, uint64_t ticks, int client_fd) {
+        if (ticks < threshold_ticks_.load(std::memory_order_relaxed)) [[likely]] {
+            return;
+        }
+        record(command_id, args, ticks, client_fd);
+    }
+
+    // the newest `n` records, newest first
+    [[nodiscard]] std::vector<Record> get(size_t n) const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t oldest = std::max(reset_at_.load(std::memory_order_relaxed), head > capacity() ? head - capacity() : 0);
+        std::vector<Record> out;
+        for (uint64_t seq = head; seq > oldest && out.size() < n; --seq) {
+            Payload payload;
+            if (slots_[(seq - 1) & mask_].read(seq - 1, payload)) {
+                out.push_back(decode(payload));
+            }
+        }
+        return out;
+    }
+
+    // records currently readable
+    [[nodiscard]] size_t size() const {
+        return get(capacity()).size();
+    }
+
+    // later GETs only see commands logged after this
+    void reset() {
+        reset_at_.store(head_.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint64_t k_disabled = UINT64_MAX;
+    static constexpr size_t k_text_bytes = 256;
+    static constexpr size_t k_words = 5 + k_text_bytes / 8;
+
+    // a record as plain words: seq, timestamp, duration ticks, command id | fd << 32, text length, text
+    struct Payload {
+        uint64_t words[k_words];
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> version{0};       // odd while being written; 2 * (seq + 1) once seq is in
+        std::atomic<uint64_t> words[k_words]{};
+
+        bool write(uint64_t seq, const Payload& payload) {
+            uint64_t v = version.load(std::memory_order_relaxed);
+            // busy, or a newer lap of the ring already wrote here
+            if ((v & 1) || v > 2 * (seq + 1) || !version.compare_exchange_strong(v, v | 1, std::memory_order_acquire)) {
+                return false;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < k_words; ++i) words[i].store(payload.words[i], std::memory_order_relaxed);
+            version.store(2 * (seq + 1), std::memory_order_release);
+            return true;
+        }
+
+        bool read(uint64_t seq, Payload& payload) const {
+            uint64_t v = version.load(std::memory_order_acquire);
+            if (v != 2 * (seq + 1)) {
+                return false;                   // being written, never written, or overwritten since
+            }
+            for (size_t i = 0; i < k_words; ++i) payload.words[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return version.load(std::memory_order_relaxed) == v;
+        }
+    };
+
+    static uint64_t to_ticks(int64_t us) {
+        if (us < 0) return k_disabled;
+        return static_cast<uint64_t>(static_cast<double>(us) * 1000.0 / CommandStats::ns_per_tick());
+    }
+
+    void record(size_t command_id, const std::vector<std::string>& args, uint64_t ticks, int client_fd) {
+        Payload payload{};
+        uint64_t seq = head_.fetch_add(1, std::memory_order_acq_rel);
+        payload.words[0] = seq;
+        payload.words[1] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        payload.words[2] = ticks;
+        payload.words[3] = static_cast<uint64_t>(command_id) | (static_cast<uint64_t>(static_cast<uint32_t>(client_fd)) << 32);
+        std::string text = encode_args(args);
+        payload.words[4] = text.size();
+        std::memcpy(&payload.words[5], text.data(), text.size());
+        if (!slots_[seq & mask_].write(seq, payload)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // args separated by '\0', truncated to fit k_text_bytes
+    static std::string encode_args(const std::vector<std::string>& args) {
+        std::string text;
+        size_t kept = 0;
+        for (const auto& arg : args) {
+            std::string piece = arg.size() <= k_max_arg_bytes
+                ? arg
+                : arg.substr(0, k_max_arg_bytes) + "... (" + std::to_string(arg.size() - k_max_arg_bytes) + " more bytes)";
+            // leave room for the "more arguments" note
+            if ((args.size() > k_max_args && kept == k_max_args - 1) || text.size() + piece.size() + 1 > k_text_bytes - 32) {
+                break;
+            }
+            text += piece;
+            text += '\0';
+            ++kept;
+        }
+        if (kept < args.size()) {
+            text += "... (" + std::to_string(args.size() - kept) + " more arguments)";
+            text += '\0';
+        }
+        return text;
+    }
+
+    static Record decode(const Payload& payload) {
+        Record r;
+        r.id = payload.words[0];
+        r.timestamp_us = payload.words[1];
+        r.duration_us = static_cast<uint64_t>(static_cast<double>(payload.words[2]) * CommandStats::ns_per_tick() / 1000.0);
+        r.command = CommandStats::instance().name(payload.words[3] & 0xffffffffu);
+        r.client_fd = static_cast<int32_t>(payload.words[3] >> 32);
+        size_t len = std::min<size_t>(payload.words[4], k_text_bytes);
+        std::string_view text(reinterpret_cast<const char*>(&payload.words[5]), len);
+        while (!text.empty()) {
+            size_t end = text.find('\0');
+            r.args.emplace_back(text.substr(0, end));
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        }
+        return r;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> head_{0};             // next sequence number
+    std::atomic<uint64_t> reset_at_{0};
+    std::atomic<uint64_t> threshold_ticks_{k_disabled};
+    int64_t threshold_us_ = -1;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+#endif // STATS_SLOW_LOG_HPP
@@ -0,0 +1,345 @@
+#ifndef STATS_TRAFFIC_CAPTURE_HPP
+#define STATS_TRAFFIC_CAPTURE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <system_error>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Traffic capture: every request the server reads, with its arrival time and connection, written to a compact
+binary file for tests/traffic_replay.cpp to re-issue later.
+
+The file is an 8-byte magic ("VDBCAP01"), the unix time the capture started in ns (u64 little endian), and
+then one record per event:
+
+    kind        u8: Request, PipelinedRequest or Close
+    delta       varint: ns since the previous record (the first record counts from the start time)
+    connection  varint: capture-wide connection id, in the order connections were accepted
+    length      varint, Request kinds only: frame bytes that follow
+    frame       the request exactly as a framed client sends it: u32 big-endian payload length, then a
+                big-endian u32 length and the bytes for each argument. Text commands are converted to this
+                format, so replay only speaks one protocol
+
+PipelinedRequest marks a request that arrived in the same read as the one before it on that connection, so
+the client sent it without waiting for the earlier reply. Replay sends those back to back and holds every
+other request until the previous reply is in, which keeps the client's dependencies at any replay speed. A
+pipelining client whose frames straddle two reads shows up as waiting, which can only make replay more
+conservative.
+
+Cost: disabled is one relaxed load per request. Enabled, a record is appended to an in-memory buffer. The
+server calls flush() once per poll loop iteration, which writes the buffer with a single write(); flush()
+also runs early if the buffer reaches k_flush_bytes. A capture stops by itself at max_bytes so it can't fill
+the disk. Requests after that are counted as dropped. Records are only appended by the poll loop thread; the
+mutex makes CAPTURE START/STOP and stats() safe from anywhere.
+
+Where captures go: the server's --capture <path> starts one at startup. Over the wire, CAPTURE START only
+takes a plain file name, created inside the directory the server was given with --capture-dir; without one,
+it's refused. Either way the file must not exist yet (O_EXCL), so a capture can't overwrite anything.
+
+Shutdown: Server::run() stops the capture on the loop thread when it returns, which flushes the tail.
+
+read() parses a file back and stops cleanly at a torn last record, which is what a killed server leaves.
+*/
+
+class TrafficCapture {
+public:
+    enum Kind : uint8_t { Request = 0, PipelinedRequest = 1, Close = 2 };
+
+    static constexpr char k_magic[8] = {'V', 'D', 'B', 'C', 'A', 'P', '0', '1'};
+    static constexpr size_t k_flush_bytes = 1 << 20;
+
+    struct Options {
+        std::string path;
+        uint64_t max_bytes = 1ull << 30;        // stop capturing once the file reaches this
+    };
+
+    struct Stats {
+        bool enabled;
+        std::string path;
+        uint64_t records;
+        uint64_t bytes;                         // written to the file, header included
+        uint64_t dropped;                       // requests not captured because max_bytes was reached
+    };
+
+    struct Event {
+        Kind kind;
+        uint64_t time_ns;                       // since the capture started
+        uint32_t connection;
+        std::vector<uint8_t> frame;             // empty for Close
+    };
+
+    static TrafficCapture& instance() {
+        static TrafficCapture capture;
+        return capture;
+    }
+
+    TrafficCapture() = default;
+    // the server stops its capture in run(); this only closes one started by a test or tool
+    ~TrafficCapture() { stop(); }
+
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    // creates `options.path`, which must not exist; once it's open, a capture already running is stopped
+    Result<void> start(Options options) {
+        std::lock_guard lock(mutex_);
+        int fd = ::open(options.path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        stop_locked();
+        fd_ = fd;
+        options_ = std::move(options);
+        records_ = 0;
+        bytes_ = 0;
+        dropped_ = 0;
+        start_ = std::chrono::steady_clock::now();
+        last_ns_ = 0;
+
+        buffer_.assign(k_magic, k_magic + sizeof(k_magic));
+        uint64_t unix_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        for (int i = 0; i < 8; ++i) buffer_.push_back(static_cast<uint8_t>(unix_ns >> (8 * i)));
+        enabled_.store(true, std::memory_order_relaxed);
+        return flush_locked();
+    }
+
+    // where CAPTURE START may create files (--capture-dir); empty, the default, refuses it
+    void set_directory(std::string directory) {
+        std::lock_guard lock(mutex_);
+        directory_ = std::move(directory);
+    }
+
+    // a client's CAPTURE START: `name` is a file name inside the capture directory, no path
+    Result<void> start_named(const std::string& name, uint64_t max_bytes) {
+        std::string directory;
+        {
+            std::lock_guard lock(mutex_);
+            directory = directory_;
+        }
+        if (directory.empty()) {
+            return std::unexpected(std::make_error_code(std::errc::operation_not_permitted));
+        }
+        if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        return start({.path = directory + "/" + name, .max_bytes = max_bytes});
+    }
+
+    // flushes and closes the file
+    void stop() {
+        std::lock_guard lock(mutex_);
+        stop_locked();
+    }
+
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    // ids for Connection to tag its records with; handed out whether or not a capture is running
+    uint32_t next_connection_id() noexcept { return next_connection_.fetch_add(1, std::memory_order_relaxed); }
+
+    // `frame` is one complete framed request
+    void record(uint32_t connection, std::span<const uint8_t> frame, bool pipelined) {
+        std::lock_guard lock(mutex_);
+        if (!begin_record_locked(pipelined ? PipelinedRequest : Request, connection, frame.size())) {
+            return;
+        }
+        buffer_.insert(buffer_.end(), frame.begin(), frame.end());
+        end_record_locked();
+    }
+
+    // a text command, stored as the frame a framed client would have sent
+    void record(uint32_t connection, const std::vector<std::string>& args) {
+        std::vector<uint8_t> frame = encode_frame(args);
+        record(connection, frame, false);
+    }
+
+    void closed(uint32_t connection) {
+        std::lock_guard lock(mutex_);
+        if (begin_record_locked(Close, connection, 0)) {
+            end_record_locked();
+        }
+    }
+
+    // once per poll loop iteration
+    void flush() {
+        if (!enabled()) [[likely]] {
+            return;
+        }
+        std::lock_guard lock(mutex_);
+        (void)flush_locked();
+    }
+
+    [[nodiscard]] Stats stats() const {
+        std::lock_guard lock(mutex_);
+        return {fd_ >= 0, options_.path, records_, bytes_ + buffer_.size(), dropped_};
+    }
+
+    static std::vector<uint8_t> encode_frame(const std::vector<std::string>& args) {
+        std::vector<uint8_t> frame(4);
+        for (const auto& arg : args) {
+            put_be32(frame, static_cast<uint32_t>(arg.size()));
+            frame.insert(frame.end(), arg.begin(), arg.end());
+        }
+        uint32_t payload = static_cast<uint32_t>(frame.size() - 4);
+        for (int i = 0; i < 4; ++i) frame[i] = static_cast<uint8_t>(payload >> (24 - 8 * i));
+        return frame;
+    }
+
+    // every complete event in a capture file; `start_unix_ns` gets the header's start time if non-null
+    static Result<std::vector<Event>> read(const std::string& path, uint64_t* start_unix_ns = nullptr) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        std::vector<uint8_t> data;
+        uint8_t chunk[65536];
+        ssize_t n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) data.insert(data.end(), chunk, chunk + n);
+        ::close(fd);
+        if (data.size() < 16 || std::memcmp(data.data(), k_magic, sizeof(k_magic)) != 0) {
+            return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        }
+        if (start_unix_ns) {
+            *start_unix_ns = 0;
+            for (int i = 0; i < 8; ++i) *start_unix_ns |= uint64_t{data[8 + i]} << (8 * i);
+        }
+
+        std::vector<Event> events;
+        size_t pos = 16;
+        uint64_t time = 0;
+        while (pos < data.size()) {
+            Event e{};
+            uint64_t delta, connection, length = 0;
+            e.kind = static_cast<Kind>(data[pos++]);
+            if (e.kind > Close || !get_varint(data, pos, delta) || !get_varint(data, pos, connection)) {
+                break;
+            }
+            if (e.kind != Close) {
+                if (!get_varint(data, pos, length) || data.size() - pos < length) {
+                    break;
+                }
+                e.frame.assign(data.begin() + static_cast<ptrdiff_t>(pos),
+                               data.begin() + static_cast<ptrdiff_t>(pos + length));
+                pos += length;
+            }
+            time += delta;
+            e.time_ns = time;
+            e.connection = static_cast<uint32_t>(connection);
+            events.push_back(std::move(e));
+        }
+        return events;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint32_t> next_connection_{0};
+    int fd_ = -1;
+    Options options_;
+    std::string directory_;
+    std::vector<uint8_t> buffer_;
+    uint64_t records_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t dropped_ = 0;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t last_ns_ = 0;
+
+    // writes the record header, or counts a drop and returns false if the capture is off or full
+    bool begin_record_locked(Kind kind, uint32_t connection, size_t length) {
+        if (fd_ < 0) {
+            return false;
+        }
+        if (bytes_ + buffer_.size() + length + 16 > options_.max_bytes) {
+            dropped_ += kind != Close;
+            return false;
+        }
+        uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+        buffer_.push_back(kind);
+        put_varint(buffer_, now - last_ns_);
+        put_varint(buffer_, connection);
+        if (kind != Close) {
+            put_varint(buffer_, length);
+        }
+        last_ns_ = now;
+        return true;
+    }
+
+    void end_record_locked() {
+        ++records_;
+        if (buffer_.size() >= k_flush_bytes) {
+            (void)flush_locked();
+        }
+    }
+
+    Result<void> flush_locked() {
+        size_t done = 0;
+        while (fd_ >= 0 && done < buffer_.size()) {
+            ssize_t n = ::write(fd_, buffer_.data() + done, buffer_.size() - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                // a capture that can't be written is a capture that's over
+                auto error = std::error_code(errno, std::system_category());
+                buffer_.clear();
+                stop_locked();
+                return std::unexpected(error);
+            }
+            done += static_cast<size_t>(n);
+        }
+        bytes_ += done;
+        buffer_.clear();
+        return {};
+    }
+
+    void stop_locked() {
+        if (fd_ < 0) {
+            return;
+        }
+        enabled_.store(false, std::memory_order_relaxed);
+        (void)flush_locked();
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    static void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    static bool get_varint(const std::vector<uint8_t>& in, size_t& pos, uint64_t& v) {
+        v = 0;
+        for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+            uint8_t byte = in[pos++];
+            v |= uint64_t{byte & 0x7fu} << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void put_be32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (24 - 8 * i)));
+    }
+};
+
+#endif // STATS_TRAFFIC_CAPTURE_HPP
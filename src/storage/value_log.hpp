@@ -0,0 +1,371 @@
+#ifndef VALUE_LOG_HPP
+#define VALUE_LOG_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <optional>
+#include <expected>
+#include <system_error>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "../../common.hpp"
+#include "../../logging.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Append-only value log for cold values, WiscKey-style: the key and its metadata stay in memory, the value
+moves to disk and the in-memory entry keeps a ValueRef to it.
+
+    <dir>/<segment id>.vlog   records [crc | key_len | value_len | key | value], crc over everything after it
+
+Values are read back with one pread. Records carry their key so garbage collection can ask the owner
+whether a record is still the live copy: collect() walks a segment (mmap'd) and hands each record to the
+owner's relocate callback, which - under whatever lock guards its entries - checks the entry still
+references that record and, if so, calls copy() to rewrite it into the active segment and repoints the
+entry. Then the old segment is unlinked. Segments are chosen for GC once at least
+gc_garbage_ratio of their bytes are dead (release() marks bytes dead when the owner overwrites or drops
+a value).
+
+This is an extension of RAM, not persistence: the keys live in memory only, so open() starts from an
+empty directory.
+*/
+
+struct ValueRef {
+    uint32_t segment = 0;     // 0: not in the log
+    uint32_t record_len = 0;  // header + key + value
+    uint64_t offset = 0;      // record start within the segment
+
+    explicit operator bool() const noexcept { return segment != 0; }
+    bool operator==(const ValueRef&) const = default;
+};
+
+class ValueLog {
+public:
+    struct Options {
+        std::string dir;
+        uint64_t segment_bytes = 64ull << 20;       // roll to a new segment past this
+        double gc_garbage_ratio = 0.5;              // dead fraction that makes a segment worth collecting
+        std::chrono::milliseconds gc_interval{1000};
+    };
+
+    // if `key`'s entry still references `from`: call copy() and repoint the entry at what it returns
+    using CopyFn = std::function<Result<ValueRef>()>;
+    using RelocateFn = std::function<void(std::string_view key, const ValueRef& from, const CopyFn& copy)>;
+
+    struct Stats {
+        uint64_t segments;
+        uint64_t bytes;          // on disk
+        uint64_t live_bytes;
+        uint64_t collected_segments;
+        uint64_t relocated_bytes;
+    };
+
+    struct RecordHeader {
+        uint32_t crc;
+        uint32_t key_len;
+        uint32_t value_len;
+    };
+    static_assert(sizeof(RecordHeader) == 12);
+
+    static Result<std::unique_ptr<ValueLog>> open(Options options) {
+        std::error_code ec;
+        std::filesystem::create_directories(options.dir, ec);
+        if (ec) {
+            return std::unexpected(ec);
+        }
+        for (const auto& file : std::filesystem::directory_iterator(options.dir, ec)) {
+            if (file.path().extension() == ".vlog") {
+                std::filesystem::remove(file.path(), ec);
+            }
+        }
+        std::unique_ptr<ValueLog> log(new ValueLog(std::move(options)));
+        std::lock_guard lock(log->mutex_);
+        if (auto r = log->roll(); !r) {
+            return std::unexpected(r.error());
+        }
+        return log;
+    }
+
+    ~ValueLog() {
+        stop_gc();
+    }
+
+    ValueLog(const ValueLog&) = delete;
+    ValueLog& operator=(const ValueLog&) = delete;
+
+    Result<ValueRef> append(std::string_view key, std::string_view value) {
+        std::lock_guard lock(mutex_);
+        return append_locked(key, value);
+    }
+
+    Result<void> read(const ValueRef& ref, std::string& out) const {
+        std::shared_ptr<Segment> segment;
+        {
+            std::lock_guard lock(mutex_);
+            auto it = segments_.find(ref.segment);
+            if (it == segments_.end()) {
+                return std::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+            }
+            segment = it->second;
+        }
+        return read_record(*segment, ref, out);
+    }
+
+    // mutex_, held across a fork() so the child's copy of the segment table is consistent
+    [[nodiscard]] std::unique_lock<std::mutex> freeze() const {
+        return std::unique_lock(mutex_);
+    }
+
+    // read() in a child forked under freeze(), where mutex_ is never unlocked
+    Result<void> read_frozen(const ValueRef& ref, std::string& out) const {
+        auto it = segments_.find(ref.segment);
+        if (it == segments_.end()) {
+            return std::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+        return read_record(*it->second, ref, out);
+    }
+
+    // the record behind `ref` is no longer anyone's live copy
+    void release(const ValueRef& ref) {
+        std::lock_guard lock(mutex_);
+        auto it = segments_.find(ref.segment);
+        if (it != segments_.end()) {
+            it->second->live_bytes -= ref.record_len;
+        }
+    }
+
+    // collect every segment past the garbage threshold; returns how many were collected
+    Result<size_t> collect_garbage(const RelocateFn& relocate) {
+        size_t collected = 0;
+        while (auto victim = pick_victim()) {
+            if (auto r = collect(*victim, relocate); !r) {
+                return std::unexpected(r.error());
+            }
+            ++collected;
+        }
+        return collected;
+    }
+
+    // run collect_garbage every gc_interval on a background thread
+    void start_gc(RelocateFn relocate) {
+        stop_gc();
+        gc_stop_ = false;
+        gc_thread_ = std::thread([this, relocate = std::move(relocate)] {
+            std::unique_lock lock(gc_mutex_);
+            while (!gc_stop_) {
+                gc_cv_.wait_for(lock, options_.gc_interval, [&] { return gc_stop_; });
+                if (gc_stop_) break;
+                lock.unlock();
+                if (auto r = collect_garbage(relocate); !r) {
+                    log_message("value log: gc failed: {}", r.error().message());
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    void stop_gc() {
+        {
+            std::lock_guard lock(gc_mutex_);
+            gc_stop_ = true;
+        }
+        gc_cv_.notify_all();
+        if (gc_thread_.joinable()) {
+            gc_thread_.join();
+        }
+    }
+
+    [[nodiscard]] Stats stats() const {
+        std::lock_guard lock(mutex_);
+        Stats s{segments_.size(), 0, 0, collected_segments_, relocated_bytes_};
+        for (const auto& [id, segment] : segments_) {
+            s.bytes += segment->size;
+            s.live_bytes += segment->live_bytes;
+        }
+        return s;
+    }
+
+private:
+    struct Segment {
+        uint32_t id;
+        int fd = -1;
+        uint64_t size = 0;
+        uint64_t live_bytes = 0;
+        std::filesystem::path path;
+
+        ~Segment() {
+            if (fd != -1) ::close(fd);
+        }
+    };
+
+    Options options_;
+    mutable std::mutex mutex_;                 // segments_, active_, counters
+    std::map<uint32_t, std::shared_ptr<Segment>> segments_;
+    std::shared_ptr<Segment> active_;
+    uint32_t next_id_{1};
+    uint64_t collected_segments_{0};
+    uint64_t relocated_bytes_{0};
+
+    std::mutex collect_mutex_;                 // one collection at a time (background thread vs manual)
+    std::mutex gc_mutex_;
+    std::condition_variable gc_cv_;
+    std::thread gc_thread_;
+    bool gc_stop_{true};
+
+    explicit ValueLog(Options options) : options_(std::move(options)) {}
+
+    static Result<void> read_record(const Segment& seg, const ValueRef& ref, std::string& out) {
+        // the whole record in one read; the key is only needed for the checksum
+        out.resize(ref.record_len);
+        if (ref.record_len < sizeof(RecordHeader) ||
+            ::pread(seg.fd, out.data(), ref.record_len, static_cast<off_t>(ref.offset)) != ref.record_len) {
+            return std::unexpected(std::make_error_code(std::errc::io_error));
+        }
+        RecordHeader header;
+        std::memcpy(&header, out.data(), sizeof(header));
+        if (sizeof(header) + header.key_len + header.value_len != ref.record_len ||
+            crc32c(out.data() + sizeof(header.crc), ref.record_len - sizeof(header.crc)) != header.crc) {
+            return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        }
+        out.erase(0, sizeof(header) + header.key_len);
+        return {};
+    }
+
+    // mutex_ held
+    Result<void> roll() {
+        auto segment = std::make_shared<Segment>();
+        segment->id = next_id_++;
+        segment->path = std::filesystem::path(options_.dir) / (std::to_string(segment->id) + ".vlog");
+        segment->fd = ::open(segment->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (segment->fd < 0) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        segments_.emplace(segment->id, segment);
+        active_ = std::move(segment);
+        return {};
+    }
+
+    // mutex_ held
+    Result<ValueRef> append_locked(std::string_view key, std::string_view value) {
+        if (active_->size >= options_.segment_bytes) {
+            if (auto r = roll(); !r) {
+                return std::unexpected(r.error());
+            }
+        }
+
+        RecordHeader header{0, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())};
+        header.crc = crc32c(&header.key_len, sizeof(header) - sizeof(header.crc)); // header fields are contiguous
+        header.crc = crc32c(key.data(), key.size(), header.crc);
+        header.crc = crc32c(value.data(), value.size(), header.crc);
+
+        iovec iov[3] = {
+            {&header, sizeof(header)},
+            {const_cast<char*>(key.data()), key.size()},
+            {const_cast<char*>(value.data()), value.size()},
+        };
+        size_t total = sizeof(header) + key.size() + value.size();
+        if (::pwritev(active_->fd, iov, 3, static_cast<off_t>(active_->size)) != static_cast<ssize_t>(total)) {
+            return std::unexpected(std::error_code(errno ? errno : EIO, std::generic_category()));
+        }
+
+        ValueRef ref{active_->id, static_cast<uint32_t>(total), active_->size};
+        active_->size += total;
+        active_->live_bytes += total;
+        return ref;
+    }
+
+    std::optional<uint32_t> pick_victim() const {
+        std::lock_guard lock(mutex_);
+        std::optional<uint32_t> best;
+        double best_ratio = options_.gc_garbage_ratio;
+        for (const auto& [id, segment] : segments_) {
+            if (segment == active_ || segment->size == 0) continue;
+            double ratio = 1.0 - static_cast<double>(segment->live_bytes) / static_cast<double>(segment->size);
+            if (ratio >= best_ratio) {
+                best_ratio = ratio;
+                best = id;
+            }
+        }
+        return best;
+    }
+
+    Result<void> collect(uint32_t id, const RelocateFn& relocate) {
+        std::lock_guard collecting(collect_mutex_);
+        std::shared_ptr<Segment> segment;
+        {
+            std::lock_guard lock(mutex_);
+            auto it = segments_.find(id);
+            if (it == segments_.end() || it->second == active_) {
+                return {};
+            }
+            segment = it->second;
+        }
+
+        // sealed segments are immutable, so the scan itself needs no lock
+        void* map = segment->size ? ::mmap(nullptr, segment->size, PROT_READ, MAP_PRIVATE, segment->fd, 0) : nullptr;
+        if (map == MAP_FAILED) {
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        ::madvise(map, segment->size, MADV_SEQUENTIAL);
+        const auto* base = static_cast<const uint8_t*>(map);
+
+        uint64_t pos = 0;
+        while (pos + sizeof(RecordHeader) <= segment->size) {
+            RecordHeader header;
+            std::memcpy(&header, base + pos, sizeof(header));
+            uint64_t total = sizeof(header) + header.key_len + header.value_len;
+            if (pos + total > segment->size) break;
+
+            std::string_view key(reinterpret_cast<const char*>(base + pos + sizeof(header)), header.key_len);
+            std::string_view value(key.data() + header.key_len, header.value_len);
+            ValueRef from{id, static_cast<uint32_t>(total), pos};
+
+            std::error_code failed;
+            relocate(key, from, [&]() -> Result<ValueRef> {
+                std::lock_guard lock(mutex_);
+                auto to = append_locked(key, value);
+                if (to) {
+                    relocated_bytes_ += total;
+                } else {
+                    failed = to.error();
+                }
+                return to;
+            });
+            if (failed) {
+                ::munmap(map, segment->size);
+                return std::unexpected(failed);
+            }
+            pos += total;
+        }
+        if (map) {
+            ::munmap(map, segment->size);
+        }
+
+        std::lock_guard lock(mutex_);
+        segments_.erase(id);
+        std::error_code ec;
+        std::filesystem::remove(segment->path, ec);
+        ++collected_segments_;
+        return {};
+    }
+};
+
+#endif // VALUE_LOG_HPP
@@ -0,0 +1,298 @@
+#ifndef TRANSPORT_SHM_CLIENT_HPP
+#define TRANSPORT_SHM_CLIENT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <optional>
+#include <chrono>
+#include <thread>
+#include <initializer_list>
+#include <expected>
+#include <system_error>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include "shm_ring.hpp"
+#include "../client/client.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Client end of the shared-memory transport (see shm_ring.hpp): connects to Server::listen_unix, asks for SHM
+and from then on writes request frames into the request ring and reads responses out of the response ring.
+The Unix socket only carries doorbell bytes.
+
+send() queues a request and returns; receive() returns the next reply, in order. Pipeline by calling
+send() several times before the receive()s. A request that doesn't fit in the ring waits for room, and pulls
+replies out of the response ring in the meantime, so a deep pipeline can't deadlock against a server that
+is waiting for its responses to be read. call() is send() then receive().
+
+One thread at a time: the rings are single-producer single-consumer, and this object is both ends' only
+user on the client side. Open one ShmClient per thread.
+
+Waiting for a reply: spin for busy_poll_us after the last reply (0: not at all), then set consumer_waiting
+and block in read() on the socket until the server rings. stats() counts the doorbells this side sent and
+the times it went to sleep, which are the transport's only syscalls once it's up.
+*/
+
+class ShmClient {
+public:
+    static constexpr size_t k_max_frame = 4096;                 // MAX_MSG_SIZE in connection.hpp
+
+    struct Options {
+        std::string path;                   // the server's --unix socket
+        size_t ring_bytes = 1u << 20;       // each way; the server rounds up to a power of two
+        uint32_t busy_poll_us = 0;
+    };
+
+    struct Stats {
+        uint64_t requests;
+        uint64_t replies;
+        uint64_t doorbells;         // send() on the socket to wake the server
+        uint64_t sleeps;            // blocking read() on the socket, waiting for the server
+    };
+
+    static Result<std::unique_ptr<ShmClient>> connect(Options options) {
+        sockaddr_un addr{};
+        if (options.path.empty() || options.path.size() >= sizeof(addr.sun_path)) {
+            return std::unexpected(std::make_error_code(std::errc::filename_too_long));
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, options.path.c_str(), options.path.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        std::unique_ptr<ShmClient> client(new ShmClient(fd, options));
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        if (auto r = client->handshake(options.ring_bytes); !r) {
+            return std::unexpected(r.error());
+        }
+        return client;
+    }
+
+    ~ShmClient() {
+        if (socket_ >= 0) {
+            ::close(socket_);
+        }
+    }
+
+    ShmClient(const ShmClient&) = delete;
+    ShmClient& operator=(const ShmClient&) = delete;
+
+    // queues one request; its reply comes from a later receive()
+    Result<void> send(std::span<const ClientArg> args) {
+        size_t payload = 0;
+        for (const auto& arg : args) payload += 4 + arg.bytes().size();
+        if (args.empty() || 4 + payload > k_max_frame) {
+            return std::unexpected(std::make_error_code(args.empty() ? std::errc::invalid_argument
+                                                                     : std::errc::message_size));
+        }
+        frame_.clear();
+        put_be32(static_cast<uint32_t>(payload));
+        for (const auto& arg : args) {
+            put_be32(static_cast<uint32_t>(arg.bytes().size()));
+            frame_.insert(frame_.end(), arg.bytes().begin(), arg.bytes().end());
+        }
+
+        size_t done = 0;
+        while (true) {
+            done += requests_.write(frame_.data() + done, frame_.size() - done);
+            if (requests_.take_waiter()) {
+                ring_doorbell();
+            }
+            if (done == frame_.size()) {
+                break;
+            }
+            // the ring is full: make room on the other side while the server catches up
+            if (auto r = pull(); !r) {
+                return std::unexpected(r.error());
+            }
+            std::this_thread::yield();
+        }
+        ++stats_.requests;
+        return {};
+    }
+
+    Result<void> send(std::initializer_list<ClientArg> args) {
+        return send(std::span<const ClientArg>(args.begin(), args.size()));
+    }
+
+    // the reply to the oldest request without one
+    Result<Reply> receive() {
+        auto last = std::chrono::steady_clock::now();
+        while (true) {
+            if (auto reply = take_reply()) {
+                ++stats_.replies;
+                return std::move(*reply);
+            }
+            auto got = pull();
+            if (!got) {
+                return std::unexpected(got.error());
+            }
+            if (*got > 0) {
+                last = std::chrono::steady_clock::now();
+                continue;
+            }
+            if (std::chrono::steady_clock::now() - last < busy_poll_) {
+                std::this_thread::yield();      // hands the core over if the server shares it
+                continue;
+            }
+            if (!responses_.prepare_wait()) {
+                continue;
+            }
+            if (auto r = sleep(); !r) {
+                return std::unexpected(r.error());
+            }
+        }
+    }
+
+    Result<Reply> call(std::initializer_list<ClientArg> args) {
+        if (auto r = send(args); !r) {
+            return std::unexpected(r.error());
+        }
+        return receive();
+    }
+
+    [[nodiscard]] Stats stats() const noexcept { return stats_; }
+
+private:
+    int socket_;
+    std::chrono::nanoseconds busy_poll_;
+    ShmRegion region_;
+    ShmRing requests_;          // we produce
+    ShmRing responses_;         // we consume
+    std::vector<uint8_t> frame_;
+    std::vector<uint8_t> in_;   // response bytes out of the ring, not yet a whole reply
+    size_t in_start_ = 0;
+    Stats stats_{};
+
+    ShmClient(int socket, const Options& options)
+        : socket_(socket), busy_poll_(std::chrono::microseconds(options.busy_poll_us)) {}
+
+    // SHM over the socket, answered "OK" with the memfd attached
+    Result<void> handshake(size_t ring_bytes) {
+        std::string size = std::to_string(ring_bytes);
+        frame_.clear();
+        put_be32(static_cast<uint32_t>(4 + 3 + 4 + size.size()));
+        put_be32(3);
+        frame_.insert(frame_.end(), {'S', 'H', 'M'});
+        put_be32(static_cast<uint32_t>(size.size()));
+        frame_.insert(frame_.end(), size.begin(), size.end());
+        for (size_t done = 0; done < frame_.size();) {
+            ssize_t n = ::write(socket_, frame_.data() + done, frame_.size() - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return std::unexpected(std::make_error_code(std::errc::connection_reset));
+            }
+            done += static_cast<size_t>(n);
+        }
+
+        std::vector<uint8_t> response(256);
+        int memfd = -1;
+        auto got = receive_with_fd(socket_, response, memfd);
+        if (!got) {
+            return std::unexpected(got.error());
+        }
+        uint32_t len = 0;
+        if (*got >= sizeof(len)) {
+            std::memcpy(&len, response.data(), sizeof(len));
+        }
+        auto reply = *got >= sizeof(len) && *got - sizeof(len) >= len
+                         ? Reply::parse(std::span(response).subspan(sizeof(len), len))
+                         : Result<Reply>(std::unexpected(std::make_error_code(std::errc::connection_reset)));
+        if (!reply || reply->is_error() || memfd < 0) {
+            if (memfd >= 0) {
+                ::close(memfd);
+            }
+            // an Error reply: the server refused, e.g. this isn't its Unix socket
+            return std::unexpected(reply ? std::make_error_code(std::errc::operation_not_supported) : reply.error());
+        }
+        auto region = ShmRegion::attach(memfd);
+        if (!region) {
+            return std::unexpected(region.error());
+        }
+        region_ = std::move(*region);
+        region_.close_fd();
+        requests_ = region_.requests();
+        responses_ = region_.responses();
+        return {};
+    }
+
+    void put_be32(uint32_t v) {
+        uint32_t be = htonl(v);
+        auto* p = reinterpret_cast<const uint8_t*>(&be);
+        frame_.insert(frame_.end(), p, p + 4);
+    }
+
+    // moves whatever the response ring holds into in_; how many bytes that was
+    Result<size_t> pull() {
+        if (in_start_ > 0 && in_start_ == in_.size()) {
+            in_.clear();
+            in_start_ = 0;
+        }
+        size_t readable = responses_.readable();
+        if (readable == 0) {
+            return 0;
+        }
+        size_t have = in_.size();
+        in_.resize(have + readable);
+        size_t got = responses_.read(in_.data() + have, readable);
+        in_.resize(have + got);
+        return got;
+    }
+
+    std::optional<Result<Reply>> take_reply() {
+        size_t have = in_.size() - in_start_;
+        uint32_t len;
+        if (have < sizeof(len)) {
+            return std::nullopt;
+        }
+        std::memcpy(&len, in_.data() + in_start_, sizeof(len));
+        if (have - sizeof(len) < len) {
+            return std::nullopt;
+        }
+        auto reply = Reply::parse(std::span(in_).subspan(in_start_ + sizeof(len), len));
+        in_start_ += sizeof(len) + len;
+        if (in_start_ > 64 * 1024) {
+            in_.erase(in_.begin(), in_.begin() + static_cast<std::ptrdiff_t>(in_start_));
+            in_start_ = 0;
+        }
+        return reply;
+    }
+
+    void ring_doorbell() {
+        uint8_t bell = 1;
+        (void)::send(socket_, &bell, 1, MSG_NOSIGNAL);
+        ++stats_.doorbells;
+    }
+
+    // blocks until the server rings; doorbell bytes carry no data
+    Result<void> sleep() {
+        ++stats_.sleeps;
+        uint8_t scratch[64];
+        while (true) {
+            ssize_t n = ::recv(socket_, scratch, sizeof(scratch), 0);
+            if (n > 0) {
+                return {};
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return std::unexpected(std::make_error_code(std::errc::connection_reset));
+        }
+    }
+};
+
+#endif // TRANSPORT_SHM_CLIENT_HPP
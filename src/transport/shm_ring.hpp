@@ -0,0 +1,346 @@
+#ifndef TRANSPORT_SHM_RING_HPP
+#define TRANSPORT_SHM_RING_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <atomic>
+#include <bit>
+#include <new>
+#include <chrono>
+#include <span>
+#include <utility>
+#include <algorithm>
+#include <expected>
+#include <system_error>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+Shared-memory transport for clients on the same host: requests and responses go through a pair of
+single-producer single-consumer byte rings in a memfd, so a request costs no network stack at all.
+
+Setup rides on a Unix domain socket connection (Server::listen_unix). The client sends the framed request
+SHM [ring_bytes]. The server creates the memfd and answers "OK" with the memfd attached (SCM_RIGHTS). From
+then on the rings carry the same byte streams a socket would: framed requests one way, length-prefixed
+responses the other. Connection reads and writes through ShmChannel instead of the socket, and everything
+above that is unchanged.
+
+The memfd is one page of headers and then the two rings' data:
+
+    [request ring header][response ring header] ... | request data (capacity) | response data (capacity)
+
+A ring header holds head (bytes ever written, producer only), tail (bytes ever read, consumer only) and
+consumer_waiting, each on its own cache line. The producer publishes with a release store of head, the
+consumer with a release store of tail. Capacity is a power of two, so positions wrap with a mask.
+
+Wakeups: the Unix socket that set the transport up stays open and doubles as the doorbell. A consumer with
+nothing to read sets consumer_waiting, checks the ring once more and then blocks on the socket: the server in
+poll(), the client in read(). A producer that finds consumer_waiting set clears it and writes one byte to
+the socket. A busy consumer costs its producer no syscalls. Using the socket instead of an eventfd pair
+keeps the server at one polled fd per client, and a client that dies shows up as EOF on it.
+
+Busy polling: a consumer that just read something keeps checking the ring for busy_poll_us before it sets
+consumer_waiting. A reply that lands in that window costs no wakeup on either side, at the price of a
+spinning core; the spinning yields between checks, so a client and server sharing a core still take turns.
+Both sides default to 0, no spinning.
+*/
+
+class ShmRing {
+public:
+    struct alignas(64) Header {
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        alignas(64) std::atomic<uint32_t> consumer_waiting{0};
+        uint64_t capacity = 0;
+    };
+
+    ShmRing() = default;
+    // capacity is read once: the other process can scribble on the header, never on what we index with
+    ShmRing(Header* header, uint8_t* data) : header_(header), data_(data), capacity_(header->capacity) {}
+
+    [[nodiscard]] size_t readable() const noexcept {
+        return used(header_->head.load(std::memory_order_acquire), header_->tail.load(std::memory_order_relaxed));
+    }
+
+    // producer: copies up to n bytes in, returns how many fit
+    size_t write(const uint8_t* in, size_t n) noexcept {
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        n = std::min(n, capacity_ - used(head, tail));
+        size_t at = static_cast<size_t>(head & (capacity_ - 1));
+        size_t first = std::min(n, capacity_ - at);
+        std::memcpy(data_ + at, in, first);
+        std::memcpy(data_, in + first, n - first);
+        header_->head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // consumer: copies up to n bytes out, returns how many there were
+    size_t read(uint8_t* out, size_t n) noexcept {
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        n = std::min(n, used(head, tail));
+        size_t at = static_cast<size_t>(tail & (capacity_ - 1));
+        size_t first = std::min(n, capacity_ - at);
+        std::memcpy(out, data_ + at, first);
+        std::memcpy(out + first, data_, n - first);
+        header_->tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // producer, after a write: true if the consumer went to sleep and needs the doorbell
+    bool take_waiter() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);    // head store before the flag load
+        return header_->consumer_waiting.load(std::memory_order_relaxed) &&
+               header_->consumer_waiting.exchange(0) == 1;
+    }
+
+    // consumer, before blocking: false if bytes arrived in the meantime, so don't
+    bool prepare_wait() noexcept {
+        header_->consumer_waiting.store(1);                     // seq_cst: the flag before the head load
+        if (readable() > 0) {
+            header_->consumer_waiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    Header* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t capacity_ = 0;
+
+    // bytes in the ring; a peer that corrupted head or tail gets a full ring, which stalls only its own
+    // connection, and never an out-of-bounds copy
+    size_t used(uint64_t head, uint64_t tail) const noexcept {
+        uint64_t n = head - tail;
+        return n > capacity_ ? capacity_ : static_cast<size_t>(n);
+    }
+};
+
+// the mapped memfd: both rings
+class ShmRegion {
+public:
+    static constexpr size_t k_header_bytes = 4096;
+    static constexpr size_t k_min_ring = 4096;
+    static constexpr size_t k_max_ring = 64u << 20;
+
+    ShmRegion() = default;
+    ShmRegion(ShmRegion&& other) noexcept
+        : fd_(std::exchange(other.fd_, -1)), base_(std::exchange(other.base_, nullptr)),
+          size_(std::exchange(other.size_, 0)) {}
+    ShmRegion& operator=(ShmRegion&& other) noexcept {
+        std::swap(fd_, other.fd_);
+        std::swap(base_, other.base_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+    ~ShmRegion() {
+        if (base_) {
+            ::munmap(base_, size_);
+        }
+        close_fd();
+    }
+
+    // a fresh memfd with two rings of `ring_bytes` (rounded up to a power of two, clamped)
+    static Result<ShmRegion> create(size_t ring_bytes) {
+        size_t capacity = std::bit_ceil(std::clamp(ring_bytes, k_min_ring, k_max_ring));
+        ShmRegion region;
+        region.fd_ = ::memfd_create("vectordb-shm", MFD_CLOEXEC);
+        if (region.fd_ < 0 || ::ftruncate(region.fd_, static_cast<off_t>(k_header_bytes + 2 * capacity)) < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        if (auto r = region.map(); !r) {
+            return std::unexpected(r.error());
+        }
+        auto* headers = reinterpret_cast<ShmRing::Header*>(region.base_);
+        new (&headers[0]) ShmRing::Header();
+        new (&headers[1]) ShmRing::Header();
+        headers[0].capacity = capacity;
+        headers[1].capacity = capacity;
+        return region;
+    }
+
+    // maps a region another process created; takes ownership of `fd`
+    static Result<ShmRegion> attach(int fd) {
+        ShmRegion region;
+        region.fd_ = fd;
+        if (auto r = region.map(); !r) {
+            return std::unexpected(r.error());
+        }
+        auto* headers = reinterpret_cast<ShmRing::Header*>(region.base_);
+        uint64_t capacity = headers[0].capacity;
+        if (!std::has_single_bit(capacity) || capacity != headers[1].capacity ||
+            k_header_bytes + 2 * capacity != region.size_) {
+            return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        }
+        return region;
+    }
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+    // the mapping outlives the fd; close it once it's been passed on
+    void close_fd() noexcept {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    ShmRing requests() const noexcept { return ring(0); }
+    ShmRing responses() const noexcept { return ring(1); }
+
+private:
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+
+    Result<void> map() {
+        struct stat st;
+        if (::fstat(fd_, &st) < 0) {
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ < k_header_bytes + 2 * k_min_ring) {
+            return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        }
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            size_ = 0;
+            return std::unexpected(std::error_code(errno, std::system_category()));
+        }
+        base_ = static_cast<uint8_t*>(p);
+        return {};
+    }
+
+    ShmRing ring(int which) const noexcept {
+        auto* headers = reinterpret_cast<ShmRing::Header*>(base_);
+        return ShmRing(&headers[which], base_ + k_header_bytes + static_cast<size_t>(which) * headers[0].capacity);
+    }
+};
+
+// the server's end of a client's rings, read and written like a nonblocking socket
+class ShmChannel {
+public:
+    // busy-poll window for every channel in this process, see above; set before clients connect
+    static inline std::atomic<uint32_t> busy_poll_us{0};
+
+    ShmChannel(ShmRegion region, int doorbell)
+        : region_(std::move(region)), requests_(region_.requests()), responses_(region_.responses()),
+          doorbell_(doorbell), busy_poll_(std::chrono::microseconds(busy_poll_us.load(std::memory_order_relaxed))) {}
+
+    // read(2) semantics: bytes read, 0 once the client has gone, -1 with EAGAIN when there's nothing yet
+    ssize_t read(uint8_t* out, size_t n) {
+        if (!spinning_) {
+            // woken by poll() or first call: take the doorbell bytes, or notice the client left
+            uint8_t scratch[64];
+            ssize_t rv;
+            while ((rv = ::recv(doorbell_, scratch, sizeof(scratch), MSG_DONTWAIT)) > 0) {
+            }
+            if (rv == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                return 0;
+            }
+        }
+        while (true) {
+            if (size_t got = requests_.read(out, n)) {
+                spinning_ = true;
+                last_active_ = std::chrono::steady_clock::now();
+                return static_cast<ssize_t>(got);
+            }
+            if (spinning_ && std::chrono::steady_clock::now() - last_active_ < busy_poll_) {
+                errno = EAGAIN;
+                return -1;
+            }
+            spinning_ = false;
+            if (requests_.prepare_wait()) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    }
+
+    // write(2) semantics: bytes taken, -1 with EAGAIN when the response ring is full
+    ssize_t write(const uint8_t* in, size_t n) {
+        size_t put = responses_.write(in, n);
+        if (put > 0 && responses_.take_waiter()) {
+            uint8_t bell = 1;
+            (void)::send(doorbell_, &bell, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+        if (put == 0 && n > 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        return static_cast<ssize_t>(put);
+    }
+
+    // not parked yet: read() found bytes last time, or is inside the busy-poll window. No doorbell is coming
+    // for what the client writes meanwhile, so the server has to call read() again without waiting for poll()
+    [[nodiscard]] bool spinning() const noexcept { return spinning_; }
+
+private:
+    ShmRegion region_;
+    ShmRing requests_;
+    ShmRing responses_;
+    int doorbell_;
+    std::chrono::nanoseconds busy_poll_;
+    bool spinning_ = false;
+    std::chrono::steady_clock::time_point last_active_{};
+};
+
+// sends `data` with `fd` attached (SCM_RIGHTS) over a Unix domain socket
+inline Result<void> send_with_fd(int socket, std::span<const uint8_t> data, int fd) {
+    iovec iov{const_cast<uint8_t*>(data.data()), data.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    ssize_t n;
+    do {
+        n = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n != static_cast<ssize_t>(data.size())) {
+        return std::unexpected(n < 0 ? std::error_code(errno, std::system_category())
+                                     : std::make_error_code(std::errc::message_size));
+    }
+    return {};
+}
+
+// receives up to out.size() bytes and the fd attached to them, -1 if none; returns the byte count
+inline Result<size_t> receive_with_fd(int socket, std::span<uint8_t> out, int& fd) {
+    iovec iov{out.data(), out.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return std::unexpected(std::error_code(errno, std::system_category()));
+    }
+    fd = -1;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(&fd, CMSG_DATA(c), sizeof(int));
+        }
+    }
+    return static_cast<size_t>(n);
+}
+
+#endif // TRANSPORT_SHM_RING_HPP
@@ -0,0 +1,933 @@
+#ifndef TRANSPORT_URING_BACKEND_HPP
+#define TRANSPORT_URING_BACKEND_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <algorithm>
+#include <expected>
+#include <system_error>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+/*
+io_uring backend for the server loop (Server::use_io_uring, --io uring). The poll loop costs a poll() per
+iteration, and then a read() and a write() per request, plus a read() that comes back EAGAIN. Here the
+kernel does the socket work asynchronously, and the loop makes one io_uring_enter() per iteration. That
+call submits every send queued in the iteration and waits for the next completions.
+
+    accept      one multishot ACCEPT per listener, re-armed only if the kernel drops it
+    recv        one multishot RECV per connection. Data lands in a provided buffer ring (k_recv_buffers
+                buffers of k_recv_buffer_bytes, buffer group 0). The loop copies it into the connection's
+                UringChannel and hands the buffer straight back to the ring.
+    send        write() on a UringChannel copies into k_send_chunk_bytes chunks from a shared pool. The chunks
+                queued in an iteration go out as one chain of SENDs linked with IOSQE_IO_LINK, so they hit
+                the socket in order. One chain is in flight per connection; more output waits for it.
+    offload     a multishot POLL on CommandOffload's eventfd
+
+Connection reads and writes a UringChannel the way it would a nonblocking socket (compare ShmChannel), so the
+protocol code doesn't change. read() returns what the recv completions delivered, or EAGAIN. write() takes
+bytes until the pool or the connection's share of it (k_max_chunks_per_channel) runs out, then EAGAIN; the
+connection gets another turn when its sends complete. Readiness is level-triggered like poll()'s: a channel
+holding unread input is in Events::ready every turn until it's read, unless it's waiting on its sends.
+
+Optional registrations, Options:
+    fixed_files     sockets go into a sparse registered file table, and SQEs name them by slot (IOSQE_FIXED_FILE).
+                    That saves a file lookup per operation, at two io_uring_register() calls per connection.
+    fixed_buffers   the send pool is registered, and sends use IORING_RECVSEND_FIXED_BUF: no page pinning per
+                    send. Kernels that only take that on SEND_ZC get SEND_ZC, and a chunk then goes back to the
+                    pool when its notification arrives. Sockets without zero-copy (Unix) fall back to plain
+                    SEND. create() turns the option off if the kernel takes neither.
+
+create() fails, and the server keeps the poll loop, if the kernel has no io_uring, it's disabled
+(kernel.io_uring_disabled), or it lacks multishot recv with provided buffer rings (Linux 6.0).
+
+Closing: the connection gives its fd to the backend (UringChannel::release). The backend cancels everything
+on that fd and closes it once the last completion is in. The fd can't be reused while a linked send is still
+waiting to run.
+
+One thread: the ring is created SINGLE_ISSUER and DEFER_TASKRUN where the kernel has them, so create()
+must run on the thread that will call wait().
+*/
+
+class UringBackend;
+
+// one connection's socket as the ring sees it
+class UringChannel {
+public:
+    UringChannel(const UringChannel&) = delete;
+    UringChannel& operator=(const UringChannel&) = delete;
+
+    // read(2) semantics: bytes read, 0 once the peer has closed, -1 with EAGAIN when nothing has arrived
+    ssize_t read(uint8_t* out, size_t n);
+    // write(2) semantics: bytes queued for sending, -1 with EAGAIN when no buffer space is left
+    ssize_t write(const uint8_t* in, size_t n);
+    // recv(MSG_PEEK) of one byte, same return values as read()
+    ssize_t peek(uint8_t* first) const;
+    // the connection is done: the backend owns the fd from here and closes it when the ring is done
+    void release();
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+private:
+    friend class UringBackend;
+    UringChannel(UringBackend& backend, int fd, uint32_t id) : backend_(backend), fd_(fd), id_(id) {}
+
+    UringBackend& backend_;
+    int fd_;
+    uint32_t id_;                   // Connection::id()
+    int slot_ = -1;                 // registered file index, -1 if none
+    std::vector<uint8_t> in_;       // received, not yet read
+    size_t in_start_ = 0;
+    bool eof_ = false;              // peer closed, or the socket failed
+    std::deque<uint32_t> out_;      // send chunks in order; the first `sending_` are in flight
+    size_t sending_ = 0;
+    bool blocked_ = false;          // write() said EAGAIN; ready again when sends complete
+    bool recv_armed_ = false;
+    bool released_ = false;
+    bool dirty_ = false;            // has unsent chunks and is on the send list
+    bool zero_copy_ = true;         // SEND_ZC works on this socket, when the backend uses it
+    bool unread_ = false;           // on the backend's unread list
+    uint64_t ready_epoch_ = 0;      // wait() that last reported it, so it's reported once
+};
+
+class UringBackend {
+public:
+    static constexpr uint32_t k_recv_buffers = 512;             // power of two
+    static constexpr uint32_t k_recv_buffer_bytes = 4096;       // MAX_MSG_SIZE in connection.hpp
+    static constexpr uint32_t k_send_chunks = 1024;
+    static constexpr uint32_t k_send_chunk_bytes = 16 * 1024;
+    static constexpr uint32_t k_max_chunks_per_channel = 64;
+    static constexpr uint32_t k_max_link = 16;                  // SENDs in one chain
+    static constexpr uint32_t k_fixed_files = 4096;
+
+    struct Options {
+        uint32_t entries = 1024;
+        bool fixed_files = false;
+        bool fixed_buffers = false;
+    };
+
+    struct Stats {
+        uint64_t enters;            // io_uring_enter() calls
+        uint64_t sqes;              // submitted
+        uint64_t cqes;              // reaped
+    };
+
+    // what one wait() turned up
+    struct Events {
+        std::vector<int> accepted;                          // new sockets, from any listener
+        std::vector<std::pair<int, uint32_t>> ready;        // (fd, id) of channels with something to do
+        bool offload = false;                               // the offload eventfd fired
+    };
+
+    static Result<std::unique_ptr<UringBackend>> create(Options options) {
+        std::unique_ptr<UringBackend> backend(new UringBackend(options));
+        if (auto r = backend->setup(); !r) {
+            return std::unexpected(r.error());
+        }
+        return backend;
+    }
+
+    ~UringBackend() {
+        for (auto& [id, channel] : channels_) {
+            ::close(channel->fd_);
+        }
+        if (ring_fd_ >= 0) {
+            ::close(ring_fd_);
+        }
+        unmap(sq_map_, sq_map_len_);
+        if (cq_map_ != sq_map_) {
+            unmap(cq_map_, cq_map_len_);
+        }
+        unmap(sqes_, sqes_len_);
+        unmap(buf_ring_, k_recv_buffers * sizeof(io_uring_buf));
+        unmap(recv_pool_, size_t(k_recv_buffers) * k_recv_buffer_bytes);
+        unmap(send_pool_, size_t(k_send_chunks) * k_send_chunk_bytes);
+    }
+
+    UringBackend(const UringBackend&) = delete;
+    UringBackend& operator=(const UringBackend&) = delete;
+
+    [[nodiscard]] Options options() const noexcept { return options_; }
+    [[nodiscard]] Stats stats() const noexcept { return stats_; }
+    // the setup flags the kernel accepted, for the startup log
+    [[nodiscard]] uint32_t setup_flags() const noexcept { return setup_flags_; }
+
+    // accept on `fd` until the backend goes away; new sockets come back in Events::accepted
+    void add_listener(int fd) {
+        listeners_.push_back(fd);
+        arm_accept(listeners_.size() - 1);
+    }
+
+    // report POLLIN on `fd` as Events::offload
+    void watch_offload(int fd) {
+        offload_fd_ = fd;
+        arm_offload();
+    }
+
+    // starts receiving on an accepted socket; the channel lives until release() and its last completion
+    UringChannel* open(int fd, uint32_t id) {
+        auto channel = std::unique_ptr<UringChannel>(new UringChannel(*this, fd, id));
+        if (options_.fixed_files && !free_slots_.empty()) {
+            int slot = free_slots_.back();
+            if (update_file(slot, fd)) {
+                free_slots_.pop_back();
+                channel->slot_ = slot;
+            }
+        }
+        auto* raw = channel.get();
+        channels_[id] = std::move(channel);
+        arm_recv(*raw);
+        return raw;
+    }
+
+    // submits what's queued, waits up to `timeout` for a completion unless some work is already pending,
+    // and reaps every completion there is
+    Result<void> wait(Events& events, std::chrono::milliseconds timeout) {
+        events.accepted.clear();
+        events.ready.clear();
+        events.offload = false;
+        ++epoch_;
+
+        // unread input is level-triggered, as it is under poll(): the channel comes back every turn until
+        // it's read, and that turn doesn't wait. Not while its sends are backed up, which is POLLOUT's turn.
+        std::erase_if(unread_, [&](uint32_t id) {
+            auto* channel = find(id);
+            if (!channel || channel->released_ || channel->in_start_ == channel->in_.size()) {
+                if (channel) {
+                    channel->unread_ = false;
+                }
+                return true;
+            }
+            if (!channel->blocked_) {
+                report(events, *channel);
+            }
+            return false;
+        });
+        // writers the pool ran dry on, with no sends of their own to wake them, once there's room again
+        if (!free_chunks_.empty()) {
+            for (uint32_t id : starved_) {
+                if (auto* channel = find(id); channel && !channel->released_ && channel->blocked_) {
+                    channel->blocked_ = false;
+                    report(events, *channel);
+                }
+            }
+            starved_.clear();
+        }
+        flush_sends();
+
+        bool completions = cq_pending() > 0;
+        unsigned wait_nr = events.ready.empty() && !completions ? 1 : 0;
+        if (auto r = enter(wait_nr, timeout); !r) {
+            return r;
+        }
+        reap(events);
+        return {};
+    }
+
+private:
+    enum class Op : uint8_t { Accept = 1, Recv, Send, Offload, Cancel, Probe };
+
+    Options options_;
+    Stats stats_{};
+    uint32_t setup_flags_ = 0;
+    int ring_fd_ = -1;
+
+    // the mmapped rings
+    void* sq_map_ = nullptr;
+    size_t sq_map_len_ = 0;
+    void* cq_map_ = nullptr;
+    size_t cq_map_len_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_len_ = 0;
+    uint32_t* sq_head_ = nullptr;
+    uint32_t* sq_tail_ = nullptr;
+    uint32_t* sq_array_ = nullptr;
+    uint32_t sq_mask_ = 0;
+    uint32_t sq_entries_ = 0;
+    uint32_t sqe_tail_ = 0;         // SQEs handed out, published to *sq_tail_ at enter()
+    uint32_t* cq_head_ = nullptr;
+    uint32_t* cq_tail_ = nullptr;
+    uint32_t cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    // provided buffers for recv
+    // the io_uring_buf_ring, as its entries: in C++ the header's bufs[] lands 8 bytes in, behind an empty
+    // struct of size 1, so it can't be used
+    io_uring_buf* buf_ring_ = nullptr;
+    uint8_t* recv_pool_ = nullptr;
+    uint16_t buf_tail_ = 0;
+
+    // send chunks
+    uint8_t* send_pool_ = nullptr;
+    std::vector<uint32_t> free_chunks_;
+    std::vector<uint32_t> chunk_len_;
+    std::vector<uint32_t> chunk_sent_;
+    std::vector<uint16_t> chunk_notifs_;    // SEND_ZC notifications still to come; the chunk waits for them
+    std::vector<bool> chunk_retired_;       // off its channel, back to the pool after the notifications
+    bool send_zc_ = false;                  // registered buffers go out with SEND_ZC
+
+    std::vector<int> free_slots_;
+    std::vector<int> listeners_;
+    int offload_fd_ = -1;
+    std::unordered_map<uint32_t, std::unique_ptr<UringChannel>> channels_;
+    std::vector<uint32_t> dirty_;   // channels with chunks to send
+    std::vector<uint32_t> unread_;  // channels holding received bytes, read or not since
+    std::vector<uint32_t> starved_; // channels blocked on an empty pool with nothing in flight
+    uint64_t epoch_ = 0;
+
+    friend class UringChannel;
+
+    explicit UringBackend(Options options) : options_(options) {}
+
+    static uint64_t tag(Op op, uint32_t id, uint32_t extra = 0) noexcept {
+        return uint64_t(op) << 56 | uint64_t(extra & 0xffffff) << 32 | id;
+    }
+    static Op tag_op(uint64_t tag) noexcept { return static_cast<Op>(tag >> 56); }
+    static uint32_t tag_id(uint64_t tag) noexcept { return static_cast<uint32_t>(tag); }
+    static uint32_t tag_extra(uint64_t tag) noexcept { return static_cast<uint32_t>(tag >> 32) & 0xffffff; }
+
+    static std::error_code last_error() { return std::error_code(errno, std::system_category()); }
+
+    static void unmap(void* p, size_t len) {
+        if (p && p != MAP_FAILED) {
+            ::munmap(p, len);
+        }
+    }
+
+    int register_op(unsigned op, const void* arg, unsigned nr) {
+        return static_cast<int>(::syscall(__NR_io_uring_register, ring_fd_, op, arg, nr));
+    }
+
+    Result<void> setup() {
+        // the newest flags first: one submitter thread, completions run only when we wait for them
+        const uint32_t attempts[] = {
+            IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+            IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN,
+            0,
+        };
+        io_uring_params p{};
+        for (uint32_t flags : attempts) {
+            p = {};
+            p.flags = flags | IORING_SETUP_CQSIZE;
+            p.cq_entries = options_.entries * 4;
+            ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, options_.entries, &p));
+            if (ring_fd_ >= 0 || errno != EINVAL) {
+                setup_flags_ = flags;
+                break;
+            }
+        }
+        if (ring_fd_ < 0) {
+            return std::unexpected(last_error());
+        }
+        const uint32_t needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG |
+                                IORING_FEAT_FAST_POLL;
+        if ((p.features & needed) != needed) {
+            return std::unexpected(std::make_error_code(std::errc::not_supported));
+        }
+
+        sq_map_len_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cq_map_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        sq_map_len_ = cq_map_len_ = std::max(sq_map_len_, cq_map_len_);
+        sq_map_ = ::mmap(nullptr, sq_map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                         IORING_OFF_SQ_RING);
+        if (sq_map_ == MAP_FAILED) {
+            return std::unexpected(last_error());
+        }
+        cq_map_ = sq_map_;
+        sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return std::unexpected(last_error());
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        auto* sq = static_cast<uint8_t*>(sq_map_);
+        sq_head_ = reinterpret_cast<uint32_t*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<uint32_t*>(sq + p.sq_off.tail);
+        sq_array_ = reinterpret_cast<uint32_t*>(sq + p.sq_off.array);
+        sq_mask_ = *reinterpret_cast<uint32_t*>(sq + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        sqe_tail_ = *sq_tail_;
+        auto* cq = static_cast<uint8_t*>(cq_map_);
+        cq_head_ = reinterpret_cast<uint32_t*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<uint32_t*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<uint32_t*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+        if (auto r = setup_buffers(); !r) {
+            return r;
+        }
+        if (options_.fixed_files) {
+            io_uring_rsrc_register files{};
+            files.nr = k_fixed_files;
+            files.flags = IORING_RSRC_REGISTER_SPARSE;
+            if (register_op(IORING_REGISTER_FILES2, &files, sizeof(files)) < 0) {
+                options_.fixed_files = false;
+            } else {
+                for (int slot = k_fixed_files - 1; slot >= 0; --slot) {
+                    free_slots_.push_back(slot);
+                }
+            }
+        }
+        return self_test();
+    }
+
+    Result<void> setup_buffers() {
+        size_t ring_bytes = k_recv_buffers * sizeof(io_uring_buf);
+        void* ring = ::mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void* recv = ::mmap(nullptr, size_t(k_recv_buffers) * k_recv_buffer_bytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void* send = ::mmap(nullptr, size_t(k_send_chunks) * k_send_chunk_bytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        buf_ring_ = ring == MAP_FAILED ? nullptr : static_cast<io_uring_buf*>(ring);
+        recv_pool_ = recv == MAP_FAILED ? nullptr : static_cast<uint8_t*>(recv);
+        send_pool_ = send == MAP_FAILED ? nullptr : static_cast<uint8_t*>(send);
+        if (!buf_ring_ || !recv_pool_ || !send_pool_) {
+            return std::unexpected(std::make_error_code(std::errc::not_enough_memory));
+        }
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = k_recv_buffers;
+        reg.bgid = 0;
+        if (register_op(IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            return std::unexpected(last_error());
+        }
+        for (uint16_t bid = 0; bid < k_recv_buffers; ++bid) {
+            recycle(bid);
+        }
+        publish_buffers();
+
+        chunk_len_.assign(k_send_chunks, 0);
+        chunk_sent_.assign(k_send_chunks, 0);
+        chunk_notifs_.assign(k_send_chunks, 0);
+        chunk_retired_.assign(k_send_chunks, false);
+        for (uint32_t c = k_send_chunks; c-- > 0;) {
+            free_chunks_.push_back(c);
+        }
+        if (options_.fixed_buffers) {
+            iovec pool{send_pool_, size_t(k_send_chunks) * k_send_chunk_bytes};
+            if (register_op(IORING_REGISTER_BUFFERS, &pool, 1) < 0) {
+                options_.fixed_buffers = false;
+            }
+        }
+        return {};
+    }
+
+    // a socketpair through the ring: multishot recv into a provided buffer must work, or we'd find out
+    // only when the first client connects. Also decides how sends use the registered pool, if at all.
+    Result<void> self_test() {
+        int pair[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+            return std::unexpected(last_error());
+        }
+        auto* recv = sqe();
+        recv->opcode = IORING_OP_RECV;
+        recv->fd = pair[0];
+        recv->flags = IOSQE_BUFFER_SELECT;
+        recv->ioprio = IORING_RECV_MULTISHOT;
+        recv->buf_group = 0;
+        recv->user_data = tag(Op::Probe, 0);
+
+        // completions for probe `id`: its result, and whether the recv probe got a byte and stayed armed
+        bool received = false;
+        auto await = [&](uint32_t id) -> std::optional<int32_t> {
+            for (int round = 0; round < 4; ++round) {
+                if (!enter(1, std::chrono::milliseconds(250))) {
+                    break;
+                }
+                std::optional<int32_t> found;
+                uint32_t head = std::atomic_ref(*cq_head_).load(std::memory_order_relaxed);
+                uint32_t tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+                for (; head != tail; ++head) {
+                    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                    if (cqe.flags & IORING_CQE_F_BUFFER) {
+                        recycle(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                    }
+                    if (tag_id(cqe.user_data) == 0) {
+                        received = cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER) &&
+                                   (cqe.flags & IORING_CQE_F_MORE);
+                    }
+                    if (tag_id(cqe.user_data) == id && !(cqe.flags & IORING_CQE_F_NOTIF)) {
+                        found = cqe.res;
+                    }
+                }
+                std::atomic_ref(*cq_head_).store(head, std::memory_order_release);
+                publish_buffers();
+                if (found) {
+                    return found;
+                }
+            }
+            return std::nullopt;
+        };
+
+        uint8_t byte = 'x';
+        (void)!::write(pair[1], &byte, 1);
+        (void)await(0);
+
+        // registered buffers: plain SEND takes them on newer kernels, SEND_ZC since 6.0. SEND_ZC on a Unix
+        // socket says EOPNOTSUPP, which still shows the kernel knows it; those connections send plainly.
+        if (received && options_.fixed_buffers) {
+            send_pool_[0] = 'x';
+            auto probe = [&](uint8_t opcode, uint32_t id) {
+                auto* send = sqe();
+                send->opcode = opcode;
+                send->fd = pair[1];
+                send->addr = reinterpret_cast<uint64_t>(send_pool_);
+                send->len = 1;
+                send->msg_flags = MSG_NOSIGNAL;
+                send->ioprio = IORING_RECVSEND_FIXED_BUF;
+                send->buf_index = 0;
+                send->user_data = tag(Op::Probe, id);
+                return await(id).value_or(-EINVAL);
+            };
+            if (probe(IORING_OP_SEND, 1) != 1) {
+                int res = probe(IORING_OP_SEND_ZC, 2);
+                send_zc_ = res == 1 || res == -EOPNOTSUPP;
+                options_.fixed_buffers = send_zc_;
+            }
+        }
+
+        // cancel the probe recv and drain its completion
+        auto* cancel = sqe();
+        cancel->opcode = IORING_OP_ASYNC_CANCEL;
+        cancel->fd = pair[0];
+        cancel->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        cancel->user_data = tag(Op::Cancel, 0);
+        (void)enter(0, std::chrono::milliseconds(0));
+        Events ignored;
+        reap(ignored);
+        ::close(pair[0]);
+        ::close(pair[1]);
+        if (!received) {
+            return std::unexpected(std::make_error_code(std::errc::not_supported));
+        }
+        return {};
+    }
+
+    // ---- submission and completion queues
+
+    // a zeroed SQE; `reserve` keeps a link chain from being split by a forced submit
+    io_uring_sqe* sqe(uint32_t reserve = 1) {
+        uint32_t head = std::atomic_ref(*sq_head_).load(std::memory_order_acquire);
+        if (sqe_tail_ + reserve - head > sq_entries_) {
+            (void)enter(0, std::chrono::milliseconds(0));
+        }
+        uint32_t index = sqe_tail_ & sq_mask_;
+        io_uring_sqe* s = &sqes_[index];
+        std::memset(s, 0, sizeof(*s));
+        sq_array_[index] = index;
+        ++sqe_tail_;
+        return s;
+    }
+
+    uint32_t cq_pending() const noexcept {
+        return std::atomic_ref(*cq_tail_).load(std::memory_order_acquire) -
+               std::atomic_ref(*cq_head_).load(std::memory_order_relaxed);
+    }
+
+    // submits everything queued and waits for `wait_nr` completions; interruptions and timeouts are fine
+    Result<void> enter(unsigned wait_nr, std::chrono::milliseconds timeout) {
+        std::atomic_ref(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+        uint32_t to_submit = sqe_tail_ - std::atomic_ref(*sq_head_).load(std::memory_order_acquire);
+        __kernel_timespec ts{};
+        ts.tv_sec = timeout.count() / 1000;
+        ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        ++stats_.enters;
+        long rc = ::syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr,
+                            IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        if (rc < 0 && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN) {
+            return std::unexpected(last_error());
+        }
+        stats_.sqes += to_submit - (sqe_tail_ - std::atomic_ref(*sq_head_).load(std::memory_order_acquire));
+        return {};
+    }
+
+    void reap(Events& events) {
+        uint32_t head = std::atomic_ref(*cq_head_).load(std::memory_order_relaxed);
+        uint32_t tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            ++stats_.cqes;
+            switch (tag_op(cqe.user_data)) {
+                case Op::Accept: on_accept(cqe, events); break;
+                case Op::Recv: on_recv(cqe, events); break;
+                case Op::Send: on_send(cqe, events); break;
+                case Op::Offload:
+                    events.offload = true;
+                    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                        arm_offload();
+                    }
+                    break;
+                case Op::Cancel:
+                case Op::Probe:
+                    if (cqe.flags & IORING_CQE_F_BUFFER) {
+                        recycle(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                    }
+                    break;
+            }
+        }
+        std::atomic_ref(*cq_head_).store(head, std::memory_order_release);
+        publish_buffers();
+    }
+
+    // ---- provided buffers
+
+    void recycle(uint16_t bid) {
+        io_uring_buf& buf = buf_ring_[buf_tail_ & (k_recv_buffers - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(recv_pool_ + size_t(bid) * k_recv_buffer_bytes);
+        buf.len = k_recv_buffer_bytes;
+        buf.bid = bid;
+        ++buf_tail_;
+    }
+
+    // the ring's tail overlays the first entry's resv field
+    void publish_buffers() { std::atomic_ref(buf_ring_[0].resv).store(buf_tail_, std::memory_order_release); }
+
+    // ---- requests
+
+    void arm_accept(size_t listener) {
+        auto* s = sqe();
+        s->opcode = IORING_OP_ACCEPT;
+        s->fd = listeners_[listener];
+        s->ioprio = IORING_ACCEPT_MULTISHOT;
+        s->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        s->user_data = tag(Op::Accept, static_cast<uint32_t>(listener));
+    }
+
+    void arm_offload() {
+        auto* s = sqe();
+        s->opcode = IORING_OP_POLL_ADD;
+        s->fd = offload_fd_;
+        s->poll32_events = POLLIN;
+        s->len = IORING_POLL_ADD_MULTI;
+        s->user_data = tag(Op::Offload, 0);
+    }
+
+    void target(io_uring_sqe* s, const UringChannel& channel) const {
+        if (channel.slot_ >= 0) {
+            s->fd = channel.slot_;
+            s->flags |= IOSQE_FIXED_FILE;
+        } else {
+            s->fd = channel.fd_;
+        }
+    }
+
+    void arm_recv(UringChannel& channel) {
+        auto* s = sqe();
+        s->opcode = IORING_OP_RECV;
+        target(s, channel);
+        s->flags |= IOSQE_BUFFER_SELECT;
+        s->ioprio = IORING_RECV_MULTISHOT;
+        s->buf_group = 0;
+        s->user_data = tag(Op::Recv, channel.id_);
+        channel.recv_armed_ = true;
+    }
+
+    // the chunks queued on each dirty channel, as one linked chain per channel
+    void flush_sends() {
+        for (uint32_t id : dirty_) {
+            auto* channel = find(id);
+            if (!channel) {
+                continue;
+            }
+            channel->dirty_ = false;
+            if (channel->released_ || channel->sending_ > 0 || channel->out_.empty()) {
+                continue;
+            }
+            size_t count = std::min<size_t>(channel->out_.size(), k_max_link);
+            io_uring_sqe* first = sqe(static_cast<uint32_t>(count));
+            for (size_t i = 0; i < count; ++i) {
+                auto* s = i == 0 ? first : sqe();
+                uint32_t chunk = channel->out_[i];
+                bool zero_copy = send_zc_ && channel->zero_copy_;
+                s->opcode = zero_copy ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+                target(s, *channel);
+                s->addr = reinterpret_cast<uint64_t>(send_pool_ + size_t(chunk) * k_send_chunk_bytes +
+                                                     chunk_sent_[chunk]);
+                s->len = chunk_len_[chunk] - chunk_sent_[chunk];
+                s->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+                if (options_.fixed_buffers && (zero_copy || !send_zc_)) {
+                    s->ioprio = IORING_RECVSEND_FIXED_BUF;
+                    s->buf_index = 0;
+                }
+                if (i + 1 < count) {
+                    s->flags |= IOSQE_IO_LINK;
+                }
+                s->user_data = tag(Op::Send, id, chunk);
+            }
+            channel->sending_ = count;
+        }
+        dirty_.clear();
+    }
+
+    // ---- completions
+
+    void on_accept(const io_uring_cqe& cqe, Events& events) {
+        if (cqe.res >= 0) {
+            events.accepted.push_back(cqe.res);
+        }
+        // the kernel drops a multishot accept on errors like EMFILE; a closed listener stays closed
+        if (!(cqe.flags & IORING_CQE_F_MORE) && cqe.res != -EBADF && cqe.res != -EINVAL && cqe.res != -ECANCELED) {
+            arm_accept(tag_id(cqe.user_data));
+        }
+    }
+
+    void on_recv(const io_uring_cqe& cqe, Events& events) {
+        auto* channel = find(tag_id(cqe.user_data));
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (channel && !channel->released_ && cqe.res > 0) {
+                const uint8_t* data = recv_pool_ + size_t(bid) * k_recv_buffer_bytes;
+                channel->in_.insert(channel->in_.end(), data, data + cqe.res);
+                if (!channel->unread_) {
+                    channel->unread_ = true;
+                    unread_.push_back(channel->id_);
+                }
+            }
+            recycle(bid);
+        }
+        if (!channel) {
+            return;
+        }
+        if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)) {
+            channel->eof_ = true;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            channel->recv_armed_ = false;
+            // ENOBUFS: the buffer ring ran dry; buffers were just recycled, so try again
+            if (!channel->eof_ && !channel->released_) {
+                arm_recv(*channel);
+            }
+        }
+        if (channel->released_) {
+            maybe_destroy(*channel);
+        } else if (cqe.res != -ENOBUFS) {
+            report(events, *channel);
+        }
+    }
+
+    void on_send(const io_uring_cqe& cqe, Events& events) {
+        uint32_t chunk = tag_extra(cqe.user_data);
+        // SEND_ZC: the result, flagged MORE, then a NOTIF once the kernel is done with the buffer
+        if (cqe.flags & IORING_CQE_F_NOTIF) {
+            if (--chunk_notifs_[chunk] == 0 && chunk_retired_[chunk]) {
+                chunk_retired_[chunk] = false;
+                free_chunks_.push_back(chunk);
+            }
+            return;
+        }
+        if (cqe.flags & IORING_CQE_F_MORE) {
+            ++chunk_notifs_[chunk];
+        }
+        auto* channel = find(tag_id(cqe.user_data));
+        if (!channel) {
+            return;
+        }
+        if (cqe.res == -EOPNOTSUPP && channel->zero_copy_) {
+            channel->zero_copy_ = false;    // e.g. a Unix socket; resent below with plain SEND
+        } else if (cqe.res > 0) {
+            chunk_sent_[chunk] += static_cast<uint32_t>(cqe.res);
+        } else if (cqe.res < 0 && cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR) {
+            channel->eof_ = true;           // EPIPE, ECONNRESET: the connection is gone
+        }
+        if (--channel->sending_ > 0) {
+            return;                         // the rest of the chain reports first
+        }
+        // chain done: drop what went out, resend from where a short send or a failure stopped it
+        while (!channel->out_.empty() &&
+               chunk_sent_[channel->out_.front()] == chunk_len_[channel->out_.front()]) {
+            release_chunk(channel->out_.front());
+            channel->out_.pop_front();
+        }
+        if (channel->released_ || channel->eof_) {
+            while (!channel->out_.empty()) {
+                release_chunk(channel->out_.front());
+                channel->out_.pop_front();
+            }
+        } else if (!channel->out_.empty()) {
+            mark_dirty(*channel);
+        }
+        if (channel->released_) {
+            maybe_destroy(*channel);
+        } else if (channel->blocked_ || channel->eof_) {
+            channel->blocked_ = false;
+            report(events, *channel);
+        }
+    }
+
+    // ---- channel bookkeeping
+
+    UringChannel* find(uint32_t id) {
+        auto it = channels_.find(id);
+        return it == channels_.end() ? nullptr : it->second.get();
+    }
+
+    void report(Events& events, UringChannel& channel) {
+        if (channel.ready_epoch_ != epoch_) {
+            channel.ready_epoch_ = epoch_;
+            events.ready.emplace_back(channel.fd_, channel.id_);
+        }
+    }
+
+    void mark_dirty(UringChannel& channel) {
+        if (!channel.dirty_) {
+            channel.dirty_ = true;
+            dirty_.push_back(channel.id_);
+        }
+    }
+
+    bool take_chunk(uint32_t& chunk) {
+        if (free_chunks_.empty()) {
+            return false;
+        }
+        chunk = free_chunks_.back();
+        free_chunks_.pop_back();
+        chunk_len_[chunk] = 0;
+        chunk_sent_[chunk] = 0;
+        return true;
+    }
+
+    void release_chunk(uint32_t chunk) {
+        if (chunk_notifs_[chunk] > 0) {
+            chunk_retired_[chunk] = true;
+        } else {
+            free_chunks_.push_back(chunk);
+        }
+    }
+
+    bool update_file(int slot, int fd) {
+        io_uring_files_update update{};
+        update.offset = static_cast<uint32_t>(slot);
+        update.fds = reinterpret_cast<uint64_t>(&fd);
+        return register_op(IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+    }
+
+    void release(UringChannel& channel) {
+        channel.released_ = true;
+        channel.in_.clear();
+        channel.in_start_ = 0;
+        // chunks not yet submitted go back now; the in-flight chain returns its own
+        while (channel.out_.size() > channel.sending_) {
+            release_chunk(channel.out_.back());
+            channel.out_.pop_back();
+        }
+        if (channel.recv_armed_ || channel.sending_ > 0) {
+            auto* s = sqe();
+            s->opcode = IORING_OP_ASYNC_CANCEL;
+            target(s, channel);
+            s->flags &= static_cast<uint8_t>(~IOSQE_FIXED_FILE);
+            s->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL |
+                              (channel.slot_ >= 0 ? IORING_ASYNC_CANCEL_FD_FIXED : 0);
+            s->user_data = tag(Op::Cancel, channel.id_);
+        }
+        maybe_destroy(channel);
+    }
+
+    void maybe_destroy(UringChannel& channel) {
+        if (!channel.released_ || channel.recv_armed_ || channel.sending_ > 0) {
+            return;
+        }
+        if (channel.slot_ >= 0 && update_file(channel.slot_, -1)) {
+            free_slots_.push_back(channel.slot_);
+        }
+        ::close(channel.fd_);
+        channels_.erase(channel.id_);
+    }
+};
+
+inline ssize_t UringChannel::read(uint8_t* out, size_t n) {
+    size_t have = in_.size() - in_start_;
+    if (have == 0) {
+        if (eof_) {
+            return 0;
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+    n = std::min(n, have);
+    std::memcpy(out, in_.data() + in_start_, n);
+    in_start_ += n;
+    if (in_start_ == in_.size()) {
+        in_.clear();
+        in_start_ = 0;
+    }
+    return static_cast<ssize_t>(n);
+}
+
+inline ssize_t UringChannel::peek(uint8_t* first) const {
+    if (in_start_ < in_.size()) {
+        *first = in_[in_start_];
+        return 1;
+    }
+    if (eof_) {
+        return 0;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+inline ssize_t UringChannel::write(const uint8_t* in, size_t n) {
+    if (eof_) {
+        errno = EPIPE;
+        return -1;
+    }
+    size_t taken = 0;
+    while (taken < n) {
+        // the last chunk takes more while it isn't on the wire yet
+        if (out_.size() > sending_ && backend_.chunk_len_[out_.back()] < UringBackend::k_send_chunk_bytes) {
+            uint32_t chunk = out_.back();
+            size_t room = UringBackend::k_send_chunk_bytes - backend_.chunk_len_[chunk];
+            size_t put = std::min(room, n - taken);
+            std::memcpy(backend_.send_pool_ + size_t(chunk) * UringBackend::k_send_chunk_bytes +
+                            backend_.chunk_len_[chunk], in + taken, put);
+            backend_.chunk_len_[chunk] += static_cast<uint32_t>(put);
+            taken += put;
+            continue;
+        }
+        uint32_t chunk;
+        if (out_.size() >= UringBackend::k_max_chunks_per_channel || !backend_.take_chunk(chunk)) {
+            if (out_.empty()) {
+                backend_.starved_.push_back(id_);
+            }
+            blocked_ = true;
+            break;
+        }
+        out_.push_back(chunk);
+    }
+    if (taken > 0) {
+        backend_.mark_dirty(*this);
+    }
+    if (taken == 0 && n > 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return static_cast<ssize_t>(taken);
+}
+
+inline void UringChannel::release() {
+    backend_.release(*this);
+}
+
+#endif // TRANSPORT_URING_BACKEND_HPP
@@ -0,0 +1,301 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+#include "../src/client/client.hpp"
+
+/*
+CLIENT BENCHMARK
+
+Throughput of src/client/client.hpp against the naive client every application hand-rolls today: one
+blocking socket per thread, write a framed GET, read its reply, repeat (tests/client.cpp, framed). `ops` GETs
+of 100-byte values over `keys` keys per mode:
+
+    naive               `threads` threads, each on its own blocking connection, one request at a time
+    pool futures        `threads` threads sharing a ClientPool, each keeping `window` futures in flight
+    pool callbacks      `window` callback chains: each reply's callback issues the next call, from the io thread
+    pool coroutines     `window` ClientTask coroutines, each co_awaiting one GET after another
+
+The pool has `connections` connections. The server runs in a forked child with its output sent to
+/dev/null, so the CPU time reported is the client process's alone (CLOCK_PROCESS_CPUTIME_ID). ops/cpu-s is
+throughput per fully used client core, which is what the library is meant to improve. calls/write is how many
+calls the pool sent per writev (naive is 1 by construction).
+
+usage: client_benchmark [ops=200000] [threads=4] [window=64] [connections=2] [keys=10000] [port=7392]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Row {
+    std::string name;
+    double seconds = 0;
+    double cpu_seconds = 0;
+    uint64_t ops = 0;
+    uint64_t errors = 0;
+    double calls_per_write = 1;
+};
+
+static double cpu_now() {
+    timespec ts;
+    ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// times `body` in wall and client cpu seconds
+template<typename F>
+static Row measure(std::string name, uint64_t ops, F&& body) {
+    Row row;
+    row.name = std::move(name);
+    row.ops = ops;
+    double cpu = cpu_now();
+    auto start = Clock::now();
+    row.errors = body();
+    row.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    row.cpu_seconds = cpu_now() - cpu;
+    return row;
+}
+
+static std::string frame(const std::vector<std::string>& args) {
+    std::string body;
+    for (const auto& a : args) {
+        uint32_t len = htonl(static_cast<uint32_t>(a.size()));
+        body.append(reinterpret_cast<const char*>(&len), 4).append(a);
+    }
+    uint32_t total = htonl(static_cast<uint32_t>(body.size()));
+    return std::string(reinterpret_cast<const char*>(&total), 4) + body;
+}
+
+static int dial(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// one blocking request/response
+static bool round_trip(int fd, const std::string& request, std::vector<char>& buffer) {
+    if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) return false;
+    size_t have = 0;
+    while (true) {
+        if (have >= 4) {
+            uint32_t len;
+            std::memcpy(&len, buffer.data(), 4);
+            if (have >= 4 + len) return true;
+            if (buffer.size() < 4 + len) buffer.resize(4 + len);
+        }
+        ssize_t n = ::read(fd, buffer.data() + have, buffer.size() - have);
+        if (n <= 0) return false;
+        have += static_cast<size_t>(n);
+    }
+}
+
+struct Chain {
+    ClientPool* pool;
+    const std::vector<std::string>* keys;
+    std::atomic<int64_t>* left;         // calls not yet issued
+    std::atomic<int64_t>* remaining;    // calls not yet answered
+    std::atomic<uint64_t>* errors;
+    std::promise<void>* done;
+    size_t next;
+
+    void issue() {
+        if (left->fetch_sub(1) <= 0) {
+            return;
+        }
+        const std::string& key = (*keys)[next++ % keys->size()];
+        pool->call({"GET", key}, [this](Result<Reply> r) {
+            if (!r || r->is_nil()) errors->fetch_add(1);
+            issue();
+            // last: once done is set main() may free the chains
+            if (remaining->fetch_sub(1) == 1) done->set_value();
+        });
+    }
+};
+
+static ClientTask get_loop(ClientPool& pool, const std::vector<std::string>& keys, size_t first, size_t count,
+                           std::atomic<uint64_t>& errors, std::atomic<size_t>& finished, std::promise<void>& done,
+                           size_t coroutines) {
+    for (size_t i = 0; i < count; ++i) {
+        std::array<ClientArg, 2> args{"GET", keys[(first + i) % keys.size()]};
+        auto r = co_await pool.async(args);
+        if (!r || r->is_nil()) errors.fetch_add(1);
+    }
+    if (finished.fetch_add(1) + 1 == coroutines) done.set_value();
+}
+
+int main(int argc, char** argv) {
+    uint64_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t threads = std::max<size_t>(1, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4);
+    size_t window = std::max<size_t>(1, argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64);
+    size_t connections = std::max<size_t>(1, argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 2);
+    size_t nkeys = std::max<size_t>(1, argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 10000);
+    uint16_t port = static_cast<uint16_t>(argc > 6 ? std::atoi(argv[6]) : 7392);
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        int null = ::open("/dev/null", O_WRONLY);
+        ::dup2(null, STDOUT_FILENO);
+        ::dup2(null, STDERR_FILENO);
+        Server server(port, 1);
+        if (!server.initialize()) _exit(1);
+        server.run();
+        _exit(0);
+    }
+    auto finish = [&](int code) {
+        ::kill(child, SIGKILL);
+        ::waitpid(child, nullptr, 0);
+        return code;
+    };
+
+    std::unique_ptr<ClientPool> pool;
+    for (int attempt = 0; attempt < 100 && !pool; ++attempt) {
+        if (auto p = ClientPool::connect({.port = port, .connections = connections, .unix_path = ""})) {
+            pool = std::move(*p);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    if (!pool) {
+        std::cerr << "can't reach the server on port " << port << "\n";
+        return finish(1);
+    }
+
+    std::vector<std::string> keys(nkeys);
+    std::string value(100, 'v');
+    {
+        std::vector<std::future<Result<Reply>>> loads;
+        for (size_t k = 0; k < nkeys; ++k) {
+            keys[k] = "key:" + std::to_string(k);
+            loads.push_back(pool->call({"SET", keys[k], value}));
+        }
+        for (auto& f : loads) {
+            if (!f.get()) {
+                std::cerr << "load failed\n";
+                return finish(1);
+            }
+        }
+    }
+
+    std::vector<Row> rows;
+    uint64_t per_thread = ops / threads;
+
+    rows.push_back(measure("naive", per_thread * threads, [&] {
+        std::atomic<uint64_t> errors{0};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                int fd = dial(port);
+                if (fd < 0) {
+                    errors += per_thread;
+                    return;
+                }
+                std::vector<char> buffer(4096);
+                for (uint64_t i = 0; i < per_thread; ++i) {
+                    if (!round_trip(fd, frame({"GET", keys[(t * per_thread + i) % nkeys]}), buffer)) ++errors;
+                }
+                ::close(fd);
+            });
+        }
+        for (auto& w : workers) w.join();
+        return errors.load();
+    }));
+
+    auto batching = [&](Row row, ClientPool::Stats before) {
+        auto after = pool->stats();
+        uint64_t writes = after.writes - before.writes;
+        row.calls_per_write = writes ? static_cast<double>(after.calls - before.calls) / static_cast<double>(writes) : 0;
+        return row;
+    };
+
+    auto before = pool->stats();
+    rows.push_back(batching(measure("pool futures", per_thread * threads, [&] {
+        std::atomic<uint64_t> errors{0};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::vector<std::future<Result<Reply>>> inflight;
+                for (uint64_t i = 0; i < per_thread;) {
+                    inflight.clear();
+                    for (size_t w = 0; w < window && i < per_thread; ++w, ++i) {
+                        inflight.push_back(pool->call({"GET", keys[(t * per_thread + i) % nkeys]}));
+                    }
+                    for (auto& f : inflight) {
+                        auto r = f.get();
+                        if (!r || r->is_nil()) ++errors;
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        return errors.load();
+    }), before));
+
+    before = pool->stats();
+    rows.push_back(batching(measure("pool callbacks", ops, [&] {
+        std::atomic<int64_t> left{static_cast<int64_t>(ops)}, remaining{static_cast<int64_t>(ops)};
+        std::atomic<uint64_t> errors{0};
+        std::promise<void> done;
+        std::vector<Chain> chains(window);
+        for (size_t c = 0; c < window; ++c) {
+            chains[c] = {pool.get(), &keys, &left, &remaining, &errors, &done, c * 7919};
+        }
+        for (auto& chain : chains) chain.issue();
+        done.get_future().wait();
+        return errors.load();
+    }), before));
+
+    before = pool->stats();
+    uint64_t per_coroutine = ops / window;
+    rows.push_back(batching(measure("pool coroutines", per_coroutine * window, [&] {
+        std::atomic<uint64_t> errors{0};
+        std::atomic<size_t> finished{0};
+        std::promise<void> done;
+        for (size_t c = 0; c < window; ++c) {
+            get_loop(*pool, keys, c * per_coroutine, per_coroutine, errors, finished, done, window);
+        }
+        done.get_future().wait();
+        return errors.load();
+    }), before));
+
+    pool.reset();
+    finish(0);
+
+    std::cout << "ops=" << ops << " threads=" << threads << " window=" << window << " connections=" << connections
+              << " keys=" << nkeys << "\n"
+              << std::left << std::setw(18) << "mode" << std::right << std::setw(12) << "ops/s" << std::setw(14)
+              << "ops/cpu-s" << std::setw(13) << "calls/write" << std::setw(9) << "errors" << "\n";
+    int code = 0;
+    for (const auto& row : rows) {
+        std::cout << std::left << std::setw(18) << row.name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << static_cast<double>(row.ops) / row.seconds << std::setw(14)
+                  << static_cast<double>(row.ops) / row.cpu_seconds << std::setprecision(1) << std::setw(13)
+                  << row.calls_per_write << std::setw(9) << row.errors << "\n";
+        code |= row.errors != 0;
+    }
+    return code;
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../server.hpp"
+#include "../src/client/client.hpp"
+
+/*
+CLIENT LIBRARY TESTS
+*/
+
+// a Server in a forked child, output to /dev/null, killed with the object
+struct ForkedServer {
+    pid_t pid;
+    uint16_t port;
+
+    explicit ForkedServer(uint16_t p) : port(p) {
+        pid = ::fork();
+        if (pid == 0) {
+            int null = ::open("/dev/null", O_WRONLY);
+            ::dup2(null, STDOUT_FILENO);
+            ::dup2(null, STDERR_FILENO);
+            Server server(port, 1);
+            if (!server.initialize()) _exit(1);
+            server.run();
+            _exit(0);
+        }
+    }
+    ~ForkedServer() { stop(); }
+
+    void stop() {
+        if (pid > 0) {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+
+    std::unique_ptr<ClientPool> pool(size_t connections) {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            auto p = ClientPool::connect({.port = port, .connections = connections, .unix_path = ""});
+            if (p) return std::move(*p);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return nullptr;
+    }
+};
+
+TEST(ClientTest, FuturesAndReplyTypes) {
+    ForkedServer server(7411);
+    auto pool = server.pool(2);
+    ASSERT_TRUE(pool);
+
+    auto set = pool->call({"SET", "k", "hello"}).get();
+    ASSERT_TRUE(set);
+    EXPECT_FALSE(set->is_error());
+    auto get = pool->call({"GET", "k"}).get();
+    ASSERT_TRUE(get);
+    EXPECT_EQ(get->type, SerializationType::String);
+    EXPECT_EQ(get->str, "hello");
+    auto exists = pool->call({"EXISTS", "k"}).get();
+    ASSERT_TRUE(exists);
+    EXPECT_EQ(exists->type, SerializationType::Integer);
+    EXPECT_EQ(exists->integer, 1);
+    EXPECT_TRUE(pool->call({"GET", "missing"}).get()->is_nil());
+    EXPECT_TRUE(pool->call({"NOSUCHCOMMAND"}).get()->is_error());
+
+    std::string huge(ClientPool::k_max_frame, 'x');
+    EXPECT_EQ(pool->call({"SET", "k", huge}).get().error(), std::errc::message_size);
+}
+
+TEST(ClientTest, ConcurrentCallsArePipelined) {
+    ForkedServer server(7412);
+    auto pool = server.pool(2);
+    ASSERT_TRUE(pool);
+
+    constexpr int k_threads = 4, k_calls = 500;
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_threads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<std::string> keys(k_calls), values(k_calls);
+            std::vector<std::future<Result<Reply>>> sets;
+            for (int i = 0; i < k_calls; ++i) {
+                keys[i] = "t" + std::to_string(t) + ":" + std::to_string(i);
+                values[i] = std::to_string(i * 7);
+                sets.push_back(pool->call({"SET", keys[i], values[i]}));
+            }
+            for (auto& f : sets) {
+                if (!f.get()) ++wrong;
+            }
+            // callbacks, with everything in flight at once
+            std::atomic<int> left{k_calls};
+            std::promise<void> all;
+            for (int i = 0; i < k_calls; ++i) {
+                pool->call({"GET", keys[i]}, [&, i](Result<Reply> r) {
+                    if (!r || r->str != values[i]) ++wrong;
+                    if (--left == 0) all.set_value();
+                });
+            }
+            all.get_future().wait();
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(wrong.load(), 0);
+    auto stats = pool->stats();
+    EXPECT_EQ(stats.calls, 2u * k_threads * k_calls);
+    EXPECT_EQ(stats.replies, stats.calls);
+    EXPECT_LE(stats.writes, stats.calls);
+}
+
+TEST(ClientTest, BinaryVectorArgumentsAreNotCopied) {
+    ForkedServer server(7413);
+    auto pool = server.pool(1);
+    ASSERT_TRUE(pool);
+
+    std::vector<float> v(300);
+    for (size_t i = 0; i < v.size(); ++i) v[i] = static_cast<float>(i) * 0.5f;
+    ASSERT_GE(v.size() * sizeof(float), ClientPool::k_zero_copy_min);
+    ASSERT_TRUE(pool->call({"SET", "vec", ClientArg::binary(std::span<const float>(v))}).get());
+
+    auto get = pool->call({"GET", "vec"}).get();
+    ASSERT_TRUE(get);
+    ASSERT_EQ(get->str.size(), v.size() * sizeof(float));
+    EXPECT_EQ(std::memcmp(get->str.data(), v.data(), get->str.size()), 0);
+}
+
+static ClientTask count_up(ClientPool& pool, int n, std::promise<int>& done) {
+    int seen = 0;
+    for (int i = 0; i < n; ++i) {
+        std::string value = std::to_string(i);
+        // named arrays: GCC 12 can't put a braced argument list in a coroutine frame
+        std::array<ClientArg, 3> set_args{"SET", "co", value};
+        std::array<ClientArg, 2> get_args{"GET", "co"};
+        auto set = co_await pool.async(set_args);
+        auto get = co_await pool.async(get_args);
+        if (set && get && get->str == value) ++seen;
+    }
+    done.set_value(seen);
+}
+
+TEST(ClientTest, CoroutinesAndServerLoss) {
+    ForkedServer server(7414);
+    auto pool = server.pool(2);
+    ASSERT_TRUE(pool);
+
+    std::promise<int> done;
+    count_up(*pool, 100, done);
+    EXPECT_EQ(done.get_future().get(), 100);
+
+    server.stop();
+    // every call either fails on the dead connection or finds none left
+    for (int i = 0; i < 4; ++i) {
+        auto r = pool->call({"GET", "co"}).get();
+        ASSERT_FALSE(r);
+        EXPECT_TRUE(r.error() == std::errc::connection_reset || r.error() == std::errc::not_connected);
+    }
+    EXPECT_FALSE(ClientPool::connect({.port = 7414, .unix_path = ""}));
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include "../command_processor.hpp"
+
+/*
+COMMAND STATS BENCHMARK
+
+What per-command latency recording costs. `keys` string keys are loaded and uniform GETs run through
+CommandProcessor::process_command from `threads` threads sharing one EntryManager, with CommandStats disabled
+and enabled (interleaved, best of 3). Reports:
+    throughput with and without recording, and the overhead
+    the cost of one timed record (two timestamps + histogram update) in a tight loop
+    what LATENCY GET reported for the last enabled run, next to the mean from wall time
+
+usage: command_stats_benchmark [keys=100000] [ops_per_thread=2000000] [threads=1]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+    unsigned threads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 1;
+
+    EntryManager db;
+    for (size_t i = 0; i < keys; ++i) {
+        db.create_entry<std::string>("key:" + std::to_string(i), "value");
+    }
+
+    std::vector<std::vector<std::vector<std::string>>> streams(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        std::mt19937_64 rng(100 + t);
+        streams[t].reserve(ops);
+        for (size_t n = 0; n < ops; ++n) {
+            streams[t].push_back({"GET", "key:" + std::to_string(rng() % keys)});
+        }
+    }
+
+    std::cout << "keys=" << keys << " ops=" << ops * threads << " threads=" << threads << "\n";
+
+    CommandStats& stats = CommandStats::instance();
+    double best[2] = {0, 0};
+    double enabled_wall_us = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (int on = 0; on < 2; ++on) {
+            stats.set_enabled(on);
+            stats.reset();
+            auto t0 = Clock::now();
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; ++t) {
+                pool.emplace_back([&, t] {
+                    std::vector<uint8_t> response;
+                    for (const auto& args : streams[t]) {
+                        response.clear();
+                        CommandProcessor::process_command({args, response, db});
+                    }
+                });
+            }
+            for (auto& th : pool) th.join();
+            double s = std::chrono::duration<double>(Clock::now() - t0).count();
+            best[on] = std::max(best[on], static_cast<double>(ops * threads) / s);
+            if (on) enabled_wall_us = s * 1e6 * threads / static_cast<double>(ops * threads);
+        }
+    }
+    std::string latency = stats.latency("get");
+
+    // the bare recording path
+    const size_t records = 20000000;
+    size_t id = stats.id("get");
+    auto t0 = Clock::now();
+    for (size_t n = 0; n < records; ++n) {
+        uint64_t start = CommandStats::now();
+        stats.record(id, CommandStats::now() - start);
+    }
+    double record_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / records;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "recording off  " << best[0] / 1e6 << " M GET/s\n"
+              << "recording on   " << best[1] / 1e6 << " M GET/s  overhead " << std::setprecision(1)
+              << 100.0 * (best[0] / best[1] - 1.0) << "%\n"
+              << "one timed record " << record_ns << " ns\n"
+              << "LATENCY GET: " << latency
+              << "mean from wall time " << std::setprecision(2) << enabled_wall_us << " us/op per thread\n";
+    return 0;
+}
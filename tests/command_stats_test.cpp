@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../command_processor.hpp"
+
+/*
+COMMAND STATS TESTS
+*/
+
+TEST(CommandStatsTest, HistogramBucketsAreLogLinear) {
+    // every bucket starts where the previous one ends
+    for (size_t i = 1; i < LatencyHistogram::k_buckets; ++i) {
+        EXPECT_EQ(LatencyHistogram::lower(i), LatencyHistogram::lower(i - 1) + LatencyHistogram::width(i - 1)) << i;
+    }
+    std::mt19937_64 rng(5);
+    for (int n = 0; n < 100000; ++n) {
+        uint64_t v = rng() >> (rng() % 64);
+        size_t b = LatencyHistogram::bucket(v);
+        ASSERT_LT(b, LatencyHistogram::k_buckets);
+        EXPECT_GE(v, LatencyHistogram::lower(b));
+        EXPECT_LT(v - LatencyHistogram::lower(b), LatencyHistogram::width(b));
+        // relative bucket width bounded by 1/32
+        EXPECT_LE(LatencyHistogram::width(b) * LatencyHistogram::k_sub, std::max<uint64_t>(v, LatencyHistogram::k_sub));
+    }
+}
+
+TEST(CommandStatsTest, QuantilesWithinBucketError) {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v);
+    LatencyHistogram::Snapshot snap;
+    snap.add(h);
+    EXPECT_EQ(snap.calls, 100000u);
+    EXPECT_EQ(snap.max, 100000u);
+    EXPECT_NEAR(static_cast<double>(snap.quantile(0.5)), 50000.0, 50000.0 / 32);
+    EXPECT_NEAR(static_cast<double>(snap.quantile(0.99)), 99000.0, 99000.0 / 32);
+    EXPECT_NEAR(static_cast<double>(snap.quantile(0.999)), 99900.0, 99900.0 / 32);
+    EXPECT_EQ(snap.quantile(1.0), 100000u);
+}
+
+TEST(CommandStatsTest, InfoAndLatencyMergeThreads) {
+    EntryManager db;
+    CommandStats::instance().reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<uint8_t> response;
+            for (int n = 0; n < 1000; ++n) {
+                std::vector<std::string> set{"SET", "k" + std::to_string(t) + ":" + std::to_string(n), "v"};
+                std::vector<std::string> get{"get", set[1]};
+                response.clear();
+                CommandProcessor::process_command({set, response, db});
+                response.clear();
+                CommandProcessor::process_command({get, response, db});
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    std::vector<uint8_t> response;
+    std::vector<std::string> info{"INFO", "commandstats"};
+    CommandProcessor::process_command({info, response, db});
+    std::string out = ResponseSerializer::deserialize_string(response);
+    EXPECT_NE(out.find("cmdstat_get:calls=4000,"), std::string::npos) << out;
+    EXPECT_NE(out.find("cmdstat_set:calls=4000,"), std::string::npos) << out;
+
+    std::vector<std::string> latency{"LATENCY", "GET"};
+    response.clear();
+    CommandProcessor::process_command({latency, response, db});
+    out = ResponseSerializer::deserialize_string(response);
+    EXPECT_EQ(out.rfind("get calls=4000 ", 0), 0u) << out;
+    EXPECT_NE(out.find("p999="), std::string::npos) << out;
+
+    // after a reset only what follows counts
+    std::vector<std::string> reset{"LATENCY", "RESET"};
+    response.clear();
+    CommandProcessor::process_command({reset, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response), "OK");
+    auto after = CommandStats::instance().summaries();
+    ASSERT_EQ(after.size(), 1u); // the RESET itself, timed once it returned
+    EXPECT_EQ(after[0].command, "latency");
+    EXPECT_EQ(after[0].calls, 1u);
+
+    std::vector<std::string> bad{"INFO", "nosuchsection"};
+    response.clear();
+    CommandProcessor::process_command({bad, response, db});
+    EXPECT_NE(ResponseSerializer::deserialize_error(response), "No error");
+}
@@ -0,0 +1,206 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "../src/cache/CountMinSketch.cpp"
+
+/*
+COUNT-MIN SKETCH BENCHMARK
+
+Compares the cache-line-blocked CountMinSketch (with and without its doorkeeper) against the classic layout it
+replaced: 4 independent rows of 4-bit counters, one hash per row, so 4 cache lines per operation.
+
+    throughput   increment() and getCountMin() with uniform keys over sketches of `sketch_mib` each - pick it
+                 well above the LLC to measure the memory-bound case, or small to measure compute - single
+                 thread, and increment() from 1..threads threads sharing one blocked sketch (the row sketch
+                 isn't thread-safe, so it only runs single-threaded)
+    accuracy     a Zipf(skew) stream of `ops` keys drawn from `keys`, sketch sized to `counters` per depth.
+                 For every key with true count <= 15 (the counters saturate there): mean absolute error and
+                 the fraction overestimated; plus how many one-hit keys look like >= 2 hits, which is what
+                 pollutes an admission or tiering decision.
+
+usage: count_min_sketch_benchmark [keys=4000000] [counters=4194304] [ops=20000000] [skew=0.9] [sketch_mib=512]
+                                  [threads=nproc]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+// the previous layout, kept here as the baseline
+class RowSketch {
+public:
+    explicit RowSketch(size_t counters) : rows_(4, std::vector<uint64_t>(std::bit_ceil(counters) / 16)),
+                                          mask_(std::bit_ceil(counters) - 1) {}
+
+    int getCountMin(uint64_t hash) const {
+        int min = 15;
+        for (int i = 0; i < 4; ++i) {
+            size_t idx = index(hash, i);
+            min = std::min(min, static_cast<int>((rows_[i][idx / 16] >> (idx % 16 * 4)) & 0xF));
+        }
+        return min;
+    }
+
+    void increment(uint64_t hash) {
+        for (int i = 0; i < 4; ++i) {
+            size_t idx = index(hash, i);
+            uint64_t& w = rows_[i][idx / 16];
+            if (((w >> (idx % 16 * 4)) & 0xF) < 15) {
+                w += uint64_t{1} << (idx % 16 * 4);
+            }
+        }
+    }
+
+private:
+    std::vector<std::vector<uint64_t>> rows_;
+    size_t mask_;
+
+    size_t index(uint64_t hash, int i) const {
+        static constexpr uint64_t k_seeds[4] = {0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+                                                0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull};
+        uint64_t h = (hash ^ k_seeds[i]) * 0xff51afd7ed558ccdull;
+        return static_cast<size_t>(h >> 29) & mask_;
+    }
+};
+
+static uint64_t key_hash(uint64_t i) {
+    uint64_t h = i + 0x9e3779b97f4a7c15ull;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s, uint64_t seed) : cdf_(n), rng_(seed) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    size_t next() {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+        return static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+};
+
+template<typename Sketch>
+static void throughput(const char* name, Sketch& sketch, const std::vector<uint64_t>& hashes) {
+    auto t0 = Clock::now();
+    for (uint64_t h : hashes) sketch.increment(h);
+    double inc = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    uint64_t sum = 0;
+    t0 = Clock::now();
+    for (uint64_t h : hashes) sum += static_cast<uint64_t>(sketch.getCountMin(h));
+    double est = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    double n = static_cast<double>(hashes.size());
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(1)
+              << " increment " << std::setw(7) << n / inc / 1e6 << " M/s   estimate " << std::setw(7)
+              << n / est / 1e6 << " M/s   (checksum " << sum % 1000 << ")\n";
+}
+
+template<typename Sketch>
+static void accuracy(const char* name, Sketch& sketch, const std::vector<uint64_t>& stream, size_t keys) {
+    std::vector<uint32_t> exact(keys);
+    for (uint64_t k : stream) {
+        sketch.increment(key_hash(k));
+        ++exact[k];
+    }
+    double abs_err = 0;
+    size_t counted = 0, over = 0, singles = 0, singles_polluted = 0;
+    for (size_t k = 0; k < keys; ++k) {
+        if (exact[k] == 0 || exact[k] > 15) continue;
+        int est = sketch.getCountMin(key_hash(k));
+        abs_err += std::abs(est - static_cast<int>(exact[k]));
+        over += est > static_cast<int>(exact[k]);
+        ++counted;
+        if (exact[k] == 1) {
+            ++singles;
+            singles_polluted += est >= 2;
+        }
+    }
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3)
+              << " mean abs err " << abs_err / static_cast<double>(counted) << "   overestimated "
+              << std::setprecision(1) << 100.0 * static_cast<double>(over) / static_cast<double>(counted)
+              << "%   one-hit keys estimated >= 2: "
+              << 100.0 * static_cast<double>(singles_polluted) / static_cast<double>(std::max<size_t>(1, singles))
+              << "%\n";
+}
+
+int main(int argc, char** argv) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    size_t counters = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1 << 22;
+    size_t ops = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000000;
+    double skew = argc > 4 ? std::strtod(argv[4], nullptr) : 0.9;
+    size_t sketch_mib = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 512;
+    unsigned threads = argc > 6 ? static_cast<unsigned>(std::atoi(argv[6])) : std::thread::hardware_concurrency();
+    // counters per depth that make each sketch sketch_mib: 4 rows x 4 bits = 2 bytes per counter-per-depth
+    size_t big = std::max<size_t>(64, (sketch_mib << 20) / 2);
+
+    std::cout << "keys=" << keys << " counters=" << counters << " ops=" << ops << " skew=" << skew << "\n\n";
+
+    // throughput: uniform hashes, so the working set is the whole sketch
+    std::vector<uint64_t> hashes(ops);
+    std::mt19937_64 rng(1);
+    for (auto& h : hashes) h = rng();
+    {
+        RowSketch rows(big);
+        CountMinSketch blocked(big, false);
+        CountMinSketch door(big / 4 * 3); // same bytes: a quarter of each block is doorkeeper
+        std::cout << "throughput (" << blocked.memory_bytes() / (1 << 20) << " MiB per sketch):\n";
+        throughput("rows (4 lines/op)", rows, hashes);
+        throughput("blocked", blocked, hashes);
+        throughput("blocked + doorkeeper", door, hashes);
+    }
+
+    std::cout << "\nconcurrent increment, one shared blocked sketch:\n";
+    for (unsigned t = 1; t <= threads; t *= 2) {
+        CountMinSketch shared(big / 4 * 3);
+        std::vector<std::thread> pool;
+        size_t per = hashes.size() / t;
+        auto t0 = Clock::now();
+        for (unsigned i = 0; i < t; ++i) {
+            pool.emplace_back([&, i] {
+                for (size_t n = i * per; n < (i + 1) * per; ++n) shared.increment(hashes[n]);
+            });
+        }
+        for (auto& th : pool) th.join();
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "  threads=" << std::setw(3) << t << "  " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(per * t) / s / 1e6 << " M increments/s\n";
+        if (t < threads && t * 2 > threads) t = threads / 2; // make sure `threads` itself runs
+    }
+
+    std::cout << "\naccuracy (Zipf stream):\n";
+    Zipf zipf(keys, skew, 2);
+    std::vector<uint64_t> stream(ops);
+    for (auto& k : stream) k = zipf.next();
+    {
+        RowSketch rows(counters);
+        accuracy("rows", rows, stream, keys);
+    }
+    {
+        CountMinSketch blocked(counters, false);
+        accuracy("blocked", blocked, stream, keys);
+    }
+    {
+        CountMinSketch door(counters / 4 * 3); // same memory as the two above
+        accuracy("blocked + doorkeeper", door, stream, keys);
+    }
+    return 0;
+}
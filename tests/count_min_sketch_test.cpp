@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "../src/cache/CountMinSketch.cpp"
+
+/*
+COUNT-MIN SKETCH TESTS
+*/
+
+static uint64_t key_hash(uint64_t i) {
+    return std::hash<uint64_t>{}(i) * 0x9e3779b97f4a7c15ull;
+}
+
+TEST(CountMinSketchTest, NeverUnderestimatesAndSaturates) {
+    CountMinSketch sketch(4096);
+    std::mt19937_64 rng(1);
+    std::unordered_map<uint64_t, int> exact;
+    for (int n = 0; n < 20000; ++n) {
+        uint64_t k = rng() % 2000;
+        sketch.increment(key_hash(k));
+        ++exact[k];
+    }
+    for (const auto& [k, count] : exact) {
+        EXPECT_GE(sketch.getCountMin(key_hash(k)), std::min(count, CountMinSketch::MAX_COUNT + 1)) << k;
+    }
+    EXPECT_LE(sketch.getCountMin(key_hash(0)), CountMinSketch::MAX_COUNT + 1);
+}
+
+TEST(CountMinSketchTest, DoorkeeperAbsorbsFirstHit) {
+    CountMinSketch sketch(1024);
+    EXPECT_EQ(sketch.getCountMin(key_hash(7)), 0);
+    sketch.increment(key_hash(7));
+    EXPECT_EQ(sketch.getCountMin(key_hash(7)), 1);
+    sketch.increment(key_hash(7));
+    sketch.increment(key_hash(7));
+    EXPECT_EQ(sketch.getCountMin(key_hash(7)), 3);
+
+    // decay halves the counters (2 -> 1) and forgets the doorkeeper bit
+    sketch.decay();
+    EXPECT_EQ(sketch.getCountMin(key_hash(7)), 1);
+    sketch.clear();
+    EXPECT_EQ(sketch.getCountMin(key_hash(7)), 0);
+}
+
+TEST(CountMinSketchTest, WithoutDoorkeeperCountsEveryHit) {
+    CountMinSketch sketch(1024, false);
+    sketch.increment(key_hash(3));
+    EXPECT_EQ(sketch.getCountMin(key_hash(3)), 1);
+    for (int i = 0; i < 40; ++i) sketch.increment(key_hash(3));
+    EXPECT_EQ(sketch.getCountMin(key_hash(3)), CountMinSketch::MAX_COUNT);
+    sketch.decay();
+    EXPECT_EQ(sketch.getCountMin(key_hash(3)), CountMinSketch::MAX_COUNT / 2);
+}
+
+TEST(CountMinSketchTest, ConcurrentIncrementsNeverCarryIntoNeighbours) {
+    // tiny sketch so every thread hammers the same few words
+    CountMinSketch sketch(64, false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (int n = 0; n < 100000; ++n) {
+                sketch.increment(key_hash(static_cast<uint64_t>((n + t) % 8)));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (uint64_t k = 0; k < 8; ++k) {
+        EXPECT_EQ(sketch.getCountMin(key_hash(k)), CountMinSketch::MAX_COUNT);
+    }
+    // an untouched key may share counters, but a wrapped nibble would show up as < MAX here or garbage above
+    EXPECT_LE(sketch.getCountMin(key_hash(1000)), CountMinSketch::MAX_COUNT);
+}
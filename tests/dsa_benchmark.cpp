@@ -0,0 +1,457 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../src/dsa/hashtable.hpp"
+#include "../src/dsa/heap.hpp"
+#include "../src/dsa/avl_lockfree.hpp"
+#include "../src/dsa/skiplist.hpp"
+#include "../src/dsa/zset.hpp"
+#include "../src/dsa/thread_pool.hpp"
+#include "../request_parser.hpp"
+#include "../response_serializer.hpp"
+
+/*
+DSA MICROBENCHMARK
+
+One target for every container in src/dsa plus the protocol codecs. Each workload runs with every combination
+of:
+    - key distribution: uniform, or zipfian (s = 0.99) over `keys` keys
+    - read share: 50% or 95% of operations are reads
+    - threads: 1, 2, 4, ... up to max_threads
+Each thread runs `ops` operations against one shared instance. Operation streams are generated before the
+timed region.
+
+    hmap        find / insert
+    avl         get / set                         (avl_lockfree, the tree ZSet sorts with)
+    skiplist    contains / add (no remove: it frees nodes concurrent readers may still be on)
+    heap        operator[] / push + pop
+    zset        query / add_internal (score update once the member exists)
+    threadpool  enqueue a small task; `threads` is the pool size, one submitter, no keys
+    parser      RequestParser::parse of GET / SET frames
+    serializer  ResponseSerializer of a bulk string / an integer
+
+Workloads without keys run once per thread count. Their "read" means the GET frame or the string reply.
+
+Each run is bracketed by perf_event_open counters, inherited by the worker threads and read after they join:
+    - hardware: cycles, instructions, LLC read misses, branch misses
+    - software: task clock, context switches, page faults
+Counts are user-space only, so perf_event_paranoid <= 2 is enough. Hardware counters are often missing in
+VMs and containers; those fields are null in the JSON. Multiplexed counters are scaled by enabled/running
+time.
+
+Results print as a table and are written as JSON to `json` ("-" for stdout), one object per run, for
+regression tracking. `only` picks a single workload.
+
+usage: dsa_benchmark [ops=100000] [max_threads=4] [keys=100000] [json=dsa_benchmark.json] [only=all]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+class PerfCounters {
+public:
+    enum Event { Cycles, Instructions, LlcMisses, BranchMisses, TaskClock, ContextSwitches, PageFaults, k_events };
+    static constexpr std::array<std::string_view, k_events> k_names{
+        "cycles", "instructions", "llc_misses", "branch_misses", "task_clock_ns", "context_switches", "page_faults"};
+
+    // opens and starts every counter; threads created after this are counted too
+    PerfCounters() {
+        open(Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(LlcMisses, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        open(BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(TaskClock, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+        open(ContextSwitches, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+        open(PageFaults, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // totals including exited child threads; nullopt for counters that couldn't be opened
+    std::array<std::optional<double>, k_events> read() const {
+        std::array<std::optional<double>, k_events> out;
+        for (size_t e = 0; e < k_events; ++e) {
+            uint64_t v[3]; // value, time enabled, time running
+            if (fds_[e] < 0 || ::read(fds_[e], v, sizeof(v)) != static_cast<ssize_t>(sizeof(v))) continue;
+            out[e] = v[2] == 0 ? 0.0 : static_cast<double>(v[0]) * static_cast<double>(v[1]) / static_cast<double>(v[2]);
+        }
+        return out;
+    }
+
+    // why the first unavailable counter failed, empty if all opened
+    const std::string& error() const { return error_; }
+
+private:
+    void open(Event e, uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds_[e] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fds_[e] < 0 && error_.empty()) {
+            error_ = std::string(k_names[e]) + ": " + std::strerror(errno);
+        }
+    }
+
+    std::array<int, k_events> fds_{};
+    std::string error_;
+};
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s) : cdf_(n) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    template<typename Rng>
+    uint32_t next(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return static_cast<uint32_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+struct Op {
+    uint32_t key;
+    bool read;
+};
+
+struct Params {
+    std::string_view distribution;      // "uniform" | "zipf" | "none"
+    int read_pct;
+    size_t threads;
+    size_t ops;
+    uint32_t keys;
+};
+
+struct RunResult {
+    std::string_view workload;
+    Params params;
+    size_t total_ops;
+    double seconds;
+    std::array<std::optional<double>, PerfCounters::k_events> counters;
+};
+
+// one stream per thread; zipf ranks are scattered over the key space so hot keys aren't neighbours
+std::vector<std::vector<Op>> make_ops(const Params& p, const Zipf* zipf) {
+    std::vector<std::vector<Op>> streams(p.threads);
+    for (size_t t = 0; t < p.threads; ++t) {
+        std::mt19937_64 rng(t + 1);
+        std::uniform_int_distribution<uint32_t> uniform(0, p.keys - 1);
+        std::uniform_int_distribution<int> pct(0, 99);
+        streams[t].reserve(p.ops);
+        for (size_t i = 0; i < p.ops; ++i) {
+            uint32_t key = zipf ? static_cast<uint32_t>((zipf->next(rng) * 2654435761ull) % p.keys) : uniform(rng);
+            streams[t].push_back({key, pct(rng) < p.read_pct});
+        }
+    }
+    return streams;
+}
+
+// runs body(thread) on p.threads threads between counter open and read
+RunResult measure(const Params& p, const std::function<void(size_t)>& body) {
+    PerfCounters counters;
+    auto t0 = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < p.threads; ++t) workers.emplace_back(body, t);
+    for (auto& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    return {{}, p, p.threads * p.ops, seconds, counters.read()};
+}
+
+// a request frame as Connection reads it: big-endian total length, then length-prefixed strings
+std::vector<uint8_t> frame(const std::vector<std::string>& args) {
+    std::vector<uint8_t> out(4);
+    for (const auto& a : args) {
+        uint32_t len = __builtin_bswap32(static_cast<uint32_t>(a.size()));
+        out.insert(out.end(), reinterpret_cast<const uint8_t*>(&len), reinterpret_cast<const uint8_t*>(&len) + 4);
+        out.insert(out.end(), a.begin(), a.end());
+    }
+    uint32_t total = __builtin_bswap32(static_cast<uint32_t>(out.size() - 4));
+    std::memcpy(out.data(), &total, 4);
+    return out;
+}
+
+std::vector<std::string> make_names(uint32_t keys) {
+    std::vector<std::string> names(keys);
+    for (uint32_t k = 0; k < keys; ++k) names[k] = "member:" + std::to_string(k);
+    return names;
+}
+
+using Workload = std::function<RunResult(const Params&, const std::vector<std::vector<Op>>&)>;
+
+struct Entry {
+    std::string_view name;
+    bool keyed;                         // uses the key distribution and read share
+    Workload run;
+};
+
+std::vector<Entry> workloads() {
+    std::vector<Entry> all;
+
+    all.push_back({"hmap", true, [](const Params& p, const auto& ops) {
+        HMap<uint32_t, uint64_t> map;
+        for (uint32_t k = 0; k < p.keys; k += 2) map.insert(k, k);
+        return measure(p, [&](size_t t) {
+            uint64_t sink = 0;
+            for (const Op& op : ops[t]) {
+                if (op.read) {
+                    if (uint64_t* v = map.find(op.key)) sink += *v;
+                } else {
+                    map.insert(op.key, op.key);
+                }
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    all.push_back({"avl", true, [](const Params& p, const auto& ops) {
+        AVLTree<uint32_t, uint64_t> tree;
+        for (uint32_t k = 0; k < p.keys; k += 2) tree.set(k, k);
+        return measure(p, [&](size_t t) {
+            uint64_t sink = 0;
+            for (const Op& op : ops[t]) {
+                if (op.read) {
+                    if (auto v = tree.get(op.key)) sink += *v;
+                } else {
+                    tree.set(op.key, op.key);
+                }
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    all.push_back({"skiplist", true, [](const Params& p, const auto& ops) {
+        SkipList<uint32_t, uint64_t> list;
+        for (uint32_t k = 0; k < p.keys; k += 2) (void)list.add(k, k);
+        return measure(p, [&](size_t t) {
+            uint64_t sink = 0;
+            for (const Op& op : ops[t]) {
+                if (op.read) {
+                    sink += list.contains(op.key);
+                } else {
+                    sink += list.add(op.key, op.key);
+                }
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    all.push_back({"heap", true, [](const Params& p, const auto& ops) {
+        BinaryHeap<uint32_t> heap{std::less<uint32_t>()};
+        for (uint32_t k = 0; k < p.keys; k += 2) heap.push(HeapItem<uint32_t>(k, nullptr));
+        size_t base = heap.size();
+        return measure(p, [&](size_t t) {
+            uint64_t sink = 0;
+            for (const Op& op : ops[t]) {
+                if (op.read) {
+                    // never past `base`: every pop below follows this thread's own push
+                    sink += heap[op.key % base].value();
+                } else {
+                    heap.push(HeapItem<uint32_t>(op.key, nullptr));
+                    sink += heap.pop().value();
+                }
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    all.push_back({"zset", true, [](const Params& p, const auto& ops) {
+        ZSet zset(1);
+        std::vector<std::string> names = make_names(p.keys);
+        for (uint32_t k = 0; k < p.keys; k += 2) zset.add_internal(names[k], k);
+        return measure(p, [&](size_t t) {
+            uint64_t sink = 0;
+            for (const Op& op : ops[t]) {
+                if (op.read) {
+                    sink += zset.query(0, names[op.key], 0) != nullptr;
+                } else {
+                    sink += zset.add_internal(names[op.key], op.key + 0.5);
+                }
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    all.push_back({"threadpool", false, [](const Params& p, const auto&) {
+        // p.threads is the pool size; one submitter
+        Params one = p;
+        one.threads = 1;
+        std::atomic<uint64_t> done{0};
+        RunResult r = measure(one, [&](size_t) {
+            ThreadPool pool(p.threads);
+            for (size_t i = 0; i < p.ops; ++i) {
+                pool.enqueue([&done, i] { done.fetch_add(i & 1, std::memory_order_relaxed); });
+            }
+            pool.wait_for_tasks();
+        });
+        r.params.threads = p.threads;
+        return r;
+    }});
+
+    all.push_back({"parser", false, [](const Params& p, const auto&) {
+        std::vector<std::vector<uint8_t>> frames;
+        for (uint32_t k = 0; k < 1024; ++k) {
+            std::string key = "key:" + std::to_string(k);
+            frames.push_back(k % 2 ? frame({"GET", key}) : frame({"SET", key, std::string(32, 'v')}));
+        }
+        return measure(p, [&](size_t t) {
+            uint64_t sink = 0;
+            for (size_t i = 0; i < p.ops; ++i) {
+                auto cmd = RequestParser::parse(frames[(i + t) & 1023]);
+                sink += cmd ? cmd->size() : 0;
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    all.push_back({"serializer", false, [](const Params& p, const auto&) {
+        const std::string value(32, 'v');
+        return measure(p, [&](size_t) {
+            std::vector<uint8_t> buffer;
+            uint64_t sink = 0;
+            for (size_t i = 0; i < p.ops; ++i) {
+                buffer.clear();
+                if (i & 1) {
+                    ResponseSerializer::serialize_string(buffer, value);
+                } else {
+                    ResponseSerializer::serialize_integer(buffer, static_cast<int64_t>(i));
+                }
+                sink += buffer.size();
+            }
+            if (sink == 1) std::cout << "";
+        });
+    }});
+
+    return all;
+}
+
+std::string json_number(const std::optional<double>& v) {
+    if (!v) return "null";
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(0) << *v;
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+    uint32_t keys = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 100000;
+    std::string json_path = argc > 4 ? argv[4] : "dsa_benchmark.json";
+    std::string only = argc > 5 ? argv[5] : "all";
+
+    std::vector<size_t> thread_counts;
+    for (size_t t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(std::max<size_t>(1, max_threads));
+
+    Zipf zipf(keys, 0.99);
+    std::string counter_error = PerfCounters().error();
+    std::cout << "ops=" << ops << " max_threads=" << max_threads << " keys=" << keys << "\n";
+    if (!counter_error.empty()) {
+        std::cout << "some perf counters unavailable (" << counter_error << "); reported as null\n";
+    }
+    std::cout << std::left << std::setw(11) << "workload" << std::setw(8) << "dist" << std::setw(6) << "read%"
+              << std::setw(4) << "thr" << std::right << std::setw(12) << "Mops/s" << std::setw(10) << "ns/op"
+              << std::setw(10) << "cpu ns/op" << std::setw(8) << "IPC" << std::setw(10) << "LLC/op" << std::setw(12)
+              << "brmiss/op" << "\n";
+
+    // ZSet reports its own errors on stderr, per call
+    std::cerr.setstate(std::ios::failbit);
+    std::vector<RunResult> results;
+    for (const auto& w : workloads()) {
+        if (only != "all" && only != w.name) continue;
+        std::vector<std::pair<std::string_view, int>> mixes{{"none", 0}};
+        if (w.keyed) mixes = {{"uniform", 50}, {"uniform", 95}, {"zipf", 50}, {"zipf", 95}};
+        for (const auto& [dist, read_pct] : mixes) {
+            for (size_t threads : thread_counts) {
+                Params p{dist, read_pct, threads, ops, keys};
+                auto streams = w.keyed ? make_ops(p, dist == "zipf" ? &zipf : nullptr) : std::vector<std::vector<Op>>{};
+                RunResult r = w.run(p, streams);
+                double total = static_cast<double>(r.total_ops);
+                auto per_op = [&](PerfCounters::Event e) {
+                    return r.counters[e] ? *r.counters[e] / total : std::nan("");
+                };
+                double ipc = r.counters[PerfCounters::Cycles] && r.counters[PerfCounters::Instructions]
+                    ? *r.counters[PerfCounters::Instructions] / std::max(1.0, *r.counters[PerfCounters::Cycles])
+                    : std::nan("");
+                std::cout << std::left << std::setw(11) << w.name << std::setw(8) << dist << std::setw(6)
+                          << (w.keyed ? std::to_string(read_pct) : "-") << std::setw(4) << threads << std::right
+                          << std::fixed << std::setprecision(3) << std::setw(12) << total / r.seconds / 1e6
+                          << std::setprecision(1) << std::setw(10) << r.seconds * 1e9 / total << std::setw(10)
+                          << per_op(PerfCounters::TaskClock) << std::setprecision(2) << std::setw(8) << ipc
+                          << std::setw(10) << per_op(PerfCounters::LlcMisses) << std::setw(12)
+                          << per_op(PerfCounters::BranchMisses) << std::endl;
+                r.workload = w.name;
+                if (!w.keyed) r.params.read_pct = -1;
+                results.push_back(std::move(r));
+            }
+        }
+    }
+    std::cerr.clear();
+
+    std::ostringstream json;
+    json << "{\"benchmark\":\"dsa\",\"ops_per_thread\":" << ops << ",\"keys\":" << keys
+         << ",\"counter_error\":\"" << counter_error << "\",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const RunResult& r = results[i];
+        double total = static_cast<double>(r.total_ops);
+        json << (i ? "," : "") << "{\"workload\":\"" << r.workload << "\",\"distribution\":\""
+             << r.params.distribution << "\",\"read_pct\":"
+             << (r.params.read_pct < 0 ? std::string("null") : std::to_string(r.params.read_pct))
+             << ",\"threads\":" << r.params.threads << ",\"ops\":" << r.total_ops
+             << std::fixed << std::setprecision(6) << ",\"seconds\":" << r.seconds << std::setprecision(0)
+             << ",\"ops_per_sec\":" << total / r.seconds << std::setprecision(2)
+             << ",\"ns_per_op\":" << r.seconds * 1e9 / total;
+        for (size_t e = 0; e < PerfCounters::k_events; ++e) {
+            json << ",\"" << PerfCounters::k_names[e] << "\":" << json_number(r.counters[e]);
+        }
+        json << "}";
+    }
+    json << "]}\n";
+
+    if (json_path == "-") {
+        std::cout << json.str();
+    } else {
+        std::ofstream(json_path) << json.str();
+        std::cout << "wrote " << results.size() << " results to " << json_path << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+#include "../src/embedded/embedded_db.hpp"
+
+/*
+EMBEDDED BENCHMARK
+
+What a co-located service saves by linking the store (src/embedded/embedded_db.hpp) instead of talking to it
+over loopback TCP. `keys` keys with `value_size`-byte values are loaded both ways. Then `ops` random GETs are
+timed one call at a time, and again in batches of `batch`:
+
+    embedded get        EmbeddedDB::get
+    embedded mget       EmbeddedDB::mget, `batch` keys per call
+    tcp get             one framed GET, wait for the reply, repeat
+    tcp pipelined       `batch` framed GETs in one write, then read all the replies
+
+The server runs in a forked child on 127.0.0.1:`port` with its output sent to /dev/null, so its per-poll
+logging costs what it costs in production, but the terminal stays readable. Latency is per call (per batch
+for the batched rows) in us. The ns/key column puts the batched rows on the same footing as the single ones.
+
+usage: embedded_benchmark [ops=200000] [keys=10000] [value_size=100] [batch=32] [port=7391]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Row {
+    std::string name;
+    LatencyHistogram::Snapshot latency;
+    uint64_t keys = 0;
+    double seconds = 0;
+};
+
+static uint64_t ns_since(Clock::time_point t) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count());
+}
+
+static void append_frame(std::string& out, const std::vector<std::string_view>& args) {
+    std::string body;
+    for (auto a : args) {
+        uint32_t len = htonl(static_cast<uint32_t>(a.size()));
+        body.append(reinterpret_cast<const char*>(&len), 4).append(a);
+    }
+    uint32_t total = htonl(static_cast<uint32_t>(body.size()));
+    out.append(reinterpret_cast<const char*>(&total), 4).append(body);
+}
+
+static bool write_all(int fd, const std::string& data) {
+    for (size_t done = 0; done < data.size();) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// reads `count` replies (native u32 length + body)
+static bool read_replies(int fd, std::vector<char>& buffer, size_t count) {
+    size_t have = 0, pos = 0;
+    while (count > 0) {
+        while (have - pos >= 4) {
+            uint32_t len;
+            std::memcpy(&len, buffer.data() + pos, 4);
+            if (have - pos - 4 < len) break;
+            pos += 4 + len;
+            if (--count == 0) return true;
+        }
+        if (buffer.size() - have < 4096) buffer.resize(buffer.size() * 2);
+        ssize_t n = ::read(fd, buffer.data() + have, buffer.size() - have);
+        if (n <= 0) return false;
+        have += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t keys = std::max<size_t>(1, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000);
+    size_t value_size = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100;
+    size_t batch = std::max<size_t>(1, argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 32);
+    uint16_t port = static_cast<uint16_t>(argc > 5 ? std::atoi(argv[5]) : 7391);
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        int null = ::open("/dev/null", O_WRONLY);
+        ::dup2(null, STDOUT_FILENO);
+        ::dup2(null, STDERR_FILENO);
+        Server server(port, 1);
+        if (!server.initialize()) _exit(1);
+        server.run();
+        _exit(0);
+    }
+
+    std::vector<std::string> names(keys);
+    for (size_t k = 0; k < keys; ++k) names[k] = "key:" + std::to_string(k);
+    std::string value(value_size, 'v');
+    std::mt19937_64 rng(7);
+    std::vector<uint32_t> order(ops);
+    for (auto& o : order) o = static_cast<uint32_t>(rng() % keys);
+    std::vector<Row> rows;
+
+    // embedded
+    EmbeddedDB db;
+    for (const auto& name : names) db.set(name, value);
+    {
+        Row row;
+        row.name = "embedded get";
+        LatencyHistogram h;
+        uint64_t sink = 0;
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            auto t = Clock::now();
+            auto v = db.get(names[order[i]]);
+            sink += v && *v ? (*v)->size() : 0;
+            h.record(ns_since(t));
+        }
+        row.seconds = static_cast<double>(ns_since(start)) / 1e9;
+        row.keys = ops;
+        row.latency.add(h);
+        rows.push_back(std::move(row));
+        if (sink == 1) std::cout << "";
+    }
+    {
+        Row row;
+        row.name = "embedded mget";
+        LatencyHistogram h;
+        std::vector<std::string> chunk(batch);
+        uint64_t sink = 0;
+        auto start = Clock::now();
+        for (size_t i = 0; i + batch <= ops; i += batch) {
+            for (size_t j = 0; j < batch; ++j) chunk[j] = names[order[i + j]];
+            auto t = Clock::now();
+            auto values = db.mget(chunk);
+            sink += values.size();
+            h.record(ns_since(t));
+            row.keys += batch;
+        }
+        row.seconds = static_cast<double>(ns_since(start)) / 1e9;
+        row.latency.add(h);
+        rows.push_back(std::move(row));
+        if (sink == 1) std::cout << "";
+    }
+
+    // loopback tcp
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd < 0; ++attempt) {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            fd = -1;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    if (fd < 0) {
+        std::cerr << "can't reach the server on port " << port << "\n";
+        ::kill(child, SIGKILL);
+        ::waitpid(child, nullptr, 0);
+        return 1;
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::vector<char> buffer(1 << 16);
+    bool ok = true;
+    for (size_t k = 0; k < keys && ok; k += batch) {
+        std::string out;
+        size_t n = std::min(batch, keys - k);
+        for (size_t j = 0; j < n; ++j) append_frame(out, {"SET", names[k + j], value});
+        ok = write_all(fd, out) && read_replies(fd, buffer, n);
+    }
+    if (ok) {
+        Row row;
+        row.name = "tcp get";
+        LatencyHistogram h;
+        std::string out;
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops && ok; ++i) {
+            out.clear();
+            append_frame(out, {"GET", names[order[i]]});
+            auto t = Clock::now();
+            ok = write_all(fd, out) && read_replies(fd, buffer, 1);
+            h.record(ns_since(t));
+        }
+        row.seconds = static_cast<double>(ns_since(start)) / 1e9;
+        row.keys = ops;
+        row.latency.add(h);
+        rows.push_back(std::move(row));
+    }
+    if (ok) {
+        Row row;
+        row.name = "tcp pipelined";
+        LatencyHistogram h;
+        std::string out;
+        auto start = Clock::now();
+        for (size_t i = 0; i + batch <= ops && ok; i += batch) {
+            out.clear();
+            for (size_t j = 0; j < batch; ++j) append_frame(out, {"GET", names[order[i + j]]});
+            auto t = Clock::now();
+            ok = write_all(fd, out) && read_replies(fd, buffer, batch);
+            h.record(ns_since(t));
+            row.keys += batch;
+        }
+        row.seconds = static_cast<double>(ns_since(start)) / 1e9;
+        row.latency.add(h);
+        rows.push_back(std::move(row));
+    }
+    ::close(fd);
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+    if (!ok) {
+        std::cerr << "tcp run failed\n";
+    }
+
+    std::cout << "ops=" << ops << " keys=" << keys << " value_size=" << value_size << " batch=" << batch << "\n"
+              << std::left << std::setw(16) << "mode" << std::right << std::setw(12) << "keys/s" << std::setw(10)
+              << "ns/key" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "p99.9 us"
+              << "\n";
+    for (const auto& row : rows) {
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        std::cout << std::left << std::setw(16) << row.name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << static_cast<double>(row.keys) / row.seconds << std::setw(10)
+                  << row.seconds * 1e9 / static_cast<double>(row.keys) << std::setprecision(2) << std::setw(10)
+                  << us(row.latency.quantile(0.5)) << std::setw(10) << us(row.latency.quantile(0.99)) << std::setw(10)
+                  << us(row.latency.quantile(0.999)) << "\n";
+    }
+    return ok ? 0 : 1;
+}
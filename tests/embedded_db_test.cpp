@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/embedded/embedded_db.hpp"
+
+/*
+EMBEDDED DB TESTS
+*/
+
+TEST(EmbeddedDBTest, StringsAndBatches) {
+    EmbeddedDB db;
+    db.set("a", "1");
+    EXPECT_EQ(db.get("a").value(), "1");
+    EXPECT_EQ(db.get("missing").value(), std::nullopt);
+    EXPECT_TRUE(db.exists("a"));
+    EXPECT_EQ(db.pttl("a"), -1);
+    EXPECT_EQ(db.pttl("missing"), -2);
+    EXPECT_TRUE(db.pexpire("a", 60000));
+    EXPECT_GT(db.pttl("a"), 0);
+
+    std::vector<std::pair<std::string, std::string>> pairs{{"b", "2"}, {"c", "3"}};
+    db.mset(pairs);
+    std::vector<std::string> keys{"a", "b", "nope", "c"};
+    auto values = db.mget(keys);
+    ASSERT_EQ(values.size(), 4u);
+    EXPECT_EQ(values[1].value(), "2");
+    EXPECT_EQ(values[2].value(), std::nullopt);
+    EXPECT_EQ(values[3].value(), "3");
+
+    EXPECT_TRUE(db.del("b"));
+    EXPECT_FALSE(db.del("b"));
+    EXPECT_FALSE(db.exists("b"));
+}
+
+TEST(EmbeddedDBTest, SortedSetsAndWrongType) {
+    EmbeddedDB db;
+    EXPECT_EQ(db.zadd("z", "m1", 1.5).value(), true);
+    EXPECT_EQ(db.zadd("z", "m1", 2.5).value(), false);
+    EXPECT_EQ(db.zscore("z", "m1").value(), 2.5);
+    EXPECT_EQ(db.zscore("z", "m2").value(), std::nullopt);
+    EXPECT_EQ(db.zrem("z", "m1").value(), true);
+    EXPECT_EQ(db.zrem("nokey", "m1").value(), false);
+
+    db.set("s", "v");
+    EXPECT_EQ(db.zadd("s", "m", 1).error(), std::errc::invalid_argument);
+    EXPECT_EQ(db.get("z").error(), std::errc::invalid_argument);
+}
+
+TEST(EmbeddedDBTest, VectorCollections) {
+    EmbeddedDB db;
+    ASSERT_TRUE(db.create_collection("v", {.dim = 2, .cache_bytes = 1 << 20}));
+    EXPECT_EQ(db.create_collection("v", {.dim = 2}).error(), std::errc::file_exists);
+    EXPECT_EQ(db.search("none", std::vector<float>{0, 0}, 1).error(), std::errc::no_such_file_or_directory);
+
+    std::vector<EmbeddedDB::Label> labels{1, 2, 3, 4};
+    std::vector<float> vectors{0, 0, 1, 0, 5, 5, 10, 10};
+    ASSERT_TRUE(db.upsert_batch("v", labels, vectors));
+    EXPECT_EQ(db.upsert("v", 9, std::vector<float>{1, 2, 3}).error(), std::errc::invalid_argument);
+
+    std::vector<float> q{0.9f, 0.1f};
+    auto hits = db.search("v", q, 2).value();
+    ASSERT_EQ(hits.size(), 2u);
+    EXPECT_EQ(hits[0].second, 2u);
+    EXPECT_EQ(hits[1].second, 1u);
+
+    // cached results must follow writes
+    ASSERT_TRUE(db.upsert("v", 4, std::vector<float>{1, 0.1f}));
+    EXPECT_EQ(db.search("v", q, 1).value()[0].second, 4u);
+    EXPECT_EQ(db.remove("v", 4).value(), true);
+    EXPECT_EQ(db.search("v", q, 1).value()[0].second, 2u);
+    EXPECT_EQ(db.collection_size("v").value(), 3u);
+
+    std::vector<float> queries{0, 0, 6, 6};
+    auto batch = db.search_batch("v", queries, 1).value();
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_EQ(batch[0][0].second, 1u);
+    EXPECT_EQ(batch[1][0].second, 3u);
+
+    ASSERT_TRUE(db.create_collection("ip", {.dim = 2, .metric = EmbeddedDB::Metric::InnerProduct}));
+    ASSERT_TRUE(db.upsert_batch("ip", labels, vectors));
+    EXPECT_EQ(db.search("ip", std::vector<float>{1, 1}, 1).value()[0].second, 4u);
+    EXPECT_TRUE(db.drop_collection("ip"));
+}
+
+TEST(EmbeddedDBTest, ConcurrentReadersAndWriters) {
+    EmbeddedDB db;
+    ASSERT_TRUE(db.create_collection("v", {.dim = 4}));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<float> v(4, static_cast<float>(t));
+            for (int i = 0; i < 2000; ++i) {
+                std::string key = "k" + std::to_string(i % 500);
+                if (t % 2 == 0) {
+                    db.set(key, std::to_string(i));
+                    (void)db.zadd("z", key, i);
+                    (void)db.upsert("v", static_cast<EmbeddedDB::Label>(i % 100), v);
+                } else {
+                    auto value = db.get(key);
+                    EXPECT_TRUE(value.has_value());
+                    (void)db.zscore("z", key);
+                    (void)db.search("v", v, 3);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_TRUE(db.get("k499").value().has_value());
+    EXPECT_EQ(db.collection_size("v").value(), 100u);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <poll.h>
+#include "../connection.hpp"
+
+/*
+FRAMED PROTOCOL TESTS
+*/
+
+static std::string frame(const std::vector<std::string>& args) {
+    std::string body;
+    for (const auto& a : args) {
+        uint32_t len = __builtin_bswap32(static_cast<uint32_t>(a.size()));
+        body.append(reinterpret_cast<const char*>(&len), 4).append(a);
+    }
+    uint32_t total = __builtin_bswap32(static_cast<uint32_t>(body.size()));
+    return std::string(reinterpret_cast<const char*>(&total), 4) + body;
+}
+
+// splits a reply stream into bodies: native u32 length, then the serialized reply
+static std::vector<std::vector<uint8_t>> replies(const std::string& stream) {
+    std::vector<std::vector<uint8_t>> out;
+    size_t pos = 0;
+    while (stream.size() - pos >= 4) {
+        uint32_t len;
+        std::memcpy(&len, stream.data() + pos, 4);
+        if (stream.size() - pos - 4 < len) break;
+        out.emplace_back(stream.begin() + static_cast<ptrdiff_t>(pos + 4),
+                         stream.begin() + static_cast<ptrdiff_t>(pos + 4 + len));
+        pos += 4 + len;
+    }
+    return out;
+}
+
+// a MULTIPLEX frame: the big-endian request id goes first in the payload
+static std::string tagged(uint32_t id, const std::vector<std::string>& args) {
+    std::string plain = frame(args);
+    uint32_t total = __builtin_bswap32(static_cast<uint32_t>(plain.size()));
+    uint32_t be_id = __builtin_bswap32(id);
+    return std::string(reinterpret_cast<const char*>(&total), 4) +
+           std::string(reinterpret_cast<const char*>(&be_id), 4) + plain.substr(4);
+}
+
+// a multiplexed reply body is the native request id, then the serialized reply
+static std::pair<uint32_t, std::vector<uint8_t>> untag(const std::vector<uint8_t>& body) {
+    uint32_t id;
+    std::memcpy(&id, body.data(), 4);
+    return {id, std::vector<uint8_t>(body.begin() + 4, body.end())};
+}
+
+struct FramedPair {
+    EntryManager db;
+    CommandProcessor processor;
+    int client = -1;
+    std::unique_ptr<Connection> conn;
+
+    explicit FramedPair(CommandOffload* offload = nullptr) {
+        int fds[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        client = fds[0];
+        ::fcntl(fds[1], F_SETFL, O_NONBLOCK);     // as the server sets its client sockets
+        conn = std::make_unique<Connection>(Socket(fds[1]), db, processor, nullptr, false, offload);
+    }
+    ~FramedPair() { ::close(client); }
+
+    std::string send(const std::string& bytes) {
+        (void)!::write(client, bytes.data(), bytes.size());
+        EXPECT_TRUE(conn->process_io());
+        char buffer[8192];
+        ssize_t n = ::recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+        return n > 0 ? std::string(buffer, static_cast<size_t>(n)) : "";
+    }
+};
+
+TEST(FramedProtocolTest, PipelinedRequestsAnsweredInOrder) {
+    FramedPair p;
+    auto out = replies(p.send(frame({"SET", "a", "1"}) + frame({"SET", "b", "2"}) + frame({"GET", "a"}) +
+                              frame({"GET", "b"}) + frame({"GET", "missing"})));
+    ASSERT_EQ(out.size(), 5u);
+    EXPECT_EQ(ResponseSerializer::deserialize_string(out[2]), "1");
+    EXPECT_EQ(ResponseSerializer::deserialize_string(out[3]), "2");
+    EXPECT_EQ(p.conn->state(), ConnectionState::Request);
+}
+
+TEST(FramedProtocolTest, PartialFrameWaitsForTheRest) {
+    FramedPair p;
+    std::string request = frame({"SET", "k", "v"}) + frame({"GET", "k"});
+    size_t split = request.size() - 3;
+    EXPECT_EQ(replies(p.send(request.substr(0, split))).size(), 1u);
+    auto out = replies(p.send(request.substr(split)));
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(ResponseSerializer::deserialize_string(out[0]), "v");
+}
+
+TEST(FramedProtocolTest, OversizedFrameClosesConnection) {
+    FramedPair p;
+    uint32_t huge = __builtin_bswap32(static_cast<uint32_t>(MAX_MSG_SIZE));
+    std::string request(reinterpret_cast<const char*>(&huge), 4);
+    (void)!::write(p.client, request.data(), request.size());
+    EXPECT_FALSE(p.conn->process_io());
+}
+
+TEST(FramedProtocolTest, TextClientsStillServed) {
+    FramedPair p;
+    p.send("SET k v");
+    std::string reply = p.send("GET k");
+    EXPECT_NE(reply.find('v'), std::string::npos);
+}
+
+TEST(FramedProtocolTest, MultiplexedRepliesCarryRequestIds) {
+    FramedPair p;
+    auto hello = replies(p.send(frame({"MULTIPLEX"})));
+    ASSERT_EQ(hello.size(), 1u);
+    EXPECT_EQ(ResponseSerializer::deserialize_string(hello[0]), "OK");
+
+    auto out = replies(p.send(tagged(7, {"SET", "k", "v"}) + tagged(9, {"GET", "k"})));
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(untag(out[0]).first, 7u);
+    auto [id, body] = untag(out[1]);
+    EXPECT_EQ(id, 9u);
+    EXPECT_EQ(ResponseSerializer::deserialize_string(body), "v");
+}
+
+TEST(FramedProtocolTest, DebugIsOffUnlessEnabled) {
+    CommandProcessor::debug_enabled = false;
+    FramedPair p;
+    auto out = replies(p.send(frame({"DEBUG", "SLEEP", "60000"}))); // answered at once, not in a minute
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_NE(ResponseSerializer::deserialize_error(out[0]).find("disabled"), std::string::npos);
+}
+
+TEST(FramedProtocolTest, OffloadedCommandsAnswerOutOfOrder) {
+    CommandProcessor::debug_enabled = true;
+    ThreadPool pool(1);
+    CommandOffload offload(pool);
+    FramedPair p(&offload);
+    p.send(frame({"MULTIPLEX"}));
+
+    // the sleep goes to a worker; the GET behind it is answered without waiting for it
+    auto out = replies(p.send(tagged(1, {"DEBUG", "SLEEP", "50"}) + tagged(2, {"GET", "missing"})));
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(untag(out[0]).first, 2u);
+    EXPECT_TRUE(ResponseSerializer::deserialize_nil(untag(out[0]).second));
+
+    pollfd pfd{offload.event_fd(), POLLIN, 0};
+    ASSERT_EQ(::poll(&pfd, 1, 5000), 1);
+    auto done = offload.drain();
+    ASSERT_EQ(done.size(), 1u);
+    EXPECT_EQ(done[0].connection, p.conn->id());
+    ASSERT_TRUE(p.conn->complete(done[0].request_id, done[0].response));
+    char buffer[256];
+    ssize_t n = ::recv(p.client, buffer, sizeof(buffer), MSG_DONTWAIT);
+    ASSERT_GT(n, 0);
+    auto late = replies(std::string(buffer, static_cast<size_t>(n)));
+    ASSERT_EQ(late.size(), 1u);
+    EXPECT_EQ(untag(late[0]).first, 1u);
+    EXPECT_EQ(ResponseSerializer::deserialize_string(untag(late[0]).second), "OK");
+    EXPECT_EQ(offload.in_flight(), 0u);
+}
+
+TEST(FramedProtocolTest, TaggedFramesParse) {
+    std::string request = tagged(0xabcdef01, {"GET", "key"});
+    auto parsed = RequestParser::parse_tagged(std::span(reinterpret_cast<const uint8_t*>(request.data()), request.size()));
+    ASSERT_TRUE(parsed);
+    EXPECT_EQ(parsed->first, 0xabcdef01u);
+    EXPECT_EQ(parsed->second, (std::vector<std::string>{"GET", "key"}));
+
+    std::string short_frame = request.substr(0, 6);
+    EXPECT_FALSE(RequestParser::parse_tagged(
+        std::span(reinterpret_cast<const uint8_t*>(short_frame.data()), short_frame.size())));
+}
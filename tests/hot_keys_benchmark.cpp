@@ -0,0 +1,130 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstdlib>
+#include "../command_processor.hpp"
+
+/*
+HOT KEY TRACKING BENCHMARK
+
+What HOTKEYS costs on the dispatch path, and what it buys. `keys` string keys are loaded and GETs with
+Zipf(`skew`) popularity run through CommandProcessor::process_command from `threads` threads sharing one
+EntryManager, with tracking off and at each sample rate (interleaved, best of 3). For each rate:
+    throughput (GETs/s) and overhead against the untracked run
+    recall of the true top-10 in HOTKEYS 10, and the worst relative error of the reported counts
+
+usage: hot_keys_benchmark [keys=100000] [ops_per_thread=2000000] [threads=1] [skew=1.0]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s, uint64_t seed) : cdf_(n), rng_(seed) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    size_t next() {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+        return static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+};
+
+int main(int argc, char** argv) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+    unsigned threads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 1;
+    double skew = argc > 4 ? std::strtod(argv[4], nullptr) : 1.0;
+
+    EntryManager db;
+    for (size_t i = 0; i < keys; ++i) {
+        db.create_entry<std::string>("key:" + std::to_string(i), "value");
+    }
+
+    // pre-generated request streams so the timed loop is dispatch + lookup only
+    std::vector<std::vector<std::vector<std::string>>> streams(threads);
+    std::unordered_map<std::string, uint64_t> exact;
+    for (unsigned t = 0; t < threads; ++t) {
+        Zipf zipf(keys, skew, 100 + t);
+        streams[t].reserve(ops);
+        for (size_t n = 0; n < ops; ++n) {
+            std::string key = "key:" + std::to_string(zipf.next());
+            ++exact[key];
+            streams[t].push_back({"GET", std::move(key)});
+        }
+    }
+    std::vector<std::pair<uint64_t, std::string>> truth;
+    for (const auto& [key, count] : exact) truth.emplace_back(count, key);
+    std::partial_sort(truth.begin(), truth.begin() + 10, truth.end(), std::greater<>());
+
+    std::cout << "keys=" << keys << " ops=" << ops * threads << " threads=" << threads << " skew=" << skew << "\n";
+
+    // configurations interleaved over several rounds, best of each, so drift on a shared box hits them all alike
+    const std::vector<uint32_t> rates{0, 1, 16, 128};
+    std::vector<double> best(rates.size(), 0);
+    for (int round = 0; round < 3; ++round) {
+        for (size_t c = 0; c < rates.size(); ++c) {
+            HotKeys::instance().configure({.sample_rate = rates[c]});
+            auto t0 = Clock::now();
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; ++t) {
+                pool.emplace_back([&, t] {
+                    std::vector<uint8_t> response;
+                    for (const auto& args : streams[t]) {
+                        response.clear();
+                        CommandProcessor::process_command({args, response, db});
+                    }
+                });
+            }
+            for (auto& th : pool) th.join();
+            double s = std::chrono::duration<double>(Clock::now() - t0).count();
+            best[c] = std::max(best[c], static_cast<double>(ops * threads) / s);
+        }
+    }
+
+    for (size_t c = 0; c < rates.size(); ++c) {
+        uint32_t rate = rates[c];
+        std::cout << "sample=" << std::setw(5) << (rate ? "1/" + std::to_string(rate) : std::string("off"))
+                  << std::fixed << std::setprecision(2) << "  " << best[c] / 1e6 << " M GET/s  overhead "
+                  << std::setprecision(1) << 100.0 * (best[0] / best[c] - 1.0) << "%";
+        if (rate != 0) {
+            // one more run to read HOTKEYS after exactly one pass over the streams
+            HotKeys::instance().configure({.sample_rate = rate});
+            std::vector<uint8_t> response;
+            for (const auto& stream : streams) {
+                for (const auto& args : stream) {
+                    response.clear();
+                    CommandProcessor::process_command({args, response, db});
+                }
+            }
+            auto top = HotKeys::instance().top(10);
+            size_t hits = 0;
+            double worst = 0;
+            for (const auto& h : top) {
+                hits += std::any_of(truth.begin(), truth.begin() + 10, [&](const auto& p) { return p.second == h.key; });
+                double real = static_cast<double>(exact[h.key]);
+                worst = std::max(worst, std::abs(static_cast<double>(h.count) - real) / real);
+            }
+            std::cout << "  top-10 recall " << hits << "/10  worst count error " << 100.0 * worst << "%";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "../command_processor.hpp"
+
+/*
+HOT KEY TRACKING TESTS
+*/
+
+TEST(HotKeysTest, SpaceSavingKeepsHeavyHitters) {
+    HotKeys hot({.capacity = 32, .shards = 4, .sample_rate = 1});
+    std::mt19937_64 rng(3);
+    std::unordered_map<std::string, uint64_t> exact;
+    // 3 heavy keys at ~10% each, the rest spread over 100k keys
+    for (int n = 0; n < 200000; ++n) {
+        uint64_t r = rng() % 100;
+        std::string key = r < 30 ? "heavy" + std::to_string(r % 3) : "k" + std::to_string(rng() % 100000);
+        hot.observe(key);
+        ++exact[key];
+    }
+
+    auto top = hot.top(3);
+    ASSERT_EQ(top.size(), 3u);
+    for (const auto& h : top) {
+        EXPECT_EQ(h.key.rfind("heavy", 0), 0u) << h.key;
+        // count - error <= true count <= count
+        EXPECT_GE(h.count, exact[h.key]);
+        EXPECT_LE(h.count - h.error, exact[h.key]);
+        EXPECT_GT(h.rate, 0);
+    }
+    EXPECT_GE(top[0].count, top[1].count);
+    EXPECT_GE(top[1].count, top[2].count);
+}
+
+TEST(HotKeysTest, SampledCountsAreScaled) {
+    HotKeys hot({.capacity = 16, .shards = 2, .sample_rate = 8});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int n = 0; n < 50000; ++n) hot.observe(n % 2 ? "hot" : "warm" + std::to_string(n % 64));
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    auto top = hot.top(1);
+    ASSERT_EQ(top.size(), 1u);
+    EXPECT_EQ(top[0].key, "hot");
+    // 100k real requests, estimated from ~12.5k samples
+    EXPECT_NEAR(static_cast<double>(top[0].count), 100000.0, 10000.0);
+}
+
+TEST(HotKeysTest, HotkeysCommand) {
+    HotKeys::instance().configure({.capacity = 64, .shards = 4, .sample_rate = 1});
+    EntryManager db;
+    std::vector<uint8_t> response;
+    for (int i = 0; i < 100; ++i) {
+        std::vector<std::string> get{"GET", i % 4 ? "popular" : "other"};
+        response.clear();
+        CommandProcessor::process_command({get, response, db});
+    }
+
+    // admin commands' arguments aren't keys, however often they come
+    for (int i = 0; i < 200; ++i) {
+        std::vector<std::string> info{"INFO", "commandstats"};
+        response.clear();
+        CommandProcessor::process_command({info, response, db});
+    }
+
+    std::vector<std::string> hotkeys{"HOTKEYS", "1"};
+    response.clear();
+    CommandProcessor::process_command({hotkeys, response, db});
+    std::string out = ResponseSerializer::deserialize_string(response);
+    EXPECT_EQ(out.rfind("popular 75 ", 0), 0u) << out;
+
+    std::vector<std::string> all{"HOTKEYS", "10"};
+    response.clear();
+    CommandProcessor::process_command({all, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response).find("commandstats"), std::string::npos);
+
+    std::vector<std::string> bad{"HOTKEYS", "zero"};
+    response.clear();
+    CommandProcessor::process_command({bad, response, db});
+    EXPECT_NE(ResponseSerializer::deserialize_error(response), "No error");
+
+    HotKeys::instance().configure({.sample_rate = 0});
+    response.clear();
+    CommandProcessor::process_command({hotkeys, response, db});
+    EXPECT_NE(ResponseSerializer::deserialize_error(response), "No error");
+}
@@ -0,0 +1,343 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+
+/*
+IO BACKEND BENCHMARK
+
+The same pipelined GET traffic against the poll loop and the io_uring backend (src/transport/uring_backend.hpp):
+
+    poll            Server::run() as it was: poll(), then read() and write() per connection
+    uring           --io uring
+    uring+files     --io uring --uring-register files
+    uring+all       --io uring --uring-register all (registered sockets and send buffers)
+
+Each backend gets a fresh server in a forked child (1 worker thread, output to /dev/null) holding `keys`
+100-byte values, and `connections` client threads that each keep `window` GETs in flight over TCP.
+
+    ops/s           throughput, untraced
+    server cpu      the server process's user+system time per request, from /proc
+    sys/req         syscalls the server's event loop thread makes per request. Counted in a second run under
+                    ptrace (every syscall entry stops the thread, so that run's speed means nothing), over
+                    ops/10 requests. Worker threads aren't traced; the loop does all the socket work.
+    io sys/req      the same without writes to stdout and stderr: the per-request log lines, which cost the
+                    same on every backend
+
+usage: io_backend_benchmark [ops=200000] [connections=4] [window=16] [port=7440]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static void serve(uint16_t port, const std::string& mode) {
+    int null = ::open("/dev/null", O_WRONLY);
+    ::dup2(null, STDOUT_FILENO);
+    ::dup2(null, STDERR_FILENO);
+    Server server(port, 1);
+    if (!server.initialize()) _exit(1);
+    if (mode != "poll") {
+        bool all = mode == "uring+all";
+        if (!server.use_io_uring({.fixed_files = all || mode == "uring+files", .fixed_buffers = all})) _exit(1);
+    }
+    server.run();
+    _exit(0);
+}
+
+// utime + stime of `pid`, in us
+static double cpu_us(pid_t pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    std::istringstream fields(line.substr(line.rfind(')') + 2));
+    std::string skip;
+    for (int i = 3; i < 14; ++i) fields >> skip;
+    double utime = 0, stime = 0;
+    fields >> utime >> stime;
+    return (utime + stime) * 1e6 / static_cast<double>(::sysconf(_SC_CLK_TCK));
+}
+
+// the server in a forked child under ptrace, counting its main thread's syscall entries. The tracer has to be
+// the thread that forked, so it's a thread of its own here.
+class TracedServer {
+public:
+    TracedServer(uint16_t port, const std::string& mode) {
+        tracer_ = std::thread([this, port, mode] { trace(port, mode); });
+        while (pid_.load() == 0) std::this_thread::yield();
+    }
+    ~TracedServer() {
+        ::kill(pid_.load(), SIGKILL);
+        tracer_.join();
+    }
+
+    [[nodiscard]] pid_t pid() const { return pid_.load(); }
+    [[nodiscard]] uint64_t syscalls() const { return syscalls_.load(); }
+    [[nodiscard]] uint64_t log_writes() const { return log_writes_.load(); }
+
+private:
+    std::thread tracer_;
+    std::atomic<pid_t> pid_{0};
+    std::atomic<uint64_t> syscalls_{0};
+    std::atomic<uint64_t> log_writes_{0};
+
+    void trace(uint16_t port, const std::string& mode) {
+        pid_t child = ::fork();
+        if (child == 0) {
+            ::ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            ::raise(SIGSTOP);
+            serve(port, mode);
+        }
+        int status;
+        ::waitpid(child, &status, 0);
+        ::ptrace(PTRACE_SETOPTIONS, child, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+        pid_.store(child);
+        bool entry = true;
+        int signal = 0;
+        while (::ptrace(PTRACE_SYSCALL, child, nullptr, signal) == 0 && ::waitpid(child, &status, 0) == child) {
+            signal = 0;
+            if (WIFEXITED(status) || WIFSIGNALED(status)) break;
+            if (!WIFSTOPPED(status)) continue;
+            if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+                signal = WSTOPSIG(status);      // the server's own signal, passed on
+                continue;
+            }
+            if (entry) {
+                long nr = 0, arg0 = 0;
+                syscall_of(child, nr, arg0);
+                syscalls_.fetch_add(1);
+                if (nr == SYS_write && (arg0 == STDOUT_FILENO || arg0 == STDERR_FILENO)) {
+                    log_writes_.fetch_add(1);
+                }
+            }
+            entry = !entry;
+        }
+        ::waitpid(child, &status, 0);
+    }
+
+    static void syscall_of(pid_t pid, long& nr, long& arg0) {
+        user_regs_struct regs{};
+        iovec io{&regs, sizeof(regs)};
+        if (::ptrace(PTRACE_GETREGSET, pid, reinterpret_cast<void*>(NT_PRSTATUS), &io) != 0) return;
+#if defined(__x86_64__)
+        nr = static_cast<long>(regs.orig_rax);
+        arg0 = static_cast<long>(regs.rdi);
+#elif defined(__aarch64__)
+        nr = static_cast<long>(regs.regs[8]);
+        arg0 = static_cast<long>(regs.regs[0]);
+#endif
+    }
+};
+
+// blocking framed connection: send() appends to a batch, flush() writes it, receive() reads one reply
+class Conn {
+public:
+    explicit Conn(uint16_t port) : in_(1 << 16) {
+        for (int attempt = 0; attempt < 200 && fd_ < 0; ++attempt) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                fd_ = fd;
+            } else {
+                ::close(fd);
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+    }
+    ~Conn() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    [[nodiscard]] bool ok() const { return fd_ >= 0; }
+
+    void send(std::initializer_list<std::string_view> args) {
+        size_t payload = 0;
+        for (auto a : args) payload += 4 + a.size();
+        put_be32(static_cast<uint32_t>(payload));
+        for (auto a : args) {
+            put_be32(static_cast<uint32_t>(a.size()));
+            out_.insert(out_.end(), a.begin(), a.end());
+        }
+    }
+
+    bool flush() {
+        for (size_t done = 0; done < out_.size();) {
+            ssize_t n = ::write(fd_, out_.data() + done, out_.size() - done);
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        out_.clear();
+        return true;
+    }
+
+    // the next reply's body size, -1 if the connection failed
+    ssize_t receive() {
+        while (true) {
+            uint32_t len;
+            if (have_ - start_ >= 4) {
+                std::memcpy(&len, in_.data() + start_, 4);
+                if (have_ - start_ - 4 >= len) {
+                    start_ += 4 + len;
+                    return len;
+                }
+            }
+            std::memmove(in_.data(), in_.data() + start_, have_ - start_);
+            have_ -= start_;
+            start_ = 0;
+            ssize_t n = ::read(fd_, in_.data() + have_, in_.size() - have_);
+            if (n <= 0) return -1;
+            have_ += static_cast<size_t>(n);
+        }
+    }
+
+private:
+    int fd_ = -1;
+    std::vector<char> out_;
+    std::vector<char> in_;
+    size_t start_ = 0, have_ = 0;
+
+    void put_be32(uint32_t v) {
+        uint32_t be = htonl(v);
+        auto* p = reinterpret_cast<const char*>(&be);
+        out_.insert(out_.end(), p, p + 4);
+    }
+};
+
+// `ops` GETs spread over `connections` threads, `window` in flight on each; false if any reply was wrong
+static bool drive(uint16_t port, uint64_t ops, size_t connections, size_t window, size_t keys) {
+    std::vector<std::string> names;
+    for (size_t k = 0; k < keys; ++k) names.push_back("key:" + std::to_string(k));
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < connections; ++c) {
+        threads.emplace_back([&, c] {
+            Conn conn(port);
+            uint64_t mine = ops / connections + (c < ops % connections ? 1 : 0);
+            uint64_t sent = 0, done = 0;
+            while (conn.ok() && ok && done < mine) {
+                for (; sent < mine && sent - done < window; ++sent) {
+                    conn.send({"GET", names[(sent * connections + c) % keys]});
+                }
+                if (!conn.flush()) break;
+                // half the window back before topping it up, so requests go out in batches
+                for (uint64_t target = std::min(sent, done + std::max<size_t>(1, window / 2)); done < target; ++done) {
+                    if (conn.receive() != 1 + 4 + 100) {
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+            if (done != mine) ok = false;
+        });
+    }
+    for (auto& t : threads) t.join();
+    return ok;
+}
+
+static bool preload(uint16_t port, size_t keys) {
+    Conn conn(port);
+    std::string value(100, 'v');
+    for (size_t k = 0; k < keys && conn.ok(); ++k) {
+        conn.send({"SET", "key:" + std::to_string(k), value});
+        if (!conn.flush() || conn.receive() < 0) return false;
+    }
+    return conn.ok();
+}
+
+struct Row {
+    std::string mode;
+    double ops_per_sec = 0;
+    double server_cpu_us = 0;
+    double syscalls = 0;
+    double io_syscalls = 0;
+    bool ok = true;
+};
+
+static Row run(const std::string& mode, uint16_t port, uint64_t ops, size_t connections, size_t window, size_t keys) {
+    Row row;
+    row.mode = mode;
+
+    pid_t child = ::fork();
+    if (child == 0) serve(port, mode);
+    row.ok = preload(port, keys);
+    double cpu_start = cpu_us(child);
+    auto start = Clock::now();
+    row.ok = row.ok && drive(port, ops, connections, window, keys);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    row.ops_per_sec = static_cast<double>(ops) / seconds;
+    row.server_cpu_us = (cpu_us(child) - cpu_start) / static_cast<double>(ops);
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+
+    uint64_t traced_ops = std::max<uint64_t>(1000, ops / 10);
+    uint16_t traced_port = static_cast<uint16_t>(port + 1);
+    TracedServer traced(traced_port, mode);
+    row.ok = row.ok && preload(traced_port, keys);
+    uint64_t calls = traced.syscalls(), logs = traced.log_writes();
+    row.ok = row.ok && drive(traced_port, traced_ops, connections, window, keys);
+    row.syscalls = static_cast<double>(traced.syscalls() - calls) / static_cast<double>(traced_ops);
+    row.io_syscalls = static_cast<double>(traced.syscalls() - calls - (traced.log_writes() - logs)) /
+                      static_cast<double>(traced_ops);
+    return row;
+}
+
+int main(int argc, char** argv) {
+    uint64_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t connections = std::max<size_t>(1, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4);
+    size_t window = std::max<size_t>(1, argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16);
+    uint16_t port = static_cast<uint16_t>(argc > 4 ? std::atoi(argv[4]) : 7440);
+    size_t keys = 1000;
+
+    bool uring = UringBackend::create({}).has_value();
+    std::vector<std::string> modes = {"poll"};
+    if (uring) {
+        modes.insert(modes.end(), {"uring", "uring+files", "uring+all"});
+    }
+
+    std::vector<Row> rows;
+    for (size_t i = 0; i < modes.size(); ++i) {
+        rows.push_back(run(modes[i], static_cast<uint16_t>(port + 2 * i), ops, connections, window, keys));
+    }
+
+    std::cout << "ops=" << ops << " connections=" << connections << " window=" << window << " cores="
+              << std::thread::hardware_concurrency() << (uring ? "" : " (no io_uring here: poll only)") << "\n"
+              << std::left << std::setw(14) << "backend" << std::right << std::setw(12) << "ops/s"
+              << std::setw(18) << "server cpu us/req" << std::setw(10) << "sys/req" << std::setw(13)
+              << "io sys/req" << "\n";
+    int code = 0;
+    for (const auto& row : rows) {
+        if (!row.ok) {
+            std::cout << std::left << std::setw(14) << row.mode << " failed\n";
+            code = 1;
+            continue;
+        }
+        std::cout << std::left << std::setw(14) << row.mode << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << row.ops_per_sec << std::setprecision(2) << std::setw(18)
+                  << row.server_cpu_us << std::setw(10) << row.syscalls << std::setw(13) << row.io_syscalls
+                  << "\n";
+    }
+    return code;
+}
@@ -0,0 +1,268 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+#include "../src/client/client.hpp"
+#include "../src/transport/shm_client.hpp"
+
+/*
+IO_URING BACKEND TESTS
+*/
+
+static bool uring_available() {
+    return UringBackend::create({}).has_value();
+}
+
+// a Server on io_uring in a forked child, listening on TCP `port` and on `path`, output to /dev/null
+struct ForkedUringServer {
+    pid_t pid;
+    uint16_t port;
+    std::string path;
+
+    ForkedUringServer(uint16_t p, UringBackend::Options options)
+        : port(p), path("/tmp/vectordb_uring_test_" + std::to_string(p) + ".sock") {
+        pid = ::fork();
+        if (pid == 0) {
+            int null = ::open("/dev/null", O_WRONLY);
+            ::dup2(null, STDOUT_FILENO);
+            ::dup2(null, STDERR_FILENO);
+            Server server(port, 1);
+            if (!server.initialize() || !server.listen_unix(path) || !server.use_io_uring(options)) _exit(1);
+            server.run();
+            _exit(0);
+        }
+    }
+    ~ForkedUringServer() {
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+        ::unlink(path.c_str());
+    }
+
+    std::unique_ptr<ClientPool> pool(size_t connections, std::string unix_path = "") {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            auto c = ClientPool::connect({.port = port, .connections = connections, .unix_path = unix_path});
+            if (c) return std::move(*c);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return nullptr;
+    }
+
+    // a blocking TCP socket, for byte-level traffic
+    int dial() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        return fd;
+    }
+};
+
+static std::string frame(const std::vector<std::string>& args) {
+    std::string body;
+    for (const auto& a : args) {
+        uint32_t len = htonl(static_cast<uint32_t>(a.size()));
+        body.append(reinterpret_cast<const char*>(&len), 4).append(a);
+    }
+    uint32_t total = htonl(static_cast<uint32_t>(body.size()));
+    return std::string(reinterpret_cast<const char*>(&total), 4) + body;
+}
+
+// a MULTIPLEX frame: the big-endian request id goes first in the payload
+static std::string tagged(uint32_t id, const std::vector<std::string>& args) {
+    std::string plain = frame(args);
+    uint32_t be_id = htonl(id);
+    uint32_t total = htonl(static_cast<uint32_t>(plain.size()));
+    return std::string(reinterpret_cast<const char*>(&total), 4) +
+           std::string(reinterpret_cast<const char*>(&be_id), 4) + plain.substr(4);
+}
+
+static bool write_all(int fd, const std::string& bytes) {
+    for (size_t done = 0; done < bytes.size();) {
+        ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// the next `count` reply bodies off a blocking socket (native u32 length, then the body)
+static std::vector<std::string> read_replies(int fd, size_t count) {
+    std::vector<std::string> out;
+    std::string stream;
+    size_t pos = 0;
+    char buf[1 << 16];
+    while (out.size() < count) {
+        uint32_t len;
+        if (stream.size() - pos >= 4) {
+            std::memcpy(&len, stream.data() + pos, 4);
+            if (stream.size() - pos - 4 >= len) {
+                out.push_back(stream.substr(pos + 4, len));
+                pos += 4 + len;
+                continue;
+            }
+        }
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        stream.append(buf, static_cast<size_t>(n));
+    }
+    return out;
+}
+
+// SET/GET, values near the frame limit pipelined through the pool, and a reader behind on a deep pipeline
+static void exercise(ForkedUringServer& server) {
+    auto pool = server.pool(2);
+    ASSERT_TRUE(pool);
+    EXPECT_FALSE(pool->call({"SET", "k", "hello"}).get()->is_error());
+    EXPECT_EQ(pool->call({"GET", "k"}).get()->str, "hello");
+    EXPECT_TRUE(pool->call({"GET", "missing"}).get()->is_nil());
+
+    constexpr int n = 200;
+    std::vector<std::string> values;
+    std::vector<std::future<Result<Reply>>> sets, gets;
+    for (int i = 0; i < n; ++i) {
+        values.push_back(std::string(3000 + i, static_cast<char>('a' + i % 26)));
+        std::string key = "big:" + std::to_string(i);
+        sets.push_back(pool->call({"SET", key, values.back()}));
+    }
+    for (auto& f : sets) {
+        auto r = f.get();
+        ASSERT_TRUE(r);
+        EXPECT_FALSE(r->is_error());
+    }
+    for (int i = 0; i < n; ++i) {
+        std::string key = "big:" + std::to_string(i);
+        gets.push_back(pool->call({"GET", key}));
+    }
+    for (int i = 0; i < n; ++i) {
+        auto r = gets[i].get();
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->str, values[i]);
+    }
+
+    // ~12 MB of replies to a client that isn't reading yet: more than the send pool holds for one connection,
+    // so the server stops on EAGAIN and picks up again as its sends drain
+    int fd = server.dial();
+    constexpr size_t deep = 4000;
+    std::string batch;
+    for (size_t i = 0; i < deep; ++i) {
+        batch += frame({"GET", "big:" + std::to_string(i % n)});
+    }
+    std::thread writer([&] { EXPECT_TRUE(write_all(fd, batch)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto replies = read_replies(fd, deep);
+    writer.join();
+    ASSERT_EQ(replies.size(), deep);
+    for (size_t i = 0; i < deep; ++i) {
+        ASSERT_EQ(replies[i].size(), 1 + 4 + values[i % n].size()) << i;
+        EXPECT_EQ(replies[i].substr(5), values[i % n]) << i;
+    }
+    ::close(fd);
+}
+
+TEST(IoUringBackendTest, CommandsOverIoUring) {
+    if (!uring_available()) GTEST_SKIP() << "no io_uring here";
+    ForkedUringServer server(7417, {});
+    exercise(server);
+}
+
+TEST(IoUringBackendTest, RegisteredFilesAndBuffers) {
+    if (!uring_available()) GTEST_SKIP() << "no io_uring here";
+    auto backend = UringBackend::create({.fixed_files = true, .fixed_buffers = true});
+    ASSERT_TRUE(backend);
+    EXPECT_TRUE((*backend)->options().fixed_files);
+    ForkedUringServer server(7418, {.fixed_files = true, .fixed_buffers = true});
+    exercise(server);
+
+    // Unix sockets can't send zero-copy: those connections fall back to plain sends
+    auto local = server.pool(1, server.path);
+    ASSERT_TRUE(local);
+    EXPECT_FALSE(local->call({"SET", "u", std::string(2500, 'u')}).get()->is_error());
+    EXPECT_EQ(local->call({"GET", "u"}).get()->str, std::string(2500, 'u'));
+}
+
+TEST(IoUringBackendTest, TextClientsAndOffloadedCommands) {
+    if (!uring_available()) GTEST_SKIP() << "no io_uring here";
+    CommandProcessor::debug_enabled = true; // inherited by the forked server
+    ForkedUringServer server(7419, {});
+    ASSERT_TRUE(server.pool(1));        // waits for the server to come up
+
+    int text = server.dial();
+    ASSERT_TRUE(write_all(text, "SET t v"));
+    char buf[256];
+    EXPECT_GT(::read(text, buf, sizeof(buf)), 0);
+    ASSERT_TRUE(write_all(text, "GET t"));
+    ssize_t n = ::read(text, buf, sizeof(buf));
+    ASSERT_GT(n, 0);
+    EXPECT_NE(std::string(buf, static_cast<size_t>(n)).find('v'), std::string::npos);
+    ::close(text);
+
+    // the sleep runs on a worker and answers through the offload eventfd, after the GET behind it
+    int fd = server.dial();
+    ASSERT_TRUE(write_all(fd, frame({"MULTIPLEX"})));
+    ASSERT_EQ(read_replies(fd, 1).size(), 1u);
+    ASSERT_TRUE(write_all(fd, tagged(1, {"DEBUG", "SLEEP", "50"}) + tagged(2, {"GET", "t"})));
+    auto out = read_replies(fd, 2);
+    ASSERT_EQ(out.size(), 2u);
+    uint32_t first, second;
+    std::memcpy(&first, out[0].data(), 4);
+    std::memcpy(&second, out[1].data(), 4);
+    EXPECT_EQ(first, 2u);
+    EXPECT_EQ(second, 1u);
+    ::close(fd);
+}
+
+TEST(IoUringBackendTest, ManyConnectionsAndClientsLeavingMidStream) {
+    if (!uring_available()) GTEST_SKIP() << "no io_uring here";
+    ForkedUringServer server(7420, {.fixed_files = true});
+    auto pool = server.pool(64);
+    ASSERT_TRUE(pool);
+    std::vector<std::future<Result<Reply>>> calls;
+    for (int i = 0; i < 512; ++i) {
+        calls.push_back(pool->call({"SET", "c:" + std::to_string(i), std::to_string(i)}));
+    }
+    for (auto& f : calls) {
+        auto r = f.get();
+        ASSERT_TRUE(r);
+        EXPECT_FALSE(r->is_error());
+    }
+
+    // clients that hang up with requests and replies still in flight
+    std::string value(3000, 'x');
+    ASSERT_FALSE(pool->call({"SET", "x", value}).get()->is_error());
+    for (int round = 0; round < 20; ++round) {
+        int fd = server.dial();
+        std::string batch;
+        for (int i = 0; i < 200; ++i) batch += frame({"GET", "x"});
+        (void)write_all(fd, batch);
+        if (round % 2) {
+            read_replies(fd, 3);
+        }
+        ::close(fd);
+    }
+
+    // and the server carries on for everyone else
+    for (int i = 0; i < 512; i += 37) {
+        EXPECT_EQ(pool->call({"GET", "c:" + std::to_string(i)}).get()->str, std::to_string(i));
+    }
+}
+
+TEST(IoUringBackendTest, ShmNeedsThePollBackend) {
+    if (!uring_available()) GTEST_SKIP() << "no io_uring here";
+    ForkedUringServer server(7421, {});
+    auto local = server.pool(1, server.path);
+    ASSERT_TRUE(local);
+    EXPECT_FALSE(ShmClient::connect({.path = server.path}));
+    EXPECT_FALSE(local->call({"SET", "k", "v"}).get()->is_error());
+    EXPECT_EQ(local->call({"GET", "k"}).get()->str, "v");
+}
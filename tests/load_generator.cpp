@@ -0,0 +1,487 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../src/stats/command_stats.hpp"
+
+/*
+LOAD GENERATOR
+
+Drives a running server over the framed binary protocol (the one RequestParser reads). Requests are a
+big-endian u32 payload length, then a big-endian u32 length and the bytes for each argument. Responses are a
+native-endian u32 length, then the serialized reply. The server tells framed clients from text ones by the
+first byte, so both kinds can use the same port.
+
+Each of `threads` threads owns `connections` non-blocking connections on its own epoll and keeps up to
+`pipeline` requests in flight on each one. Replies come back in order, so a per-connection FIFO of send times
+is enough to match them to requests.
+
+    closed loop (rate 0)   every connection refills its pipeline as replies arrive; throughput is whatever
+                           the server sustains, latency is measured from the actual send
+    open loop (rate > 0)   requests are scheduled at a constant total rate, split evenly over threads. A
+                           request that finds every pipeline full waits in a backlog. Its latency counts from
+                           the time it was scheduled, not the time it was sent. That is the coordinated-
+                           omission correction: a stalled server can't hide the requests it kept us from
+                           sending. Latencies measured from the actual send are reported next to it.
+
+Workload profile:
+    keys        keyspace size ("key:<n>"), drawn uniform or zipfian (s = 0.99)
+    value-size  SET value bytes, fixed ("32") or uniform in a range ("16-512"); capped so a frame fits the
+                server's 4 KiB request buffer
+    mix         command weights, e.g. "get:90,set:10"; any of get, set, del, exists, zadd (ZADD goes to one
+                of 100 sorted sets, "zset:<n>", with the key as member)
+
+Latencies go into the same log-linear histograms as INFO commandstats (~3% resolution) and are reported as
+p50/p90/p99/p99.9/p99.99/max, measured over `duration` seconds after `warmup`. `json` also writes the summary
+to a file.
+
+usage: load_generator [--host 127.0.0.1] [--port 1234] [--threads 2] [--connections 4] [--pipeline 1]
+                      [--duration 10] [--warmup 1] [--rate 0] [--keys 100000] [--dist uniform|zipf]
+                      [--value-size 32|min-max] [--mix get:90,set:10] [--json path]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    uint16_t port = 1234;
+    size_t threads = 2;
+    size_t connections = 4;             // per thread
+    size_t pipeline = 1;
+    double duration = 10;
+    double warmup = 1;
+    double rate = 0;                    // requests/s over all threads; 0 is closed loop
+    uint32_t keys = 100000;
+    std::string dist = "uniform";
+    size_t value_min = 32;
+    size_t value_max = 32;
+    std::vector<std::pair<std::string, double>> mix{{"get", 90}, {"set", 10}};
+    std::string json;
+};
+
+static constexpr size_t k_max_frame = 4096;     // the server's MAX_MSG_SIZE
+static constexpr size_t k_max_value = k_max_frame - 128;
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s) : cdf_(n) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    template<typename Rng>
+    uint32_t next(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return static_cast<uint32_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+// builds request frames for the configured profile
+class Workload {
+public:
+    Workload(const Options& o, const Zipf* zipf, uint64_t seed)
+        : o_(o), zipf_(zipf), rng_(seed), values_(k_max_value, 'v') {
+        for (size_t i = 0; i < values_.size(); ++i) values_[i] = static_cast<char>('a' + rng_() % 26);
+        double total = 0;
+        for (const auto& [command, weight] : o_.mix) cumulative_.push_back(total += weight);
+    }
+
+    // appends one request frame to `out`
+    void next(std::vector<uint8_t>& out) {
+        double pick = std::uniform_real_distribution<double>(0, cumulative_.back())(rng_);
+        const std::string& command = o_.mix[static_cast<size_t>(
+            std::upper_bound(cumulative_.begin(), cumulative_.end(), pick) - cumulative_.begin())].first;
+        uint32_t k = zipf_ ? static_cast<uint32_t>((zipf_->next(rng_) * 2654435761ull) % o_.keys)
+                           : static_cast<uint32_t>(rng_() % o_.keys);
+        std::string key = "key:" + std::to_string(k);
+
+        size_t start = out.size();
+        out.resize(start + 4);
+        if (command == "set") {
+            size_t len = o_.value_min + rng_() % (o_.value_max - o_.value_min + 1);
+            append(out, "SET");
+            append(out, key);
+            append(out, std::string_view(values_).substr(rng_() % (values_.size() - len + 1), len));
+        } else if (command == "zadd") {
+            append(out, "ZADD");
+            append(out, "zset:" + std::to_string(k % 100));
+            append(out, std::to_string(rng_() % 1000000));
+            append(out, key);
+        } else {
+            std::string upper = command;
+            for (auto& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            append(out, upper);
+            append(out, key);
+        }
+        uint32_t payload = __builtin_bswap32(static_cast<uint32_t>(out.size() - start - 4));
+        std::memcpy(out.data() + start, &payload, 4);
+    }
+
+private:
+    static void append(std::vector<uint8_t>& out, std::string_view arg) {
+        uint32_t len = __builtin_bswap32(static_cast<uint32_t>(arg.size()));
+        out.insert(out.end(), reinterpret_cast<const uint8_t*>(&len), reinterpret_cast<const uint8_t*>(&len) + 4);
+        out.insert(out.end(), arg.begin(), arg.end());
+    }
+
+    const Options& o_;
+    const Zipf* zipf_;
+    std::mt19937_64 rng_;
+    std::string values_;
+    std::vector<double> cumulative_;
+};
+
+struct Pending {
+    uint64_t intended_ns;               // when the schedule wanted it sent (open loop), else = sent_ns
+    uint64_t sent_ns;
+};
+
+struct Conn {
+    int fd = -1;
+    std::vector<uint8_t> out;
+    size_t out_sent = 0;
+    std::vector<uint8_t> in;
+    std::deque<Pending> inflight;
+};
+
+struct ThreadResult {
+    LatencyHistogram corrected;         // from intended send time
+    LatencyHistogram uncorrected;       // from actual send time
+    uint64_t completed = 0;             // replies inside the measurement window
+    uint64_t errors = 0;                // error replies inside the window
+    uint64_t backlog_max = 0;           // open loop: most requests ever waiting for a free pipeline slot
+    std::string failure;                // why the thread stopped early, if it did
+};
+
+static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+static int connect_to(const Options& o, std::string& error) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (int rc = ::getaddrinfo(o.host.c_str(), std::to_string(o.port).c_str(), &hints, &res); rc != 0) {
+        error = ::gai_strerror(rc);
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+        error = std::string("connect: ") + std::strerror(errno);
+        ::freeaddrinfo(res);
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    ::freeaddrinfo(res);
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// one load thread: its connections, its schedule, its histograms
+static void run_thread(const Options& o, const Zipf* zipf, size_t index, uint64_t start_ns, ThreadResult& result) {
+    uint64_t measure_from = start_ns + static_cast<uint64_t>(o.warmup * 1e9);
+    uint64_t end = measure_from + static_cast<uint64_t>(o.duration * 1e9);
+    Workload workload(o, zipf, index + 1);
+
+    int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Conn> conns(o.connections);
+    for (size_t c = 0; c < conns.size(); ++c) {
+        conns[c].fd = connect_to(o, result.failure);
+        if (conns[c].fd < 0) {
+            for (auto& open : conns) if (open.fd >= 0) ::close(open.fd);
+            ::close(ep);
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = c;
+        ::epoll_ctl(ep, EPOLL_CTL_ADD, conns[c].fd, &ev);
+    }
+
+    // open loop: this thread's share of the rate, staggered so threads don't send in lockstep
+    bool open_loop = o.rate > 0;
+    double interval = open_loop ? 1e9 * static_cast<double>(o.threads) / o.rate : 0;
+    double next_due = static_cast<double>(start_ns) + interval * static_cast<double>(index) / static_cast<double>(o.threads);
+    std::deque<uint64_t> backlog;       // scheduled, not yet sent
+    size_t rr = 0;
+
+    auto send_one = [&](Conn& conn, uint64_t intended, uint64_t now) {
+        workload.next(conn.out);
+        conn.inflight.push_back({intended, now});
+    };
+
+    auto on_reply = [&](Conn& conn, bool error, uint64_t now) {
+        Pending p = conn.inflight.front();
+        conn.inflight.pop_front();
+        if (now < measure_from || now >= end) return;
+        ++result.completed;
+        result.errors += error;
+        result.corrected.record(now - p.intended_ns);
+        result.uncorrected.record(now - p.sent_ns);
+    };
+
+    std::vector<epoll_event> events(conns.size());
+    while (true) {
+        uint64_t now = now_ns();
+        if (now >= end) break;
+
+        if (open_loop) {
+            while (next_due <= static_cast<double>(now)) {
+                backlog.push_back(static_cast<uint64_t>(next_due));
+                next_due += interval;
+            }
+            result.backlog_max = std::max<uint64_t>(result.backlog_max, backlog.size());
+            // hand the backlog out round-robin to connections with a free pipeline slot
+            for (size_t tried = 0; !backlog.empty() && tried < conns.size(); ) {
+                Conn& conn = conns[rr];
+                if (conn.inflight.size() < o.pipeline) {
+                    send_one(conn, backlog.front(), now);
+                    backlog.pop_front();
+                    tried = 0;
+                } else {
+                    ++tried;
+                }
+                rr = (rr + 1) % conns.size();
+            }
+        } else {
+            for (auto& conn : conns) {
+                while (conn.inflight.size() < o.pipeline) send_one(conn, now, now);
+            }
+        }
+
+        bool unsent = false;
+        for (auto& conn : conns) {
+            while (conn.out_sent < conn.out.size()) {
+                ssize_t n = ::send(conn.fd, conn.out.data() + conn.out_sent, conn.out.size() - conn.out_sent, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    result.failure = std::string("send: ") + std::strerror(errno);
+                    goto done;
+                }
+                conn.out_sent += static_cast<size_t>(n);
+            }
+            if (conn.out_sent == conn.out.size()) {
+                conn.out.clear();
+                conn.out_sent = 0;
+            } else {
+                unsent = true;
+            }
+        }
+
+        // sleep until a reply, the next scheduled send (spinning when it's under a millisecond away), or 10 ms
+        int timeout = 10;
+        if (unsent) {
+            timeout = 0;
+        } else if (open_loop) {
+            double wait_ms = (next_due - static_cast<double>(now_ns())) / 1e6;
+            timeout = wait_ms < 1 ? 0 : static_cast<int>(std::min(wait_ms, 10.0));
+        }
+        int ready = ::epoll_wait(ep, events.data(), static_cast<int>(events.size()), timeout);
+        for (int e = 0; e < ready; ++e) {
+            Conn& conn = conns[events[e].data.u64];
+            char buffer[16384];
+            while (true) {
+                ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (n <= 0) {
+                    result.failure = n == 0 ? "server closed the connection" : std::string("recv: ") + std::strerror(errno);
+                    goto done;
+                }
+                conn.in.insert(conn.in.end(), buffer, buffer + n);
+            }
+            uint64_t t = now_ns();
+            size_t pos = 0;
+            while (conn.in.size() - pos >= 4) {
+                uint32_t len;
+                std::memcpy(&len, conn.in.data() + pos, 4);
+                if (conn.in.size() - pos - 4 < len) break;
+                if (conn.inflight.empty()) {
+                    result.failure = "reply without a request";
+                    goto done;
+                }
+                on_reply(conn, len > 0 && conn.in[pos + 4] == 1 /* SerializationType::Error */, t);
+                pos += 4 + len;
+            }
+            conn.in.erase(conn.in.begin(), conn.in.begin() + static_cast<ptrdiff_t>(pos));
+        }
+    }
+done:
+    for (auto& conn : conns) ::close(conn.fd);
+    ::close(ep);
+}
+
+static bool parse_options(int argc, char** argv, Options& o) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--host") {
+            o.host = value;
+        } else if (flag == "--port") {
+            o.port = static_cast<uint16_t>(std::stoi(value));
+        } else if (flag == "--threads") {
+            o.threads = std::max<size_t>(1, std::stoul(value));
+        } else if (flag == "--connections") {
+            o.connections = std::max<size_t>(1, std::stoul(value));
+        } else if (flag == "--pipeline") {
+            o.pipeline = std::max<size_t>(1, std::stoul(value));
+        } else if (flag == "--duration") {
+            o.duration = std::stod(value);
+        } else if (flag == "--warmup") {
+            o.warmup = std::stod(value);
+        } else if (flag == "--rate") {
+            o.rate = std::stod(value);
+        } else if (flag == "--keys") {
+            o.keys = static_cast<uint32_t>(std::max(1ul, std::stoul(value)));
+        } else if (flag == "--dist" && (value == "uniform" || value == "zipf")) {
+            o.dist = value;
+        } else if (flag == "--value-size") {
+            size_t dash = value.find('-');
+            o.value_min = std::stoul(value.substr(0, dash));
+            o.value_max = dash == std::string::npos ? o.value_min : std::stoul(value.substr(dash + 1));
+        } else if (flag == "--mix") {
+            o.mix.clear();
+            std::istringstream in(value);
+            std::string item;
+            while (std::getline(in, item, ',')) {
+                size_t colon = item.find(':');
+                std::string command = item.substr(0, colon);
+                static constexpr std::string_view k_known[] = {"get", "set", "del", "exists", "zadd"};
+                if (std::find(std::begin(k_known), std::end(k_known), command) == std::end(k_known)) return false;
+                o.mix.emplace_back(command, colon == std::string::npos ? 1.0 : std::stod(item.substr(colon + 1)));
+            }
+            if (o.mix.empty()) return false;
+        } else if (flag == "--json") {
+            o.json = value;
+        } else {
+            return false;
+        }
+    }
+    if (o.value_max < o.value_min) std::swap(o.value_min, o.value_max);
+    if (o.value_max > k_max_value) {
+        std::cerr << "value size capped at " << k_max_value << " bytes (the server reads frames up to " << k_max_frame
+                  << ")\n";
+        o.value_max = k_max_value;
+        o.value_min = std::min(o.value_min, o.value_max);
+    }
+    return argc % 2 == 1;
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        if (!parse_options(argc, argv, o)) {
+            std::cerr << "usage: load_generator [--host 127.0.0.1] [--port 1234] [--threads 2] [--connections 4]\n"
+                         "                      [--pipeline 1] [--duration 10] [--warmup 1] [--rate 0] [--keys 100000]\n"
+                         "                      [--dist uniform|zipf] [--value-size 32|min-max] [--mix get:90,set:10]\n"
+                         "                      [--json path]\n";
+            return 2;
+        }
+    } catch (const std::exception&) {
+        std::cerr << "bad option value\n";
+        return 2;
+    }
+
+    std::optional<Zipf> zipf;
+    if (o.dist == "zipf") zipf.emplace(o.keys, 0.99);
+    std::string mix;
+    for (const auto& [command, weight] : o.mix) mix += (mix.empty() ? "" : ",") + command + ":" + std::to_string(static_cast<int>(weight));
+    std::cout << o.host << ":" << o.port << " threads=" << o.threads << " connections=" << o.threads * o.connections
+              << " pipeline=" << o.pipeline << " mode=" << (o.rate > 0 ? "open" : "closed");
+    if (o.rate > 0) std::cout << " rate=" << o.rate << "/s";
+    std::cout << " keys=" << o.keys << " dist=" << o.dist << " value=" << o.value_min << "-" << o.value_max
+              << " mix=" << mix << " warmup=" << o.warmup << "s duration=" << o.duration << "s" << std::endl;
+
+    std::vector<std::unique_ptr<ThreadResult>> results;
+    std::vector<std::thread> threads;
+    uint64_t start = now_ns();
+    for (size_t t = 0; t < o.threads; ++t) {
+        results.push_back(std::make_unique<ThreadResult>());
+        threads.emplace_back(run_thread, std::cref(o), zipf ? &*zipf : nullptr, t, start, std::ref(*results.back()));
+    }
+    for (auto& t : threads) t.join();
+
+    LatencyHistogram::Snapshot corrected, uncorrected;
+    uint64_t completed = 0, errors = 0, backlog_max = 0;
+    for (const auto& r : results) {
+        if (!r->failure.empty()) std::cerr << "load thread stopped: " << r->failure << "\n";
+        corrected.add(r->corrected);
+        uncorrected.add(r->uncorrected);
+        completed += r->completed;
+        errors += r->errors;
+        backlog_max = std::max(backlog_max, r->backlog_max);
+    }
+    double throughput = static_cast<double>(completed) / o.duration;
+
+    static constexpr double k_quantiles[] = {0.5, 0.9, 0.99, 0.999, 0.9999};
+    static constexpr std::string_view k_labels[] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+    auto line = [&](std::string_view name, const LatencyHistogram::Snapshot& h) {
+        std::cout << std::left << std::setw(13) << name << std::right << std::fixed << std::setprecision(1);
+        for (size_t q = 0; q < std::size(k_quantiles); ++q) {
+            std::cout << " " << k_labels[q] << "=" << static_cast<double>(h.quantile(k_quantiles[q])) / 1000.0;
+        }
+        std::cout << " max=" << static_cast<double>(h.max) / 1000.0 << "\n";
+    };
+    std::cout << "requests " << completed << "  errors " << errors << "  throughput " << std::fixed
+              << std::setprecision(1) << throughput << " req/s";
+    if (o.rate > 0) std::cout << " (target " << o.rate << ")  max backlog " << backlog_max;
+    std::cout << "\nlatency (us), " << (o.rate > 0 ? "from scheduled send:" : "from send:") << "\n";
+    line("  all", corrected);
+    if (o.rate > 0) line("  uncorrected", uncorrected);
+
+    if (!o.json.empty()) {
+        std::ofstream out(o.json);
+        out << std::fixed << std::setprecision(1) << "{\"mode\":\"" << (o.rate > 0 ? "open" : "closed")
+            << "\",\"threads\":" << o.threads << ",\"connections\":" << o.threads * o.connections
+            << ",\"pipeline\":" << o.pipeline << ",\"rate\":" << o.rate << ",\"duration_s\":" << o.duration
+            << ",\"requests\":" << completed << ",\"errors\":" << errors << ",\"throughput\":" << throughput;
+        auto hist = [&](std::string_view name, const LatencyHistogram::Snapshot& h) {
+            out << ",\"" << name << "\":{";
+            for (size_t q = 0; q < std::size(k_quantiles); ++q) {
+                out << "\"" << k_labels[q] << "_us\":" << static_cast<double>(h.quantile(k_quantiles[q])) / 1000.0 << ",";
+            }
+            out << "\"max_us\":" << static_cast<double>(h.max) / 1000.0 << "}";
+        };
+        hist("latency", corrected);
+        hist("latency_uncorrected", uncorrected);
+        out << "}\n";
+    }
+    for (const auto& r : results) {
+        if (!r->failure.empty()) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "../src/dsa/hashtable.hpp"
+#include "../src/dsa/heap.hpp"
+#include "../src/dsa/avl_locking.hpp"
+
+/*
+LOCK PROFILER BENCHMARK
+
+`threads` threads share one HMap, one BinaryHeap and one AVLTree and run `ops` operations each, rotating
+between them. HMap: 80% find, 20% insert over `keys` keys. Heap: push, size, pop. AVL: 90% get, 10% set. The
+benchmark reports ops/s. Built with -DVECTORDB_LOCK_PROFILING it also prints the per-site lock report (the
+same as LOCKSTATS). Comparing ops/s against a plain build shows what the profiling costs.
+
+usage: lock_profiler_benchmark [threads=4] [ops=200000] [keys=10000]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    int keys = argc > 3 ? std::atoi(argv[3]) : 10000;
+
+    HMap<int, int> map;
+    BinaryHeap<int> heap{std::less<int>()};
+    AVLTree<int, int> tree;
+    for (int k = 0; k < keys; k += 2) {
+        map.insert(k, k);
+        tree.set(k, k);
+    }
+    LockProfiler::instance().reset();
+
+    auto t0 = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(static_cast<uint32_t>(t + 1));
+            std::uniform_int_distribution<int> key(0, keys - 1);
+            std::uniform_int_distribution<int> pct(0, 99);
+            uint64_t sink = 0;
+            for (size_t i = 0; i < ops; ++i) {
+                int k = key(rng);
+                switch (i % 3) {
+                case 0:
+                    if (pct(rng) < 20) {
+                        map.insert(k, k);
+                    } else if (int* v = map.find(k)) {
+                        sink += static_cast<uint64_t>(*v);
+                    }
+                    break;
+                case 1:
+                    // every pop follows this thread's own push, so the heap is never empty here
+                    heap.push(HeapItem<int>(k, nullptr));
+                    sink += heap.size();
+                    sink += static_cast<uint64_t>(heap.pop().value());
+                    break;
+                default:
+                    if (pct(rng) < 10) {
+                        tree.set(k, k);
+                    } else if (auto v = tree.get(k)) {
+                        sink += static_cast<uint64_t>(*v);
+                    }
+                }
+            }
+            if (sink == 42) std::cout << "";
+        });
+    }
+    for (auto& w : workers) w.join();
+    double s = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::cout << "threads=" << threads << " ops=" << ops << " keys=" << keys << "\n"
+              << std::fixed << std::setprecision(0) << static_cast<double>(threads * ops) / s << " ops/s\n";
+    if (LockProfiler::compiled_in()) {
+        std::cout << LockProfiler::instance().report();
+    } else {
+        std::cout << "(no lock report: build with -DVECTORDB_LOCK_PROFILING)\n";
+    }
+    return 0;
+}
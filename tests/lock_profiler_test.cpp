@@ -0,0 +1,101 @@
+#define VECTORDB_LOCK_PROFILING
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../command_processor.hpp"
+
+/*
+LOCK PROFILER TESTS
+*/
+
+static const LockProfiler::Summary* find_site(const std::vector<LockProfiler::Summary>& all, std::string_view site) {
+    for (const auto& s : all) {
+        if (s.site == site) return &s;
+    }
+    return nullptr;
+}
+
+TEST(LockProfilerTest, CountsUncontendedAcquisitions) {
+    SiteMutex<std::shared_mutex> m("test.uncontended");
+    for (int i = 0; i < 100; ++i) {
+        std::unique_lock lock(m);
+    }
+    for (int i = 0; i < 50; ++i) {
+        std::shared_lock outer(m);
+        std::shared_lock inner(m); // nested shared holds are timed separately
+    }
+    ASSERT_TRUE(m.try_lock());
+    m.unlock();
+
+    auto all = LockProfiler::instance().summaries();
+    const auto* s = find_site(all, "test.uncontended");
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->exclusive, 101u);
+    EXPECT_EQ(s->shared, 100u);
+    EXPECT_EQ(s->contended, 0u);
+    EXPECT_EQ(s->wait_us, 0.0);
+}
+
+TEST(LockProfilerTest, MeasuresWaitAndHold) {
+    SiteMutex<std::mutex> m("test.contended");
+    std::atomic<bool> held{false};
+    std::thread holder([&] {
+        std::lock_guard lock(m);
+        held = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+    while (!held) std::this_thread::yield();
+    {
+        std::lock_guard lock(m);
+    }
+    holder.join();
+
+    auto all = LockProfiler::instance().summaries();
+    const auto* s = find_site(all, "test.contended");
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->exclusive, 2u);
+    EXPECT_EQ(s->contended, 1u);
+    EXPECT_GT(s->wait_max_us, 10000.0);
+    EXPECT_GT(s->hold_max_us, 15000.0);
+    EXPECT_EQ(all.front().site, "test.contended"); // most total wait first
+}
+
+TEST(LockProfilerTest, DataStructureSitesReport) {
+    HMap<std::string, int> map;
+    for (int i = 0; i < 2000; ++i) map.insert("k" + std::to_string(i), i);
+
+    std::string report = LockProfiler::instance().report();
+    EXPECT_NE(report.find("hmap acquisitions="), std::string::npos) << report;
+    EXPECT_NE(report.find("htable.bucket acquisitions="), std::string::npos) << report;
+    auto all = LockProfiler::instance().summaries();
+    const auto* s = find_site(all, "hmap");
+    ASSERT_NE(s, nullptr);
+    EXPECT_GE(s->exclusive, 2000u);
+}
+
+TEST(LockProfilerTest, LockstatsCommand) {
+    SiteMutex<std::shared_mutex> m("test.command");
+    m.lock();
+    m.unlock();
+
+    EntryManager db;
+    std::vector<uint8_t> response;
+    std::vector<std::string> stats{"LOCKSTATS"};
+    CommandProcessor::process_command({stats, response, db});
+    std::string out = ResponseSerializer::deserialize_string(response);
+    EXPECT_NE(out.find("test.command acquisitions=1 shared=0 contended=0"), std::string::npos) << out;
+
+    std::vector<std::string> reset{"lockstats", "reset"};
+    response.clear();
+    CommandProcessor::process_command({reset, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response), "OK");
+    EXPECT_EQ(find_site(LockProfiler::instance().summaries(), "test.command"), nullptr);
+
+    std::vector<std::string> bad{"LOCKSTATS", "NOW"};
+    response.clear();
+    CommandProcessor::process_command({bad, response, db});
+    EXPECT_NE(ResponseSerializer::deserialize_error(response), "No error");
+}
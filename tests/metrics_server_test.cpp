@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+
+/*
+METRICS ENDPOINT TESTS
+*/
+
+// one HTTP request against 127.0.0.1:port, the whole response back
+static std::string http_get(uint16_t port, const std::string& target, const std::string& method = "GET") {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return "";
+    }
+    std::string request = method + " " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    (void)!::write(fd, request.data(), request.size());
+    std::string response;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) response.append(buffer, static_cast<size_t>(n));
+    ::close(fd);
+    return response;
+}
+
+TEST(MetricsServerTest, ServesCollectorOutput) {
+    auto server = MetricsServer::start({}, [](MetricsWriter& w) {
+        w.family("test_answer", "gauge", "The answer.");
+        w.sample("test_answer", "kind=\"ultimate\"", 42);
+    });
+    ASSERT_TRUE(server) << server.error().message();
+    uint16_t port = (*server)->port();
+
+    std::string ok = http_get(port, "/metrics");
+    EXPECT_EQ(ok.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << ok;
+    EXPECT_NE(ok.find("Content-Type: text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(ok.find("# TYPE test_answer gauge\ntest_answer{kind=\"ultimate\"} 42\n"), std::string::npos) << ok;
+
+    EXPECT_EQ(http_get(port, "/").rfind("HTTP/1.1 404", 0), 0u);
+    EXPECT_EQ(http_get(port, "/metrics", "POST").rfind("HTTP/1.1 405", 0), 0u);
+    EXPECT_EQ((*server)->scrapes(), 1u);
+}
+
+TEST(MetricsServerTest, HistogramBucketsAreCumulative) {
+    LatencyHistogram h;
+    for (uint64_t ns = 100; ns <= 100000; ns += 100) h.record(ns); // 0.1us .. 100us, ticks = ns
+    LatencyHistogram::Snapshot snap;
+    snap.add(h);
+    MetricsWriter w;
+    w.histogram("lat_seconds", "", snap, 1e-9);
+    const std::string& text = w.text();
+    EXPECT_NE(text.find("lat_seconds_bucket{le=\"+Inf\"} 1000\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("lat_seconds_count 1000\n"), std::string::npos);
+    // 10% at or under 10us, half under 50us, all under 250us - within the ~3% bucket resolution
+    auto below = [&](const std::string& le) {
+        std::string prefix = "lat_seconds_bucket{le=\"" + le + "\"} ";
+        auto at = text.find(prefix);
+        return at == std::string::npos ? -1.0 : std::stod(text.substr(at + prefix.size()));
+    };
+    EXPECT_NEAR(below("1e-05"), 100, 3);
+    EXPECT_NEAR(below("5e-05"), 500, 15);
+    EXPECT_EQ(below("0.00025"), 1000);
+}
+
+TEST(MetricsServerTest, ServerExportsKeyspaceAndCommands) {
+    Server server(0, 2);
+    ASSERT_TRUE(server.enable_metrics(0));
+    server.entry_manager_.create_entry<std::string>("a", "1");
+    server.entry_manager_.create_entry<std::string>("b", "2");
+    server.entry_manager_.create_entry<int64_t>("b", 3);    // overwrite changes the type
+    server.entry_manager_.create_entry<double>("c", 4.0);
+    server.entry_manager_.delete_entry("c");
+    std::vector<uint8_t> response;
+    std::vector<std::string> get{"GET", "a"};
+    CommandProcessor::process_command({get, response, server.entry_manager_});
+
+    std::string text = http_get(server.metrics_server_->port(), "/metrics");
+    EXPECT_NE(text.find("vectordb_keys{type=\"string\"} 1\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("vectordb_keys{type=\"int\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("vectordb_keys{type=\"double\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("vectordb_commands_total{command=\"get\"} "), std::string::npos);
+    EXPECT_NE(text.find("vectordb_command_duration_seconds_bucket{command=\"get\",le=\"+Inf\"} "), std::string::npos);
+    EXPECT_NE(text.find("vectordb_connected_clients 0\n"), std::string::npos);
+    EXPECT_NE(text.find("vectordb_thread_pool_queue_depth{pool=\"server\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("vectordb_process_resident_memory_bytes "), std::string::npos);
+}
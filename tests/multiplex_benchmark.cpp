@@ -0,0 +1,256 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+
+/*
+MULTIPLEX BENCHMARK
+
+Head-of-line blocking with and without MULTIPLEX (request ids, out-of-order responses, see connection.hpp)
+and worker offload (command_offload.hpp). One connection keeps `window` requests in flight. The requests
+are GETs of 100-byte values, except every `slow_every`-th, which is a DEBUG SLEEP `slow_ms`: the stand-in for
+a long command such as a vector search. GET latency runs from the send to the reply:
+
+    in order            plain frames: every GET behind a sleep waits for it
+    multiplex inline    request ids, but --offload off, so the sleep still holds the poll loop
+    multiplex offload   request ids, and the sleep runs on a worker while the loop answers the GETs
+
+Each mode gets its own server in a forked child (2 worker threads, DEBUG on) with its output sent to /dev/null.
+Latency columns are for the GETs only, in us.
+
+usage: multiplex_benchmark [ops=200000] [window=16] [slow_every=1000] [slow_ms=5] [port=7393]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+static void put_be32(std::string& out, uint32_t v) {
+    uint32_t be = htonl(v);
+    out.append(reinterpret_cast<const char*>(&be), 4);
+}
+
+// a frame, with the request id first in the payload when `tagged`
+static void append_request(std::string& out, bool tagged, uint32_t id, const std::vector<std::string>& args) {
+    size_t payload = tagged ? 4 : 0;
+    for (const auto& a : args) payload += 4 + a.size();
+    put_be32(out, static_cast<uint32_t>(payload));
+    if (tagged) put_be32(out, id);
+    for (const auto& a : args) {
+        put_be32(out, static_cast<uint32_t>(a.size()));
+        out.append(a);
+    }
+}
+
+static pid_t fork_server(uint16_t port, bool offload) {
+    pid_t child = ::fork();
+    if (child == 0) {
+        int null = ::open("/dev/null", O_WRONLY);
+        ::dup2(null, STDOUT_FILENO);
+        ::dup2(null, STDERR_FILENO);
+        Server server(port, 2);
+        server.set_offload(offload);
+        CommandProcessor::debug_enabled = true;
+        if (!server.initialize()) _exit(1);
+        server.run();
+        _exit(0);
+    }
+    return child;
+}
+
+static int dial(uint16_t port) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return -1;
+}
+
+static bool write_all(int fd, const std::string& data) {
+    for (size_t done = 0; done < data.size();) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+struct Row {
+    std::string name;
+    LatencyHistogram::Snapshot get_latency;
+    uint64_t gets = 0;
+    uint64_t slow = 0;
+    double seconds = 0;
+    bool ok = true;
+};
+
+static Row run(const std::string& name, uint16_t port, bool offload, bool tagged, uint64_t ops, size_t window,
+               uint64_t slow_every, uint64_t slow_ms, size_t keys) {
+    Row row;
+    row.name = name;
+    pid_t child = fork_server(port, offload);
+    int fd = dial(port);
+    if (fd < 0) {
+        row.ok = false;
+        ::kill(child, SIGKILL);
+        ::waitpid(child, nullptr, 0);
+        return row;
+    }
+
+    std::vector<char> in(1 << 16);
+    size_t have = 0;
+    std::vector<uint64_t> sent_ns(ops, 0);
+    std::vector<uint32_t> fifo;             // ids in send order, for plain frames
+    size_t fifo_head = 0;
+    std::string out;
+    auto expect_replies = [&](size_t count, auto&& on_reply) {
+        while (count > 0) {
+            size_t pos = 0;
+            while (count > 0 && have - pos >= 4) {
+                uint32_t len;
+                std::memcpy(&len, in.data() + pos, 4);
+                if (have - pos - 4 < len) break;
+                uint32_t id;
+                if (tagged) {
+                    std::memcpy(&id, in.data() + pos + 4, 4);
+                } else {
+                    id = fifo[fifo_head++];
+                }
+                on_reply(id);
+                pos += 4 + len;
+                --count;
+            }
+            std::memmove(in.data(), in.data() + pos, have - pos);
+            have -= pos;
+            if (count == 0) break;
+            ssize_t n = ::read(fd, in.data() + have, in.size() - have);
+            if (n <= 0) return false;
+            have += static_cast<size_t>(n);
+        }
+        return true;
+    };
+
+    // load the keys, and say MULTIPLEX first if this run is tagged
+    std::string value(100, 'v');
+    if (tagged) {
+        out.clear();
+        append_request(out, false, 0, {"MULTIPLEX"});
+        fifo.push_back(0);
+        row.ok = write_all(fd, out) && expect_replies(1, [](uint32_t) {});
+    }
+    for (size_t k = 0; k < keys && row.ok; ++k) {
+        out.clear();
+        append_request(out, tagged, 0, {"SET", "key:" + std::to_string(k), value});
+        fifo.push_back(0);
+        row.ok = write_all(fd, out) && expect_replies(1, [](uint32_t) {});
+    }
+    fifo.clear();
+    fifo_head = 0;
+
+    LatencyHistogram h;
+    size_t in_flight = 0;
+    uint64_t next = 0, done = 0;
+    auto start = Clock::now();
+    while (row.ok && done < ops) {
+        out.clear();
+        uint64_t t = now_ns();
+        while (in_flight < window && next < ops) {
+            uint32_t id = static_cast<uint32_t>(next);
+            if (slow_every && next % slow_every == slow_every - 1) {
+                append_request(out, tagged, id, {"DEBUG", "SLEEP", std::to_string(slow_ms)});
+                sent_ns[next] = 0;         // not a GET
+            } else {
+                append_request(out, tagged, id, {"GET", "key:" + std::to_string(next % keys)});
+                sent_ns[next] = t;
+            }
+            fifo.push_back(id);
+            ++next;
+            ++in_flight;
+        }
+        if (!out.empty() && !write_all(fd, out)) {
+            row.ok = false;
+            break;
+        }
+        // at least one reply, then whatever else already arrived
+        row.ok = expect_replies(1, [&](uint32_t id) {
+            if (sent_ns[id]) {
+                h.record(now_ns() - sent_ns[id]);
+                ++row.gets;
+            } else {
+                ++row.slow;
+            }
+            --in_flight;
+            ++done;
+        });
+    }
+    row.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    row.get_latency.add(h);
+    ::close(fd);
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+    return row;
+}
+
+int main(int argc, char** argv) {
+    uint64_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t window = std::max<size_t>(1, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16);
+    uint64_t slow_every = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000;
+    uint64_t slow_ms = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 5;
+    uint16_t port = static_cast<uint16_t>(argc > 5 ? std::atoi(argv[5]) : 7393);
+    size_t keys = 1000;
+
+    std::vector<Row> rows;
+    rows.push_back(run("in order", port, true, false, ops, window, slow_every, slow_ms, keys));
+    rows.push_back(run("multiplex inline", static_cast<uint16_t>(port + 1), false, true, ops, window, slow_every,
+                       slow_ms, keys));
+    rows.push_back(run("multiplex offload", static_cast<uint16_t>(port + 2), true, true, ops, window, slow_every,
+                       slow_ms, keys));
+
+    std::cout << "ops=" << ops << " window=" << window << " slow_every=" << slow_every << " slow_ms=" << slow_ms
+              << "\n"
+              << std::left << std::setw(19) << "mode" << std::right << std::setw(12) << "GETs/s" << std::setw(10)
+              << "p50 us" << std::setw(10) << "p99 us" << std::setw(11) << "p99.9 us" << std::setw(11) << "max us"
+              << "\n";
+    int code = 0;
+    for (const auto& row : rows) {
+        if (!row.ok) {
+            std::cout << std::left << std::setw(19) << row.name << " failed\n";
+            code = 1;
+            continue;
+        }
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        std::cout << std::left << std::setw(19) << row.name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << static_cast<double>(row.gets) / row.seconds << std::setprecision(1)
+                  << std::setw(10) << us(row.get_latency.quantile(0.5)) << std::setw(10)
+                  << us(row.get_latency.quantile(0.99)) << std::setw(11) << us(row.get_latency.quantile(0.999))
+                  << std::setw(11) << us(row.get_latency.max) << "\n";
+    }
+    return code;
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include "../src/raft/apply.hpp"
+
+/*
+RAFT APPLY BENCHMARK
+
+Builds `entries` raft entries of `batch` SET commands each (random keys out of a 1M keyspace, 32-byte
+values) and times applying all of them:
+
+    serial   - one EntryManager, commands applied one at a time on the calling thread (applylog)
+    sharded  - ShardedApplier over S EntryManager shards, one applylog_batch call per `run` entries,
+               for S = 1, 2, 4, ... up to max_shards
+
+Reports commands applied per second. Decoding is included in both, so the difference is what spreading
+the apply over shard workers buys.
+
+usage: raft_apply_benchmark [entries=20000] [batch=64] [run=64] [max_shards=2*nproc]
+*/
+
+using Clock = std::chrono::steady_clock;
+using Command = CommandBatch::Command;
+
+static std::vector<std::vector<uint8_t>> make_entries(size_t entries, size_t batch) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<uint64_t> key(0, 999'999);
+    std::string value(32, 'v');
+    std::vector<std::vector<uint8_t>> out;
+    out.reserve(entries);
+    for (size_t e = 0; e < entries; ++e) {
+        std::vector<Command> commands;
+        commands.reserve(batch);
+        for (size_t c = 0; c < batch; ++c) {
+            commands.push_back({"SET", "key:" + std::to_string(key(rng)), value});
+        }
+        out.push_back(CommandBatch::encode(commands));
+    }
+    return out;
+}
+
+static std::vector<raft_entry_t> as_raft_entries(std::vector<std::vector<uint8_t>>& payloads) {
+    std::vector<raft_entry_t> etys(payloads.size());
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        etys[i] = {};
+        etys[i].type = RAFT_LOGTYPE_NORMAL;
+        etys[i].data.buf = payloads[i].data();
+        etys[i].data.len = static_cast<unsigned int>(payloads[i].size());
+    }
+    return etys;
+}
+
+int main(int argc, char** argv) {
+    const size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000;
+    const size_t batch = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const size_t run = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    const size_t max_shards = argc > 4 ? std::strtoull(argv[4], nullptr, 10)
+                                       : 2 * std::max(1u, std::thread::hardware_concurrency());
+
+    auto payloads = make_entries(entries, batch);
+    auto etys = as_raft_entries(payloads);
+    const double commands = static_cast<double>(entries * batch);
+    std::cout << "[Workload] " << entries << " entries x " << batch << " SETs, " << run << " entries per apply, "
+              << std::thread::hardware_concurrency() << " cpus\n";
+
+    double serial_rate;
+    {
+        EntryManager db(1);
+        std::vector<Command> decoded;
+        std::vector<uint8_t> response;
+        auto start = Clock::now();
+        for (const auto& ety : etys) {
+            decoded.clear();
+            (void)CommandBatch::decode({static_cast<const uint8_t*>(ety.data.buf), ety.data.len}, decoded);
+            for (const auto& command : decoded) {
+                response.clear();
+                CommandProcessor::process_command({command, response, db});
+            }
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        serial_rate = commands / elapsed;
+        std::cout << "[serial] " << static_cast<uint64_t>(serial_rate) << " cmds/sec, " << db.size() << " keys\n";
+    }
+
+    for (size_t shards = 1; shards <= max_shards; shards *= 2) {
+        std::vector<std::unique_ptr<EntryManager>> owned;
+        std::vector<EntryManager*> views;
+        for (size_t i = 0; i < shards; ++i) {
+            owned.push_back(std::make_unique<EntryManager>(1));
+            views.push_back(owned.back().get());
+        }
+        ShardedApplier applier(views);
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < etys.size(); i += run) {
+            int n = static_cast<int>(std::min(run, etys.size() - i));
+            applier.apply(&etys[i], static_cast<raft_index_t>(i + 1), n);
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        size_t keys = 0;
+        for (auto* shard : views) keys += shard->size();
+        double rate = commands / elapsed;
+        std::cout << "[sharded " << shards << "] " << static_cast<uint64_t>(rate) << " cmds/sec ("
+                  << rate / serial_rate << "x serial), " << keys << " keys\n";
+    }
+    return 0;
+}
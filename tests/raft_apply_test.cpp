@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/raft/apply.hpp"
+
+/*
+RAFT SHARDED APPLY TESTS
+*/
+
+using Command = CommandBatch::Command;
+
+static std::string get(EntryManager& db, const std::string& key) {
+    auto entry = std::dynamic_pointer_cast<Entry<std::string>>(db.find_entry(key));
+    return entry ? entry->value : "(nil)";
+}
+
+static std::vector<Command> workload(size_t n) {
+    std::vector<Command> commands;
+    for (size_t i = 0; i < n; ++i) {
+        std::string key = "k" + std::to_string(i % 97);
+        if (i % 13 == 0) {
+            commands.push_back({"DEL", key});
+        } else {
+            commands.push_back({"SET", key, "v" + std::to_string(i)});
+        }
+        if (i == n / 2) {
+            commands.push_back({"FLUSHALL"});
+        }
+    }
+    return commands;
+}
+
+TEST(RaftApplyTest, BatchRoundTrip) {
+    std::vector<Command> commands{{"SET", "a", "1"}, {"DEL", "a"}, {"FLUSHALL"}, {"SET", "", std::string("\0x", 2)}};
+    auto bytes = CommandBatch::encode(commands);
+
+    std::vector<Command> decoded;
+    ASSERT_TRUE(CommandBatch::decode(bytes, decoded));
+    EXPECT_EQ(decoded, commands);
+
+    bytes.pop_back();
+    decoded.clear();
+    EXPECT_FALSE(CommandBatch::decode(bytes, decoded));
+}
+
+TEST(RaftApplyTest, ShardedMatchesSerial) {
+    auto commands = workload(5000);
+
+    EntryManager serial(1);
+    for (const auto& command : commands) {
+        std::vector<uint8_t> response;
+        CommandProcessor::process_command({command, response, serial});
+    }
+
+    std::vector<std::unique_ptr<EntryManager>> owned;
+    std::vector<EntryManager*> shards;
+    for (int i = 0; i < 4; ++i) {
+        owned.push_back(std::make_unique<EntryManager>(1));
+        shards.push_back(owned.back().get());
+    }
+    ShardedApplier applier(shards, ShardedApplier::Options{.min_parallel = 1});
+    applier.apply(commands);
+
+    size_t total = 0;
+    for (auto* shard : shards) total += shard->size();
+    EXPECT_EQ(total, serial.size());
+    for (int k = 0; k < 97; ++k) {
+        std::string key = "k" + std::to_string(k);
+        EXPECT_EQ(get(applier.shard(ShardedApplier::shard_of(key, 4)), key), get(serial, key)) << key;
+    }
+}
+
+static ShardedApplier* g_applier;
+static ShardedApplier* applier_of(void*) { return g_applier; }
+
+TEST(RaftApplyTest, AdvancesLastAppliedAfterShardsFinish) {
+    std::vector<std::unique_ptr<EntryManager>> owned;
+    std::vector<EntryManager*> shards;
+    for (int i = 0; i < 2; ++i) {
+        owned.push_back(std::make_unique<EntryManager>(1));
+        shards.push_back(owned.back().get());
+    }
+    ShardedApplier applier(shards, ShardedApplier::Options{.min_parallel = 1});
+    g_applier = &applier;
+
+    raft_cbs_t cbs = {};
+    ShardedApplier::install<&applier_of>(cbs);
+    raft_server_t* raft = raft_new();
+    raft_set_callbacks(raft, &cbs, nullptr);
+    raft_add_node(raft, nullptr, 1, 1);
+    raft_become_leader(raft);
+
+    std::vector<std::vector<uint8_t>> payloads;
+    for (int e = 0; e < 10; ++e) {
+        std::vector<Command> batch;
+        for (int c = 0; c < 20; ++c) {
+            batch.push_back({"SET", "key" + std::to_string(e * 20 + c), std::to_string(e)});
+        }
+        payloads.push_back(CommandBatch::encode(batch));
+    }
+    unsigned int id = 1;
+    for (auto& payload : payloads) {
+        msg_entry_t entry = {};
+        entry.id = id++;
+        entry.data.buf = payload.data();
+        entry.data.len = static_cast<unsigned int>(payload.size());
+        msg_entry_response_t response;
+        ASSERT_EQ(raft_recv_entry(raft, &entry, &response), 0);
+    }
+
+    // single voter: periodic commits everything, and with applylog_batch set applies it in one call
+    raft_periodic(raft, 1);
+    EXPECT_EQ(raft_get_commit_idx(raft), 10);
+    EXPECT_EQ(raft_get_last_applied_idx(raft), 10);
+    EXPECT_EQ(applier.applied_commands(), 200u);
+    EXPECT_EQ(shards[0]->size() + shards[1]->size(), 200u);
+    EXPECT_EQ(get(applier.shard(ShardedApplier::shard_of("key199", 2)), "key199"), "9");
+    raft_free(raft);
+}
+
+TEST(RaftApplyTest, OverwriteDropsTheOldTtl) {
+    // SET over a key with a TTL frees the old entry; its heap slot must not outlive it
+    EntryManager db(1);
+    std::vector<std::vector<std::string>> commands{
+        {"SET", "x", "1"}, {"SET", "k", "v"}, {"PEXPIRE", "k", "1000"}, {"SET", "k", "v2"}, {"PEXPIRE", "x", "1000"}};
+    for (const auto& command : commands) {
+        std::vector<uint8_t> response;
+        CommandProcessor::process_command({command, response, db});
+    }
+
+    EXPECT_EQ(get(db, "k"), "v2");
+    EXPECT_EQ(db.get_expiry_time(*db.find_entry("k")), -1);
+    EXPECT_GT(db.get_expiry_time(*db.find_entry("x")), 0);
+    EXPECT_EQ(db.keyspace_stats().keys_with_expiry, 1u);
+
+    // a TTL'd key that isn't the heap's root can be overwritten and deleted too
+    std::vector<uint8_t> response;
+    CommandProcessor::process_command({{"PEXPIRE", "k", "500"}, response, db});
+    CommandProcessor::process_command({{"SET", "x", "2"}, response, db});
+    EXPECT_EQ(db.get_expiry_time(*db.find_entry("x")), -1);
+    EXPECT_GT(db.get_expiry_time(*db.find_entry("k")), 0);
+    EXPECT_TRUE(db.delete_entry("k"));
+    EXPECT_EQ(db.keyspace_stats().keys_with_expiry, 0u);
+}
+
+TEST(RaftApplyTest, UndecodableEntryIsSkippedWhole) {
+    std::vector<std::unique_ptr<EntryManager>> owned;
+    std::vector<EntryManager*> shards;
+    for (int i = 0; i < 2; ++i) {
+        owned.push_back(std::make_unique<EntryManager>(1));
+        shards.push_back(owned.back().get());
+    }
+    ShardedApplier applier(shards, ShardedApplier::Options{.min_parallel = 1});
+
+    // the middle entry's first command decodes, then its bytes run out
+    auto good1 = CommandBatch::encode(std::vector<Command>{{"SET", "a", "1"}});
+    auto bad = CommandBatch::encode(std::vector<Command>{{"SET", "b", "1"}, {"SET", "c", "1"}});
+    bad.resize(bad.size() - 3);
+    auto good2 = CommandBatch::encode(std::vector<Command>{{"SET", "d", "1"}});
+
+    raft_entry_t etys[3] = {};
+    std::vector<uint8_t>* payloads[3] = {&good1, &bad, &good2};
+    for (int i = 0; i < 3; ++i) {
+        etys[i].type = RAFT_LOGTYPE_NORMAL;
+        etys[i].data.buf = payloads[i]->data();
+        etys[i].data.len = static_cast<unsigned int>(payloads[i]->size());
+    }
+    EXPECT_EQ(applier.apply(etys, 1, 3), 0);
+
+    EXPECT_EQ(applier.applied_commands(), 2u);
+    auto value = [&](const std::string& key) { return get(applier.shard(ShardedApplier::shard_of(key, 2)), key); };
+    EXPECT_EQ(value("a"), "1");
+    EXPECT_EQ(value("b"), "(nil)");
+    EXPECT_EQ(value("c"), "(nil)");
+    EXPECT_EQ(value("d"), "1");
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../src/raft/log_store.hpp"
+
+/*
+RAFT LOG STORE TESTS
+*/
+
+class RaftLogStoreTest : public ::testing::Test {
+protected:
+    std::string dir_;
+
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("raft_log_store_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::unique_ptr<RaftLogStore> open_store(size_t segment_entries = 8) {
+        auto store = RaftLogStore::open({dir_, segment_entries, 1 << 20});
+        EXPECT_TRUE(store.has_value());
+        return std::move(*store);
+    }
+
+    static std::vector<uint8_t> payload(int i) {
+        std::string s = "entry-" + std::to_string(i);
+        return {s.begin(), s.end()};
+    }
+};
+
+TEST_F(RaftLogStoreTest, AppendSyncReopen) {
+    {
+        auto store = open_store();
+        for (int i = 1; i <= 20; ++i) {
+            ASSERT_TRUE(store->append(i, 1, i, RAFT_LOGTYPE_NORMAL, payload(i)));
+        }
+        ASSERT_TRUE(store->sync());
+        EXPECT_EQ(store->sync_count(), 1u);   // one fdatasync round for the whole batch
+        EXPECT_EQ(store->segment_count(), 3u); // 8 + 8 + 4
+    }
+
+    auto store = open_store();
+    EXPECT_EQ(store->first_index(), 1);
+    EXPECT_EQ(store->last_index(), 20);
+    for (int i = 1; i <= 20; ++i) {
+        auto record = store->read(i);
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(record->id, static_cast<unsigned int>(i));
+        EXPECT_EQ(record->data, payload(i));
+    }
+}
+
+TEST_F(RaftLogStoreTest, ReadBeforeSync) {
+    auto store = open_store();
+    ASSERT_TRUE(store->append(1, 1, 1, RAFT_LOGTYPE_NORMAL, payload(1)));
+    auto record = store->read(1);
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->data, payload(1));
+}
+
+TEST_F(RaftLogStoreTest, TruncateSuffixDeletesSegments) {
+    auto store = open_store();
+    for (int i = 1; i <= 20; ++i) {
+        ASSERT_TRUE(store->append(i, 1, i, RAFT_LOGTYPE_NORMAL, payload(i)));
+    }
+    ASSERT_TRUE(store->sync());
+
+    ASSERT_TRUE(store->truncate_suffix(6));
+    EXPECT_EQ(store->last_index(), 5);
+    EXPECT_EQ(store->segment_count(), 1u);
+    EXPECT_FALSE(store->read(6).has_value());
+
+    ASSERT_TRUE(store->append(6, 2, 100, RAFT_LOGTYPE_NORMAL, payload(100)));
+    ASSERT_TRUE(store->sync());
+    store.reset();
+
+    store = open_store();
+    EXPECT_EQ(store->last_index(), 6);
+    EXPECT_EQ(store->read(6)->term, 2);
+}
+
+TEST_F(RaftLogStoreTest, CompactPrefixDeletesWholeSegments) {
+    auto store = open_store();
+    for (int i = 1; i <= 20; ++i) {
+        ASSERT_TRUE(store->append(i, 1, i, RAFT_LOGTYPE_NORMAL, payload(i)));
+    }
+    ASSERT_TRUE(store->sync());
+
+    ASSERT_TRUE(store->compact_prefix(12));
+    EXPECT_EQ(store->first_index(), 9);   // segment [9, 16] still holds 12
+    EXPECT_EQ(store->segment_count(), 2u);
+    EXPECT_FALSE(store->read(8).has_value());
+    EXPECT_TRUE(store->read(12).has_value());
+}
+
+TEST_F(RaftLogStoreTest, TornTailIsDropped) {
+    {
+        auto store = open_store(64);
+        for (int i = 1; i <= 3; ++i) {
+            ASSERT_TRUE(store->append(i, 1, i, RAFT_LOGTYPE_NORMAL, payload(i)));
+        }
+        ASSERT_TRUE(store->sync());
+    }
+
+    // chop the last record in half as if we crashed mid-write
+    auto path = dir_ + "/00000000000000000001.log";
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+    auto store = open_store(64);
+    EXPECT_EQ(store->last_index(), 2);
+    ASSERT_TRUE(store->append(3, 1, 3, RAFT_LOGTYPE_NORMAL, payload(3)));
+}
+
+TEST_F(RaftLogStoreTest, TermAndVoteSurviveRestart) {
+    {
+        auto store = open_store();
+        ASSERT_TRUE(store->save_term_vote(7, 3));
+    }
+    auto store = open_store();
+    EXPECT_EQ(store->term(), 7);
+    EXPECT_EQ(store->voted_for(), 3);
+}
+
+TEST_F(RaftLogStoreTest, DirectoryChangesAreSyncedAndReopenConsistently) {
+    {
+        auto store = open_store();
+        uint64_t synced = store->dir_sync_count();   // the open itself
+        EXPECT_GE(synced, 1u);
+        for (int i = 1; i <= 20; ++i) {
+            ASSERT_TRUE(store->append(i, 1, i, RAFT_LOGTYPE_NORMAL, payload(i)));
+        }
+        ASSERT_TRUE(store->sync());
+        EXPECT_EQ(store->dir_sync_count(), synced + 3);  // one per segment created
+        synced = store->dir_sync_count();
+
+        ASSERT_TRUE(store->truncate_suffix(10));          // unlinks [17, 20], cuts [9, 16] back to 9
+        EXPECT_EQ(store->dir_sync_count(), synced + 1);
+        ASSERT_TRUE(store->compact_prefix(9));            // unlinks [1, 8]
+        EXPECT_EQ(store->dir_sync_count(), synced + 2);
+        for (int i = 10; i <= 18; ++i) {
+            ASSERT_TRUE(store->append(i, 2, 100 + i, RAFT_LOGTYPE_NORMAL, payload(100 + i)));
+        }
+        ASSERT_TRUE(store->sync());
+    }
+
+    std::vector<std::string> files;
+    for (const auto& file : std::filesystem::directory_iterator(dir_)) {
+        files.push_back(file.path().filename().string());
+    }
+    std::sort(files.begin(), files.end());
+    EXPECT_EQ(files, (std::vector<std::string>{"00000000000000000009.idx", "00000000000000000009.log",
+                                               "00000000000000000017.idx", "00000000000000000017.log",
+                                               "raft.meta"}));
+
+    for (int round = 0; round < 2; ++round) {   // and a second reopen finds the same thing
+        auto store = open_store();
+        EXPECT_EQ(store->first_index(), 9);
+        EXPECT_EQ(store->last_index(), 18);
+        EXPECT_EQ(store->segment_count(), 2u);
+        EXPECT_EQ(store->read(9)->term, 1);
+        for (int i = 10; i <= 18; ++i) {
+            auto record = store->read(i);
+            ASSERT_TRUE(record.has_value());
+            EXPECT_EQ(record->term, 2);
+            EXPECT_EQ(record->data, payload(100 + i));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
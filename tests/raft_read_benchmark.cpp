@@ -0,0 +1,218 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "../src/raft/raft.hpp"
+
+/*
+RAFT READ BENCHMARK
+
+Three raft servers in one process, wired together with an in-memory message queue (every message is
+delivered before the next simulated millisecond). Each simulated ms a client issues `batch` reads against
+the leader using one of:
+
+    log        - every read is appended to the raft log and answered when it's applied (the naive way)
+    readindex  - raft_queue_read_request; one heartbeat round confirms every read queued in that ms
+    lease      - raft_lease_read_ok; served locally while the lease holds, ReadIndex otherwise
+
+Reports wall-clock read QPS, plus AppendEntries messages and log entries spent per read.
+
+usage: raft_read_benchmark [reads=200000] [batch=64]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Message {
+    enum Type { AE, AER, RV, RVR } type;
+    int from, to;
+    msg_appendentries_t ae;
+    std::vector<msg_entry_t> entries;
+    msg_appendentries_response_t aer;
+    msg_requestvote_t rv;
+    msg_requestvote_response_t rvr;
+
+    static Message to_node(Type type, int from, int to) {
+        Message m{};
+        m.type = type;
+        m.from = from;
+        m.to = to;
+        return m;
+    }
+};
+
+struct Cluster {
+    static constexpr int k_nodes = 3;
+    raft_server_t* servers[k_nodes];
+    std::deque<Message> wire;
+    uint64_t appendentries_sent = 0;
+    uint64_t reads_applied = 0;
+    unsigned int next_id = 1;
+
+    Cluster() {
+        raft_cbs_t cbs = {};
+        cbs.send_requestvote = [](raft_server_t* raft, void* udata, raft_node_t* node, msg_requestvote_t* msg) {
+            auto* cluster = static_cast<Cluster*>(udata);
+            Message m = Message::to_node(Message::RV, raft_get_nodeid(raft), raft_node_get_id(node));
+            m.rv = *msg;
+            cluster->wire.push_back(std::move(m));
+            return 0;
+        };
+        cbs.send_appendentries = [](raft_server_t* raft, void* udata, raft_node_t* node, msg_appendentries_t* msg) {
+            auto* cluster = static_cast<Cluster*>(udata);
+            Message m = Message::to_node(Message::AE, raft_get_nodeid(raft), raft_node_get_id(node));
+            m.ae = *msg;
+            m.entries.assign(msg->entries, msg->entries + msg->n_entries);
+            cluster->wire.push_back(std::move(m));
+            ++cluster->appendentries_sent;
+            return 0;
+        };
+        cbs.applylog = [](raft_server_t* raft, void* udata, raft_entry_t* ety) {
+            auto* cluster = static_cast<Cluster*>(udata);
+            if (raft_is_leader(raft) && ety->data.len == 1) {
+                ++cluster->reads_applied; // a read that went through the log
+            }
+            return 0;
+        };
+
+        for (int i = 0; i < k_nodes; ++i) {
+            servers[i] = raft_new();
+            raft_set_callbacks(servers[i], &cbs, this);
+            raft_set_election_timeout(servers[i], 1000);
+            raft_set_request_timeout(servers[i], 100);
+            for (int j = 0; j < k_nodes; ++j) {
+                raft_add_node(servers[i], nullptr, j, i == j);
+            }
+        }
+    }
+
+    ~Cluster() {
+        for (auto* server : servers) {
+            raft_free(server);
+        }
+    }
+
+    raft_server_t* leader() { return servers[0]; }
+
+    void deliver() {
+        while (!wire.empty()) {
+            Message m = std::move(wire.front());
+            wire.pop_front();
+            raft_server_t* to = servers[m.to];
+            raft_node_t* from = raft_get_node(to, m.from);
+            switch (m.type) {
+                case Message::AE: {
+                    Message reply = Message::to_node(Message::AER, m.to, m.from);
+                    m.ae.entries = m.entries.data();
+                    raft_recv_appendentries(to, from, &m.ae, &reply.aer);
+                    wire.push_back(std::move(reply));
+                    break;
+                }
+                case Message::AER:
+                    raft_recv_appendentries_response(to, from, &m.aer);
+                    break;
+                case Message::RV: {
+                    Message reply = Message::to_node(Message::RVR, m.to, m.from);
+                    raft_recv_requestvote(to, from, &m.rv, &reply.rvr);
+                    wire.push_back(std::move(reply));
+                    break;
+                }
+                case Message::RVR:
+                    raft_recv_requestvote_response(to, from, &m.rvr);
+                    break;
+            }
+        }
+    }
+
+    void tick(int ms) {
+        for (auto* server : servers) {
+            raft_periodic(server, ms);
+        }
+        deliver();
+        for (auto* server : servers) {
+            raft_apply_all(server);
+        }
+        raft_periodic(leader(), 0); // hand out reads whose index just got applied
+    }
+
+    bool append(unsigned int len) {
+        static char payload[2] = {'r', 'w'};
+        msg_entry_t entry = {};
+        entry.id = next_id++;
+        entry.type = RAFT_LOGTYPE_NORMAL;
+        entry.data.buf = payload;
+        entry.data.len = len;
+        msg_entry_response_t response;
+        return raft_recv_entry(leader(), &entry, &response) == 0;
+    }
+
+    void elect() {
+        raft_periodic(leader(), 1000); // node 0 times out first and wins
+        deliver();
+        append(0);                     // no-op so the new term has a committed entry
+        for (int i = 0; i < 3; ++i) {
+            tick(1);
+        }
+    }
+};
+
+enum class Mode { Log, ReadIndex, Lease };
+
+static void run(Mode mode, size_t total_reads, size_t batch) {
+    Cluster cluster;
+    cluster.elect();
+    if (mode == Mode::Lease) {
+        raft_set_lease_timeout(cluster.leader(), 500);
+    }
+
+    size_t issued = 0;
+    uint64_t completed = 0;
+    uint64_t lease_hits = 0;
+    uint64_t ae_before = cluster.appendentries_sent;
+    raft_index_t log_before = raft_get_current_idx(cluster.leader());
+    auto on_read = [](void* arg, int can_read) {
+        if (can_read) {
+            ++*static_cast<uint64_t*>(arg);
+        }
+    };
+
+    auto start = Clock::now();
+    while (issued < total_reads || (mode == Mode::Log ? cluster.reads_applied : completed) < total_reads) {
+        for (size_t i = 0; i < batch && issued < total_reads; ++i, ++issued) {
+            if (mode == Mode::Log) {
+                cluster.append(1);
+            } else if (mode == Mode::Lease && raft_lease_read_ok(cluster.leader())) {
+                ++completed;
+                ++lease_hits;
+            } else {
+                raft_queue_read_request(cluster.leader(), on_read, &completed);
+            }
+        }
+        cluster.tick(1);
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (mode == Mode::Log) {
+        completed = cluster.reads_applied;
+    }
+
+    const char* name = mode == Mode::Log ? "log" : mode == Mode::ReadIndex ? "readindex" : "lease";
+    std::cout << "[" << name << "] " << completed << " reads in " << elapsed * 1000 << " ms ("
+              << static_cast<uint64_t>(completed / elapsed) << " reads/sec), "
+              << static_cast<double>(cluster.appendentries_sent - ae_before) / completed << " AE msgs/read, "
+              << static_cast<double>(raft_get_current_idx(cluster.leader()) - log_before) / completed << " log entries/read";
+    if (mode == Mode::Lease) {
+        std::cout << ", " << lease_hits << " served under lease";
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    const size_t reads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000;
+    const size_t batch = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+
+    run(Mode::Log, reads, batch);
+    run(Mode::ReadIndex, reads, batch);
+    run(Mode::Lease, reads, batch);
+    return 0;
+}
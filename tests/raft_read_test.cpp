@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <utility>
+#include <vector>
+#include "../src/raft/sim.hpp"
+
+/*
+RAFT READINDEX / LEASE READ TESTS
+*/
+
+// a leader whose term has a committed entry (its no-op), applied everywhere
+static int settle(RaftSim& sim) {
+    sim.run_until([&] {
+        int leader = sim.leader();
+        if (leader == -1 || raft_get_commit_idx(sim.raft(leader)) < raft_get_current_idx(sim.raft(leader))) {
+            return false;
+        }
+        for (int i = 0; i < sim.size(); ++i) {
+            if (raft_get_last_applied_idx(sim.raft(i)) != raft_get_current_idx(sim.raft(leader))) return false;
+        }
+        return raft_get_commit_idx(sim.raft(leader)) > 0;
+    }, 10'000);
+    return sim.leader();
+}
+
+// what each callback saw, in the order they ran
+struct Reads {
+    std::vector<std::pair<int, int>> done; // (read number, can_read)
+    std::vector<raft_index_t> applied;     // the server's last applied index when each ran
+    std::vector<std::pair<Reads*, int>> args;
+    raft_server_t* raft = nullptr;
+
+    Reads() { args.reserve(64); }
+
+    int queue(raft_server_t* server) {
+        raft = server;
+        args.push_back({this, static_cast<int>(args.size())});
+        return raft_queue_read_request(server, [](void* arg, int can_read) {
+            auto* a = static_cast<std::pair<Reads*, int>*>(arg);
+            a->first->done.push_back({a->second, can_read});
+            a->first->applied.push_back(raft_get_last_applied_idx(a->first->raft));
+        }, &args.back());
+    }
+};
+
+TEST(RaftReadTest, ReadsQueuedTogetherShareOneRound) {
+    RaftSim sim(RaftSim::Options{});
+    int l = settle(sim);
+    ASSERT_NE(l, -1);
+    raft_server_t* leader = sim.raft(l);
+    Reads reads;
+
+    // nothing confirms a read until the next broadcast is acknowledged by a majority
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(reads.queue(leader), 0);
+    }
+    EXPECT_TRUE(reads.done.empty());
+    uint64_t sent = sim.stats().sent;
+    ASSERT_TRUE(sim.run_until([&] { return reads.done.size() == 5; }, 50));
+    EXPECT_EQ(sim.stats().sent - sent, 4u);      // one heartbeat per follower and its ack, for all five
+    for (auto [n, can_read] : reads.done) EXPECT_EQ(can_read, 1);
+
+    // a read queued after that round has to wait for a round of its own
+    ASSERT_EQ(reads.queue(leader), 0);
+    sim.isolate(l);
+    sim.step(5);
+    EXPECT_EQ(reads.done.size(), 5u);
+    sim.heal();
+    sim.step(5);
+    EXPECT_EQ(reads.done.size(), 5u);           // its round was lost; nothing resends it before the heartbeat
+    auto took = sim.run_until([&] { return reads.done.size() == 6; }, 200);
+    ASSERT_TRUE(took);
+    EXPECT_GT(*took, 50u);
+    EXPECT_EQ(reads.done.back(), std::make_pair(5, 1));
+}
+
+TEST(RaftReadTest, ReadsAreReleasedInQueueOrder) {
+    RaftSim sim(RaftSim::Options{});
+    int l = settle(sim);
+    ASSERT_NE(l, -1);
+    raft_server_t* leader = sim.raft(l);
+    Reads reads;
+
+    // round one: reads 0 and 1. round two: read 2, queued once round one's broadcast is out but unanswered.
+    // only one follower answers, which is still a majority: everything goes out, oldest first
+    sim.partition({{l, (l + 1) % 3}});
+    reads.queue(leader);
+    reads.queue(leader);
+    sim.step();
+    reads.queue(leader);
+    ASSERT_TRUE(sim.run_until([&] { return reads.done.size() == 3; }, 50));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(reads.done[i], std::make_pair(i, 1));
+    }
+
+    // a read behind a write waits for that write to be applied, and the next read waits behind it
+    auto write = sim.propose("w");
+    ASSERT_TRUE(write);
+    reads.queue(leader);
+    reads.queue(leader);
+    ASSERT_TRUE(sim.run_until([&] { return reads.done.size() == 5; }, 50));
+    EXPECT_EQ(reads.done[3], std::make_pair(3, 1));
+    EXPECT_EQ(reads.done[4], std::make_pair(4, 1));
+    EXPECT_GE(reads.applied[3], write->idx);
+    EXPECT_GE(reads.applied[4], write->idx);
+}
+
+TEST(RaftReadTest, ReadBeforeTheTermCommitsWaitsForIt) {
+    RaftSim sim(RaftSim::Options{});
+    ASSERT_TRUE(sim.run_until([&] { return sim.leader() != -1; }, 10'000));
+    raft_server_t* leader = sim.raft(sim.leader());
+    ASSERT_EQ(raft_get_commit_idx(leader), 0);  // elected, its no-op not committed yet
+
+    Reads reads;
+    ASSERT_EQ(reads.queue(leader), 0);
+    raft_process_read_queue(leader);
+    EXPECT_TRUE(reads.done.empty());
+    ASSERT_TRUE(sim.run_until([&] { return reads.done.size() == 1; }, 50));
+    EXPECT_EQ(reads.done[0], std::make_pair(0, 1));
+    EXPECT_GE(reads.applied[0], 1);
+}
+
+TEST(RaftReadTest, LeaseHoldsUntilItRunsOut) {
+    RaftSim sim(RaftSim::Options{});
+    int l = settle(sim);
+    ASSERT_NE(l, -1);
+    raft_server_t* leader = sim.raft(l);
+    EXPECT_EQ(raft_lease_read_ok(leader), 0);    // leases are off by default
+
+    raft_set_lease_timeout(leader, 500);
+    EXPECT_EQ(raft_lease_read_ok(leader), 0);    // and setting one doesn't grant it
+    ASSERT_TRUE(sim.run_until([&] { return raft_lease_read_ok(leader) == 1; }, 200));  // the next acked heartbeat
+
+    // cut off: the lease counts from when the last acked heartbeat was sent, at most a heartbeat ago
+    sim.isolate(l);
+    auto lasted = sim.run_until([&] { return raft_lease_read_ok(leader) == 0; }, 1000);
+    ASSERT_TRUE(lasted);
+    EXPECT_GT(*lasted, 500u - 100u - 5u);
+    EXPECT_LE(*lasted, 500u);
+
+    // and it is clamped below the election timeout, so it ends before anyone else can be elected
+    raft_set_lease_timeout(leader, 5000);
+    sim.heal();
+    ASSERT_TRUE(sim.run_until([&] { return raft_lease_read_ok(leader) == 1; }, 200));
+    sim.isolate(l);
+    lasted = sim.run_until([&] { return raft_lease_read_ok(leader) == 0; }, 5000);
+    ASSERT_TRUE(lasted);
+    EXPECT_LT(*lasted, 1000u);
+}
+
+TEST(RaftReadTest, StaleLeaderCannotServeReads) {
+    RaftSim sim(RaftSim::Options{});
+    int l = settle(sim);
+    ASSERT_NE(l, -1);
+    raft_server_t* old_leader = sim.raft(l);
+    raft_set_lease_timeout(old_leader, 500);
+    ASSERT_TRUE(sim.run_until([&] { return raft_lease_read_ok(old_leader) == 1; }, 200));
+
+    // the old leader is cut off and the rest elect someone else in a new term
+    sim.isolate(l);
+    Reads reads;
+    ASSERT_EQ(reads.queue(old_leader), 0);
+    ASSERT_TRUE(sim.run_until([&] { return sim.leader() != l; }, 5000));
+    sim.step(10);
+    EXPECT_TRUE(raft_is_leader(old_leader));     // still thinks so
+    EXPECT_EQ(raft_lease_read_ok(old_leader), 0);
+    EXPECT_TRUE(reads.done.empty());             // but no majority confirms the read
+
+    // healed: the new term reaches the old leader, which steps down and gives up the queued read
+    sim.heal();
+    ASSERT_TRUE(sim.run_until([&] { return !raft_is_leader(old_leader); }, 200));
+    ASSERT_EQ(reads.done.size(), 1u);
+    EXPECT_EQ(reads.done[0], std::make_pair(0, 0));
+    EXPECT_EQ(raft_queue_read_request(old_leader, [](void*, int) {}, nullptr), -1);
+}
+
+TEST(RaftReadTest, StateChangeResetsRoundsAndLease) {
+    RaftSim::Options options;
+    RaftSim sim(options);
+    int l = settle(sim);
+    ASSERT_NE(l, -1);
+    raft_server_t* leader = sim.raft(l);
+    raft_set_lease_timeout(leader, 500);
+    ASSERT_TRUE(sim.run_until([&] { return raft_lease_read_ok(leader) == 1; }, 200));
+
+    Reads reads;
+    reads.queue(leader);
+    reads.queue(leader);
+    raft_become_follower(leader);
+    EXPECT_EQ(raft_lease_read_ok(leader), 0);
+    ASSERT_EQ(reads.done.size(), 2u);            // failed straight away, in order
+    EXPECT_EQ(reads.done[0], std::make_pair(0, 0));
+    EXPECT_EQ(reads.done[1], std::make_pair(1, 0));
+
+    // back as leader (a new election), acks from the earlier term's rounds confirm nothing: no lease, and
+    // a new read waits for a round sent in this term
+    raft_periodic(leader, options.election_timeout_ms);
+    ASSERT_TRUE(sim.run_until([&] { return raft_is_leader(leader); }, 100));
+    EXPECT_EQ(raft_lease_read_ok(leader), 0);
+    reads.queue(leader);
+    raft_process_read_queue(leader);
+    EXPECT_EQ(reads.done.size(), 2u);
+    ASSERT_TRUE(sim.run_until([&] { return reads.done.size() == 3; }, 50));
+    EXPECT_EQ(reads.done[2], std::make_pair(2, 1));
+    EXPECT_EQ(raft_lease_read_ok(leader), 1);
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "../src/raft/sim.hpp"
+#include "../src/raft/replica.hpp"
+
+/*
+RAFT REPLICA READ TESTS
+*/
+
+// a RaftSim with a ReplicaReads per node. forwarded read-index traffic takes the same partitions as raft's own
+// messages and is delivered at the end of every simulated ms, followed by a poll() on every node.
+struct ReplicaCluster {
+    struct Request { int from, to; msg_readindex_t msg; };
+    struct Response { int to; msg_readindex_response_t msg; };
+
+    RaftSim sim;
+    std::vector<std::unique_ptr<ReplicaReads>> reads;
+    std::deque<Request> requests;
+    std::deque<Response> responses;
+
+    explicit ReplicaCluster(ReplicaReads::Options options = {}) : sim(RaftSim::Options{}) {
+        for (int i = 0; i < sim.size(); ++i) {
+            reads.push_back(std::make_unique<ReplicaReads>(sim.raft(i), [this, i](int to, const msg_readindex_t& msg) {
+                requests.push_back({i, to, msg});
+            }, options));
+        }
+    }
+
+    void step(int ms = 1) {
+        for (int i = 0; i < ms; ++i) {
+            sim.step();
+            pump();
+        }
+    }
+
+    void pump() {
+        while (!requests.empty()) {
+            Request r = requests.front();
+            requests.pop_front();
+            if (sim.connected(r.from, r.to)) {
+                reads[r.to]->on_readindex(r.msg, [this, to = r.from](const msg_readindex_response_t& msg) {
+                    responses.push_back({to, msg});
+                });
+            }
+        }
+        while (!responses.empty()) {
+            Response r = responses.front();
+            responses.pop_front();
+            reads[r.to]->on_readindex_response(r.msg);
+        }
+        for (auto& node : reads) {
+            node->poll();
+        }
+    }
+
+    // a leader every node follows, whose whole log (its no-op included) is applied everywhere
+    int settle() {
+        for (int ms = 0; ms < 10'000; ++ms) {
+            step();
+            int leader = sim.leader();
+            if (leader == -1) continue;
+            raft_index_t last = raft_get_current_idx(sim.raft(leader));
+            bool settled = last > 0 && raft_get_commit_idx(sim.raft(leader)) == last;
+            for (int i = 0; i < sim.size(); ++i) {
+                settled = settled && raft_get_current_leader(sim.raft(i)) == leader &&
+                          raft_get_last_applied_idx(sim.raft(i)) == last;
+            }
+            if (settled) return leader;
+        }
+        return -1;
+    }
+};
+
+// what each read callback saw, in order
+struct Outcomes {
+    std::vector<bool> done;
+    ReplicaReads::ReadFn next() {
+        return [this](bool ok) { done.push_back(ok); };
+    }
+};
+
+TEST(RaftReplicaTest, StaleReadsAreGatedOnLagAndSilence) {
+    ReplicaCluster c(ReplicaReads::Options{.max_lag = 5, .max_silence_ms = 300});
+    int leader = c.settle();
+    ASSERT_NE(leader, -1);
+    int follower = (leader + 1) % c.sim.size();
+    ReplicaReads& reads = *c.reads[follower];
+    Outcomes out;
+
+    // caught up and recently heard from the leader: served on the spot
+    ASSERT_TRUE(reads.submit(ReadConsistency::BoundedStaleness, out.next()));
+    EXPECT_EQ(out.done, std::vector<bool>{true});
+    EXPECT_EQ(reads.served_local(), 1u);
+
+    // our state machine falls behind while the leader carries on committing
+    c.sim.stall_apply(follower);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(c.sim.propose("w"));
+    }
+    ASSERT_TRUE(c.sim.run_until([&] {
+        return raft_get_leader_commit_idx(c.sim.raft(follower)) - raft_get_last_applied_idx(c.sim.raft(follower)) > 5;
+    }, 500));
+    ASSERT_EQ(raft_get_current_leader(c.sim.raft(follower)), leader);
+    EXPECT_FALSE(reads.within_staleness());
+    ASSERT_TRUE(reads.submit(ReadConsistency::BoundedStaleness, out.next()));
+    EXPECT_EQ(reads.forwarded(), 1u);           // upgraded to a read index from the leader
+    c.step(50);
+    EXPECT_EQ(out.done.size(), 1u);             // which can't be served until we've applied that far
+    c.sim.stall_apply(follower, false);
+    c.step(5);
+    EXPECT_EQ(out.done, (std::vector<bool>{true, true}));
+    EXPECT_EQ(reads.served_forwarded(), 1u);
+
+    // caught up again, but silent past max_silence_ms
+    c.sim.isolate(follower);
+    c.step(301);
+    EXPECT_FALSE(reads.within_staleness());
+    ASSERT_TRUE(reads.submit(ReadConsistency::BoundedStaleness, out.next()));
+    EXPECT_EQ(reads.forwarded(), 2u);
+    EXPECT_EQ(reads.served_local(), 1u);
+}
+
+TEST(RaftReplicaTest, ForwardedReadIndexWaitsForTheLeadersCommit) {
+    ReplicaCluster c;
+    int leader = c.settle();
+    ASSERT_NE(leader, -1);
+    int follower = (leader + 1) % c.sim.size();
+    raft_server_t* raft = c.sim.raft(follower);
+
+    // committed on the leader, not yet known to be committed here
+    ASSERT_TRUE(c.sim.propose("w"));
+    ASSERT_TRUE(c.sim.run_until([&] {
+        return raft_get_commit_idx(c.sim.raft(leader)) > raft_get_last_applied_idx(raft);
+    }, 100));
+    raft_index_t committed = raft_get_commit_idx(c.sim.raft(leader));
+
+    raft_index_t applied_at_read = -1;
+    ASSERT_TRUE(c.reads[follower]->submit(ReadConsistency::ReadIndex, [&](bool ok) {
+        EXPECT_TRUE(ok);
+        applied_at_read = raft_get_last_applied_idx(raft);
+    }));
+    EXPECT_EQ(c.reads[follower]->forwarded(), 1u);
+    EXPECT_EQ(c.reads[follower]->pending(), 1u);
+
+    c.step(200);
+    EXPECT_GE(applied_at_read, committed);
+    EXPECT_EQ(c.reads[follower]->served_forwarded(), 1u);
+    EXPECT_EQ(c.reads[follower]->pending(), 0u);
+
+    // Linearizable never leaves the leader
+    Outcomes out;
+    EXPECT_FALSE(c.reads[follower]->submit(ReadConsistency::Linearizable, out.next()));
+    ASSERT_TRUE(c.reads[leader]->submit(ReadConsistency::Linearizable, out.next()));
+    c.step(200);
+    EXPECT_EQ(out.done, std::vector<bool>{true});
+}
+
+TEST(RaftReplicaTest, ReadIndexFromAnotherTermIsRefused) {
+    ReplicaCluster c;
+    int leader = c.settle();
+    ASSERT_NE(leader, -1);
+    int follower = (leader + 1) % c.sim.size();
+    int term = raft_get_current_term(c.sim.raft(leader));
+
+    // leader side: a request stamped with an older term gets no index
+    std::vector<msg_readindex_response_t> replies;
+    c.reads[leader]->on_readindex(msg_readindex_t{7, term - 1}, [&](const msg_readindex_response_t& r) {
+        replies.push_back(r);
+    });
+    ASSERT_EQ(replies.size(), 1u);
+    EXPECT_EQ(replies[0].success, 0);
+    EXPECT_EQ(replies[0].term, term);
+
+    // follower side: an answer issued in a term other than the one we asked in fails the read
+    Outcomes out;
+    ASSERT_TRUE(c.reads[follower]->submit(ReadConsistency::ReadIndex, out.next()));
+    ASSERT_EQ(c.requests.size(), 1u);
+    uint64_t id = c.requests.front().msg.request_id;
+    c.requests.clear();
+    c.reads[follower]->on_readindex_response(msg_readindex_response_t{id, 1, 1, term - 1});
+    EXPECT_EQ(out.done, std::vector<bool>{false});
+    EXPECT_EQ(c.reads[follower]->pending(), 0u);
+    EXPECT_EQ(c.reads[follower]->served_forwarded(), 0u);
+}
+
+TEST(RaftReplicaTest, PendingReadsFailWhenTheLeaderChanges) {
+    ReplicaCluster c;
+    int leader = c.settle();
+    ASSERT_NE(leader, -1);
+    int follower = (leader + 1) % c.sim.size();
+    Outcomes out;
+
+    // the leader is cut off before our request reaches it, so the read can only wait
+    c.sim.isolate(leader);
+    ASSERT_TRUE(c.reads[follower]->submit(ReadConsistency::ReadIndex, out.next()));
+    c.step(100);
+    EXPECT_TRUE(out.done.empty());
+    EXPECT_EQ(c.reads[follower]->pending(), 1u);
+
+    // the rest elect someone else; the read waiting on the old leader fails so the caller can retry
+    ASSERT_TRUE(c.sim.run_until([&] {
+        int now = raft_get_current_leader(c.sim.raft(follower));
+        return now != -1 && now != leader;
+    }, 5'000));
+    c.pump();
+    EXPECT_EQ(out.done, std::vector<bool>{false});
+    EXPECT_EQ(c.reads[follower]->pending(), 0u);
+
+    // and a retry goes to the new leader and succeeds
+    ASSERT_TRUE(c.reads[follower]->submit(ReadConsistency::ReadIndex, out.next()));
+    c.step(300);
+    EXPECT_EQ(out.done, (std::vector<bool>{false, true}));
+}
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "../src/raft/sim.hpp"
+
+/*
+RAFT SIMULATION BENCHMARK
+
+Runs the raft library over RaftSim (deterministic virtual-time transport, see src/raft/sim.hpp) under a few
+network/disk profiles and reports:
+
+    throughput  - commits per simulated second with `inflight` client proposals kept outstanding against the
+                  leader, plus how fast the simulation itself ran (wall clock)
+    recovery    - the leader is cut off `rounds` times; virtual ms from the cut until the rest of the
+                  cluster has a new leader (min / avg / p99 / max)
+
+Numbers are in simulated time, so they measure the protocol under the given latency/drop/fsync profile,
+not this machine.
+
+usage: raft_sim_benchmark [nodes=3] [seconds=10] [inflight=64] [rounds=50]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Profile {
+    const char* name;
+    int latency_min_ms;
+    int latency_max_ms;
+    double drop_rate;
+    int disk_sync_ms;
+};
+
+static const Profile k_profiles[] = {
+    {"lan",        1, 1, 0.0,  0},
+    {"jitter",     1, 5, 0.0,  0},
+    {"lossy",      1, 5, 0.01, 0},
+    {"fsync",      1, 1, 0.0,  2},
+    {"wan+fsync", 10, 30, 0.01, 2},
+};
+
+static RaftSim::Options make_options(const Profile& p, int nodes, uint64_t seed) {
+    RaftSim::Options o;
+    o.nodes = nodes;
+    o.seed = seed;
+    o.latency_min_ms = p.latency_min_ms;
+    o.latency_max_ms = p.latency_max_ms;
+    o.drop_rate = p.drop_rate;
+    o.disk_sync_ms = p.disk_sync_ms;
+    o.request_timeout_ms = std::max(10, p.latency_max_ms * 2);
+    o.election_timeout_ms = std::max(150, p.latency_max_ms * 10);
+    return o;
+}
+
+static void throughput(const Profile& p, int nodes, int seconds, size_t inflight) {
+    RaftSim sim(make_options(p, nodes, 1));
+    if (!sim.run_until([&] { return sim.leader() != -1; }, 60'000)) {
+        std::cout << "[" << p.name << "] no leader elected\n";
+        return;
+    }
+
+    std::deque<msg_entry_response_t> outstanding;
+    uint64_t commits = 0, lost = 0;
+    const uint64_t end = sim.now() + static_cast<uint64_t>(seconds) * 1000;
+    auto start = Clock::now();
+    while (sim.now() < end) {
+        while (outstanding.size() < inflight) {
+            auto r = sim.propose("SET key value");
+            if (!r) break;
+            outstanding.push_back(*r);
+        }
+        sim.step();
+        // commit order follows log order, so only the front needs checking
+        while (!outstanding.empty()) {
+            int state = sim.committed(outstanding.front());
+            if (state == 0) break;
+            state == 1 ? ++commits : ++lost;
+            outstanding.pop_front();
+        }
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "[" << p.name << "] " << static_cast<uint64_t>(commits / static_cast<double>(seconds))
+              << " commits/sec (simulated), " << lost << " lost, "
+              << sim.stats().dropped << "/" << sim.stats().sent << " msgs dropped, "
+              << static_cast<uint64_t>(seconds / wall) << "x realtime\n";
+}
+
+static void recovery(const Profile& p, int nodes, int rounds) {
+    RaftSim sim(make_options(p, nodes, 2));
+    std::vector<uint64_t> samples;
+    int failed = 0;
+    for (int round = 0; round < rounds; ++round) {
+        sim.heal();
+        if (!sim.run_until([&] { return sim.leader() != -1; }, 60'000)) {
+            ++failed;
+            continue;
+        }
+        sim.step(200); // let the leader settle before pulling it
+        int old = sim.leader();
+        sim.isolate(old);
+        auto took = sim.run_until([&] {
+            int l = sim.leader();
+            return l != -1 && l != old;
+        }, 60'000);
+        took ? samples.push_back(*took) : void(++failed);
+    }
+    if (samples.empty()) {
+        std::cout << "[" << p.name << "] no successful failovers\n";
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    uint64_t sum = 0;
+    for (auto s : samples) sum += s;
+    std::cout << "[" << p.name << "] election recovery over " << samples.size() << " failovers: min "
+              << samples.front() << " ms, avg " << sum / samples.size() << " ms, p99 "
+              << samples[std::min(samples.size() - 1, samples.size() * 99 / 100)] << " ms, max "
+              << samples.back() << " ms";
+    if (failed) std::cout << ", " << failed << " timed out";
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    const int nodes = argc > 1 ? std::atoi(argv[1]) : 3;
+    const int seconds = argc > 2 ? std::atoi(argv[2]) : 10;
+    const size_t inflight = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    const int rounds = argc > 4 ? std::atoi(argv[4]) : 50;
+
+    std::cout << "[Cluster] " << nodes << " nodes, " << inflight << " proposals in flight\n";
+    for (const auto& p : k_profiles) {
+        throughput(p, nodes, seconds, inflight);
+    }
+    for (const auto& p : k_profiles) {
+        recovery(p, nodes, rounds);
+    }
+    return 0;
+}
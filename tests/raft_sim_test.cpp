@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../src/raft/sim.hpp"
+
+/*
+RAFT SIMULATION TESTS
+*/
+
+static RaftSim::Options options(int nodes, uint64_t seed) {
+    RaftSim::Options o;
+    o.nodes = nodes;
+    o.seed = seed;
+    o.latency_min_ms = 1;
+    o.latency_max_ms = 5;
+    return o;
+}
+
+TEST(RaftSimTest, ElectsSingleLeader) {
+    for (uint64_t seed = 1; seed <= 5; ++seed) {
+        RaftSim sim(options(5, seed));
+        ASSERT_TRUE(sim.run_until([&] { return sim.leader() != -1; }, 10'000)) << "seed " << seed;
+        sim.step(500);
+
+        int leaders = 0;
+        for (int i = 0; i < sim.size(); ++i) {
+            leaders += raft_is_leader(sim.raft(i));
+        }
+        EXPECT_EQ(leaders, 1) << "seed " << seed;
+    }
+}
+
+TEST(RaftSimTest, SameSeedReplaysIdentically) {
+    auto run = [](uint64_t seed) {
+        RaftSim sim(options(3, seed));
+        sim.run_until([&] { return sim.leader() != -1; }, 10'000);
+        for (int i = 0; i < 50; ++i) {
+            sim.propose("x");
+            sim.step(3);
+        }
+        return std::vector<uint64_t>{sim.now(), sim.stats().sent, sim.stats().delivered,
+                                     static_cast<uint64_t>(sim.leader()), sim.applied(0)};
+    };
+    EXPECT_EQ(run(7), run(7));
+}
+
+TEST(RaftSimTest, ReplicatesUnderDrops) {
+    auto o = options(3, 3);
+    o.drop_rate = 0.1;
+    RaftSim sim(o);
+    ASSERT_TRUE(sim.run_until([&] { return sim.leader() != -1; }, 10'000));
+
+    std::vector<msg_entry_response_t> pending;
+    for (int i = 0; i < 100; ++i) {
+        if (auto r = sim.propose("entry " + std::to_string(i))) {
+            pending.push_back(*r);
+        }
+        sim.step(2);
+    }
+    ASSERT_FALSE(pending.empty());
+    auto last = pending.back();
+    ASSERT_TRUE(sim.run_until([&] { return sim.committed(last) != 0; }, 10'000));
+    EXPECT_EQ(sim.committed(last), 1);
+
+    // every node catches up to the leader's commit index
+    raft_index_t commit = raft_get_commit_idx(sim.raft(sim.leader()));
+    ASSERT_TRUE(sim.run_until([&] {
+        for (int i = 0; i < sim.size(); ++i) {
+            if (raft_get_last_applied_idx(sim.raft(i)) < commit) return false;
+        }
+        return true;
+    }, 10'000));
+    EXPECT_GT(sim.stats().dropped, 0u);
+}
+
+TEST(RaftSimTest, MinorityPartitionCannotCommit) {
+    RaftSim sim(options(5, 11));
+    ASSERT_TRUE(sim.run_until([&] { return sim.leader() != -1; }, 10'000));
+    int old_leader = sim.leader();
+
+    // old leader keeps one follower; the other three form the majority
+    std::vector<int> minority{old_leader, (old_leader + 1) % 5};
+    std::vector<int> majority;
+    for (int i = 0; i < 5; ++i) {
+        if (i != minority[0] && i != minority[1]) majority.push_back(i);
+    }
+    sim.partition({minority, majority});
+
+    msg_entry_t entry = {};
+    static char payload[] = "lost";
+    entry.id = 999'999;
+    entry.data.buf = payload;
+    entry.data.len = sizeof(payload) - 1;
+    msg_entry_response_t stranded;
+    ASSERT_EQ(raft_recv_entry(sim.raft(old_leader), &entry, &stranded), 0);
+
+    sim.step(5'000);
+    EXPECT_LT(raft_get_commit_idx(sim.raft(old_leader)), stranded.idx);
+    int new_leader = sim.leader();
+    ASSERT_NE(new_leader, -1);
+    EXPECT_NE(new_leader, old_leader);
+
+    // after healing the stranded entry is overwritten by the majority's log
+    sim.heal();
+    ASSERT_TRUE(sim.run_until([&] { return !raft_is_leader(sim.raft(old_leader)); }, 10'000));
+    for (int i = 0; i < 10; ++i) {
+        sim.propose("majority " + std::to_string(i));
+    }
+    sim.step(2'000);
+    EXPECT_EQ(raft_msg_entry_response_committed(sim.raft(old_leader), &stranded), -1);
+}
+
+TEST(RaftSimTest, IsolatedLeaderIsReplaced) {
+    RaftSim sim(options(3, 5));
+    ASSERT_TRUE(sim.run_until([&] { return sim.leader() != -1; }, 10'000));
+    int old_leader = sim.leader();
+    int old_term = raft_get_current_term(sim.raft(old_leader));
+
+    sim.isolate(old_leader);
+    auto took = sim.run_until([&] { return sim.leader() != -1 && sim.leader() != old_leader; }, 10'000);
+    ASSERT_TRUE(took);
+    EXPECT_GT(raft_get_current_term(sim.raft(sim.leader())), old_term);
+
+    auto r = sim.propose("after failover");
+    ASSERT_TRUE(r);
+    EXPECT_TRUE(sim.run_until([&] { return sim.committed(*r) == 1; }, 1'000));
+}
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <filesystem>
+#include <unistd.h>
+#include "../src/raft/snapshot.hpp"
+
+/*
+RAFT SNAPSHOT CATCH-UP BENCHMARK
+
+A fresh follower joins a leader whose log has been compacted, so the only way to catch up is InstallSnapshot.
+Times the phases separately:
+    fork     - create() on the raft thread: freeze the keyspace and fork, the only part that stalls raft
+    write    - the child encodes its copy-on-write image to disk (tmp + fdatasync); meanwhile the "raft thread"
+               keeps applying SETs, and the longest of those is reported next to how many got through
+    stream   - chunks pread on the leader, pwritten on the follower (in-process, no network)
+    install  - follower fsyncs, mmaps and loads the image into its EntryManager
+The leader's keyspace is freed before the stream so the follower's copy fits next to it at 10M keys.
+
+usage: raft_snapshot_benchmark [keys=10000000] [chunk_kib=1024]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    const size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    const size_t chunk_bytes = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024) * 1024;
+
+    auto root = std::filesystem::temp_directory_path() / ("raft_snapshot_bench_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(root);
+
+    auto leader_db = std::make_unique<EntryManager>();
+    {
+        auto start = Clock::now();
+        std::string value(32, 'v');
+        for (size_t i = 0; i < num_keys; ++i) {
+            leader_db->create_entry("key:" + std::to_string(i), value);
+        }
+        std::cout << "[Populate] " << num_keys << " keys in " << ms_since(start) << " ms\n";
+    }
+
+    auto leader_store = RaftSnapshotStore::open(root / "leader");
+    auto follower_store = RaftSnapshotStore::open(root / "follower");
+    if (!leader_store || !follower_store) {
+        std::cerr << "failed to open snapshot dirs under " << root << "\n";
+        return 1;
+    }
+
+    raft_server_t* leader = raft_new();
+    raft_add_node(leader, nullptr, 1, 1);
+    raft_node_t* follower_node = raft_add_node(leader, nullptr, 2, 0);
+    raft_set_current_term(leader, 1);
+
+    raft_server_t* follower = raft_new();
+    raft_add_node(follower, nullptr, 2, 1);
+    raft_add_node(follower, nullptr, 1, 0);
+
+    // one SET per key: the leader's log starts just before num_keys, with that last entry applied
+    const raft_index_t snapshot_idx = static_cast<raft_index_t>(num_keys);
+    raft_load_snapshot(leader, 1, snapshot_idx - 1);
+    raft_entry_t last{};
+    last.term = 1;
+    last.id = 1;
+    raft_append_entry(leader, &last);
+    raft_set_commit_idx(leader, snapshot_idx);
+    raft_set_last_applied_idx(leader, snapshot_idx);
+
+    auto start = Clock::now();
+    if (auto result = (*leader_store)->create(leader, *leader_db); !result) {
+        std::cerr << "create failed: " << result.error().message() << "\n";
+        return 1;
+    }
+    double fork_ms = ms_since(start);
+
+    size_t applied = 0;
+    double worst_apply_ms = 0;
+    Result<raft_index_t> installed = 0;
+    while ((installed = (*leader_store)->poll_create(leader)) && *installed == 0) {
+        auto apply_start = Clock::now();
+        leader_db->create_entry("during:" + std::to_string(applied++), std::string(32, 'w'));
+        worst_apply_ms = std::max(worst_apply_ms, ms_since(apply_start));
+    }
+    if (!installed) {
+        std::cerr << "background write failed: " << installed.error().message() << "\n";
+        return 1;
+    }
+    double write_ms = ms_since(start) - fork_ms;
+    double save_ms = fork_ms + write_ms;
+    double image_mb = static_cast<double>((*leader_store)->image_size()) / (1 << 20);
+    leader_db.reset();
+
+    EntryManager follower_db;
+    RaftSnapshotSender sender(**leader_store, chunk_bytes);
+    std::vector<uint8_t> buffer;
+    msg_installsnapshot_t msg;
+    size_t chunks = 0;
+    double stream_ms = 0;
+    double install_ms = 0;
+
+    start = Clock::now();
+    while (!sender.complete()) {
+        if (!sender.next(leader, msg, buffer)) {
+            std::cerr << "sender stalled at " << sender.acked_bytes() << " bytes\n";
+            return 1;
+        }
+        auto recv_start = Clock::now();
+        auto response = (*follower_store)->recv_installsnapshot(follower, follower_db, msg);
+        if (msg.done) {
+            install_ms = ms_since(recv_start);
+        }
+        sender.on_response(leader, follower_node, response);
+        ++chunks;
+    }
+    stream_ms = ms_since(start) - install_ms;
+
+    bool ok = follower_db.size() == num_keys &&
+              raft_get_commit_idx(follower) == snapshot_idx &&
+              raft_node_get_next_idx(follower_node) == snapshot_idx + 1 &&
+              (num_keys == 0 || follower_db.find_entry("key:" + std::to_string(num_keys - 1)) != nullptr);
+
+    std::cout << "[Fork]    " << fork_ms << " ms on the raft thread\n";
+    std::cout << "[Write]   " << write_ms << " ms, " << image_mb << " MiB (" << image_mb / (write_ms / 1000) << " MiB/s); "
+              << applied << " SETs applied meanwhile, slowest " << worst_apply_ms << " ms\n";
+    std::cout << "[Stream]  " << chunks << " chunks of " << chunk_bytes / 1024 << " KiB in " << stream_ms << " ms ("
+              << image_mb / (stream_ms / 1000) << " MiB/s)\n";
+    std::cout << "[Install] " << install_ms << " ms (" << num_keys / (install_ms / 1000) << " keys/sec)\n";
+    std::cout << "[Catch-up] " << save_ms + stream_ms + install_ms << " ms total, follower "
+              << (ok ? "matches leader" : "DOES NOT MATCH leader") << "\n";
+
+    raft_free(leader);
+    raft_free(follower);
+    std::filesystem::remove_all(root);
+    return ok ? 0 : 1;
+}
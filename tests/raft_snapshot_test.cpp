@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../src/raft/snapshot.hpp"
+
+/*
+RAFT SNAPSHOT TESTS
+*/
+
+class RaftSnapshotTest : public ::testing::Test {
+protected:
+    std::filesystem::path dir_;
+
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("raft_snapshot_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    static void populate(EntryManager& db) {
+        db.create_entry(std::string("str"), std::string("hello"));
+        db.create_entry(std::string("int"), int64_t{42});
+        db.create_entry(std::string("dbl"), 2.5);
+        db.create_entry(std::string("list"), std::vector<std::string>{"a", "b", "c"});
+        db.create_entry(std::string("hash"), std::unordered_map<std::string, std::string>{{"f", "v"}});
+        db.create_entry(std::string("set"), std::unordered_set<std::string>{"x", "y"});
+    }
+};
+
+TEST_F(RaftSnapshotTest, SerializerRoundTrip) {
+    EntryManager source;
+    populate(source);
+
+    std::vector<uint8_t> image;
+    auto written = SnapshotSerializer::write(source, [&](std::span<const uint8_t> chunk) -> Result<void> {
+        image.insert(image.end(), chunk.begin(), chunk.end());
+        return {};
+    }, 16);
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(*written, 6u);
+
+    EntryManager target;
+    target.create_entry(std::string("stale"), std::string("gone"));
+    auto loaded = SnapshotSerializer::load(target, image);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(*loaded, 6u);
+    EXPECT_EQ(target.find_entry("stale"), nullptr);
+
+    EXPECT_EQ(std::dynamic_pointer_cast<Entry<std::string>>(target.find_entry("str"))->value, "hello");
+    EXPECT_EQ(std::dynamic_pointer_cast<Entry<int64_t>>(target.find_entry("int"))->value, 42);
+    EXPECT_EQ(std::dynamic_pointer_cast<Entry<double>>(target.find_entry("dbl"))->value, 2.5);
+    EXPECT_EQ(std::dynamic_pointer_cast<Entry<std::vector<std::string>>>(target.find_entry("list"))->value.size(), 3u);
+    EXPECT_EQ((std::dynamic_pointer_cast<Entry<std::unordered_map<std::string, std::string>>>(target.find_entry("hash"))->value.at("f")), "v");
+    EXPECT_EQ(std::dynamic_pointer_cast<Entry<std::unordered_set<std::string>>>(target.find_entry("set"))->value.count("y"), 1u);
+}
+
+TEST_F(RaftSnapshotTest, CorruptImageIsRejected) {
+    EntryManager source;
+    populate(source);
+    std::vector<uint8_t> image;
+    ASSERT_TRUE(SnapshotSerializer::write(source, [&](std::span<const uint8_t> chunk) -> Result<void> {
+        image.insert(image.end(), chunk.begin(), chunk.end());
+        return {};
+    }));
+
+    image[image.size() / 2] ^= 0xFF;
+    EntryManager target;
+    target.create_entry(std::string("keep"), std::string("me"));
+    EXPECT_FALSE(SnapshotSerializer::load(target, image).has_value());
+    EXPECT_NE(target.find_entry("keep"), nullptr); // nothing touched on a bad checksum
+}
+
+TEST_F(RaftSnapshotTest, StreamedInstallCatchesUpFollower) {
+    EntryManager leader_db;
+    populate(leader_db);
+    auto leader_store = RaftSnapshotStore::open(dir_ / "leader");
+    ASSERT_TRUE(leader_store.has_value());
+    ASSERT_TRUE((*leader_store)->save(leader_db, 100, 3));
+
+    raft_server_t* leader = raft_new();
+    raft_add_node(leader, nullptr, 1, 1);
+    raft_node_t* node = raft_add_node(leader, nullptr, 2, 0);
+    raft_set_current_term(leader, 3);
+
+    raft_server_t* follower = raft_new();
+    raft_add_node(follower, nullptr, 2, 1);
+    EntryManager follower_db;
+    auto follower_store = RaftSnapshotStore::open(dir_ / "follower");
+    ASSERT_TRUE(follower_store.has_value());
+
+    RaftSnapshotSender sender(**leader_store, 32, 2);
+    std::vector<uint8_t> buffer;
+    msg_installsnapshot_t msg;
+
+    // drop the very first chunk on the floor: the follower should ask to rewind to 0
+    ASSERT_TRUE(sender.next(leader, msg, buffer));
+    ASSERT_TRUE(sender.next(leader, msg, buffer));
+    auto r = (*follower_store)->recv_installsnapshot(follower, follower_db, msg);
+    EXPECT_FALSE(r.success);
+    EXPECT_EQ(r.next_offset, 0u);
+    sender.on_response(leader, node, r);
+
+    while (!sender.complete()) {
+        ASSERT_TRUE(sender.next(leader, msg, buffer));
+        sender.on_response(leader, node, (*follower_store)->recv_installsnapshot(follower, follower_db, msg));
+    }
+
+    EXPECT_EQ(follower_db.size(), 6u);
+    EXPECT_EQ(raft_get_commit_idx(follower), 100);
+    EXPECT_EQ(raft_get_snapshot_last_term(follower), 3);
+    EXPECT_EQ(raft_get_current_term(follower), 3);
+    EXPECT_EQ(raft_node_get_next_idx(node), 101);
+
+    // the installed snapshot survives a restart
+    auto reopened = RaftSnapshotStore::open(dir_ / "follower");
+    ASSERT_TRUE(reopened.has_value());
+    EXPECT_EQ((*reopened)->last_idx(), 100);
+
+    raft_free(leader);
+    raft_free(follower);
+}
+
+// a single-node raft whose log holds `count` entries of `term`, the first `applied` of them applied
+static raft_server_t* raft_with_log(int term, int count, raft_index_t applied) {
+    raft_server_t* raft = raft_new();
+    raft_add_node(raft, nullptr, 1, 1);
+    raft_set_current_term(raft, term);
+    for (int i = 1; i <= count; ++i) {
+        raft_entry_t ety{};
+        ety.term = static_cast<unsigned int>(term);
+        ety.id = static_cast<unsigned int>(i);
+        raft_append_entry(raft, &ety);
+    }
+    raft_set_commit_idx(raft, applied);
+    raft_set_last_applied_idx(raft, applied);
+    return raft;
+}
+
+TEST_F(RaftSnapshotTest, CreateForksAPointInTimeSnapshot) {
+    EntryManager db;
+    populate(db);
+    raft_server_t* raft = raft_with_log(4, 10, 8);
+    auto store = RaftSnapshotStore::open(dir_ / "bg");
+    ASSERT_TRUE(store.has_value());
+
+    ASSERT_TRUE((*store)->create(raft, db));
+    EXPECT_TRUE((*store)->creating());
+    ASSERT_TRUE((*store)->create(raft, db));   // one at a time: this one is a no-op
+
+    // the keyspace moves on while the child writes; none of it may reach the snapshot
+    db.create_entry(std::string("str"), std::string("changed"));
+    db.create_entry(std::string("late"), std::string("too late"));
+    db.delete_entry("int");
+
+    auto installed = (*store)->poll_create(raft, true);
+    ASSERT_TRUE(installed.has_value());
+    EXPECT_EQ(*installed, 8);
+    EXPECT_FALSE((*store)->creating());
+    EXPECT_EQ((*store)->last_idx(), 8);
+    EXPECT_EQ((*store)->last_term(), 4);
+    EXPECT_EQ(raft_get_snapshot_last_idx(raft), 8);
+    EXPECT_EQ(raft_get_log_count(raft), 2);     // 9 and 10 stay
+    EXPECT_EQ(*(*store)->poll_create(raft), 0); // nothing left to pick up
+    EXPECT_FALSE(std::filesystem::exists(dir_ / "bg" / "snapshot.new"));
+
+    auto reopened = RaftSnapshotStore::open(dir_ / "bg");
+    ASSERT_TRUE(reopened.has_value());
+    raft_server_t* restarted = raft_with_log(4, 0, 0);
+    EntryManager restored;
+    ASSERT_TRUE((*reopened)->restore(restarted, restored));
+    EXPECT_EQ(restored.size(), 6u);
+    auto str = std::dynamic_pointer_cast<Entry<std::string>>(restored.find_entry("str"));
+    ASSERT_TRUE(str);
+    EXPECT_EQ(str->value, "hello");
+    EXPECT_TRUE(restored.find_entry("int"));
+    EXPECT_FALSE(restored.find_entry("late"));
+    EXPECT_EQ(raft_get_commit_idx(restarted), 8);
+
+    raft_free(raft);
+    raft_free(restarted);
+}
+
+TEST_F(RaftSnapshotTest, ForkedSnapshotReadsDemotedValues) {
+    EntryManager db;
+    ASSERT_TRUE(db.enable_tiering({.dir = (dir_ / "vlog").string(), .min_value_bytes = 16}));
+    for (int i = 0; i < 100; ++i) {
+        db.create_entry<std::string>("k" + std::to_string(i), std::string(100, static_cast<char>('a' + i % 26)));
+    }
+    ASSERT_EQ(db.demote_cold(), 100u);
+
+    raft_server_t* raft = raft_with_log(1, 3, 3);
+    auto store = RaftSnapshotStore::open(dir_ / "tiered");
+    ASSERT_TRUE(store.has_value());
+    ASSERT_TRUE((*store)->create(raft, db));
+    auto installed = (*store)->poll_create(raft, true);
+    ASSERT_TRUE(installed.has_value());
+    EXPECT_EQ(*installed, 3);
+
+    raft_server_t* restarted = raft_with_log(1, 0, 0);
+    EntryManager restored;
+    ASSERT_TRUE((*store)->restore(restarted, restored));
+    ASSERT_EQ(restored.size(), 100u);
+    for (int i = 0; i < 100; ++i) {
+        auto entry = std::dynamic_pointer_cast<Entry<std::string>>(restored.find_entry("k" + std::to_string(i)));
+        ASSERT_TRUE(entry);
+        EXPECT_EQ(entry->value, std::string(100, static_cast<char>('a' + i % 26)));
+    }
+    raft_free(raft);
+    raft_free(restarted);
+}
+
+TEST_F(RaftSnapshotTest, LoadSnapshotKeepsAMatchingSuffix) {
+    // our entry at the snapshot's index has the snapshot's term: what follows it is the leader's log too
+    raft_server_t* matching = raft_with_log(2, 5, 0);
+    ASSERT_EQ(raft_load_snapshot(matching, 2, 3), 0);
+    EXPECT_EQ(raft_get_current_idx(matching), 5);
+    EXPECT_EQ(raft_get_log_count(matching), 2);
+    EXPECT_EQ(raft_get_commit_idx(matching), 3);
+    ASSERT_NE(raft_get_entry_from_idx(matching, 4), nullptr);
+    EXPECT_EQ(raft_get_entry_from_idx(matching, 4)->id, 4u);
+
+    // a different term there: our log diverged, so all of it goes
+    raft_server_t* diverged = raft_with_log(1, 5, 0);
+    ASSERT_EQ(raft_load_snapshot(diverged, 2, 3), 0);
+    EXPECT_EQ(raft_get_current_idx(diverged), 3);
+    EXPECT_EQ(raft_get_log_count(diverged), 0);
+
+    // and a snapshot past the end of our log replaces it too
+    raft_server_t* short_log = raft_with_log(2, 2, 0);
+    ASSERT_EQ(raft_load_snapshot(short_log, 2, 3), 0);
+    EXPECT_EQ(raft_get_current_idx(short_log), 3);
+    EXPECT_EQ(raft_get_log_count(short_log), 0);
+
+    raft_free(matching);
+    raft_free(diverged);
+    raft_free(short_log);
+}
+
+static RaftLogStore* g_log;
+static RaftLogStore* log_of(void*) { return g_log; }
+
+TEST_F(RaftSnapshotTest, InstalledSnapshotRestartsTheDurableLog) {
+    auto log = RaftLogStore::open({(dir_ / "log").string(), 8, 1 << 20});
+    ASSERT_TRUE(log.has_value());
+    g_log = log->get();
+    raft_cbs_t cbs = {};
+    RaftLogStore::install<&log_of>(cbs);
+
+    // 1..10 in the durable log, 3 of them compacted away in memory - the store keeps its partly covered segment
+    raft_server_t* follower = raft_new();
+    raft_set_callbacks(follower, &cbs, nullptr);
+    raft_add_node(follower, nullptr, 2, 1);
+    raft_set_current_term(follower, 1);
+    for (int i = 1; i <= 10; ++i) {
+        raft_entry_t ety{};
+        ety.term = 1;
+        ety.id = static_cast<unsigned int>(i);
+        ASSERT_EQ(raft_append_entry(follower, &ety), 0);
+    }
+    raft_set_commit_idx(follower, 3);
+    raft_set_last_applied_idx(follower, 3);
+    ASSERT_EQ(raft_compact_log(follower, 3), 0);
+    EXPECT_EQ(g_log->first_index(), 1);
+
+    // the leader's snapshot reaches past our log, so all of it goes
+    EntryManager leader_db;
+    populate(leader_db);
+    auto leader_store = RaftSnapshotStore::open(dir_ / "leader");
+    ASSERT_TRUE(leader_store.has_value());
+    ASSERT_TRUE((*leader_store)->save(leader_db, 20, 5));
+    raft_server_t* leader = raft_new();
+    raft_add_node(leader, nullptr, 1, 1);
+    raft_node_t* node = raft_add_node(leader, nullptr, 2, 0);
+    raft_set_current_term(leader, 5);
+
+    EntryManager follower_db;
+    auto follower_store = RaftSnapshotStore::open(dir_ / "follower");
+    ASSERT_TRUE(follower_store.has_value());
+    RaftSnapshotSender sender(**leader_store, 64, 2);
+    std::vector<uint8_t> buffer;
+    msg_installsnapshot_t msg;
+    while (!sender.complete()) {
+        ASSERT_TRUE(sender.next(leader, msg, buffer));
+        sender.on_response(leader, node, (*follower_store)->recv_installsnapshot(follower, follower_db, msg, g_log));
+    }
+    EXPECT_EQ(raft_get_current_idx(follower), 20);
+    EXPECT_EQ(g_log->first_index(), 21);
+    EXPECT_EQ(g_log->last_index(), 20);
+
+    // the leader's next entry lands in both logs
+    raft_entry_t next{};
+    next.term = 5;
+    next.id = 21;
+    ASSERT_EQ(raft_append_entry(follower, &next), 0);
+    ASSERT_TRUE(g_log->sync());
+    EXPECT_EQ(g_log->last_index(), 21);
+    EXPECT_EQ(g_log->read(21)->term, 5);
+    raft_free(follower);
+    raft_free(leader);
+    log->reset();
+
+    // after a restart the log continues the snapshot, so restore keeps it
+    auto reopened_log = RaftLogStore::open({(dir_ / "log").string(), 8, 1 << 20});
+    ASSERT_TRUE(reopened_log.has_value());
+    g_log = reopened_log->get();
+    auto reopened = RaftSnapshotStore::open(dir_ / "follower");
+    ASSERT_TRUE(reopened.has_value());
+    raft_server_t* restarted = raft_new();
+    raft_set_callbacks(restarted, &cbs, nullptr);
+    raft_add_node(restarted, nullptr, 2, 1);
+    EntryManager restored;
+    ASSERT_TRUE((*reopened)->restore(restarted, restored, g_log));
+    ASSERT_TRUE(g_log->load_into(restarted));
+    EXPECT_EQ(restored.size(), 6u);
+    EXPECT_EQ(raft_get_current_idx(restarted), 21);
+    EXPECT_EQ(g_log->first_index(), 21);
+    raft_free(restarted);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
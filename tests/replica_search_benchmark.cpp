@@ -0,0 +1,153 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/raft/replica.hpp"
+
+/*
+REPLICA SEARCH SCALING BENCHMARK
+
+Vector search is CPU-bound, so read capacity should grow with the number of replicas serving it. This forks
+R replica processes (1, 2, 4, ... up to max_replicas), each holding the same dataset and a raft follower that
+has heard from a leader, and has every query go through ReplicaReads at BoundedStaleness before running a
+brute-force top-k L2 scan. Aggregate QPS is summed over the replicas through a pipe.
+
+Replication traffic itself isn't modelled here - every replica is caught up - this measures how far reads
+spread, plus the cost of the consistency check on the hot path.
+
+usage: replica_search_benchmark [max_replicas=nproc] [seconds=2] [vectors=20000] [dim=64]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Dataset {
+    size_t dim;
+    std::vector<float> vectors;
+
+    Dataset(size_t count, size_t dim, uint32_t seed) : dim(dim), vectors(count * dim) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for (auto& v : vectors) {
+            v = dist(rng);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return vectors.size() / dim; }
+
+    // brute-force top-k by squared L2 distance
+    std::vector<std::pair<float, size_t>> search(const float* query, size_t k) const {
+        std::vector<std::pair<float, size_t>> best;
+        best.reserve(k + 1);
+        for (size_t i = 0; i < size(); ++i) {
+            const float* v = &vectors[i * dim];
+            float dist = 0.0f;
+            for (size_t d = 0; d < dim; ++d) {
+                float diff = v[d] - query[d];
+                dist += diff * diff;
+            }
+            if (best.size() < k || dist < best.back().first) {
+                best.insert(std::upper_bound(best.begin(), best.end(), std::make_pair(dist, i)), {dist, i});
+                if (best.size() > k) {
+                    best.pop_back();
+                }
+            }
+        }
+        return best;
+    }
+};
+
+// a follower (node 2) that has accepted one heartbeat from the leader (node 1), i.e. a caught-up replica
+static raft_server_t* make_follower() {
+    raft_server_t* raft = raft_new();
+    raft_add_node(raft, nullptr, 1, 0);
+    raft_add_node(raft, nullptr, 2, 1);
+
+    msg_appendentries_t heartbeat = {};
+    heartbeat.term = 1;
+    msg_appendentries_response_t response;
+    raft_recv_appendentries(raft, raft_get_node(raft, 1), &heartbeat, &response);
+    return raft;
+}
+
+static uint64_t run_replica(const Dataset& data, double seconds, uint32_t seed) {
+    raft_server_t* raft = make_follower();
+    ReplicaReads reads(raft, [](int, const msg_readindex_t&) {});
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> query(data.dim);
+
+    uint64_t served = 0;
+    volatile size_t sink = 0;
+    auto deadline = Clock::now() + std::chrono::duration<double>(seconds);
+    while (Clock::now() < deadline) {
+        for (auto& q : query) {
+            q = dist(rng);
+        }
+        reads.submit(ReadConsistency::BoundedStaleness, [&](bool ok) {
+            if (ok) {
+                sink = sink + data.search(query.data(), 10).front().second;
+                ++served;
+            }
+        });
+    }
+    raft_free(raft);
+    return served;
+}
+
+int main(int argc, char** argv) {
+    const size_t max_replicas = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                         : std::max(1u, std::thread::hardware_concurrency());
+    const double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 2.0;
+    const size_t count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20'000;
+    const size_t dim = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 64;
+
+    Dataset data(count, dim, 42); // built before fork so every replica starts from the same state
+    std::cout << "[Dataset] " << count << " x " << dim << " floats, top-10 brute force, "
+              << std::thread::hardware_concurrency() << " cpus\n";
+
+    double base_qps = 0;
+    for (size_t replicas = 1; replicas <= max_replicas; replicas *= 2) {
+        int fds[2];
+        if (::pipe(fds) < 0) {
+            std::perror("pipe");
+            return 1;
+        }
+
+        std::vector<pid_t> children;
+        for (size_t r = 0; r < replicas; ++r) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                ::close(fds[0]);
+                uint64_t served = run_replica(data, seconds, static_cast<uint32_t>(r + 1));
+                ssize_t n = ::write(fds[1], &served, sizeof(served));
+                ::_exit(n == sizeof(served) ? 0 : 1);
+            }
+            children.push_back(pid);
+        }
+        ::close(fds[1]);
+
+        uint64_t total = 0, served = 0;
+        while (::read(fds[0], &served, sizeof(served)) == sizeof(served)) {
+            total += served;
+        }
+        ::close(fds[0]);
+        for (pid_t pid : children) {
+            ::waitpid(pid, nullptr, 0);
+        }
+
+        double qps = total / seconds;
+        if (replicas == 1) {
+            base_qps = qps;
+        }
+        std::cout << "[Replicas " << replicas << "] " << static_cast<uint64_t>(qps) << " searches/sec ("
+                  << qps / base_qps << "x)\n";
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/replication/primary.hpp"
+#include "../src/replication/replica.hpp"
+
+/*
+ASYNC REPLICATION BENCHMARK
+
+Two local processes: a primary that applies `writes` SETs (value_bytes each) as fast as it can, at most
+`rate` per second if given, and a replica attached over loopback TCP. Halfway through, the replica drops
+its link and reconnects so the run also exercises partial resync out of the backlog.
+
+The primary samples every replica's acked offset every 10ms and reports:
+    write throughput, replication throughput (stream MB/s), lag in bytes (p50 / p99 / max),
+    and how long the replica took to catch up once the writes stopped.
+The replica reports what it applied and how it resynced.
+
+usage: replication_benchmark [writes=500000] [value_bytes=64] [rate=0 (unlimited)]
+*/
+
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+static int run_replica(uint16_t port, uint64_t writes) {
+    EntryManager db(1);
+    ReplicationReplica replica(db, ReplicationReplica::Options{.port = port, .ack_interval = 10ms, .retry_interval = 50ms});
+
+    bool dropped = false;
+    auto start = Clock::now();
+    while (replica.stats().commands_applied < writes) {
+        if (!dropped && replica.stats().commands_applied > writes / 2) {
+            replica.disconnect();
+            dropped = true;
+        }
+        std::this_thread::sleep_for(1ms);
+        if (Clock::now() - start > 120s) {
+            std::cout << "[replica] timed out\n";
+            return 1;
+        }
+    }
+    std::this_thread::sleep_for(50ms); // let the final ack out
+    auto s = replica.stats();
+    std::cout << "[replica] applied " << s.commands_applied << " commands (" << s.offset << " stream bytes), "
+              << db.size() << " keys, " << s.full_resyncs << " full / " << s.partial_resyncs << " partial resyncs\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t writes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500'000;
+    const size_t value_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const double rate = argc > 3 ? std::strtod(argv[3], nullptr) : 0;
+
+    EntryManager db(1);
+    auto started = ReplicationPrimary::start(db, ReplicationPrimary::Options{.backlog_bytes = 64u << 20});
+    if (!started) {
+        std::cerr << "primary: " << started.error().message() << "\n";
+        return 1;
+    }
+    ReplicationPrimary& primary = **started;
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        int rc = run_replica(primary.port(), writes);
+        std::cout.flush(); // _exit skips stdio teardown
+        ::_exit(rc);
+    }
+
+    // wait for the replica's initial (empty) full resync
+    while (primary.stats().replicas.empty() || !primary.stats().replicas[0].streaming) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    std::vector<uint64_t> lag_samples;
+    std::atomic<bool> writing{true};
+    std::thread sampler([&] {
+        while (writing) {
+            auto s = primary.stats();
+            if (!s.replicas.empty()) lag_samples.push_back(s.replicas[0].lag_bytes);
+            std::this_thread::sleep_for(10ms);
+        }
+    });
+
+    std::string value(value_bytes, 'v');
+    std::vector<std::string> args{"SET", "", value};
+    std::vector<uint8_t> response;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < writes; ++i) {
+        args[1] = "key:" + std::to_string(i);
+        primary.write(args, [&] {
+            response.clear();
+            CommandProcessor::process_command({args, response, db});
+        });
+        if (rate > 0) {
+            auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / rate));
+            std::this_thread::sleep_until(due);
+        }
+    }
+    auto written = Clock::now();
+    writing = false;
+    sampler.join();
+
+    // caught up once some replica acks the final offset
+    uint64_t end = primary.offset();
+    auto acked = [&] {
+        auto s = primary.stats();
+        return !s.replicas.empty() && s.replicas[0].acked_offset >= end;
+    };
+    while (!acked() && Clock::now() - written < 60s) {
+        std::this_thread::sleep_for(1ms);
+    }
+    auto caught_up = Clock::now();
+
+    int status = 0;
+    ::waitpid(child, &status, 0);
+
+    double write_secs = std::chrono::duration<double>(written - start).count();
+    double total_secs = std::chrono::duration<double>(caught_up - start).count();
+    std::sort(lag_samples.begin(), lag_samples.end());
+    auto pct = [&](double p) {
+        return lag_samples.empty() ? 0 : lag_samples[std::min(lag_samples.size() - 1, static_cast<size_t>(p * lag_samples.size()))];
+    };
+    auto s = primary.stats();
+    std::cout << "[primary] " << static_cast<uint64_t>(writes / write_secs) << " writes/sec, stream "
+              << end / total_secs / (1 << 20) << " MB/s to the replica, " << s.full_resyncs << " full / "
+              << s.partial_resyncs << " partial resyncs served\n"
+              << "[lag] p50 " << pct(0.5) << " B, p99 " << pct(0.99) << " B, max "
+              << (lag_samples.empty() ? 0 : lag_samples.back()) << " B; caught up "
+              << std::chrono::duration<double, std::milli>(caught_up - written).count() << " ms after the last write\n";
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/replication/primary.hpp"
+#include "../src/replication/replica.hpp"
+
+/*
+ASYNC REPLICATION TESTS
+*/
+
+using namespace std::chrono_literals;
+
+static std::string get(EntryManager& db, const std::string& key) {
+    auto entry = std::dynamic_pointer_cast<Entry<std::string>>(db.find_entry(key));
+    return entry ? entry->value : "(nil)";
+}
+
+static void set(ReplicationPrimary& primary, EntryManager& db, const std::string& key, const std::string& value) {
+    std::vector<std::string> args{"SET", key, value};
+    std::vector<uint8_t> response;
+    primary.write(args, [&] { CommandProcessor::process_command({args, response, db}); });
+}
+
+static bool wait_for(const std::function<bool()>& pred, std::chrono::milliseconds timeout = 5s) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(5ms);
+    }
+    return true;
+}
+
+TEST(ReplicationTest, BacklogWrapsAndReads) {
+    ReplicationBacklog backlog(8);
+    std::vector<uint8_t> a{1, 2, 3, 4, 5, 6};
+    std::vector<uint8_t> b{7, 8, 9, 10};
+    backlog.append(a);
+    backlog.append(b);
+    EXPECT_EQ(backlog.end_offset(), 10u);
+    EXPECT_EQ(backlog.start_offset(), 2u);
+    EXPECT_FALSE(backlog.covers(1));
+
+    std::vector<uint8_t> out(8);
+    auto n = backlog.read(2, out);
+    ASSERT_TRUE(n);
+    EXPECT_EQ(*n, 8u);
+    EXPECT_EQ(out, (std::vector<uint8_t>{3, 4, 5, 6, 7, 8, 9, 10}));
+    EXPECT_EQ(*backlog.read(10, out), 0u);
+    EXPECT_FALSE(backlog.read(0, out));
+}
+
+TEST(ReplicationTest, FullThenPartialResync) {
+    EntryManager primary_db(1), replica_db(1);
+    auto primary = ReplicationPrimary::start(primary_db, {});
+    ASSERT_TRUE(primary);
+    ReplicationPrimary& p = **primary;
+
+    set(p, primary_db, "before", "snapshot"); // reaches the replica through the full resync
+
+    ReplicationReplica replica(replica_db, ReplicationReplica::Options{.port = p.port(), .retry_interval = 20ms});
+    ASSERT_TRUE(wait_for([&] { return replica.stats().full_resyncs == 1 && replica.stats().connected; }));
+
+    for (int i = 0; i < 1000; ++i) {
+        set(p, primary_db, "k" + std::to_string(i), "v" + std::to_string(i));
+    }
+    ASSERT_TRUE(wait_for([&] { return replica.offset() == p.offset(); }));
+    EXPECT_EQ(get(replica_db, "before"), "snapshot");
+    EXPECT_EQ(get(replica_db, "k999"), "v999");
+
+    // writes made while the link is down come back out of the backlog, not a new snapshot
+    replica.disconnect();
+    ASSERT_TRUE(wait_for([&] { return !replica.stats().connected; }));
+    for (int i = 0; i < 100; ++i) {
+        set(p, primary_db, "k" + std::to_string(i), "updated");
+    }
+    ASSERT_TRUE(wait_for([&] { return replica.offset() == p.offset(); }));
+    EXPECT_EQ(replica.stats().partial_resyncs, 1u);
+    EXPECT_EQ(replica.stats().full_resyncs, 1u);
+    EXPECT_EQ(get(replica_db, "k42"), "updated");
+
+    ASSERT_TRUE(wait_for([&] {
+        auto s = p.stats();
+        return s.replicas.size() == 1 && s.replicas[0].lag_bytes == 0;
+    }));
+}
+
+TEST(ReplicationTest, FallsBackToFullResyncWhenBacklogOverrun) {
+    EntryManager primary_db(1), replica_db(1);
+    auto primary = ReplicationPrimary::start(primary_db, ReplicationPrimary::Options{.backlog_bytes = 1024});
+    ASSERT_TRUE(primary);
+    ReplicationPrimary& p = **primary;
+
+    ReplicationReplica replica(replica_db, ReplicationReplica::Options{.port = p.port(), .retry_interval = 200ms});
+    ASSERT_TRUE(wait_for([&] { return replica.stats().connected; }));
+    replica.disconnect();
+    ASSERT_TRUE(wait_for([&] { return !replica.stats().connected; }));
+
+    for (int i = 0; i < 500; ++i) { // far more than 1 KiB of stream
+        set(p, primary_db, "k" + std::to_string(i), std::string(32, 'x'));
+    }
+    ASSERT_TRUE(wait_for([&] { return replica.stats().connected && replica.offset() == p.offset(); }));
+    EXPECT_EQ(replica.stats().full_resyncs, 2u);
+    EXPECT_EQ(replica_db.size(), primary_db.size());
+}
+
+TEST(ReplicationTest, WritesCarryOnDuringAFullResync) {
+    EntryManager primary_db(1), replica_db(1);
+    auto primary = ReplicationPrimary::start(primary_db, {});
+    ASSERT_TRUE(primary);
+    ReplicationPrimary& p = **primary;
+    for (int i = 0; i < 200000; ++i) {
+        set(p, primary_db, "k" + std::to_string(i), std::string(64, 'a' + i % 26));
+    }
+
+    // the snapshot is written by a forked child, so these land while it is in flight and reach the replica
+    // through the stream from the offset the fork happened at
+    std::atomic<bool> stop{false};
+    std::atomic<int> written{0};
+    std::thread writer([&] {
+        for (int i = 0; !stop; ++i, ++written) {
+            set(p, primary_db, "live" + std::to_string(i), std::to_string(i));
+            set(p, primary_db, "k" + std::to_string(i % 200000), "overwritten");
+        }
+    });
+    ReplicationReplica replica(replica_db, ReplicationReplica::Options{.port = p.port(), .retry_interval = 20ms});
+    ASSERT_TRUE(wait_for([&] { return replica.stats().full_resyncs == 1 && replica.stats().connected; }, 30s));
+    stop = true;
+    writer.join();
+    ASSERT_GT(written.load(), 0);
+
+    ASSERT_TRUE(wait_for([&] { return replica.offset() == p.offset(); }, 30s));
+    EXPECT_EQ(replica_db.size(), primary_db.size());
+    int last = written.load() - 1;
+    EXPECT_EQ(get(replica_db, "live" + std::to_string(last)), std::to_string(last));
+    EXPECT_EQ(get(replica_db, "k0"), "overwritten");
+    EXPECT_EQ(get(replica_db, "k199999"), get(primary_db, "k199999"));
+}
+
+TEST(ReplicationTest, ExpiryIsReplicatedAsADeadline) {
+    EntryManager primary_db(1), replica_db(1);
+    auto primary = ReplicationPrimary::start(primary_db, {});
+    ASSERT_TRUE(primary);
+    ReplicationPrimary& p = **primary;
+    set(p, primary_db, "k", "v");
+
+    ReplicationReplica replica(replica_db, ReplicationReplica::Options{.port = p.port(), .retry_interval = 300ms});
+    ASSERT_TRUE(wait_for([&] { return replica.stats().connected && replica.offset() == p.offset(); }));
+    replica.disconnect();
+    ASSERT_TRUE(wait_for([&] { return !replica.stats().connected; }));
+
+    // the replica only sees this ~300ms later, when it reconnects; it must still expire 400ms from now
+    auto issued = std::chrono::steady_clock::now();
+    std::vector<std::string> args{"PEXPIRE", "k", "400"};
+    std::vector<uint8_t> response;
+    p.write(args, [&] { CommandProcessor::process_command({args, response, primary_db}); });
+    ASSERT_TRUE(wait_for([&] { return replica.stats().connected && replica.offset() == p.offset(); }));
+    auto entry = replica_db.find_entry("k");
+    ASSERT_TRUE(entry);
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - issued).count();
+    ASSERT_LT(elapsed, 400);
+    int64_t remaining = replica_db.get_expiry_time(*entry);
+    EXPECT_GT(remaining, 0);
+    EXPECT_LE(remaining, 400 - elapsed + 20); // a relative TTL would have restarted the 400ms on apply
+}
+
+TEST(ReplicationTest, PrimaryPublishesReplicasForDiscovery) {
+    EntryManager primary_db(1), replica_db(1);
+    auto primary = ReplicationPrimary::start(primary_db, ReplicationPrimary::Options{.client_port = 7100});
+    ASSERT_TRUE(primary);
+    ReplicationPrimary& p = **primary;
+    ReplicationReplica replica(replica_db, ReplicationReplica::Options{.port = p.port(), .retry_interval = 20ms,
+                                                                       .listening_port = 7101});
+    set(p, primary_db, "k", "v");
+
+    ASSERT_TRUE(wait_for([&] {
+        auto list = ReplicaDirectory::instance().list();
+        return list.size() == 2 && list[1].lag == 0 && list[1].applied_idx == static_cast<int64_t>(p.offset());
+    }));
+    auto list = ReplicaDirectory::instance().list();
+    EXPECT_EQ(list[0].role, ReplicaDirectory::Role::Leader);
+    EXPECT_EQ(list[0].address, "127.0.0.1:7100");
+    EXPECT_EQ(list[1].role, ReplicaDirectory::Role::Follower);
+    EXPECT_EQ(list[1].address, "127.0.0.1:7101");
+
+    // and REPLICAS serves it
+    std::vector<std::string> args{"REPLICAS"};
+    std::vector<uint8_t> response;
+    CommandProcessor::process_command({args, response, primary_db});
+    EXPECT_NE(ResponseSerializer::deserialize_string(response).find("127.0.0.1:7101 follower"), std::string::npos);
+
+    primary->reset();
+    EXPECT_TRUE(ReplicaDirectory::instance().list().empty());
+}
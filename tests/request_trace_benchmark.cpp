@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../connection.hpp"
+
+/*
+REQUEST TRACING BENCHMARK
+
+What sampled lifecycle tracing costs. A Connection serves GETs over a socketpair, one request in flight, with
+tracing off and at 1/64 and 1/1 (interleaved, best of 5 after a warm-up round); the connection's own logging
+to stdout is muted for the timed loops. Also reports begin() + finish() on their own with tracing off (the price every request pays)
+and the stage breakdown (mean per stage) from the traces of the 1/1 run.
+
+usage: request_trace_benchmark [requests=50000]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000;
+
+    RequestTracer& tracer = RequestTracer::instance();
+    tracer.configure({.sample_rate = 0});
+    const size_t calls = 20000000;
+    RequestTrace trace;
+    auto t0 = Clock::now();
+    for (size_t n = 0; n < calls; ++n) {
+        tracer.begin(trace, static_cast<int>(n));
+        trace.stamp(RequestTrace::Parsed);
+        tracer.finish(trace);
+    }
+    double off_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / calls;
+
+    EntryManager db;
+    db.create_entry<std::string>("key", "value");
+    CommandProcessor processor;
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    Connection conn(Socket(fds[1]), db, processor);
+    const std::string request = "GET key";
+    char buffer[256];
+
+    const std::vector<uint32_t> rates{0, 64, 1};
+    std::vector<double> best(rates.size(), 0);
+    // round 0 warms the socket buffers and the allocator and isn't counted
+    for (int round = 0; round <= 5; ++round) {
+        for (size_t c = 0; c < rates.size(); ++c) {
+            tracer.configure({.sample_rate = rates[c], .buffer = requests});
+            std::cout.setstate(std::ios::failbit);
+            std::cerr.setstate(std::ios::failbit);
+            auto start = Clock::now();
+            for (size_t n = 0; n < requests; ++n) {
+                (void)!::write(fds[0], request.data(), request.size());
+                (void)conn.process_io();
+                (void)!::read(fds[0], buffer, sizeof(buffer));
+            }
+            double s = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout.clear();
+            std::cerr.clear();
+            if (round > 0) best[c] = std::max(best[c], static_cast<double>(requests) / s);
+        }
+    }
+
+    // stage means from the last 1/1 run's traces, straight from the dump
+    std::string json = tracer.dump();
+    std::vector<std::pair<std::string, std::pair<double, size_t>>> stages;
+    for (size_t at = json.find("\"name\":\""); at != std::string::npos; at = json.find("\"name\":\"", at + 1)) {
+        std::string name = json.substr(at + 8, json.find('"', at + 8) - at - 8);
+        double dur = std::stod(json.substr(json.find("\"dur\":", at) + 6, 32));
+        auto it = std::find_if(stages.begin(), stages.end(), [&](const auto& s) { return s.first == name; });
+        if (it == stages.end()) it = stages.insert(stages.end(), {name, {0.0, 0}});
+        it->second.first += dur;
+        ++it->second.second;
+    }
+
+    std::cout << "requests=" << requests << "\n" << std::fixed << std::setprecision(2)
+              << "disabled begin+stamp+finish  " << off_ns << " ns/request\n";
+    for (size_t c = 0; c < rates.size(); ++c) {
+        std::cout << "trace " << std::setw(5) << (rates[c] ? "1/" + std::to_string(rates[c]) : std::string("off"))
+                  << "  " << std::setprecision(0) << best[c] << " req/s  overhead " << std::setprecision(1)
+                  << 100.0 * (best[0] / best[c] - 1.0) << "%\n";
+    }
+    std::cout << "stage means (us):";
+    for (const auto& [name, sum] : stages) {
+        std::cout << "  " << name << " " << std::setprecision(2) << sum.first / static_cast<double>(sum.second);
+    }
+    std::cout << "\n";
+    ::close(fds[0]);
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../connection.hpp"
+
+/*
+REQUEST TRACING TESTS
+*/
+
+// a Connection on one end of a socketpair, the test playing client on the other
+struct Pair {
+    EntryManager db;
+    CommandProcessor processor;
+    int client = -1;
+    std::unique_ptr<Connection> conn;
+
+    Pair() {
+        int fds[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        client = fds[0];
+        conn = std::make_unique<Connection>(Socket(fds[1]), db, processor);
+    }
+    ~Pair() { ::close(client); }
+
+    std::string roundtrip(const std::string& request) {
+        (void)!::write(client, request.data(), request.size());
+        EXPECT_TRUE(conn->process_io());
+        char buffer[4096];
+        ssize_t n = ::read(client, buffer, sizeof(buffer));
+        return n > 0 ? std::string(buffer, static_cast<size_t>(n)) : "";
+    }
+};
+
+TEST(RequestTraceTest, DisabledTracesNothing) {
+    RequestTracer::instance().configure({.sample_rate = 0});
+    RequestTrace trace;
+    RequestTracer::instance().begin(trace, 3);
+    EXPECT_FALSE(trace.active);
+    trace.stamp(RequestTrace::Parsed);
+    EXPECT_EQ(trace.ticks[RequestTrace::Parsed], 0u);
+    RequestTracer::instance().finish(trace);
+    EXPECT_EQ(RequestTracer::instance().buffered(), 0u);
+}
+
+TEST(RequestTraceTest, StampsEveryStageInOrder) {
+    RequestTracer::instance().configure({.sample_rate = 1});
+    Pair pair;
+    pair.roundtrip("SET key value");
+    pair.roundtrip("GET key");
+    ASSERT_EQ(RequestTracer::instance().buffered(), 2u);
+
+    std::string json = RequestTracer::instance().dump();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(json.substr(json.size() - 2), "]}");
+    for (const char* span : {"read", "parse", "dispatch", "execute", "serialize", "write"}) {
+        EXPECT_NE(json.find("\"name\":\"" + std::string(span) + "\""), std::string::npos) << span;
+    }
+    EXPECT_NE(json.find("\"command\":\"set\""), std::string::npos) << json;
+    EXPECT_NE(json.find("\"command\":\"get\""), std::string::npos);
+    EXPECT_NE(json.find("\"fd\":" + std::to_string(pair.conn->fd())), std::string::npos);
+    // 2 requests x 6 spans
+    size_t events = 0;
+    for (size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1)) ++events;
+    EXPECT_EQ(events, 12u);
+    RequestTracer::instance().configure({});
+}
+
+TEST(RequestTraceTest, SamplesOneInN) {
+    RequestTracer::instance().configure({.sample_rate = 8});
+    Pair pair;
+    for (int i = 0; i < 800; ++i) pair.roundtrip("GET key");
+    EXPECT_NEAR(static_cast<double>(RequestTracer::instance().buffered()), 100.0, 40.0);
+    RequestTracer::instance().configure({});
+}
+
+TEST(RequestTraceTest, TraceCommand) {
+    EntryManager db;
+    std::vector<uint8_t> response;
+    std::vector<std::string> sample{"TRACE", "SAMPLE", "1"};
+    CommandProcessor::process_command({sample, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response), "OK");
+    EXPECT_EQ(RequestTracer::instance().sample_rate(), 1u);
+
+    std::vector<std::string> dump{"TRACE", "DUMP"};
+    response.clear();
+    CommandProcessor::process_command({dump, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response).rfind("{\"displayTimeUnit\"", 0), 0u);
+
+    std::vector<std::string> bad{"TRACE", "SAMPLE", "-1"};
+    response.clear();
+    CommandProcessor::process_command({bad, response, db});
+    EXPECT_NE(ResponseSerializer::deserialize_error(response), "No error");
+    RequestTracer::instance().configure({});
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <csignal>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../server.hpp"
+#include "../src/client/client.hpp"
+#include "../src/transport/shm_client.hpp"
+
+/*
+SHARED-MEMORY TRANSPORT TESTS
+*/
+
+// a Server in a forked child listening on TCP `port` and on `path`, output to /dev/null
+struct ForkedServer {
+    pid_t pid;
+    uint16_t port;
+    std::string path;
+
+    ForkedServer(uint16_t p, std::string unix_path) : port(p), path(std::move(unix_path)) {
+        pid = ::fork();
+        if (pid == 0) {
+            int null = ::open("/dev/null", O_WRONLY);
+            ::dup2(null, STDOUT_FILENO);
+            ::dup2(null, STDERR_FILENO);
+            Server server(port, 1);
+            if (!server.initialize() || !server.listen_unix(path)) _exit(1);
+            server.run();
+            _exit(0);
+        }
+    }
+    ~ForkedServer() {
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+        ::unlink(path.c_str());
+    }
+
+    std::unique_ptr<ShmClient> shm(size_t ring_bytes) {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            auto c = ShmClient::connect({.path = path, .ring_bytes = ring_bytes});
+            if (c) return std::move(*c);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return nullptr;
+    }
+};
+
+TEST(ShmTransportTest, RingWrapsAround) {
+    auto region = ShmRegion::create(1000);     // rounds up to the 4 KiB minimum
+    ASSERT_TRUE(region);
+    auto producer = region->requests();
+    auto consumer = region->requests();
+
+    std::vector<uint8_t> in(3000), out(3000);
+    std::iota(in.begin(), in.end(), 0);
+    for (int round = 0; round < 10; ++round) {
+        // 3000 bytes at a time into 4096: every other round straddles the end of the buffer
+        in[0] = static_cast<uint8_t>(round);
+        ASSERT_EQ(producer.write(in.data(), in.size()), in.size());
+        EXPECT_EQ(consumer.readable(), in.size());
+        ASSERT_EQ(consumer.read(out.data(), out.size()), out.size());
+        EXPECT_EQ(in, out);
+    }
+
+    // a full ring takes what fits
+    std::vector<uint8_t> big(5000, 7);
+    EXPECT_EQ(producer.write(big.data(), big.size()), 4096u);
+    EXPECT_EQ(producer.write(big.data(), 1), 0u);
+    EXPECT_EQ(consumer.read(big.data(), big.size()), 4096u);
+    EXPECT_EQ(consumer.readable(), 0u);
+}
+
+TEST(ShmTransportTest, DoorbellOnlyForASleepingConsumer) {
+    auto region = ShmRegion::create(4096);
+    ASSERT_TRUE(region);
+    auto ring = region->responses();
+    uint8_t byte = 1;
+
+    // nobody waiting: writes ring nothing
+    ring.write(&byte, 1);
+    EXPECT_FALSE(ring.take_waiter());
+    // a byte is there, so the consumer mustn't sleep
+    EXPECT_FALSE(ring.prepare_wait());
+    ring.read(&byte, 1);
+
+    EXPECT_TRUE(ring.prepare_wait());
+    ring.write(&byte, 1);
+    EXPECT_TRUE(ring.take_waiter());
+    EXPECT_FALSE(ring.take_waiter());      // one wakeup per sleep
+}
+
+TEST(ShmTransportTest, AttachSeesTheSameRings) {
+    auto region = ShmRegion::create(8192);
+    ASSERT_TRUE(region);
+    auto other = ShmRegion::attach(::dup(region->fd()));
+    ASSERT_TRUE(other);
+    std::string msg = "across the mapping";
+    region->requests().write(reinterpret_cast<const uint8_t*>(msg.data()), msg.size());
+    std::string got(msg.size(), '\0');
+    ASSERT_EQ(other->requests().read(reinterpret_cast<uint8_t*>(got.data()), got.size()), msg.size());
+    EXPECT_EQ(got, msg);
+
+    // a file that isn't a region is refused
+    int fd = ::memfd_create("not-a-region", MFD_CLOEXEC);
+    ASSERT_EQ(::ftruncate(fd, 12345), 0);
+    EXPECT_FALSE(ShmRegion::attach(fd));
+}
+
+TEST(ShmTransportTest, CommandsOverSharedMemory) {
+    ForkedServer server(7415, "/tmp/vectordb_shm_test_7415.sock");
+    auto client = server.shm(4096);        // small rings, so the pipeline below wraps them many times
+    ASSERT_TRUE(client);
+
+    auto set = client->call({"SET", "k", "hello"});
+    ASSERT_TRUE(set);
+    EXPECT_FALSE(set->is_error());
+    auto get = client->call({"GET", "k"});
+    ASSERT_TRUE(get);
+    EXPECT_EQ(get->str, "hello");
+    EXPECT_TRUE(client->call({"GET", "missing"})->is_nil());
+
+    // values near the frame limit, pipelined well past the ring size
+    constexpr int n = 200;
+    std::vector<std::string> values;
+    for (int i = 0; i < n; ++i) {
+        values.push_back(std::string(3000 + i, static_cast<char>('a' + i % 26)));
+        ASSERT_TRUE(client->send({"SET", "big:" + std::to_string(i), values.back()}));
+    }
+    for (int i = 0; i < n; ++i) {
+        auto r = client->receive();
+        ASSERT_TRUE(r);
+        EXPECT_FALSE(r->is_error());
+    }
+    for (int i = 0; i < n; ++i) {
+        ASSERT_TRUE(client->send({"GET", "big:" + std::to_string(i)}));
+    }
+    for (int i = 0; i < n; ++i) {
+        auto r = client->receive();
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->str, values[i]);
+    }
+
+    // a client going away leaves the server serving the next one
+    client.reset();
+    auto again = server.shm(1 << 16);
+    ASSERT_TRUE(again);
+    EXPECT_EQ(again->call({"GET", "k"})->str, "hello");
+}
+
+TEST(ShmTransportTest, UnixSocketWithoutShmAndTcpRefusesIt) {
+    ForkedServer server(7416, "/tmp/vectordb_shm_test_7416.sock");
+    ASSERT_TRUE(server.shm(4096));         // waits for the server to come up
+
+    // plain framed traffic on the Unix socket
+    auto local = ClientPool::connect({.connections = 1, .unix_path = server.path});
+    ASSERT_TRUE(local);
+    EXPECT_FALSE((*local)->call({"SET", "k", "v"}).get()->is_error());
+    EXPECT_EQ((*local)->call({"GET", "k"}).get()->str, "v");
+
+    // SHM needs the Unix socket: over TCP it's an error reply and the connection carries on
+    auto tcp = ClientPool::connect({.port = server.port, .connections = 1, .unix_path = ""});
+    ASSERT_TRUE(tcp);
+    EXPECT_TRUE((*tcp)->call({"SHM"}).get()->is_error());
+    EXPECT_EQ((*tcp)->call({"GET", "k"}).get()->str, "v");
+}
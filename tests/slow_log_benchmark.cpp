@@ -0,0 +1,83 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include "../command_processor.hpp"
+
+/*
+SLOW LOG BENCHMARK
+
+What the SLOWLOG threshold check costs on every request, and what logging a slow one costs:
+    maybe_record() below the threshold in a tight loop (the per-request price), and above it (a ring write)
+    uniform GETs through CommandProcessor::process_command with the slow log off and on at a 10ms threshold,
+    latency recording on in both (interleaved, best of 3)
+
+usage: slow_log_benchmark [keys=100000] [ops=2000000]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+    SlowLog& slow_log = SlowLog::instance();
+    std::vector<std::string> args{"GET", "key:12345"};
+    size_t id = CommandStats::instance().id("get");
+
+    // per-request check, with varying durations so the compiler can't fold it
+    slow_log.configure({.threshold_us = 10000});
+    const size_t checks = 100000000;
+    auto t0 = Clock::now();
+    for (size_t n = 0; n < checks; ++n) {
+        slow_log.maybe_record(id, args, n & 0xffff, -1);
+    }
+    double check_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / checks;
+
+    slow_log.configure({.threshold_us = 0});
+    const size_t writes = 2000000;
+    t0 = Clock::now();
+    for (size_t n = 0; n < writes; ++n) {
+        slow_log.maybe_record(id, args, n, 5);
+    }
+    double record_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / writes;
+
+    EntryManager db;
+    for (size_t i = 0; i < keys; ++i) {
+        db.create_entry<std::string>("key:" + std::to_string(i), "value");
+    }
+    std::mt19937_64 rng(7);
+    std::vector<std::vector<std::string>> stream;
+    stream.reserve(ops);
+    for (size_t n = 0; n < ops; ++n) {
+        stream.push_back({"GET", "key:" + std::to_string(rng() % keys)});
+    }
+
+    double best[2] = {0, 0};
+    for (int round = 0; round < 3; ++round) {
+        for (int on = 0; on < 2; ++on) {
+            slow_log.configure({.threshold_us = on ? 10000 : -1});
+            std::vector<uint8_t> response;
+            auto start = Clock::now();
+            for (const auto& cmd : stream) {
+                response.clear();
+                CommandProcessor::process_command({cmd, response, db});
+            }
+            double s = std::chrono::duration<double>(Clock::now() - start).count();
+            best[on] = std::max(best[on], static_cast<double>(ops) / s);
+        }
+    }
+
+    std::cout << "keys=" << keys << " ops=" << ops << "\n"
+              << std::fixed << std::setprecision(2)
+              << "threshold check    " << check_ns << " ns/request\n"
+              << "slow record        " << record_ns << " ns/record\n"
+              << "slowlog off        " << best[0] / 1e6 << " M GET/s\n"
+              << "slowlog on (10ms)  " << best[1] / 1e6 << " M GET/s  overhead " << std::setprecision(1)
+              << 100.0 * (best[0] / best[1] - 1.0) << "%\n";
+    return 0;
+}
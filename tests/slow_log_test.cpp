@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../command_processor.hpp"
+
+/*
+SLOW LOG TESTS
+*/
+
+static uint64_t us_to_ticks(double us) {
+    return static_cast<uint64_t>(us * 1000.0 / CommandStats::ns_per_tick());
+}
+
+TEST(SlowLogTest, KeepsSlowCommandsNewestFirst) {
+    SlowLog log({.threshold_us = 100, .capacity = 4});
+    size_t get = CommandStats::instance().id("get");
+    log.maybe_record(get, {"GET", "fast"}, us_to_ticks(50), 7);
+    EXPECT_EQ(log.size(), 0u);
+
+    for (int i = 0; i < 6; ++i) {
+        log.maybe_record(get, {"GET", "slow" + std::to_string(i)}, us_to_ticks(200 + i), 7);
+    }
+    auto records = log.get(10);
+    ASSERT_EQ(records.size(), 4u); // capacity
+    EXPECT_EQ(records[0].args, (std::vector<std::string>{"GET", "slow5"}));
+    EXPECT_EQ(records[3].args, (std::vector<std::string>{"GET", "slow2"}));
+    EXPECT_EQ(records[0].command, "get");
+    EXPECT_EQ(records[0].client_fd, 7);
+    EXPECT_EQ(records[0].id, 5u);
+    EXPECT_NEAR(static_cast<double>(records[0].duration_us), 205.0, 2.0);
+    EXPECT_GT(records[0].timestamp_us, 0u);
+
+    log.reset();
+    EXPECT_EQ(log.size(), 0u);
+    log.maybe_record(get, {"GET", "after"}, us_to_ticks(300), -1);
+    ASSERT_EQ(log.size(), 1u);
+    EXPECT_EQ(log.get(1)[0].client_fd, -1);
+}
+
+TEST(SlowLogTest, TruncatesArguments) {
+    SlowLog log({.threshold_us = 0, .capacity = 2});
+    std::vector<std::string> args{"SET", "k", std::string(1000, 'x')};
+    for (int i = 0; i < 40; ++i) args.push_back("a" + std::to_string(i));
+    log.maybe_record(0, args, 1, 3);
+
+    auto record = log.get(1).at(0);
+    EXPECT_EQ(record.args[0], "SET");
+    EXPECT_EQ(record.args[2], std::string(SlowLog::k_max_arg_bytes, 'x') + "... (936 more bytes)");
+    EXPECT_LE(record.args.size(), SlowLog::k_max_args);
+    EXPECT_EQ(record.args.back(), "... (" + std::to_string(args.size() - (record.args.size() - 1)) + " more arguments)");
+}
+
+TEST(SlowLogTest, ConcurrentWritersLeaveConsistentRecords) {
+    SlowLog log({.threshold_us = 0, .capacity = 64});
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        while (!done) {
+            for (const auto& r : log.get(64)) {
+                // every record's arguments agree with its fd: a torn read would mix two writers
+                ASSERT_EQ(r.args.size(), 2u);
+                ASSERT_EQ(r.args[1], "t" + std::to_string(r.client_fd));
+            }
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&, t] {
+            for (int n = 0; n < 50000; ++n) log.maybe_record(0, {"GET", "t" + std::to_string(t)}, 1, t);
+        });
+    }
+    for (auto& w : writers) w.join();
+    done = true;
+    reader.join();
+    EXPECT_LE(log.size(), 64u);
+    EXPECT_GE(log.size() + log.dropped(), 1u);
+}
+
+TEST(SlowLogTest, SlowlogCommand) {
+    SlowLog::instance().configure({.threshold_us = 0, .capacity = 16});
+    EntryManager db;
+    std::vector<uint8_t> response;
+    std::vector<std::string> set{"SET", "key", "value"};
+    CommandProcessor::process_command({set, response, db, 42});
+
+    std::vector<std::string> get{"SLOWLOG", "GET", "1"};
+    response.clear();
+    CommandProcessor::process_command({get, response, db});
+    std::string out = ResponseSerializer::deserialize_string(response);
+    EXPECT_NE(out.find(" 42 SET key value\n"), std::string::npos) << out;
+    EXPECT_EQ(out.rfind("0 ", 0), 0u) << out;
+
+    // the SET and the SLOWLOG GET itself
+    std::vector<std::string> len{"SLOWLOG", "LEN"};
+    response.clear();
+    CommandProcessor::process_command({len, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response), "2");
+
+    std::vector<std::string> reset{"slowlog", "reset"};
+    response.clear();
+    CommandProcessor::process_command({reset, response, db});
+    EXPECT_EQ(ResponseSerializer::deserialize_string(response), "OK");
+    EXPECT_EQ(SlowLog::instance().size(), 1u); // the RESET, logged once it returned
+
+    std::vector<std::string> bad{"SLOWLOG", "FETCH"};
+    response.clear();
+    CommandProcessor::process_command({bad, response, db});
+    EXPECT_NE(ResponseSerializer::deserialize_error(response), "No error");
+    SlowLog::instance().configure({});
+}
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <bit>
+#include "../entry_manager.hpp"
+
+/*
+TIERED STORAGE BENCHMARK
+
+Loads `keys` string values of `value_bytes` each, warms the sketch with a Zipf(`skew`) access pattern and
+runs one demote_cold() pass, so the long tail moves to the value log while the head stays in RAM. Then:
+    - GET latency (p50 / p99) for hits that were resident vs hits that had to come back from disk
+      (the latter is measured on each cold key's first access, before it's promoted again)
+    - RAM saved: value bytes demoted, against the total
+    - value log GC: overwrite three quarters of the cold keys and report how many segments / bytes the background
+      collector reclaims and how much it had to relocate
+
+The value log lives under $TMPDIR, so "disk" is usually the page cache - pass a directory on a real device as
+`dir` to see device reads.
+
+usage: tiered_storage_benchmark [keys=200000] [value_bytes=1024] [skew=0.99] [dir=$TMPDIR/vlog_bench]
+*/
+
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+static std::string key_of(size_t i) {
+    return "key:" + std::to_string(i);
+}
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s, uint64_t seed) : cdf_(n), rng_(seed) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    size_t next() {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+        return static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+};
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0;
+    size_t i = std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())));
+    std::nth_element(v.begin(), v.begin() + static_cast<ptrdiff_t>(i), v.end());
+    return v[i];
+}
+
+int main(int argc, char** argv) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t value_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+    double skew = argc > 3 ? std::strtod(argv[3], nullptr) : 0.99;
+    std::string dir = argc > 4 ? argv[4] : (std::filesystem::temp_directory_path() / "vlog_bench").string();
+
+    EntryManager db;
+    EntryManager::TieringOptions options;
+    options.dir = dir;
+    options.min_value_bytes = 64;
+    options.sketch_counters = std::bit_ceil(keys * 4);
+    options.segment_bytes = 8ull << 20; // small enough that GC has sealed segments to pick from
+    options.gc_interval = 100ms;
+    if (auto r = db.enable_tiering(options); !r) {
+        std::cerr << "enable_tiering: " << r.error().message() << "\n";
+        return 1;
+    }
+
+    std::string value(value_bytes, 'x');
+    for (size_t i = 0; i < keys; ++i) {
+        db.create_entry<std::string>(key_of(i), value);
+    }
+
+    // warm the sketch; create_entry counted one touch per key already
+    Zipf zipf(keys, skew, 42);
+    for (size_t i = 0; i < keys * 2; ++i) {
+        db.find_entry(key_of(zipf.next()));
+    }
+
+    auto t0 = Clock::now();
+    size_t demoted = db.demote_cold();
+    double demote_ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    auto stats = db.tiering_stats();
+    std::cout << "keys=" << keys << " value_bytes=" << value_bytes << " skew=" << skew << "\n";
+    std::cout << "demoted " << demoted << " values (" << 100.0 * static_cast<double>(demoted) / static_cast<double>(keys)
+              << "%) in " << demote_ms << " ms; RAM saved " << stats.evicted_bytes / (1 << 20) << " MiB of "
+              << keys * value_bytes / (1 << 20) << " MiB, value log " << stats.log.bytes / (1 << 20) << " MiB in "
+              << stats.log.segments << " segments\n";
+
+    // hit latency per tier: one timed lookup per access, classified by where the value was before it
+    std::vector<double> ram_us, disk_us;
+    std::vector<bool> was_cold(keys);
+    db.for_each_entry([&](const std::shared_ptr<EntryBase>& entry) {
+        size_t i = std::strtoull(entry->key.c_str() + 4, nullptr, 10);
+        was_cold[i] = entry->value_evicted;
+    });
+    std::mt19937_64 rng(7);
+    for (size_t n = 0; n < keys; ++n) {
+        size_t i = std::uniform_int_distribution<size_t>(0, keys - 1)(rng);
+        bool cold = was_cold[i];
+        auto start = Clock::now();
+        auto entry = std::static_pointer_cast<Entry<std::string>>(db.find_entry(key_of(i)));
+        volatile char sink = entry->value[0];
+        (void)sink;
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        (cold ? disk_us : ram_us).push_back(us);
+        was_cold[i] = false; // promoted now
+    }
+    std::cout << "GET ram  hits=" << ram_us.size() << " p50=" << percentile(ram_us, 0.5)
+              << "us p99=" << percentile(ram_us, 0.99) << "us\n";
+    std::cout << "GET disk hits=" << disk_us.size() << " p50=" << percentile(disk_us, 0.5)
+              << "us p99=" << percentile(disk_us, 0.99) << "us\n";
+
+    // GC: demote again, then overwrite three quarters of what went to disk
+    db.demote_cold();
+    std::vector<size_t> cold_keys;
+    db.for_each_entry([&](const std::shared_ptr<EntryBase>& entry) {
+        if (entry->value_evicted) {
+            cold_keys.push_back(std::strtoull(entry->key.c_str() + 4, nullptr, 10));
+        }
+    });
+    auto before = db.tiering_stats().log;
+    size_t overwritten = 0;
+    for (size_t n = 0; n < cold_keys.size(); ++n) {
+        if (n % 4 != 0) {
+            db.create_entry<std::string>(key_of(cold_keys[n]), "short");
+            ++overwritten;
+        }
+    }
+    // let the background collector run until it has nothing left over the garbage threshold
+    auto gc_start = Clock::now();
+    auto last_change = gc_start;
+    uint64_t collected = before.collected_segments;
+    while (Clock::now() - last_change < 1s && Clock::now() - gc_start < 30s) {
+        std::this_thread::sleep_for(20ms);
+        if (auto now = db.tiering_stats().log.collected_segments; now != collected) {
+            collected = now;
+            last_change = Clock::now();
+        }
+    }
+    auto after = db.tiering_stats().log;
+    std::cout << "GC: overwrote " << overwritten << " cold values; collected "
+              << after.collected_segments - before.collected_segments << " segments, log "
+              << before.bytes / (1 << 20) << " -> " << after.bytes / (1 << 20) << " MiB, relocated "
+              << (after.relocated_bytes - before.relocated_bytes) / (1 << 20) << " MiB\n";
+    return 0;
+}
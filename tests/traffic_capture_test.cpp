@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../connection.hpp"
+
+/*
+TRAFFIC CAPTURE TESTS
+*/
+
+// a fresh path: start() refuses to open a file that's already there
+static std::string temp_path(const char* name) {
+    std::string path = std::string(::testing::TempDir()) + name;
+    std::remove(path.c_str());
+    return path;
+}
+
+static std::vector<uint8_t> frame(const std::vector<std::string>& args) {
+    return TrafficCapture::encode_frame(args);
+}
+
+TEST(TrafficCaptureTest, RoundTripsEvents) {
+    std::string path = temp_path("capture_roundtrip.bin");
+    TrafficCapture capture;
+    ASSERT_TRUE(capture.start({.path = path}));
+    std::string big(1000, 'x');
+    capture.record(3, frame({"SET", "k", big}), false);
+    capture.record(3, frame({"GET", "k"}), true);
+    capture.record(7, std::vector<std::string>{"DEL", "k"});
+    capture.closed(3);
+    EXPECT_EQ(capture.stats().records, 4u);
+    capture.stop();
+
+    uint64_t start_unix_ns = 0;
+    auto events = TrafficCapture::read(path, &start_unix_ns);
+    ASSERT_TRUE(events);
+    EXPECT_GT(start_unix_ns, 0u);
+    ASSERT_EQ(events->size(), 4u);
+    EXPECT_EQ((*events)[0].kind, TrafficCapture::Request);
+    EXPECT_EQ((*events)[0].frame, frame({"SET", "k", big}));
+    EXPECT_EQ((*events)[1].kind, TrafficCapture::PipelinedRequest);
+    EXPECT_EQ((*events)[2].connection, 7u);
+    EXPECT_EQ((*events)[2].frame, frame({"DEL", "k"}));
+    EXPECT_EQ((*events)[3].kind, TrafficCapture::Close);
+    EXPECT_TRUE((*events)[3].frame.empty());
+    for (size_t i = 1; i < events->size(); ++i) {
+        EXPECT_GE((*events)[i].time_ns, (*events)[i - 1].time_ns);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TrafficCaptureTest, TornTailAndSizeLimit) {
+    std::string path = temp_path("capture_limit.bin");
+    TrafficCapture capture;
+    ASSERT_TRUE(capture.start({.path = path, .max_bytes = 200}));
+    for (int i = 0; i < 20; ++i) {
+        capture.record(1, frame({"GET", "key" + std::to_string(i)}), false);
+    }
+    auto st = capture.stats();
+    EXPECT_GT(st.dropped, 0u);
+    EXPECT_LE(st.bytes, 200u);
+    capture.stop();
+
+    // a server killed mid-write leaves half a record behind
+    ::truncate(path.c_str(), static_cast<off_t>(st.bytes - 3));
+    auto events = TrafficCapture::read(path);
+    ASSERT_TRUE(events);
+    EXPECT_EQ(events->size(), st.records - 1);
+    std::remove(path.c_str());
+}
+
+TEST(TrafficCaptureTest, ConnectionRecordsFramesAndPipelining) {
+    std::string path = temp_path("capture_connection.bin");
+    ASSERT_TRUE(TrafficCapture::instance().start({.path = path}));
+    {
+        EntryManager db;
+        CommandProcessor processor;
+        int fds[2];
+        ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        ::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        Connection conn(Socket(fds[1]), db, processor);
+
+        auto set = frame({"SET", "a", "1"});
+        auto get = frame({"GET", "a"});
+        std::vector<uint8_t> both(set);
+        both.insert(both.end(), get.begin(), get.end());
+        (void)!::write(fds[0], both.data(), both.size());
+        ASSERT_TRUE(conn.process_io());
+        (void)!::write(fds[0], get.data(), get.size());
+        ASSERT_TRUE(conn.process_io());
+        ::close(fds[0]);
+    }
+    TrafficCapture::instance().stop();
+
+    auto events = TrafficCapture::read(path);
+    ASSERT_TRUE(events);
+    ASSERT_EQ(events->size(), 4u);
+    EXPECT_EQ((*events)[0].kind, TrafficCapture::Request);
+    EXPECT_EQ((*events)[0].frame, frame({"SET", "a", "1"}));
+    EXPECT_EQ((*events)[1].kind, TrafficCapture::PipelinedRequest);
+    EXPECT_EQ((*events)[2].kind, TrafficCapture::Request);
+    EXPECT_EQ((*events)[3].kind, TrafficCapture::Close);
+    EXPECT_EQ((*events)[3].connection, (*events)[0].connection);
+    std::remove(path.c_str());
+}
+
+TEST(TrafficCaptureTest, ClientsOnlyNameFilesInTheCaptureDirectory) {
+    TrafficCapture capture;
+    EXPECT_EQ(capture.start_named("capture_named.bin", 1 << 20).error(), std::errc::operation_not_permitted);
+
+    std::string dir = ::testing::TempDir();
+    if (!dir.empty() && dir.back() == '/') dir.pop_back();
+    capture.set_directory(dir);
+    for (const char* name : {"", ".", "..", "../capture_named.bin", "a/b", "/etc/passwd"}) {
+        EXPECT_EQ(capture.start_named(name, 1 << 20).error(), std::errc::invalid_argument) << name;
+    }
+
+    std::string path = temp_path("capture_named.bin");
+    ASSERT_TRUE(capture.start_named("capture_named.bin", 1 << 20));
+    capture.record(1, frame({"PING"}), false);
+    capture.stop();
+    auto events = TrafficCapture::read(path);
+    ASSERT_TRUE(events);
+    EXPECT_EQ(events->size(), 1u);
+
+    // never over an existing file, whoever names it
+    EXPECT_EQ(capture.start_named("capture_named.bin", 1 << 20).error(), std::errc::file_exists);
+    EXPECT_EQ(capture.start({.path = path}).error(), std::errc::file_exists);
+    EXPECT_EQ(TrafficCapture::read(path)->size(), 1u);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,308 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../src/stats/command_stats.hpp"
+#include "../src/stats/traffic_capture.hpp"
+
+/*
+TRAFFIC REPLAY
+
+Re-issues a traffic capture (CAPTURE START, or the server's --capture flag; format in
+src/stats/traffic_capture.hpp) against a running server, over the framed protocol.
+
+Every captured connection gets a connection of its own. It opens at that connection's first request and
+closes where the capture saw it close. Requests go out at their captured times divided by `speed`: 1 is the
+original pace, 10 is ten times faster, 0 is as fast as ordering allows. On each connection, a request the
+client pipelined goes out right behind the one before it. Any other request also waits for the previous
+reply, however late that makes it. So replies a client depended on stay in front of the requests that
+followed them, at any speed.
+
+Reports throughput, errors, and latency percentiles measured from the actual send. It also reports
+percentiles measured from the scheduled send, which add the time a request spent held back behind a slow
+reply (the coordinated-omission view), and how far behind schedule sends fell.
+
+usage: traffic_replay <capture> [--host 127.0.0.1] [--port 1234] [--speed 1] [--json path]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Pending {
+    uint64_t due_ns;
+    uint64_t sent_ns;
+};
+
+struct Conn {
+    int fd = -1;
+    bool dead = false;                  // the server closed it, or connecting failed
+    std::deque<size_t> waiting;         // event indices that are due but not sent yet
+    std::deque<Pending> inflight;
+    std::vector<uint8_t> out;
+    size_t out_sent = 0;
+    std::vector<uint8_t> in;
+};
+
+static uint64_t now_ns(Clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+static int connect_to(const std::string& host, uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+    if (fd >= 0) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc % 2 != 0) {
+        std::cerr << "usage: traffic_replay <capture> [--host 127.0.0.1] [--port 1234] [--speed 1] [--json path]\n";
+        return 2;
+    }
+    std::string path = argv[1], host = "127.0.0.1", json;
+    uint16_t port = 1234;
+    double speed = 1;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--host") {
+            host = argv[i + 1];
+        } else if (flag == "--port") {
+            port = static_cast<uint16_t>(std::atoi(argv[i + 1]));
+        } else if (flag == "--speed") {
+            speed = std::atof(argv[i + 1]);
+        } else if (flag == "--json") {
+            json = argv[i + 1];
+        } else {
+            std::cerr << "unknown option " << flag << "\n";
+            return 2;
+        }
+    }
+
+    auto events = TrafficCapture::read(path);
+    if (!events) {
+        std::cerr << "can't read " << path << ": " << events.error().message() << "\n";
+        return 1;
+    }
+    uint64_t requests = 0;
+    std::unordered_map<uint32_t, Conn> conns;
+    for (const auto& e : *events) {
+        requests += e.kind != TrafficCapture::Close;
+        conns.try_emplace(e.connection);
+    }
+    uint64_t captured_ns = events->empty() ? 0 : events->back().time_ns;
+    auto due = [&](size_t i) -> uint64_t {
+        return speed > 0 ? static_cast<uint64_t>(static_cast<double>((*events)[i].time_ns) / speed) : 0;
+    };
+    std::cout << path << ": " << requests << " requests on " << conns.size() << " connections over " << std::fixed
+              << std::setprecision(2) << static_cast<double>(captured_ns) / 1e9 << "s, replaying at ";
+    if (speed > 0) {
+        std::cout << std::defaultfloat << speed << "x" << std::fixed;
+    } else {
+        std::cout << "full speed";
+    }
+    std::cout << " against " << host << ":" << port << std::endl;
+
+    int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    LatencyHistogram from_send, from_schedule;
+    uint64_t completed = 0, errors = 0, lost = 0, max_lag = 0;
+    size_t next = 0;
+    auto start = Clock::now();
+    uint64_t last_progress = 0;
+
+    auto drop = [&](Conn& conn) {
+        lost += conn.inflight.size();
+        for (size_t i : conn.waiting) lost += (*events)[i].kind != TrafficCapture::Close;
+        conn.inflight.clear();
+        conn.waiting.clear();
+        if (conn.fd >= 0) ::close(conn.fd);
+        conn.fd = -1;
+        conn.dead = true;
+    };
+
+    std::vector<epoll_event> ready(64);
+    while (true) {
+        uint64_t now = now_ns(start);
+        for (; next < events->size() && due(next) <= now; ++next) {
+            Conn& conn = conns[(*events)[next].connection];
+            if (conn.dead) {
+                lost += (*events)[next].kind != TrafficCapture::Close;
+                continue;
+            }
+            if (conn.fd < 0 && (*events)[next].kind != TrafficCapture::Close) {
+                conn.fd = connect_to(host, port);
+                if (conn.fd < 0) {
+                    std::cerr << "connect to " << host << ":" << port << " failed: " << std::strerror(errno) << "\n";
+                    drop(conn);
+                    ++lost;
+                    continue;
+                }
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.u32 = (*events)[next].connection;
+                ::epoll_ctl(ep, EPOLL_CTL_ADD, conn.fd, &ev);
+            }
+            conn.waiting.push_back(next);
+            last_progress = now;
+        }
+
+        // send what ordering allows, and flush
+        bool busy = next < events->size();
+        bool unsent = false;
+        for (auto& [id, conn] : conns) {
+            while (!conn.waiting.empty()) {
+                const auto& e = (*events)[conn.waiting.front()];
+                if (e.kind == TrafficCapture::Close) {
+                    if (!conn.inflight.empty()) break;
+                    if (conn.fd >= 0) ::close(conn.fd);
+                    conn.fd = -1;
+                    conn.waiting.pop_front();
+                    continue;
+                }
+                if (e.kind == TrafficCapture::Request && !conn.inflight.empty()) break;
+                uint64_t scheduled = due(conn.waiting.front());
+                conn.out.insert(conn.out.end(), e.frame.begin(), e.frame.end());
+                conn.inflight.push_back({scheduled, now});
+                max_lag = std::max(max_lag, now - std::min(now, scheduled));
+                conn.waiting.pop_front();
+            }
+            while (conn.fd >= 0 && conn.out_sent < conn.out.size()) {
+                ssize_t n = ::send(conn.fd, conn.out.data() + conn.out_sent, conn.out.size() - conn.out_sent, MSG_NOSIGNAL);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (n < 0) {
+                    drop(conn);
+                    break;
+                }
+                conn.out_sent += static_cast<size_t>(n);
+            }
+            if (conn.out_sent == conn.out.size()) {
+                conn.out.clear();
+                conn.out_sent = 0;
+            } else {
+                unsent = true;
+            }
+            busy = busy || !conn.waiting.empty() || !conn.inflight.empty();
+        }
+        if (!busy) break;
+        if (next == events->size() && now - last_progress > 10'000'000'000ull) {
+            std::cerr << "no reply for 10s, giving up\n";
+            for (auto& [id, conn] : conns) drop(conn);
+            break;
+        }
+
+        int timeout = 10;
+        if (unsent) {
+            timeout = 0;
+        } else if (next < events->size()) {
+            uint64_t t = now_ns(start);
+            uint64_t wait_ns = due(next) > t ? due(next) - t : 0;
+            timeout = wait_ns < 1'000'000 ? 0 : static_cast<int>(std::min<uint64_t>(wait_ns / 1'000'000, 10));
+        }
+        int n = ::epoll_wait(ep, ready.data(), static_cast<int>(ready.size()), timeout);
+        for (int r = 0; r < n; ++r) {
+            Conn& conn = conns[ready[r].data.u32];
+            if (conn.fd < 0) continue;
+            char buffer[16384];
+            bool closed = false;
+            while (true) {
+                ssize_t got = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+                if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (got <= 0) {
+                    closed = true;
+                    break;
+                }
+                conn.in.insert(conn.in.end(), buffer, buffer + got);
+            }
+            uint64_t t = now_ns(start);
+            size_t pos = 0;
+            while (conn.in.size() - pos >= 4 && !conn.inflight.empty()) {
+                uint32_t len;
+                std::memcpy(&len, conn.in.data() + pos, 4);
+                if (conn.in.size() - pos - 4 < len) break;
+                Pending p = conn.inflight.front();
+                conn.inflight.pop_front();
+                errors += len > 0 && conn.in[pos + 4] == 1;     // SerializationType::Error
+                from_send.record(t - p.sent_ns);
+                from_schedule.record(t - std::min(t, p.due_ns));
+                ++completed;
+                last_progress = t;
+                pos += 4 + len;
+            }
+            conn.in.erase(conn.in.begin(), conn.in.begin() + static_cast<ptrdiff_t>(pos));
+            if (closed) drop(conn);
+        }
+    }
+    double elapsed = static_cast<double>(now_ns(start)) / 1e9;
+    ::close(ep);
+    for (auto& [id, conn] : conns) {
+        if (conn.fd >= 0) ::close(conn.fd);
+    }
+
+    LatencyHistogram::Snapshot sent, scheduled;
+    sent.add(from_send);
+    scheduled.add(from_schedule);
+    static constexpr double k_quantiles[] = {0.5, 0.9, 0.99, 0.999, 0.9999};
+    static constexpr std::string_view k_labels[] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+    auto line = [&](std::string_view name, const LatencyHistogram::Snapshot& h) {
+        std::cout << std::left << std::setw(16) << name << std::right << std::setprecision(1);
+        for (size_t q = 0; q < std::size(k_quantiles); ++q) {
+            std::cout << " " << k_labels[q] << "=" << static_cast<double>(h.quantile(k_quantiles[q])) / 1000.0;
+        }
+        std::cout << " max=" << static_cast<double>(h.max) / 1000.0 << "\n";
+    };
+    std::cout << "replies " << completed << "  errors " << errors << "  lost " << lost << "  in " << std::setprecision(2)
+              << elapsed << "s  " << std::setprecision(1) << static_cast<double>(completed) / elapsed
+              << " req/s";
+    if (speed > 0) std::cout << "  max send lag " << static_cast<double>(max_lag) / 1000.0 << "us";
+    std::cout << "\nlatency (us):\n";
+    line("  from send", sent);
+    if (speed > 0) line("  from schedule", scheduled);
+
+    if (!json.empty()) {
+        std::ofstream out(json);
+        out << std::fixed << std::setprecision(1) << "{\"capture\":\"" << path << "\",\"speed\":" << speed
+            << ",\"requests\":" << requests << ",\"replies\":" << completed << ",\"errors\":" << errors
+            << ",\"lost\":" << lost << ",\"elapsed_s\":" << std::setprecision(3) << elapsed << std::setprecision(1) << ",\"max_send_lag_us\":"
+            << static_cast<double>(max_lag) / 1000.0;
+        auto hist = [&](std::string_view name, const LatencyHistogram::Snapshot& h) {
+            out << ",\"" << name << "\":{";
+            for (size_t q = 0; q < std::size(k_quantiles); ++q) {
+                out << "\"" << k_labels[q] << "_us\":" << static_cast<double>(h.quantile(k_quantiles[q])) / 1000.0 << ",";
+            }
+            out << "\"max_us\":" << static_cast<double>(h.max) / 1000.0 << "}";
+        };
+        hist("latency", sent);
+        hist("latency_from_schedule", scheduled);
+        out << "}\n";
+    }
+    return lost == 0 ? 0 : 1;
+}
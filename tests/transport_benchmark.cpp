@@ -0,0 +1,293 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../server.hpp"
+#include "../src/transport/shm_client.hpp"
+
+/*
+TRANSPORT BENCHMARK
+
+The same GET traffic over each way a local client can reach the server:
+
+    tcp             framed requests over loopback TCP
+    unix            the same frames over the Unix domain socket (--unix)
+    shm             SHM on the Unix socket, then the shared-memory rings (src/transport/shm_ring.hpp)
+    shm busy-poll   shm, with server and client spinning `busy_us` on an empty ring before sleeping
+
+Two phases per transport, against a fresh server in a forked child (1 worker thread, output to /dev/null)
+holding `keys` 100-byte values:
+
+    round trip      one GET at a time: latency p50 / p99 in us
+    pipelined       `window` GETs in flight: throughput
+
+"client sys/req" is the client's syscalls per request in the pipelined phase: writes and reads for the
+sockets, doorbells and sleeps for shm. "server cpu us/req" is the server process's user+system time per
+request over both phases, from /proc. Both sides yield between checks of an empty ring, so busy polling
+works on a single core too; with a core each, the spinning shows up as server cpu instead.
+
+usage: transport_benchmark [ops=100000] [window=32] [busy_us=50] [port=7394] [path=/tmp/vectordb_bench.sock]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+static pid_t fork_server(uint16_t port, const std::string& path, uint32_t busy_us) {
+    pid_t child = ::fork();
+    if (child == 0) {
+        int null = ::open("/dev/null", O_WRONLY);
+        ::dup2(null, STDOUT_FILENO);
+        ::dup2(null, STDERR_FILENO);
+        ShmChannel::busy_poll_us.store(busy_us);
+        Server server(port, 1);
+        if (!server.initialize() || !server.listen_unix(path)) _exit(1);
+        server.run();
+        _exit(0);
+    }
+    return child;
+}
+
+// utime + stime of `pid`, in us
+static double cpu_us(pid_t pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    std::istringstream fields(line.substr(line.rfind(')') + 2));
+    std::string skip;
+    for (int i = 3; i < 14; ++i) fields >> skip;
+    double utime = 0, stime = 0;
+    fields >> utime >> stime;
+    return (utime + stime) * 1e6 / static_cast<double>(::sysconf(_SC_CLK_TCK));
+}
+
+// blocking framed client over a TCP or Unix socket; send() buffers, flush() writes
+class SocketClient {
+public:
+    explicit SocketClient(int fd) : fd_(fd), in_(1 << 16) {}
+    ~SocketClient() { ::close(fd_); }
+
+    static std::unique_ptr<SocketClient> dial(int family, uint16_t port, const std::string& path) {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            int fd = ::socket(family, SOCK_STREAM, 0);
+            int rc;
+            if (family == AF_INET) {
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(port);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            } else {
+                sockaddr_un addr{};
+                addr.sun_family = AF_UNIX;
+                std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+                rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            }
+            if (rc == 0) return std::make_unique<SocketClient>(fd);
+            ::close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return nullptr;
+    }
+
+    bool send(std::initializer_list<ClientArg> args) {
+        size_t payload = 0;
+        for (const auto& a : args) payload += 4 + a.bytes().size();
+        put_be32(static_cast<uint32_t>(payload));
+        for (const auto& a : args) {
+            put_be32(static_cast<uint32_t>(a.bytes().size()));
+            out_.insert(out_.end(), a.bytes().begin(), a.bytes().end());
+        }
+        return true;
+    }
+
+    bool flush() {
+        for (size_t done = 0; done < out_.size();) {
+            ssize_t n = ::write(fd_, out_.data() + done, out_.size() - done);
+            ++syscalls_;
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        out_.clear();
+        return true;
+    }
+
+    Result<Reply> receive() {
+        while (true) {
+            uint32_t len;
+            if (have_ - start_ >= 4) {
+                std::memcpy(&len, in_.data() + start_, 4);
+                if (have_ - start_ - 4 >= len) {
+                    auto reply = Reply::parse(std::span(in_).subspan(start_ + 4, len));
+                    start_ += 4 + len;
+                    return reply;
+                }
+            }
+            std::memmove(in_.data(), in_.data() + start_, have_ - start_);
+            have_ -= start_;
+            start_ = 0;
+            ssize_t n = ::read(fd_, in_.data() + have_, in_.size() - have_);
+            ++syscalls_;
+            if (n <= 0) return std::unexpected(std::make_error_code(std::errc::connection_reset));
+            have_ += static_cast<size_t>(n);
+        }
+    }
+
+    [[nodiscard]] uint64_t syscalls() const { return syscalls_; }
+
+private:
+    int fd_;
+    std::vector<uint8_t> out_;
+    std::vector<uint8_t> in_;
+    size_t start_ = 0, have_ = 0;
+    uint64_t syscalls_ = 0;
+
+    void put_be32(uint32_t v) {
+        uint32_t be = htonl(v);
+        auto* p = reinterpret_cast<const uint8_t*>(&be);
+        out_.insert(out_.end(), p, p + 4);
+    }
+};
+
+// ShmClient with the same face; the rings need no flush
+struct ShmAdapter {
+    std::unique_ptr<ShmClient> client;
+    bool send(std::initializer_list<ClientArg> args) { return client->send(args).has_value(); }
+    bool flush() { return true; }
+    Result<Reply> receive() { return client->receive(); }
+    uint64_t syscalls() const { return client->stats().doorbells + client->stats().sleeps; }
+};
+
+struct Row {
+    std::string name;
+    LatencyHistogram::Snapshot round_trip;
+    double pipelined_ops = 0;
+    double client_syscalls = 0;
+    double server_cpu_us = 0;
+    bool ok = true;
+};
+
+template<typename Client>
+static void measure(Row& row, Client& client, uint64_t ops, size_t window, size_t keys, pid_t server) {
+    std::string value(100, 'v');
+    std::vector<std::string> names;
+    for (size_t k = 0; k < keys; ++k) names.push_back("key:" + std::to_string(k));
+    for (size_t k = 0; k < keys && row.ok; ++k) {
+        row.ok = client.send({"SET", names[k], value}) && client.flush() && client.receive().has_value();
+    }
+    double cpu_start = cpu_us(server);
+
+    LatencyHistogram h;
+    for (uint64_t i = 0; i < ops && row.ok; ++i) {
+        uint64_t t = now_ns();
+        row.ok = client.send({"GET", names[i % keys]}) && client.flush();
+        auto reply = client.receive();
+        row.ok = row.ok && reply && reply->str.size() == value.size();
+        h.record(now_ns() - t);
+    }
+    row.round_trip.add(h);
+
+    uint64_t syscalls_start = client.syscalls();
+    auto start = Clock::now();
+    uint64_t sent = 0, done = 0;
+    while (row.ok && done < ops) {
+        while (sent < ops && sent - done < window) {
+            row.ok = row.ok && client.send({"GET", names[sent % keys]});
+            ++sent;
+        }
+        row.ok = row.ok && client.flush();
+        // half the window back before topping it up, so sends go out in batches
+        for (uint64_t target = std::min(sent, done + std::max<size_t>(1, window / 2)); row.ok && done < target; ++done) {
+            auto reply = client.receive();
+            row.ok = reply && reply->str.size() == value.size();
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    row.pipelined_ops = static_cast<double>(ops) / seconds;
+    row.client_syscalls = static_cast<double>(client.syscalls() - syscalls_start) / static_cast<double>(ops);
+    row.server_cpu_us = (cpu_us(server) - cpu_start) / static_cast<double>(2 * ops);
+}
+
+static Row run(const std::string& name, uint16_t port, const std::string& path, uint32_t busy_us,
+               uint64_t ops, size_t window, size_t keys) {
+    Row row;
+    row.name = name;
+    pid_t child = fork_server(port, path, name.starts_with("shm") ? busy_us : 0);
+    if (name == "tcp" || name == "unix") {
+        auto client = SocketClient::dial(name == "tcp" ? AF_INET : AF_UNIX, port, path);
+        row.ok = client != nullptr;
+        if (row.ok) measure(row, *client, ops, window, keys, child);
+    } else {
+        ShmAdapter client;
+        for (int attempt = 0; attempt < 100 && !client.client; ++attempt) {
+            auto c = ShmClient::connect({.path = path, .busy_poll_us = busy_us});
+            if (c) {
+                client.client = std::move(*c);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+        row.ok = client.client != nullptr;
+        if (row.ok) measure(row, client, ops, window, keys, child);
+    }
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+    ::unlink(path.c_str());
+    return row;
+}
+
+int main(int argc, char** argv) {
+    uint64_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t window = std::max<size_t>(1, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 32);
+    uint32_t busy_us = static_cast<uint32_t>(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 50);
+    uint16_t port = static_cast<uint16_t>(argc > 4 ? std::atoi(argv[4]) : 7394);
+    std::string path = argc > 5 ? argv[5] : "/tmp/vectordb_bench.sock";
+    size_t keys = 1000;
+
+    std::vector<Row> rows;
+    rows.push_back(run("tcp", port, path, 0, ops, window, keys));
+    rows.push_back(run("unix", static_cast<uint16_t>(port + 1), path, 0, ops, window, keys));
+    rows.push_back(run("shm", static_cast<uint16_t>(port + 2), path, 0, ops, window, keys));
+    rows.push_back(run("shm busy-poll", static_cast<uint16_t>(port + 3), path, busy_us, ops, window, keys));
+
+    std::cout << "ops=" << ops << " window=" << window << " busy_us=" << busy_us << " cores="
+              << std::thread::hardware_concurrency() << "\n"
+              << std::left << std::setw(15) << "transport" << std::right << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us" << std::setw(14) << "pipelined/s" << std::setw(16) << "client sys/req"
+              << std::setw(20) << "server cpu us/req" << "\n";
+    int code = 0;
+    for (const auto& row : rows) {
+        if (!row.ok) {
+            std::cout << std::left << std::setw(15) << row.name << " failed\n";
+            code = 1;
+            continue;
+        }
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        std::cout << std::left << std::setw(15) << row.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << us(row.round_trip.quantile(0.5)) << std::setw(10)
+                  << us(row.round_trip.quantile(0.99)) << std::setprecision(0) << std::setw(14) << row.pipelined_ops
+                  << std::setprecision(2) << std::setw(16) << row.client_syscalls << std::setw(20)
+                  << row.server_cpu_us << "\n";
+    }
+    return code;
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../snapshot_serializer.hpp"
+
+/*
+VALUE LOG / TIERED STORAGE TESTS
+*/
+
+using namespace std::chrono_literals;
+
+static std::string temp_dir(const char* name) {
+    auto dir = std::filesystem::temp_directory_path() / (std::string("vlog_test_") + name);
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+static std::string resident(EntryManager& db, const std::string& key) {
+    auto entry = std::dynamic_pointer_cast<Entry<std::string>>(db.find_entry(key));
+    return entry ? entry->value : "(nil)";
+}
+
+TEST(ValueLogTest, AppendReadAndDetectCorruption) {
+    auto dir = temp_dir("append");
+    auto log = ValueLog::open({dir});
+    ASSERT_TRUE(log.has_value());
+
+    auto a = (*log)->append("alpha", std::string(1000, 'a'));
+    auto b = (*log)->append("beta", "second");
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(b->offset, a->record_len);
+
+    std::string out;
+    ASSERT_TRUE((*log)->read(*a, out));
+    EXPECT_EQ(out, std::string(1000, 'a'));
+    ASSERT_TRUE((*log)->read(*b, out));
+    EXPECT_EQ(out, "second");
+
+    // flip one byte of beta's value on disk
+    {
+        std::fstream f(std::filesystem::path(dir) / "1.vlog", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(static_cast<std::streamoff>(b->offset + b->record_len - 1));
+        f.put('X');
+    }
+    EXPECT_FALSE((*log)->read(*b, out));
+    EXPECT_TRUE((*log)->read(*a, out));
+}
+
+TEST(ValueLogTest, DemoteAndPromoteKeepsValueAndTtl) {
+    EntryManager db;
+    ASSERT_TRUE(db.enable_tiering({.dir = temp_dir("demote"), .min_value_bytes = 64, .hot_threshold = 3}));
+
+    std::string big(4096, 'v');
+    db.create_entry<std::string>("cold", big);
+    db.create_entry<std::string>("small", "tiny");
+    db.set_entry_ttl(*db.find_entry("cold"), 60000); // two touches: create + find, still under the threshold
+    for (int i = 0; i < 5; ++i) {
+        db.create_entry<std::string>("hot", big); // keeps its sketch count up
+    }
+
+    EXPECT_EQ(db.demote_cold(), 1u);
+    auto stats = db.tiering_stats();
+    EXPECT_EQ(stats.evicted_values, 1u);
+    EXPECT_EQ(stats.evicted_bytes, big.size());
+
+    // the key and its expiry never left memory
+    auto cold = db.find_entry("cold");
+    ASSERT_NE(cold, nullptr);
+    EXPECT_GT(db.get_expiry_time(*cold), 0);
+
+    EXPECT_EQ(resident(db, "cold"), big);
+    EXPECT_EQ(resident(db, "small"), "tiny");
+    stats = db.tiering_stats();
+    EXPECT_EQ(stats.evicted_values, 0u);
+    EXPECT_EQ(stats.promoted, 1u);
+}
+
+TEST(ValueLogTest, SnapshotIncludesDemotedValues) {
+    EntryManager db;
+    ASSERT_TRUE(db.enable_tiering({.dir = temp_dir("snapshot"), .min_value_bytes = 16}));
+    for (int i = 0; i < 100; ++i) {
+        db.create_entry<std::string>("k" + std::to_string(i), std::string(100, static_cast<char>('a' + i % 26)));
+    }
+    ASSERT_EQ(db.demote_cold(), 100u);
+
+    std::vector<uint8_t> image;
+    ASSERT_TRUE(SnapshotSerializer::write(db, [&](std::span<const uint8_t> chunk) -> Result<void> {
+        image.insert(image.end(), chunk.begin(), chunk.end());
+        return {};
+    }));
+
+    EntryManager restored;
+    ASSERT_TRUE(SnapshotSerializer::load(restored, image));
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(resident(restored, "k" + std::to_string(i)), std::string(100, static_cast<char>('a' + i % 26)));
+    }
+}
+
+TEST(ValueLogTest, GcRelocatesLiveValuesAndDropsSegments) {
+    EntryManager db;
+    auto dir = temp_dir("gc");
+    ASSERT_TRUE(db.enable_tiering({.dir = dir, .min_value_bytes = 16, .segment_bytes = 16 << 10,
+                                   .gc_garbage_ratio = 0.5, .gc_interval = 10ms}));
+
+    // 256 x ~1KiB values spread over ~16 segments, then overwrite three quarters of them
+    for (int i = 0; i < 256; ++i) {
+        db.create_entry<std::string>("k" + std::to_string(i), std::string(1000, 'a'));
+    }
+    ASSERT_EQ(db.demote_cold(), 256u);
+    auto before = db.tiering_stats().log;
+    for (int i = 0; i < 256; ++i) {
+        if (i % 4 != 0) {
+            db.create_entry<std::string>("k" + std::to_string(i), "new");
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (db.tiering_stats().log.collected_segments == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(10ms);
+    }
+    auto after = db.tiering_stats().log;
+    EXPECT_GT(after.collected_segments, 0u);
+    EXPECT_GT(after.relocated_bytes, 0u);
+    EXPECT_LT(after.bytes, before.bytes);
+
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(resident(db, "k" + std::to_string(i)), i % 4 == 0 ? std::string(1000, 'a') : "new");
+    }
+}
+
+// the background pass demotes while readers hold and read values: a reader's entry never changes under it
+TEST(ValueLogTest, BackgroundDemotionUnderConcurrentReads) {
+    EntryManager db;
+    ASSERT_TRUE(db.enable_tiering({.dir = temp_dir("background"), .min_value_bytes = 16,
+                                   .demote_interval = 1ms}));
+    auto value = [](int i) { return std::string(200, static_cast<char>('a' + i % 26)); };
+    for (int i = 0; i < 200; ++i) {
+        db.create_entry<std::string>("k" + std::to_string(i), value(i));
+    }
+    db.set_entry_ttl(*db.find_entry("k7"), 60000);
+
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (db.tiering_stats().demoted == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_GT(db.tiering_stats().demoted, 0u);
+
+    std::vector<std::thread> readers;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t] {
+            for (int round = 0; round < 2000; ++round) {
+                int i = (round * 7 + t) % 200;
+                if (resident(db, "k" + std::to_string(i)) != value(i)) ++mismatches;
+            }
+        });
+    }
+    for (auto& r : readers) r.join();
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_GT(db.tiering_stats().promoted, 0u);
+
+    // a TTL goes with the entry when it is swapped for its demoted or promoted copy
+    auto k7 = db.find_entry("k7");
+    ASSERT_NE(k7, nullptr);
+    EXPECT_GT(db.get_expiry_time(*k7), 0);
+}
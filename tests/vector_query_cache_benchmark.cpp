@@ -0,0 +1,160 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "../src/cache/vector_query_cache.hpp"
+
+/*
+VECTOR QUERY CACHE BENCHMARK
+
+Brute-force top-k L2 search over `vectors` x `dim` floats stands in for the index. Queries come from a pool
+of `pool` distinct embeddings with Zipf(`skew`) popularity, the repetition pattern of upstream models that
+cache their own outputs. Between queries, each op is a delete with probability deletes/1000 (the cache drops
+results containing that label) or an insert with probability inserts/1000 (generation bump). Reports QPS
+uncached vs cached, hit rate, search time saved, invalidations, and the memory the cache held.
+
+usage: vector_query_cache_benchmark [vectors=20000] [dim=128] [pool=10000] [ops=20000] [skew=1.0]
+                                    [cache_mib=16] [deletes=1] [inserts=0]
+*/
+
+using Clock = std::chrono::steady_clock;
+using Hits = VectorQueryCache::Hits;
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s, uint64_t seed) : cdf_(n), rng_(seed) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    size_t next() {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+        return static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+};
+
+struct Index {
+    size_t dim;
+    std::vector<float> vectors;
+    std::vector<bool> deleted;
+
+    Hits search(const float* q, size_t k) const {
+        Hits best; // max-heap on distance
+        size_t n = vectors.size() / dim;
+        for (size_t i = 0; i < n; ++i) {
+            if (deleted[i]) continue;
+            const float* v = &vectors[i * dim];
+            // 8 independent sums so the compiler can vectorise without -ffast-math
+            float part[8] = {};
+            size_t j = 0;
+            for (; j + 8 <= dim; j += 8) {
+                for (size_t l = 0; l < 8; ++l) {
+                    float diff = v[j + l] - q[j + l];
+                    part[l] += diff * diff;
+                }
+            }
+            float d = 0;
+            for (; j < dim; ++j) {
+                float diff = v[j] - q[j];
+                d += diff * diff;
+            }
+            for (float p : part) d += p;
+            if (best.size() < k) {
+                best.emplace_back(d, i);
+                std::push_heap(best.begin(), best.end());
+            } else if (d < best.front().first) {
+                std::pop_heap(best.begin(), best.end());
+                best.back() = {d, i};
+                std::push_heap(best.begin(), best.end());
+            }
+        }
+        std::sort_heap(best.begin(), best.end());
+        return best;
+    }
+};
+
+int main(int argc, char** argv) {
+    size_t vectors = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    size_t dim = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 128;
+    size_t pool = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000;
+    size_t ops = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 20000;
+    double skew = argc > 5 ? std::strtod(argv[5], nullptr) : 1.0;
+    size_t cache_mib = argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 16;
+    double deletes = argc > 7 ? std::strtod(argv[7], nullptr) / 1000.0 : 0.001;
+    double inserts = argc > 8 ? std::strtod(argv[8], nullptr) / 1000.0 : 0.0;
+    const uint32_t k = 10;
+
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    Index index{dim, std::vector<float>(vectors * dim), std::vector<bool>(vectors, false)};
+    for (auto& v : index.vectors) v = unit(rng);
+    std::vector<std::vector<float>> queries(pool, std::vector<float>(dim));
+    for (auto& q : queries) for (auto& v : q) v = unit(rng);
+
+    // the same op sequence for both runs
+    Zipf zipf(pool, skew, 2);
+    std::vector<size_t> sequence(ops);
+    for (auto& s : sequence) s = zipf.next();
+    std::vector<int> writes(ops);          // 0 none, 1 delete, 2 insert
+    std::vector<size_t> victims(ops);
+    std::uniform_real_distribution<double> coin(0, 1);
+    for (size_t i = 0; i < ops; ++i) {
+        double c = coin(rng);
+        writes[i] = c < deletes ? 1 : c < deletes + inserts ? 2 : 0;
+        victims[i] = rng() % vectors;
+    }
+
+    std::cout << "vectors=" << vectors << " dim=" << dim << " pool=" << pool << " ops=" << ops << " skew=" << skew
+              << " cache=" << cache_mib << "MiB deletes=" << deletes * 1000 << "/1000 inserts=" << inserts * 1000
+              << "/1000\n";
+
+    auto run = [&](VectorQueryCache* cache) {
+        Index idx = index;
+        uint64_t checksum = 0;
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            if (writes[i] == 1 && !idx.deleted[victims[i]]) {
+                idx.deleted[victims[i]] = true;
+                if (cache) cache->on_delete(victims[i]);
+            } else if (writes[i] == 2) {
+                // stand-in for an insert: revive a vector, which can enter any result
+                idx.deleted[victims[i]] = false;
+                if (cache) cache->on_insert();
+            }
+            const auto& q = queries[sequence[i]];
+            Hits hits = cache ? cache->get_or_compute({q, k, 0, 0}, [&] { return idx.search(q.data(), k); })
+                              : idx.search(q.data(), k);
+            checksum += hits.empty() ? 0 : hits.front().second;
+        }
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        return std::pair(static_cast<double>(ops) / s, checksum);
+    };
+
+    auto [base_qps, base_sum] = run(nullptr);
+    VectorQueryCache cache({.max_bytes = cache_mib << 20});
+    auto [cached_qps, cached_sum] = run(&cache);
+    auto st = cache.stats();
+
+    std::cout << std::fixed << std::setprecision(0) << "uncached  " << base_qps << " QPS\n"
+              << "cached    " << cached_qps << " QPS  (" << std::setprecision(1) << cached_qps / base_qps << "x)\n"
+              << "hit rate " << 100.0 * st.hit_rate() << "%  saved " << static_cast<double>(st.saved_ns) / 1e9
+              << " s of search  admitted " << st.admitted << " rejected " << st.rejected << " evicted " << st.evicted
+              << " invalidated " << st.invalidated << "\n"
+              << "cache held " << st.entries << " results in " << st.bytes / 1024 << " KiB"
+              << (base_sum == cached_sum ? "" : "   RESULTS DIFFER") << "\n";
+    return base_sum == cached_sum ? 0 : 1;
+}
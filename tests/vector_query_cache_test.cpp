@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../src/cache/vector_query_cache.hpp"
+
+/*
+VECTOR QUERY CACHE TESTS
+*/
+
+using Hits = VectorQueryCache::Hits;
+
+static VectorQueryCache::Query query(const std::vector<float>& v, uint32_t k = 3, uint32_t ef = 64, uint64_t filter = 0) {
+    return {v, k, ef, filter};
+}
+
+TEST(VectorQueryCacheTest, HitsOnlyOnTheExactQuery) {
+    VectorQueryCache cache;
+    std::vector<float> q{1.0f, 2.0f, 3.0f};
+    Hits hits{{0.1f, 7}, {0.2f, 8}, {0.3f, 9}};
+
+    EXPECT_FALSE(cache.lookup(query(q)));
+    ASSERT_TRUE(cache.insert(query(q), hits, std::chrono::microseconds(100), cache.ticket()));
+    auto cached = cache.lookup(query(q));
+    ASSERT_TRUE(cached);
+    EXPECT_EQ(*cached, hits);
+
+    // any part of the key changing is a different query
+    std::vector<float> nudged{1.0f, 2.0f, 3.0001f};
+    EXPECT_FALSE(cache.lookup(query(nudged)));
+    EXPECT_FALSE(cache.lookup(query(q, 4)));
+    EXPECT_FALSE(cache.lookup(query(q, 3, 128)));
+    EXPECT_FALSE(cache.lookup(query(q, 3, 64, 42)));
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 5u);
+    EXPECT_EQ(stats.saved_ns, 100000u);
+}
+
+TEST(VectorQueryCacheTest, DeletesDropOnlyResultsContainingTheLabel) {
+    VectorQueryCache cache;
+    std::vector<float> a{1.0f}, b{2.0f};
+    ASSERT_TRUE(cache.insert(query(a), {{0.1f, 1}, {0.2f, 2}}, std::chrono::microseconds(1), cache.ticket()));
+    ASSERT_TRUE(cache.insert(query(b), {{0.1f, 3}, {0.2f, 4}}, std::chrono::microseconds(1), cache.ticket()));
+
+    cache.on_delete(2);
+    EXPECT_FALSE(cache.lookup(query(a)));
+    EXPECT_TRUE(cache.lookup(query(b)));
+    EXPECT_EQ(cache.stats().invalidated, 1u);
+}
+
+TEST(VectorQueryCacheTest, InsertsBumpTheGeneration) {
+    VectorQueryCache cache;
+    std::vector<float> a{1.0f};
+    ASSERT_TRUE(cache.insert(query(a), {{0.1f, 1}}, std::chrono::microseconds(1), cache.ticket()));
+    cache.on_insert();
+    EXPECT_FALSE(cache.lookup(query(a)));
+
+    VectorQueryCache tolerant({.inserts_invalidate = false});
+    ASSERT_TRUE(tolerant.insert(query(a), {{0.1f, 1}}, std::chrono::microseconds(1), tolerant.ticket()));
+    tolerant.on_insert();
+    EXPECT_TRUE(tolerant.lookup(query(a)));
+}
+
+TEST(VectorQueryCacheTest, ResultsComputedAcrossAWriteAreNotCached) {
+    VectorQueryCache cache;
+    std::vector<float> a{1.0f};
+    auto before = cache.ticket();
+    cache.on_delete(99);
+    EXPECT_FALSE(cache.insert(query(a), {{0.1f, 1}}, std::chrono::microseconds(1), before));
+
+    int searches = 0;
+    auto search = [&] { ++searches; return Hits{{0.5f, 5}}; };
+    cache.get_or_compute(query(a), search);
+    cache.get_or_compute(query(a), search);
+    EXPECT_EQ(searches, 1);
+}
+
+TEST(VectorQueryCacheTest, TinyLfuProtectsFrequentQueriesWhenFull) {
+    // one shard, room for a handful of entries
+    VectorQueryCache cache({.max_bytes = 2048, .shards = 1});
+    std::vector<std::vector<float>> hot;
+    for (int i = 0; i < 4; ++i) {
+        hot.push_back(std::vector<float>(8, static_cast<float>(i)));
+        for (int n = 0; n < 5; ++n) cache.lookup(query(hot.back()));
+        cache.insert(query(hot.back()), {{0.0f, static_cast<size_t>(i)}}, std::chrono::microseconds(1), cache.ticket());
+    }
+    size_t resident = cache.stats().entries;
+    ASSERT_GT(resident, 0u);
+    EXPECT_LE(cache.stats().bytes, 2048u);
+
+    // a stream of one-off queries: each is looked up once, then offered
+    for (int i = 0; i < 100; ++i) {
+        std::vector<float> once(8, 1000.0f + static_cast<float>(i));
+        cache.lookup(query(once));
+        cache.insert(query(once), {{0.0f, 1000u + static_cast<size_t>(i)}}, std::chrono::microseconds(1), cache.ticket());
+    }
+    size_t still_hot = 0;
+    for (const auto& q : hot) still_hot += cache.lookup(query(q)).has_value();
+    EXPECT_EQ(still_hot, resident);
+    EXPECT_GT(cache.stats().rejected, 0u);
+}
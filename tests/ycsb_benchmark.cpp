@@ -0,0 +1,291 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <memory>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "../command_processor.hpp"
+
+/*
+YCSB BENCHMARK
+
+Runs the YCSB core workloads straight through CommandProcessor::process_command on one in-process
+EntryManager, with no sockets or parsing in the way, so storage engine changes can be measured on their own.
+`records` keys ("user<n>", one `value_size`-byte value each) are loaded once. Then each workload in
+`workloads` runs in order on the same data: `threads` threads for `warmup` seconds unrecorded, then for
+`seconds` seconds measured.
+
+    a  update heavy     50% read, 50% update
+    b  read mostly      95% read, 5% update
+    c  read only        100% read
+    d  read latest      95% read, 5% insert; reads favour the newest keys
+    e  short ranges     95% scan, 5% insert
+    f  read-mod-write   50% read, 50% read-modify-write (GET then SET)
+    v  vector mix       80% embedding fetch, 10% embedding upsert, 10% ZADD to a label index
+
+Keys are zipfian (s = `zipf`, 0 is uniform) over the records loaded so far, scrambled so the hot keys aren't
+neighbours; d draws its zipf rank back from the newest insert instead. Inserts append new keys, as in YCSB.
+
+Adapted to what the server has: there is no range command, so a scan is 1-100 GETs of consecutive keys,
+timed as one operation. Vector search runs outside EntryManager (see vector_query_cache_benchmark), so the
+vector mix covers the engine side of it: `dim`-float embeddings stored as string values under "vec<n>",
+fetched and overwritten, plus score updates on 64 "labels<n>" sorted sets.
+
+Reports ops/s per workload and a latency histogram (p50/p99/p99.9/max in us) per operation type.
+
+usage: ycsb_benchmark [workloads=abcdefv] [threads=4] [records=100000] [seconds=5] [warmup=1]
+                      [value_size=100] [zipf=0.99] [dim=128]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+enum Op : size_t { Read, Update, Insert, Scan, ReadModifyWrite, VectorGet, VectorPut, LabelAdd, k_op_count };
+static constexpr std::string_view k_op_names[] = {"read", "update", "insert", "scan", "rmw",
+                                                  "vec_get", "vec_put", "label_zadd"};
+
+struct Workload {
+    char name;
+    std::string_view description;
+    std::vector<std::pair<Op, double>> mix;
+    bool latest = false;                // d: zipf rank counts back from the newest key
+};
+
+static const Workload k_workloads[] = {
+    {'a', "update heavy", {{Read, 50}, {Update, 50}}},
+    {'b', "read mostly", {{Read, 95}, {Update, 5}}},
+    {'c', "read only", {{Read, 100}}},
+    {'d', "read latest", {{Read, 95}, {Insert, 5}}, true},
+    {'e', "short ranges", {{Scan, 95}, {Insert, 5}}},
+    {'f', "read-modify-write", {{Read, 50}, {ReadModifyWrite, 50}}},
+    {'v', "vector mix", {{VectorGet, 80}, {VectorPut, 10}, {LabelAdd, 10}}},
+};
+
+// inverse-CDF Zipf over [0, n)
+class Zipf {
+public:
+    Zipf(size_t n, double s) : cdf_(n) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    template<typename Rng>
+    uint64_t next(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return static_cast<uint64_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+struct Config {
+    size_t threads;
+    uint64_t records;
+    double seconds;
+    double warmup;
+    size_t value_size;
+    double zipf;
+    size_t dim;
+};
+
+// the data every thread shares
+struct Store {
+    EntryManager db;
+    std::atomic<uint64_t> keys{0};      // "user0" .. "user<keys-1>" exist
+    std::string values;                 // values are slices of this
+    std::string embeddings;
+};
+
+struct ThreadResult {
+    std::array<LatencyHistogram, k_op_count> latency;
+    uint64_t ops = 0;
+    uint64_t errors = 0;
+};
+
+static bool run(Store& store, std::vector<std::string>& args) {
+    std::vector<uint8_t> response;
+    CommandProcessor::process_command({args, response, store.db});
+    return response.empty() || response[0] != static_cast<uint8_t>(SerializationType::Error);
+}
+
+static void worker(const Config& cfg, const Workload& w, const Zipf& zipf, Store& store, size_t index,
+                   Clock::time_point measure_from, Clock::time_point end, ThreadResult& result) {
+    std::mt19937_64 rng(index * 7919 + static_cast<uint64_t>(w.name));
+    std::vector<double> cumulative;
+    double total = 0;
+    for (const auto& [op, weight] : w.mix) cumulative.push_back(total += weight);
+    std::vector<std::string> args;
+    args.reserve(4);
+
+    auto value = [&](size_t len, const std::string& pool) {
+        return pool.substr(rng() % (pool.size() - len + 1), len);
+    };
+    // zipf rank -> record, spread over the keys loaded so far
+    auto choose = [&]() -> uint64_t {
+        uint64_t n = store.keys.load(std::memory_order_relaxed);
+        uint64_t rank = zipf.next(rng) % n;
+        return w.latest ? n - 1 - rank : (rank * 0x9E3779B97F4A7C15ull) % n;
+    };
+    auto user = [](uint64_t k) { return "user" + std::to_string(k); };
+
+    while (true) {
+        auto t0 = Clock::now();
+        if (t0 >= end) break;
+        double pick = std::uniform_real_distribution<double>(0, cumulative.back())(rng);
+        Op op = w.mix[static_cast<size_t>(std::upper_bound(cumulative.begin(), cumulative.end(), pick) -
+                                          cumulative.begin())].first;
+        bool ok = true;
+        switch (op) {
+        case Read:
+            args = {"GET", user(choose())};
+            ok = run(store, args);
+            break;
+        case Update:
+            args = {"SET", user(choose()), value(cfg.value_size, store.values)};
+            ok = run(store, args);
+            break;
+        case Insert:
+            args = {"SET", user(store.keys.load(std::memory_order_relaxed)), value(cfg.value_size, store.values)};
+            ok = run(store, args);
+            store.keys.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case Scan: {
+            uint64_t first = choose();
+            uint64_t len = 1 + rng() % 100;
+            uint64_t n = store.keys.load(std::memory_order_relaxed);
+            for (uint64_t k = first; k < std::min(first + len, n) && ok; ++k) {
+                args = {"GET", user(k)};
+                ok = run(store, args);
+            }
+            break;
+        }
+        case ReadModifyWrite: {
+            std::string key = user(choose());
+            args = {"GET", key};
+            ok = run(store, args);
+            args = {"SET", key, value(cfg.value_size, store.values)};
+            ok = run(store, args) && ok;
+            break;
+        }
+        case VectorGet:
+            args = {"GET", "vec" + std::to_string(choose())};
+            ok = run(store, args);
+            break;
+        case VectorPut:
+            args = {"SET", "vec" + std::to_string(choose()), value(cfg.dim * sizeof(float), store.embeddings)};
+            ok = run(store, args);
+            break;
+        case LabelAdd: {
+            uint64_t k = choose();
+            args = {"ZADD", "labels" + std::to_string(k % 64), std::to_string(rng() % 1000000), "vec" + std::to_string(k)};
+            ok = run(store, args);
+            break;
+        }
+        default:
+            break;
+        }
+        auto t1 = Clock::now();
+        if (t0 < measure_from) continue;
+        result.latency[op].record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        ++result.ops;
+        result.errors += !ok;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string workloads = argc > 1 ? argv[1] : "abcdefv";
+    Config cfg{
+        .threads = std::max<size_t>(1, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4),
+        .records = std::max<uint64_t>(1, argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000),
+        .seconds = argc > 4 ? std::atof(argv[4]) : 5,
+        .warmup = argc > 5 ? std::atof(argv[5]) : 1,
+        .value_size = std::max<size_t>(1, argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 100),
+        .zipf = argc > 7 ? std::atof(argv[7]) : 0.99,
+        .dim = std::max<size_t>(1, argc > 8 ? std::strtoull(argv[8], nullptr, 10) : 128),
+    };
+
+    Store store;
+    std::mt19937_64 rng(42);
+    store.values.resize(std::max<size_t>(cfg.value_size * 4, 4096));
+    for (auto& c : store.values) c = static_cast<char>('a' + rng() % 26);
+    store.embeddings.resize(cfg.dim * sizeof(float) * 4);
+    for (size_t i = 0; i + sizeof(float) <= store.embeddings.size(); i += sizeof(float)) {
+        float f = std::uniform_real_distribution<float>(-1, 1)(rng);
+        std::memcpy(store.embeddings.data() + i, &f, sizeof(float));
+    }
+
+    // load phase: single threaded, not measured
+    auto load_start = Clock::now();
+    bool vectors = workloads.find('v') != std::string::npos;
+    std::vector<std::string> args;
+    for (uint64_t k = 0; k < cfg.records; ++k) {
+        args = {"SET", "user" + std::to_string(k), store.values.substr(rng() % (store.values.size() - cfg.value_size + 1), cfg.value_size)};
+        run(store, args);
+        if (vectors) {
+            args = {"SET", "vec" + std::to_string(k), store.embeddings.substr(rng() % (store.embeddings.size() / 4), cfg.dim * sizeof(float))};
+            run(store, args);
+        }
+    }
+    store.keys = cfg.records;
+    std::cout << "records=" << cfg.records << " value_size=" << cfg.value_size << " threads=" << cfg.threads
+              << " zipf=" << cfg.zipf << " warmup=" << cfg.warmup << "s seconds=" << cfg.seconds << "s loaded in "
+              << std::fixed << std::setprecision(2) << std::chrono::duration<double>(Clock::now() - load_start).count()
+              << "s\n";
+
+    // ranks cover the initial records; inserted keys are reached through the modulo in choose()
+    Zipf zipf(cfg.records, cfg.zipf);
+    for (char name : workloads) {
+        auto w = std::find_if(std::begin(k_workloads), std::end(k_workloads), [&](const Workload& x) { return x.name == name; });
+        if (w == std::end(k_workloads)) {
+            std::cerr << "unknown workload '" << name << "'\n";
+            return 2;
+        }
+
+        std::vector<std::unique_ptr<ThreadResult>> results;
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        auto measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.warmup));
+        auto end = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.seconds));
+        for (size_t t = 0; t < cfg.threads; ++t) {
+            results.push_back(std::make_unique<ThreadResult>());
+            threads.emplace_back(worker, std::cref(cfg), std::cref(*w), std::cref(zipf), std::ref(store), t,
+                                 measure_from, end, std::ref(*results.back()));
+        }
+        for (auto& t : threads) t.join();
+
+        uint64_t ops = 0, errors = 0;
+        std::array<LatencyHistogram::Snapshot, k_op_count> latency;
+        for (const auto& r : results) {
+            ops += r->ops;
+            errors += r->errors;
+            for (size_t op = 0; op < k_op_count; ++op) latency[op].add(r->latency[op]);
+        }
+        std::cout << "\nworkload " << w->name << " (" << w->description << ")  " << std::setprecision(0)
+                  << static_cast<double>(ops) / cfg.seconds << " ops/s";
+        if (errors) std::cout << "  errors=" << errors;
+        std::cout << "\n";
+        for (size_t op = 0; op < k_op_count; ++op) {
+            const auto& h = latency[op];
+            if (h.calls == 0) continue;
+            auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+            std::cout << "  " << std::left << std::setw(11) << k_op_names[op] << std::right << " calls=" << std::setw(9)
+                      << h.calls << std::setprecision(2) << "  p50=" << us(h.quantile(0.5)) << "us  p99="
+                      << us(h.quantile(0.99)) << "us  p99.9=" << us(h.quantile(0.999)) << "us  max=" << us(h.max)
+                      << "us\n";
+        }
+    }
+    return 0;
+}